@@ -0,0 +1,100 @@
+#include "CSVTable.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <optional>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace m2;
+
+// Resident set size of this process, from /proc/self/statm
+static long rss_mb()
+{
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+template <typename F>
+static long time_ms(F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+// Builds, copies, slices and frees a table, reporting the time and memory of each step
+static void run(const std::string &filename, size_t num_rows, CSVTable::StorageMode mode)
+{
+    malloc_trim(0); // Return memory freed by the previous run, so it is not counted as reused here
+    long base = rss_mb();
+    std::optional<CSVTable> table, copy, half;
+
+    long read_ms = time_ms([&]
+                           { table.emplace(filename, mode); });
+    long table_mb = rss_mb() - base;
+
+    long copy_ms = time_ms([&]
+                           { copy.emplace(*table); });
+    long copy_mb = rss_mb() - base - table_mb;
+
+    std::vector<int> even_rows;
+    for (size_t i = 0; i < num_rows; i += 2)
+    {
+        even_rows.push_back(static_cast<int>(i));
+    }
+    long sub_ms = time_ms([&]
+                          { half.emplace(table->sub_table(even_rows)); });
+
+    long free_ms = time_ms([&]
+                           {
+                               half.reset();
+                               copy.reset();
+                               table.reset(); });
+
+    std::cout << "  read_file:  " << read_ms << "ms (" << table_mb << "MB)" << std::endl;
+    std::cout << "  copy:       " << copy_ms << "ms (+" << copy_mb << "MB)" << std::endl;
+    std::cout << "  sub_table:  " << sub_ms << "ms" << std::endl;
+    std::cout << "  teardown:   " << free_ms << "ms\n" << std::endl;
+}
+
+int main()
+{
+    std::cout << "=== CSVTable Allocation Performance Test ===\n" << std::endl;
+
+    // Strings longer than the small-string buffer, so each one needs its own allocation as a std::string
+    const size_t num_rows = 2000000;
+    const std::string filename = "allocation_perf_test.csv";
+    std::cout << "Writing " << num_rows << " rows to " << filename << "..." << std::endl;
+    {
+        std::ofstream file(filename);
+        file << "id,account,note\n";
+        for (size_t i = 0; i < num_rows; ++i)
+        {
+            file << i << ",ACCT-" << (i * 7919) % 1000003 << "-XNAS-0001,order note number " << i << "\n";
+        }
+    }
+    std::cout << std::endl;
+
+    // Row storage: one vector per row plus one std::string per long string
+    std::cout << "Test 1: Row storage" << std::endl;
+    run(filename, num_rows, CSVTable::StorageMode::Row);
+
+    // Columnar storage: typed buffers, with string characters in shared arena blocks
+    std::cout << "Test 2: Columnar storage" << std::endl;
+    run(filename, num_rows, CSVTable::StorageMode::Columnar);
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "Peak RSS: " << usage.ru_maxrss / 1024 << "MB" << std::endl;
+
+    std::filesystem::remove(filename);
+    std::cout << "\n=== Test Complete ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,501 @@
+#include "CSVTable.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <sys/resource.h>
+#include <thread>
+
+using namespace m2;
+
+// Benchmark suite: generates a deterministic table, times the main CSVTable operations on it and prints
+// one JSON document with rows/sec, bytes/sec and peak RSS per operation. Passing the JSON of an earlier
+// run as --baseline reports operations that got slower, so releases of the header can be compared.
+//
+//   benchmarks [--rows N] [--columns int:2,double:2,string:2,bool:1] [--cardinality K] [--seed S]
+//              [--storage row|columnar] [--threads T] [--repeat R] [--only name,...] [--label text]
+//              [--out file.json] [--baseline file.json] [--tolerance 0.10]
+
+struct Options
+{
+    size_t rows = 1000000;
+    std::string columns = "int:2,double:2,string:2,bool:1";
+    size_t cardinality = 1000;
+    uint64_t seed = 42;
+    CSVTable::StorageMode storage = CSVTable::StorageMode::Columnar;
+    size_t threads = 1;
+    size_t repeat = 3;
+    std::vector<std::string> only;
+    std::string label;
+    std::string out;
+    std::string baseline;
+    double tolerance = 0.10;
+};
+
+struct Result
+{
+    std::string name;
+    size_t rows = 0;
+    size_t bytes = 0;
+    double min_seconds = 0;
+    double median_seconds = 0;
+    long peak_rss_kb = 0;
+};
+
+static std::vector<std::string> split(const std::string &text, char separator)
+{
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    for (std::string part; std::getline(stream, part, separator);)
+    {
+        if (!part.empty())
+        {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+static Options parse_options(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc)
+        {
+            throw std::invalid_argument("Missing value for " + flag);
+        }
+        const std::string value = argv[++i];
+        if (flag == "--rows")
+            options.rows = std::stoull(value);
+        else if (flag == "--columns")
+            options.columns = value;
+        else if (flag == "--cardinality")
+            options.cardinality = std::max<size_t>(1, std::stoull(value));
+        else if (flag == "--seed")
+            options.seed = std::stoull(value);
+        else if (flag == "--storage")
+            options.storage = value == "row" ? CSVTable::StorageMode::Row : CSVTable::StorageMode::Columnar;
+        else if (flag == "--threads")
+            options.threads = std::stoull(value);
+        else if (flag == "--repeat")
+            options.repeat = std::max<size_t>(1, std::stoull(value));
+        else if (flag == "--only")
+            options.only = split(value, ',');
+        else if (flag == "--label")
+            options.label = value;
+        else if (flag == "--out")
+            options.out = value;
+        else if (flag == "--baseline")
+            options.baseline = value;
+        else if (flag == "--tolerance")
+            options.tolerance = std::stod(value);
+        else
+            throw std::invalid_argument("Unknown option: " + flag);
+    }
+    return options;
+}
+
+// Peak resident set size since the last reset_peak_rss(), from /proc/self/status (VmHWM)
+static long peak_rss_kb()
+{
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);)
+    {
+        if (line.starts_with("VmHWM:"))
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Resets the kernel's peak RSS counter, so each benchmark reports its own peak (Linux 4.0+)
+static void reset_peak_rss()
+{
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+// Keeps a result alive, so the compiler cannot drop the computation that produced it (GCC and Clang)
+template <typename T>
+static void keep(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// The generated table: int "id" (a permutation of 0..rows-1), int "key" (cardinality distinct values)
+// and the columns of the type mix, filled from a seeded generator so every run sees the same data
+struct Dataset
+{
+    CSVTable table;
+    std::map<std::string, size_t> column_bytes; // Approximate in-memory size of each column
+    std::string first_int, first_double, first_string;
+};
+
+static Dataset generate(const Options &options)
+{
+    std::mt19937_64 rng(options.seed);
+    const size_t n = options.rows;
+    Dataset data;
+
+    std::vector<int> ids(n);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::shuffle(ids.begin(), ids.end(), rng);
+    std::vector<int> keys(n);
+    for (auto &key : keys)
+        key = static_cast<int>(rng() % options.cardinality);
+
+    std::vector<std::vector<int>> ints;
+    std::vector<std::vector<double>> doubles;
+    std::vector<std::vector<std::string>> strings;
+    std::vector<std::unique_ptr<bool[]>> bools;
+    std::vector<std::string> names = {"id", "key"};
+    std::vector<CSVTable::ColumnSpan> spans;
+    data.column_bytes["id"] = data.column_bytes["key"] = n * sizeof(int);
+
+    for (const std::string &entry : split(options.columns, ','))
+    {
+        const auto colon = entry.find(':');
+        const std::string type = entry.substr(0, colon);
+        const size_t count = colon == std::string::npos ? 1 : std::stoull(entry.substr(colon + 1));
+        for (size_t c = 0; c < count; ++c)
+        {
+            const std::string name = type + "_" + std::to_string(c);
+            names.push_back(name);
+            if (type == "int")
+            {
+                auto &values = ints.emplace_back(n);
+                for (auto &v : values)
+                    v = static_cast<int>(rng() % 1000000);
+                data.column_bytes[name] = n * sizeof(int);
+                if (data.first_int.empty())
+                    data.first_int = name;
+            }
+            else if (type == "double")
+            {
+                std::uniform_real_distribution<double> uniform(0.0, 1000.0);
+                auto &values = doubles.emplace_back(n);
+                for (auto &v : values)
+                    v = uniform(rng);
+                data.column_bytes[name] = n * sizeof(double);
+                if (data.first_double.empty())
+                    data.first_double = name;
+            }
+            else if (type == "string")
+            {
+                auto &values = strings.emplace_back(n);
+                size_t bytes = 0;
+                for (auto &v : values)
+                {
+                    v = "value-" + std::to_string(rng() % options.cardinality);
+                    bytes += v.size();
+                }
+                data.column_bytes[name] = bytes;
+                if (data.first_string.empty())
+                    data.first_string = name;
+            }
+            else if (type == "bool")
+            {
+                auto &values = bools.emplace_back(new bool[n]);
+                for (size_t r = 0; r < n; ++r)
+                    values[r] = rng() & 1;
+                data.column_bytes[name] = n;
+            }
+            else
+            {
+                throw std::invalid_argument("Unknown column type: " + type);
+            }
+        }
+    }
+
+    // The spans are taken after all columns exist, as the vectors above may reallocate while they grow
+    spans.push_back(std::span<const int>(ids));
+    spans.push_back(std::span<const int>(keys));
+    size_t next_int = 0, next_double = 0, next_string = 0, next_bool = 0;
+    for (size_t c = 2; c < names.size(); ++c)
+    {
+        if (names[c].starts_with("int_"))
+            spans.push_back(std::span<const int>(ints[next_int++]));
+        else if (names[c].starts_with("double_"))
+            spans.push_back(std::span<const double>(doubles[next_double++]));
+        else if (names[c].starts_with("string_"))
+            spans.push_back(std::span<const std::string>(strings[next_string++]));
+        else
+            spans.push_back(std::span<const bool>(bools[next_bool++].get(), n));
+    }
+
+    data.table.set_storage_mode(options.storage);
+    for (const auto &name : names)
+    {
+        if (name == "id" || name == "key" || name.starts_with("int_"))
+            data.table.add_column<int>(name);
+        else if (name.starts_with("double_"))
+            data.table.add_column<double>(name);
+        else if (name.starts_with("string_"))
+            data.table.add_column<std::string>(name);
+        else
+            data.table.add_column<bool>(name);
+    }
+    data.table.reserve(n);
+    data.table.append_columns(spans);
+    return data;
+}
+
+// Sum of the approximate sizes of the named columns
+static size_t bytes_of(const Dataset &data, const std::vector<std::string> &names)
+{
+    size_t total = 0;
+    for (const auto &name : names)
+    {
+        auto it = data.column_bytes.find(name);
+        total += it == data.column_bytes.end() ? 0 : it->second;
+    }
+    return total;
+}
+
+struct Benchmark
+{
+    std::string name;
+    size_t rows;
+    std::function<size_t()> bytes;  // Bytes processed, evaluated after the first run (file sizes are known then)
+    std::function<void()> setup;    // Untimed preparation before each run, e.g. copying the table
+    std::function<void()> run;
+};
+
+static Result measure(const Benchmark &benchmark, size_t repeat)
+{
+    std::vector<double> seconds;
+    reset_peak_rss();
+    for (size_t i = 0; i < repeat; ++i)
+    {
+        if (benchmark.setup)
+            benchmark.setup();
+        auto start = std::chrono::steady_clock::now();
+        benchmark.run();
+        auto end = std::chrono::steady_clock::now();
+        seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    std::sort(seconds.begin(), seconds.end());
+    seconds.front() = std::max(seconds.front(), 1e-9);
+    return {benchmark.name, benchmark.rows, benchmark.bytes(), seconds.front(), seconds[seconds.size() / 2], peak_rss_kb()};
+}
+
+static std::string json_string(std::string_view text)
+{
+    std::string out = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void write_json(std::ostream &os, const Options &options, const std::vector<Result> &results)
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    os << "{\n";
+    os << "  \"suite\": \"csv-table\",\n";
+    os << "  \"label\": " << json_string(options.label) << ",\n";
+    os << "  \"compiler\": " << json_string(__VERSION__) << ",\n";
+    os << "  \"rows\": " << options.rows << ",\n";
+    os << "  \"columns\": " << json_string(options.columns) << ",\n";
+    os << "  \"cardinality\": " << options.cardinality << ",\n";
+    os << "  \"seed\": " << options.seed << ",\n";
+    os << "  \"storage\": \"" << (options.storage == CSVTable::StorageMode::Row ? "row" : "columnar") << "\",\n";
+    os << "  \"threads\": " << options.threads << ",\n";
+    os << "  \"repeat\": " << options.repeat << ",\n";
+    os << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        // One result per line, which read_baseline relies on
+        os << "    {\"name\": " << json_string(r.name) << ", \"rows\": " << r.rows << ", \"bytes\": " << r.bytes
+           << ", \"min_seconds\": " << r.min_seconds << ", \"median_seconds\": " << r.median_seconds
+           << ", \"rows_per_sec\": " << static_cast<uint64_t>(r.rows / r.min_seconds)
+           << ", \"bytes_per_sec\": " << static_cast<uint64_t>(r.bytes / r.min_seconds)
+           << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+// Reads name -> rows_per_sec from a file written by write_json (not a general JSON parser)
+static std::map<std::string, double> read_baseline(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open baseline: " + filename);
+    }
+    std::map<std::string, double> rates;
+    for (std::string line; std::getline(file, line);)
+    {
+        const auto name = line.find("{\"name\": \"");
+        const auto rate = line.find("\"rows_per_sec\": ");
+        if (name == std::string::npos || rate == std::string::npos)
+            continue;
+        const auto begin = name + std::strlen("{\"name\": \"");
+        rates[line.substr(begin, line.find('"', begin) - begin)] = std::stod(line.substr(rate + std::strlen("\"rows_per_sec\": ")));
+    }
+    return rates;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\nSee the top of Benchmarks.cpp for the options." << std::endl;
+        return 2;
+    }
+
+    std::cerr << "Generating " << options.rows << " rows (" << options.columns << ")..." << std::endl;
+    Dataset data = generate(options);
+    const CSVTable &table = data.table;
+    const size_t n = options.rows;
+    const std::string csv = "benchmark_data.csv";
+    const std::string parquet = "benchmark_data.parquet";
+    auto file_size = [](const std::string &path)
+    { return [path]
+      { return static_cast<size_t>(std::filesystem::file_size(path)); }; };
+    auto all_bytes = [&]
+    { return bytes_of(data, table.get_col_names()); };
+
+    // Dimension table for merge: one row per key
+    CSVTable dimension;
+    dimension.set_storage_mode(options.storage);
+    dimension.add_column<int>("key");
+    dimension.add_column<double>("weight");
+    {
+        std::vector<int> keys(options.cardinality);
+        std::vector<double> weights(options.cardinality);
+        for (size_t k = 0; k < keys.size(); ++k)
+        {
+            keys[k] = static_cast<int>(k);
+            weights[k] = 0.5 + static_cast<double>(k % 7);
+        }
+        dimension.append_columns({std::span<const int>(keys), std::span<const double>(weights)});
+    }
+
+    std::optional<CSVTable> work; // Scratch table for in-place operations and reads
+    auto copy_table = [&]
+    { work.emplace(table); };
+    auto empty_table = [&]
+    {
+        work.emplace();
+        work->set_storage_mode(options.storage);
+    };
+
+    std::vector<Benchmark> benchmarks;
+    benchmarks.push_back({"save_to_file", n, file_size(csv), nullptr, [&]
+                          { table.save_to_file(csv, false, options.threads); }});
+    benchmarks.push_back({"read_file", n, file_size(csv), empty_table, [&]
+                          { work->read_file(csv, options.threads); }});
+    benchmarks.push_back({"save_to_parquet", n, file_size(parquet), nullptr, [&]
+                          { table.save_to_parquet(parquet); }});
+    benchmarks.push_back({"read_parquet", n, file_size(parquet), empty_table, [&]
+                          { work->read_parquet(parquet, options.threads); }});
+    if (!data.first_double.empty())
+    {
+        const std::string &col = data.first_double;
+        const auto filter = CSVTable::Filter(col, CSVTable::CompareOp::Gt, 500.0) &&
+                            CSVTable::Filter("key", CSVTable::CompareOp::Lt, static_cast<int>(options.cardinality / 2));
+        benchmarks.push_back({"select", n, [&, col]
+                              { return bytes_of(data, {col, "key"}); }, nullptr, [&, filter]
+                              { keep(table.select(filter)); }});
+        benchmarks.push_back({"filter_table", n, [&, col]
+                              { return bytes_of(data, {col, "key"}); }, nullptr, [&, filter]
+                              { keep(table.filter_table(filter)); }});
+        benchmarks.push_back({"filter_in_place", n, all_bytes, copy_table, [&, filter]
+                              { work->filter_in_place(table.select(filter)); }});
+        benchmarks.push_back({"mean", n, [&, col]
+                              { return bytes_of(data, {col}); }, nullptr, [&, col]
+                              { keep(table.mean(col)); }});
+        benchmarks.push_back({"standard_deviation", n, [&, col]
+                              { return bytes_of(data, {col}); }, nullptr, [&, col]
+                              { keep(table.standard_deviation(col)); }});
+        benchmarks.push_back({"median", n, [&, col]
+                              { return bytes_of(data, {col}); }, nullptr, [&, col]
+                              { keep(table.median(col)); }});
+        benchmarks.push_back({"describe", n, all_bytes, nullptr, [&]
+                              { keep(table.describe(options.threads)); }});
+    }
+    if (!data.first_int.empty())
+    {
+        benchmarks.push_back({"sort_by_column", n, all_bytes, copy_table, [&]
+                              { work->sort_by_column<int>(data.first_int, true, false, options.threads); }});
+    }
+    if (!data.first_string.empty())
+    {
+        benchmarks.push_back({"sort_by_columns", n, all_bytes, copy_table, [&]
+                              { work->sort_by_columns({{data.first_string, true}, {"id", false}}, options.threads); }});
+    }
+    benchmarks.push_back({"merge", n, all_bytes, nullptr, [&]
+                          { keep(table.merge(dimension, {"key"}, "inner", options.threads)); }});
+    benchmarks.push_back({"drop_duplicates", n, all_bytes, copy_table, [&]
+                          { work->drop_duplicates({"key"}, "first", options.threads); }});
+
+    std::vector<Result> results;
+    for (const auto &benchmark : benchmarks)
+    {
+        // The reads need the files the writes produce, so writes always run
+        const bool writer = benchmark.name.starts_with("save_to");
+        if (!options.only.empty() && !writer && !std::ranges::contains(options.only, benchmark.name))
+            continue;
+        std::cerr << "Running " << benchmark.name << "..." << std::endl;
+        Result result = measure(benchmark, options.repeat);
+        work.reset();
+        if (options.only.empty() || std::ranges::contains(options.only, benchmark.name))
+            results.push_back(std::move(result));
+    }
+    std::filesystem::remove(csv);
+    std::filesystem::remove(parquet);
+
+    if (options.out.empty())
+    {
+        write_json(std::cout, options, results);
+    }
+    else
+    {
+        std::ofstream out(options.out);
+        write_json(out, options, results);
+    }
+
+    if (options.baseline.empty())
+    {
+        return 0;
+    }
+    // A benchmark regresses when its throughput drops by more than the tolerance
+    const auto baseline = read_baseline(options.baseline);
+    bool regressed = false;
+    for (const Result &r : results)
+    {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0)
+            continue;
+        const double ratio = (r.rows / r.min_seconds) / it->second;
+        const bool slower = ratio < 1.0 - options.tolerance;
+        regressed = regressed || slower;
+        std::cerr << (slower ? "REGRESSION " : "ok         ") << r.name << ": " << static_cast<int>(ratio * 100.0)
+                  << "% of baseline throughput" << std::endl;
+    }
+    return regressed ? 1 : 0;
+}
@@ -15,12 +15,35 @@
 #include <stdexcept>
 #include <sstream>
 #include <algorithm>
+#include <bit>
+#include <numeric>
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
 #include <iomanip>
 #include <cmath> // Added for std::floor
 #include <chrono> // For progress reporting
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <compare>
+#include <utility>
+#include <array>
+#include <span>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define M2_CSV_HAS_MMAP 1
+#else
+#define M2_CSV_HAS_MMAP 0
+#endif
 
 // Apache Arrow and Parquet includes
 #include <arrow/api.h>
@@ -70,2391 +93,11524 @@ namespace m2
     };
 
     /**
-     * @brief Concept to ensure a type can be stored in CellValue.
-     */
-    template <typename T>
-    concept ConvertibleToCellValue = std::same_as<T, std::string> ||
-                                     std::same_as<T, int> ||
-                                     std::same_as<T, double> ||
-                                     std::same_as<T, bool> ||
-                                     std::same_as<T, uint64_t>;
-
-    /**
-     * @brief A class to read, manipulate, and write CSV files with column name and row index access.
-     *
-     * This class reads a CSV file where the first row contains column names, stores values using std::variant for type safety,
-     * and supports accessing/assigning values by row index and column name. It leverages C++23 features like std::optional,
-     * std::string_view, and ranges for improved performance and clarity.
+     * @brief Sequential CSV record reader over a file, memory-mapped where the platform supports it.
      *
-     * @note Dependencies: Requires C++23 (compile with -std=c++23).
-     * @note Error Handling: Functions throw exceptions for invalid inputs, type mismatches, or file errors.
+     * Records are returned as string_views into the mapping (or into an internal block buffer
+     * when mmap is unavailable), with the trailing newline and any carriage return removed.
+     * A newline inside a double-quoted field does not end a record. As in split_fields, only a quote at
+     * the start of a field opens a quoted field; quotes elsewhere are plain text. A returned record stays
+     * valid until the next call to next_record(). Pages that have already been consumed are
+     * released back to the OS, so reading a large file does not keep the whole file resident.
      */
-    class CSVTable
+    class CSVRecordReader
     {
     public:
-        using CellValue = std::variant<std::string, int, double, bool, uint64_t>;
-
         /**
-         * @brief Assigner class for setting cell values.
+         * @brief Opens a file for record-by-record reading.
+         * @param path The path to the file.
+         * @param use_mmap If false, always use buffered block reads instead of mmap.
+         * @param block_size The read size used by the buffered fallback.
          */
-        struct CellAssigner
+        explicit CSVRecordReader(const std::string &path, bool use_mmap = true, size_t block_size = 1 << 20)
+            : block_size(std::max<size_t>(block_size, 1))
         {
-            CSVTable &table;
-            int row_index;
-            int col_index;
-
-            CellAssigner(CSVTable &t, int ri, int ci) : table(t), row_index(ri), col_index(ci) {}
-
-            /**
-             * @brief Assigns a value to the cell.
-             * @tparam T The type of the value to assign.
-             * @param value The value to set.
-             */
-            template <ConvertibleToCellValue T>
-            void operator=(const T &value)
+#if M2_CSV_HAS_MMAP
+            if (use_mmap && map_file(path))
             {
-                table.rows[row_index][col_index] = value;
+                return;
             }
+#else
+            (void)use_mmap;
+#endif
+            stream.open(path, std::ios::binary);
+            open = stream.is_open();
+        }
 
-            /**
-             * @brief Streams the cell value to an output stream.
-             * @param os The output stream.
-             * @param assigner The assigner object.
-             * @return std::ostream& The output stream.
-             */
-            friend std::ostream &operator<<(std::ostream &os, const CellAssigner &assigner)
+        ~CSVRecordReader()
+        {
+#if M2_CSV_HAS_MMAP
+            if (map_data != nullptr)
             {
-                if (assigner.row_index < 0 || static_cast<size_t>(assigner.row_index) >= assigner.table.rows.size() ||
-                    assigner.col_index < 0 || static_cast<size_t>(assigner.col_index) >= assigner.table.col_names.size())
-                {
-                    os << "Invalid cell";
-                }
-                else
-                {
-                    os << CSVTable::cell_to_string(assigner.table.rows[assigner.row_index][assigner.col_index]);
-                }
-                return os;
+                ::munmap(const_cast<char *>(map_data), map_size);
             }
-        };
+#endif
+        }
+
+        CSVRecordReader(const CSVRecordReader &) = delete;
+        CSVRecordReader &operator=(const CSVRecordReader &) = delete;
 
         /**
-         * @brief Proxy class for row-based indexing in the table.
+         * @brief Checks whether the file was opened successfully.
          */
-        struct CellProxy
-        {
-            CSVTable &table;
-            int row_index;
+        bool is_open() const { return open; }
 
-            CellProxy(CSVTable &t, int ri) : table(t), row_index(ri) {}
+        /**
+         * @brief Checks whether the file is being read through a memory mapping.
+         */
+        bool is_mapped() const { return map_data != nullptr; }
 
-            /**
-             * @brief Accesses a column in the row.
-             * @param col_name The name of the column.
-             * @return CellAssigner An assigner for the cell at the specified row and column.
-             * @throws std::out_of_range If the row index is invalid.
-             * @throws std::invalid_argument If the column name is not found.
-             */
-            CellAssigner operator[](std::string_view col_name)
+        /**
+         * @brief Reads the next record.
+         * @param record Receives a view of the record, without the line terminator.
+         * @return bool False once the end of the file has been reached.
+         */
+        bool next_record(std::string_view &record)
+        {
+            if (map_data != nullptr)
             {
-                if (row_index < 0 || static_cast<size_t>(row_index) >= table.rows.size())
-                {
-                    throw std::out_of_range("Row index out of range");
-                }
-                auto it = table.col_map.find(col_name);
-                if (it == table.col_map.end())
+                bool found = next_record(std::string_view(map_data, map_size), map_pos, record);
+#if M2_CSV_HAS_MMAP
+                if (map_pos - released >= release_interval)
                 {
-                    throw std::invalid_argument("Column name not found: " + std::string(col_name));
+                    release_consumed();
                 }
-                return CellAssigner(table, row_index, it->second);
+#endif
+                return found;
             }
-        };
+            return next_buffered_record(record);
+        }
 
         /**
-         * @brief Accesses a row in the table.
-         * @param row_index The index of the row.
-         * @return CellProxy A proxy for the specified row.
+         * @brief Returns the unread part of the file in one contiguous view.
+         *
+         * A mapped file is returned as is. Otherwise the rest of the stream is loaded into
+         * memory. The reader is exhausted afterwards.
          */
-        CellProxy operator[](int row_index)
+        std::string_view remaining()
         {
-            return CellProxy(*this, row_index);
+            if (map_data != nullptr)
+            {
+                std::string_view rest(map_data + map_pos, map_size - map_pos);
+                map_pos = map_size;
+                return rest;
+            }
+            buffer.erase(0, buffer_pos);
+            buffer_pos = 0;
+            if (stream.is_open() && !eof)
+            {
+                buffer.append(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+                eof = true;
+            }
+            buffer_pos = buffer.size();
+            return buffer;
         }
 
         /**
-         * @brief Converts a CellValue to its string representation.
-         * @param value The CellValue to convert.
-         * @return std::string The string representation of the value.
+         * @brief Reads the record starting at pos in an in-memory buffer.
+         * @param data The buffer holding one or more records.
+         * @param pos The offset of the record; advanced past its line terminator.
+         * @param record Receives a view of the record, without the line terminator.
+         * @return bool False if pos is at the end of data.
          */
-        static std::string cell_to_string(const CellValue &value)
+        static bool next_record(std::string_view data, size_t &pos, std::string_view &record)
         {
-            return std::visit([](const auto &v) -> std::string
-                              {
-                                  using T = std::decay_t<decltype(v)>;
-                                  if constexpr (std::is_same_v<T, std::string>)
-                                      return v;
-                                  else if constexpr (std::is_same_v<T, int>)
-                                      return std::to_string(v);
-                                  else if constexpr (std::is_same_v<T, double>)
-                                  {
-                                      double d = v;
-                                      if (d == std::floor(d))
-                                          return std::to_string(static_cast<int>(d)); // No .0 for whole numbers
-                                      std::ostringstream oss;
-                                      oss << std::fixed << std::setprecision(10) << v;
-                                      return oss.str();
-                                  }
-                                  else if constexpr (std::is_same_v<T, bool>)
-                                      return v ? "true" : "false";
-                                  else if constexpr (std::is_same_v<T, uint64_t>)
-                                      return std::to_string(v);
-                                  return "unknown"; },
-                              value);
+            if (pos >= data.size())
+            {
+                return false;
+            }
+            size_t newline = RecordScanner{}.find_end(data, pos);
+            size_t end = newline == std::string_view::npos ? data.size() : newline;
+            record = strip_cr(data.substr(pos, end - pos));
+            pos = end == data.size() ? end : end + 1;
+            return true;
         }
 
         /**
-         * @brief Parses a string to CellValue with type inference.
-         * @param str The string to parse.
-         * @return CellValue The parsed value.
+         * @brief Finds the offsets at which data can be split into chunks of whole records.
+         * @param data The buffer to split.
+         * @param chunk_size The target chunk size in bytes.
+         * @return std::vector<size_t> Chunk start offsets followed by data.size().
+         *
+         * Boundaries are placed at the first newline at or after each target offset that is
+         * not inside a quoted field, so every chunk can be parsed independently.
          */
-        static CellValue parse_cell(std::string_view str)
+        static std::vector<size_t> chunk_bounds(std::string_view data, size_t chunk_size)
         {
-            if (str.empty() || str == "NA" || str == "NaN" || str == "#N/A")
+            chunk_size = std::max<size_t>(chunk_size, 1);
+            std::vector<size_t> bounds{0};
+            size_t scan = 0;
+            while (scan < data.size())
             {
-                return std::string("");
+                // Step over whole records until one ends at or after the target offset
+                size_t target = std::min(data.size(), bounds.back() + chunk_size);
+                while (scan < target)
+                {
+                    size_t newline = RecordScanner{}.find_end(data, scan);
+                    scan = newline == std::string_view::npos ? data.size() : newline + 1;
+                }
+                if (scan < data.size())
+                {
+                    bounds.push_back(scan);
+                }
             }
-            if (str == "true")
-                return true;
-            if (str == "false")
-                return false;
-            try
+            bounds.push_back(data.size());
+            return bounds;
+        }
+
+    private:
+        bool open = false;
+        size_t block_size;
+
+        // mmap path
+        const char *map_data = nullptr;
+        size_t map_size = 0;
+        size_t map_pos = 0;
+        size_t released = 0;
+
+        // Buffered fallback
+        std::ifstream stream;
+        std::string buffer;
+        size_t buffer_pos = 0;
+        bool eof = false;
+
+        static constexpr size_t release_interval = size_t{64} << 20;
+
+        /**
+         * @brief Finds the newline that ends a record, keeping the quote state between calls so that a
+         * record can be scanned as more of it is read.
+         */
+        struct RecordScanner
+        {
+            enum class State { FieldStart, Unquoted, Quoted, QuoteInQuoted };
+            State state = State::FieldStart;
+
+            /**
+             * @brief Scans data from pos for the newline ending the current record.
+             * @return size_t The offset of the newline, or npos if data ends first.
+             */
+            size_t find_end(std::string_view data, size_t pos)
             {
-                size_t pos;
-                int i = std::stoi(std::string(str), &pos);
-                if (pos != str.size())
-                    throw std::invalid_argument("stoi did not consume entire string");
-                return i;
+                while (pos < data.size())
+                {
+                    switch (state)
+                    {
+                    case State::FieldStart:
+                        if (data[pos] == '"')
+                        {
+                            state = State::Quoted;
+                            ++pos;
+                        }
+                        else
+                        {
+                            state = State::Unquoted;
+                        }
+                        break;
+                    case State::Unquoted:
+                        pos = data.find_first_of(",\n", pos);
+                        if (pos == std::string_view::npos)
+                        {
+                            return pos;
+                        }
+                        state = State::FieldStart;
+                        if (data[pos] == '\n')
+                        {
+                            return pos;
+                        }
+                        ++pos;
+                        break;
+                    case State::Quoted:
+                        pos = data.find('"', pos);
+                        if (pos == std::string_view::npos)
+                        {
+                            return pos;
+                        }
+                        state = State::QuoteInQuoted;
+                        ++pos;
+                        break;
+                    case State::QuoteInQuoted:
+                        // A second quote is a "" escape; anything else closes the quoted field
+                        if (data[pos] == '"')
+                        {
+                            state = State::Quoted;
+                            ++pos;
+                        }
+                        else
+                        {
+                            state = State::Unquoted;
+                        }
+                        break;
+                    }
+                }
+                return std::string_view::npos;
             }
-            catch (...)
+        };
+
+        static std::string_view strip_cr(std::string_view record)
+        {
+            if (!record.empty() && record.back() == '\r')
             {
+                record.remove_suffix(1);
             }
-            try
+            return record;
+        }
+
+#if M2_CSV_HAS_MMAP
+        bool map_file(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
             {
-                size_t pos;
-                uint64_t u = std::stoull(std::string(str), &pos);
-                if (pos == str.size())
-                    return u;
+                return false;
             }
-            catch (...)
+            struct stat st{};
+            if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
             {
+                ::close(fd);
+                return false;
             }
-            try
+            if (st.st_size == 0)
             {
-                size_t pos;
-                double d = std::stod(std::string(str), &pos);
-                if (pos == str.size())
-                    return d;
+                ::close(fd);
+                open = true;
+                eof = true;
+                return true;
             }
-            catch (...)
+            void *addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (addr == MAP_FAILED)
             {
+                return false;
             }
-            return std::string(str);
+            ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            map_data = static_cast<const char *>(addr);
+            map_size = static_cast<size_t>(st.st_size);
+            open = true;
+            return true;
         }
 
-        /**
-         * @brief Converts a CellValue to type T, handling string conversions.
-         * @param value The CellValue to convert.
-         * @return T The converted value or default_value if conversion fails.
-         */
-        template <ConvertibleToCellValue T>
-        static T convert_cell(const CellValue &value)
+        void release_consumed()
         {
-            if (std::holds_alternative<T>(value))
+            static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            size_t end = map_pos / page * page;
+            if (end > released)
             {
-                return std::get<T>(value);
+                ::madvise(const_cast<char *>(map_data) + released, end - released, MADV_DONTNEED);
+                released = end;
             }
-            else if (std::holds_alternative<std::string>(value))
+        }
+#endif
+
+        bool next_buffered_record(std::string_view &record)
+        {
+            RecordScanner scanner;
+            size_t scan = buffer_pos;
+            while (true)
             {
-                auto str = std::get<std::string>(value);
-                if (str.empty() || str == "NA" || str == "NaN" || str == "#N/A")
-                {
-                    throw std::runtime_error("Cannot convert empty or NA string to type T");
-                }
-                if constexpr (std::is_same_v<T, int>)
-                {
-                    size_t pos;
-                    int result = std::stoi(str, &pos);
-                    if (pos != str.size())
-                        throw std::invalid_argument("stoi did not consume entire string");
-                    return result;
-                }
-                else if constexpr (std::is_same_v<T, double>)
+                size_t newline = scanner.find_end(buffer, scan);
+                if (newline != std::string::npos)
                 {
-                    return std::stod(str);
+                    record = strip_cr(std::string_view(buffer).substr(buffer_pos, newline - buffer_pos));
+                    buffer_pos = newline + 1;
+                    return true;
                 }
-                else if constexpr (std::is_same_v<T, bool>)
+                scan = buffer.size();
+                if (eof || !stream.is_open())
                 {
-                    if (str == "true")
-                        return true;
-                    if (str == "false")
-                        return false;
-                    if (str == "1")
+                    if (buffer_pos < buffer.size())
+                    {
+                        record = strip_cr(std::string_view(buffer).substr(buffer_pos));
+                        buffer_pos = buffer.size();
                         return true;
-                    if (str == "0")
-                        return false;
-                    throw std::runtime_error("Invalid boolean string: " + str);
-                }
-                else if constexpr (std::is_same_v<T, uint64_t>)
-                {
-                    return std::stoull(str);
-                }
-                else if constexpr (std::is_same_v<T, std::string>)
-                {
-                    return str;
-                }
-            }
-            if constexpr (std::is_same_v<T, double>)
-            {
-                if (std::holds_alternative<int>(value))
-                {
-                    return static_cast<double>(std::get<int>(value));
-                }
-                else if (std::holds_alternative<uint64_t>(value))
-                {
-                    return static_cast<double>(std::get<uint64_t>(value));
-                }
-            }
-            if constexpr (std::is_same_v<T, bool>)
-            {
-                if (std::holds_alternative<int>(value))
-                {
-                    return std::get<int>(value) != 0;
-                }
-                else if (std::holds_alternative<uint64_t>(value))
-                {
-                    return std::get<uint64_t>(value) != 0;
-                }
-            }
-            if constexpr (std::is_same_v<T, uint64_t>)
-            {
-                if (std::holds_alternative<int>(value))
-                {
-                    return static_cast<uint64_t>(std::get<int>(value));
+                    }
+                    return false;
                 }
-                else if (std::holds_alternative<double>(value))
+                // Keep the partial record and append the next block after it
+                buffer.erase(0, buffer_pos);
+                scan -= buffer_pos;
+                buffer_pos = 0;
+                size_t old_size = buffer.size();
+                buffer.resize(old_size + block_size);
+                stream.read(buffer.data() + old_size, static_cast<std::streamsize>(block_size));
+                buffer.resize(old_size + static_cast<size_t>(stream.gcount()));
+                if (!stream)
                 {
-                    return static_cast<uint64_t>(std::get<double>(value));
+                    eof = true;
                 }
             }
-            throw std::runtime_error("Type mismatch: Cannot convert CellValue to the requested type");
         }
+    };
 
-        /**
-         * @brief Applies a function to each value in a specified column, transforming the values in place.
-         *
-         * This method applies the provided function `func` to each value in the column specified by `col_name`.
-         * The column values are converted to type `T` if stored as strings, using a default value if conversion fails.
-         *
-         * @tparam T The type of the values in the column.
-         * @tparam Func The type of the function to apply.
-         * @param col_name The name of the column to transform.
-         * @param func The function to apply to each value.
-         * @throws std::invalid_argument If the column does not exist.
-         */
-        template <typename T, typename Func>
-        void apply_to_column(std::string_view col_name, Func func)
-        {
-            auto it = col_map.find(std::string(col_name));
-            if (it == col_map.end())
-            {
-                throw std::invalid_argument("Column not found: " + std::string(col_name));
-            }
-            int col_index = it->second;
-            for (auto &row : rows)
+    /**
+     * @brief Concept to ensure a type can be stored in CellValue.
+     */
+    template <typename T>
+    concept ConvertibleToCellValue = std::same_as<T, std::string> ||
+                                     std::same_as<T, int> ||
+                                     std::same_as<T, double> ||
+                                     std::same_as<T, bool> ||
+                                     std::same_as<T, uint64_t>;
+
+    /**
+     * @brief Concept for the CellValue types that typed expressions compute with (all but std::string).
+     */
+    template <typename T>
+    concept NumericCellValue = ConvertibleToCellValue<T> && !std::same_as<T, std::string>;
+
+    /**
+     * @brief Options for CSVTable::save_to_parquet and CSVTable::ParquetWriter.
+     */
+    struct ParquetWriteOptions
+    {
+        enum class Codec { Uncompressed, Snappy, Gzip, Zstd, Lz4 };
+
+        /// Maximum rows per row group; each row group is converted to Arrow and written on its own.
+        size_t row_group_size = 1 << 20;
+        Codec codec = Codec::Uncompressed;
+        /// Codec-specific compression level (e.g. 1-22 for ZSTD); unset uses the codec default.
+        std::optional<int> compression_level;
+        /// Enables dictionary encoding. String columns are dictionary-encoded only when their
+        /// distinct values are at most dictionary_max_ratio of their non-empty values.
+        bool dictionary = true;
+        double dictionary_max_ratio = 0.5;
+    };
+
+    /**
+     * @brief Thread count for row-wise CSVTable operations (filter_table_fast, filter_in_place, modify, apply_to_column).
+     *
+     * Thread-safety contract: under a parallel policy, user callbacks are invoked concurrently from
+     * several threads, each for a different row, and in no particular order. Predicates may only read
+     * the table through its const interface (get, get_col_names, ...). A modifier passed to modify may only
+     * write cells of the row it is called for. Any other state a callback shares must be synchronized by
+     * the caller. The first exception thrown by a callback is rethrown after the workers finish.
+     */
+    struct ExecutionPolicy
+    {
+        /// Worker threads; 0 ("auto") uses std::thread::hardware_concurrency(), 1 runs serially.
+        size_t num_threads = 1;
+
+        static ExecutionPolicy serial() { return ExecutionPolicy{1}; }
+        static ExecutionPolicy parallel(size_t num_threads = 0) { return ExecutionPolicy{num_threads}; }
+
+        /// The resolved thread count (at least 1).
+        size_t threads() const
+        {
+            return num_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : num_threads;
+        }
+    };
+
+    /**
+     * @brief Time spent in one phase of an operation, e.g. "tokenize", "parse" or "convert" for a CSV read.
+     */
+    struct PhaseTiming
+    {
+        std::string_view name;
+        std::chrono::nanoseconds time{};
+    };
+
+    /**
+     * @brief What an Observer is told about an operation.
+     *
+     * operation is "read_file", "read_file_batches", "read_parquet", "filter_table_fast" or "filter_in_place".
+     * The counters are totals since the operation started.
+     */
+    struct OperationEvent
+    {
+        std::string_view operation;
+        std::string_view source;            ///< The file read, or empty for filters
+        size_t rows = 0;                    ///< Rows processed so far
+        size_t total_rows = 0;              ///< Rows the operation will process, or 0 if not known in advance (CSV reads)
+        size_t matched = 0;                 ///< Filters: rows matched or kept so far
+        size_t bytes = 0;                   ///< Input bytes consumed so far (Parquet: the file size), or 0 if not tracked
+        std::chrono::nanoseconds elapsed{}; ///< Time since the operation started
+        std::span<const PhaseTiming> phases; ///< on_end only: time per phase ("read"/"convert" for Parquet, "snapshot" for a snapshot read_file loaded)
+    };
+
+    /**
+     * @brief Receives start, progress and end callbacks from CSVTable's long-running operations.
+     *
+     * Install one per table with CSVTable::set_observer, or for every table with CSVTable::set_default_observer;
+     * the default is a ProgressObserver on stderr. Progress arrives every 10,000 rows for CSV reads and every 1%
+     * otherwise. Callbacks of parallel operations are serialized but may run on any thread. on_end is not called
+     * when the operation throws.
+     *
+     * Defining M2_CSV_NO_OBSERVERS before including CSVTable.hpp removes every callback and timer.
+     */
+    class Observer
+    {
+    public:
+        virtual ~Observer() = default;
+
+        virtual void on_start(const OperationEvent &) {}
+        virtual void on_progress(const OperationEvent &) {}
+        virtual void on_end(const OperationEvent &) {}
+
+        /**
+         * @brief Whether a single-threaded read_file should time its tokenize, parse and convert phases.
+         * That costs three clock reads per row, so it is off unless an observer asks for it; parallel reads
+         * and Parquet reads always report their (coarser) phases.
+         */
+        virtual bool wants_phase_timings() const { return false; }
+    };
+
+    /**
+     * @brief The built-in observer: prints a "\r"-updated progress line per operation, e.g.
+     * "Reading Parquet: 42.0% (420000/1000000 rows, 950000 rows/sec)", to a stream (stderr by default).
+     */
+    class ProgressObserver : public Observer
+    {
+    public:
+        explicit ProgressObserver(std::ostream &os = std::cerr) : os_(os) {}
+
+        void on_progress(const OperationEvent &event) override
+        {
+            const double rows_per_sec = event.rows * 1000.0 / (milliseconds(event) + 1);
+            if (event.operation.starts_with("read_file"))
             {
-                try{
-                    T value = convert_cell<T>(row[col_index]);
-                    row[col_index] = func(value);
-                }
-                catch (const std::runtime_error &e)
-                {
-                    // conversion to type failed
-                    row[col_index] = func("");
-                }
+                os_ << "\rReading CSV: " << event.rows << " rows (" << std::fixed << std::setprecision(0)
+                    << rows_per_sec << " rows/sec)" << std::flush;
+                return;
+            }
+            const bool filter = event.operation.starts_with("filter");
+            os_ << "\r" << label(event) << ": " << std::fixed << std::setprecision(1)
+                << (event.total_rows ? event.rows * 100.0 / event.total_rows : 100.0) << "% (" << event.rows << "/"
+                << event.total_rows << " rows, ";
+            if (filter)
+                os_ << event.matched << (event.operation == "filter_in_place" ? " kept, " : " match, ");
+            os_ << std::setprecision(0) << rows_per_sec << " rows/sec)" << std::flush;
+        }
+
+        void on_end(const OperationEvent &event) override
+        {
+            if (event.operation.starts_with("read_file"))
+            {
+                if (event.rows > 0)
+                    os_ << "\rRead CSV: " << event.rows << " rows total" << std::string(20, ' ') << std::endl;
+                return;
             }
+            if (event.rows > 0 || event.operation == "read_parquet")
+                os_ << std::endl;
+        }
+
+    private:
+        std::ostream &os_;
+
+        static long long milliseconds(const OperationEvent &event)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(event.elapsed).count();
+        }
+
+        static std::string_view label(const OperationEvent &event)
+        {
+            if (event.operation == "read_parquet")
+                return "Reading Parquet";
+            return event.operation == "filter_in_place" ? "Filtering in-place" : "Filtering";
         }
+    };
+
+    /**
+     * @brief A class to read, manipulate, and write CSV files with column name and row index access.
+     *
+     * This class reads a CSV file where the first row contains column names, stores values using std::variant for type safety,
+     * and supports accessing/assigning values by row index and column name. It leverages C++23 features like std::optional,
+     * std::string_view, and ranges for improved performance and clarity.
+     *
+     * @note Dependencies: Requires C++23 (compile with -std=c++23).
+     * @note Error Handling: Functions throw exceptions for invalid inputs, type mismatches, or file errors.
+     */
+    class CSVTable
+    {
+        // Defined with the other private helpers; declared here for the members that take one
+        class OperationReporter;
+
+    public:
+        using CellValue = std::variant<std::string, int, double, bool, uint64_t>;
 
         /**
-         * @brief Constructor for an empty table.
+         * @brief Physical layout used to store the table's cells.
+         *
+         * Row keeps one std::vector<CellValue> per record (the default). Columnar keeps one typed
+         * buffer plus a validity bitmap per column, so column scans run over contiguous memory.
          */
-        CSVTable() = default;
+        enum class StorageMode { Row, Columnar };
 
         /**
-         * @brief Constructor to load a CSV file.
-         * @param filename The path to the CSV file.
-         * @throws std::runtime_error If the file cannot be opened or is empty.
+         * @brief Declared type of a column for schema-typed CSV reads.
+         *
+         * Infer keeps parse_cell type inference. Skip drops the column without converting or storing it.
+         * Categorical reads strings into a dictionary-encoded column in columnar storage (plain strings in
+         * row storage). The String..UInt64 values line up with Column::Type.
          */
-        CSVTable(std::string_view filename)
+        enum class ColumnType { Infer, String, Int, Double, Bool, UInt64, Skip, Categorical };
+
+        /**
+         * @brief Column name to declared type, as accepted by read_file(filename, schema).
+         */
+        using Schema = std::unordered_map<std::string, ColumnType, string_hash, string_equal>;
+
+        /**
+         * @brief Comparison operators for column predicates.
+         */
+        enum class CompareOp { Eq, Ne, Lt, Le, Gt, Ge };
+
+        /**
+         * @brief Compares a column against a constant, e.g. {"date", CompareOp::Ge, 20240101}.
+         *
+         * Numbers compare by value across int, double, bool and uint64_t; strings compare lexicographically.
+         * Missing cells and cells of the other kind (string vs number) never match.
+         */
+        struct ColumnPredicate
         {
-            read_file(filename);
-        }
+            std::string column;
+            CompareOp op;
+            CellValue value;
+        };
 
         /**
-         * @brief Constructor for sub-tables or copies.
-         * @param column_names The list of column names.
-         * @param column_map The mapping from column names to indices.
-         * @param selected_rows The selected rows of data.
+         * @brief Aggregate functions for GroupBy::agg.
          */
-        CSVTable(const std::vector<std::string> &column_names,
-                 const std::unordered_map<std::string, int, string_hash, string_equal> &column_map,
-                 const std::vector<std::vector<CellValue>> &selected_rows)
-            : col_names(column_names), col_map(column_map), rows(selected_rows) {}
+        enum class AggOp { Sum, Count, Mean, Min, Max, Std, Percentile };
 
+        /**
+         * @brief One aggregate of a group-by, e.g. {"price", AggOp::Mean} or {"price", AggOp::Percentile, 0.9}.
+         *
+         * Missing and NA cells are skipped. Count counts the non-missing cells, or the rows of the group when
+         * column is empty. Std is the sample standard deviation. The result column is named output_name, or
+         * "<column>_<op>" ("price_mean", "price_p90", "count") when that is empty.
+         */
+        struct Aggregation
+        {
+            std::string column;
+            AggOp op;
+            double percentile = 0.5;
+            std::string output_name = "";
+        };
 
         /**
-         * @brief A proxy class for accessing and modifying a cell value in a Row.
+         * @brief The window of add_rolling_column: the last `rows` rows, or the rows whose time_column value is
+         * in (t - span, t] for the current row's time t.
          *
-         * Allows reading and writing a cell value by reference, supporting type-safe
-         * assignments to the cell in the parent CSVTable.
+         * Set exactly one of rows and time_column (with a positive span). With partition_by, each value of that column has its own
+         * windows over its rows in table order. Results with fewer than min_periods non-missing values are missing.
          */
-        class CellAccess {
+        struct RollingWindow
+        {
+            size_t rows = 0;
+            std::string time_column = "";
+            uint64_t span = 0;
+            std::string partition_by = "";
+            size_t min_periods = 1;
+        };
+
+        /**
+         * @brief Kinds of secondary index for create_index: a hash of key → rows, or the rows in key order.
+         */
+        enum class IndexKind { Hash, Sorted };
+
+        /**
+         * @brief A declarative row filter: column predicates combined with && and ||.
+         *
+         * Column names are resolved once when the filter is evaluated by select(), and each predicate is
+         * evaluated over a whole column at a time, so no per-row callback or column lookup is involved.
+         * Example: Filter("value", CompareOp::Gt, 750000.0) && Filter("category", CompareOp::Eq, std::string("A"))
+         */
+        class Filter
+        {
         public:
-            /**
-             * @brief Constructs a CellAccess for a specific cell.
-             * @param table Pointer to the parent CSVTable.
-             * @param row_index The index of the row.
-             * @param col_index The index of the column.
-             */
-            CellAccess(CSVTable* table, size_t row_index, int col_index)
-                : table_(table), row_index_(row_index), col_index_(col_index) {}
+            Filter(ColumnPredicate predicate) : kind_(Kind::Predicate), predicate_(std::move(predicate)) {}
 
-            /**
-             * @brief Reads the cell value.
-             * @return CellValue The current value of the cell.
-             * @throws std::out_of_range If the row or column index is invalid.
-             */
-            operator CellValue() const {
-                if (row_index_ >= table_->rows.size()) {
-                    throw std::out_of_range("Row index out of range: " + std::to_string(row_index_));
-                }
-                if (col_index_ >= static_cast<int>(table_->rows[row_index_].size())) {
-                    throw std::out_of_range("Column index out of range: " + std::to_string(col_index_));
-                }
-                return table_->rows[row_index_][col_index_];
-            }
+            Filter(std::string column, CompareOp op, CellValue value)
+                : kind_(Kind::Predicate), predicate_{std::move(column), op, std::move(value)} {}
 
-            /**
-             * @brief Assigns a new value to the cell.
-             * @tparam T The type of the value to assign (must be convertible to CellValue).
-             * @param value The value to set.
-             * @return CellAccess& Reference to this access object for chaining.
-             * @throws std::out_of_range If the row or column index is invalid.
-             */
-            template <ConvertibleToCellValue T>
-            CellAccess& operator=(const T& value) {
-                if (row_index_ >= table_->rows.size()) {
-                    throw std::out_of_range("Row index out of range: " + std::to_string(row_index_));
-                }
-                if (col_index_ >= static_cast<int>(table_->rows[row_index_].size())) {
-                    throw std::out_of_range("Column index out of range: " + std::to_string(col_index_));
-                }
-                table_->rows[row_index_][col_index_] = value;
-                return *this;
-            }
+            friend Filter operator&&(Filter a, Filter b) { return combine(Kind::And, std::move(a), std::move(b)); }
+            friend Filter operator||(Filter a, Filter b) { return combine(Kind::Or, std::move(a), std::move(b)); }
 
         private:
-            CSVTable* table_;      ///< Pointer to the parent table
-            size_t row_index_;     ///< Index of the row
-            int col_index_;        ///< Index of the column
+            friend class CSVTable;
+            enum class Kind { Predicate, And, Or };
+
+            Kind kind_;
+            ColumnPredicate predicate_;
+            std::vector<Filter> children_;
+
+            explicit Filter(Kind kind) : kind_(kind), predicate_{std::string(), CompareOp::Eq, CellValue()} {}
+
+            // Flattens chains of the same operator, so a && b && c has three children
+            static Filter combine(Kind kind, Filter a, Filter b)
+            {
+                Filter result(kind);
+                for (Filter *part : {&a, &b})
+                {
+                    if (part->kind_ == kind)
+                    {
+                        for (auto &child : part->children_)
+                            result.children_.push_back(std::move(child));
+                    }
+                    else
+                    {
+                        result.children_.push_back(std::move(*part));
+                    }
+                }
+                return result;
+            }
         };
 
+        class TableView; // Defined after ParquetWriter; returned by view()
+        class GroupBy;   // Defined after TableView; returned by group_by()
+        class LazyTable; // Defined after GroupBy; returned by lazy(), scan_csv() and scan_parquet()
+
         /**
-         * @brief A class representing a single row in a CSVTable.
+         * @brief A set of selected rows stored as a bitmap (bit i of word i / 64 set when row i is selected).
          *
-         * Allows access to cell values by column name using operator[], supporting both
-         * reading and writing. Provides type-safe retrieval of values via get<T>.
+         * Produced by select(filter); sub_table(selection) and filter_in_place(selection) consume it.
          */
-        class Row {
+        class Selection
+        {
         public:
-            /**
-             * @brief Constructs a Row object.
-             * @param table Pointer to the parent CSVTable.
-             * @param row_index The index of the row in the table.
-             */
-            Row(CSVTable* table, size_t row_index)
-                : table_(table), row_index_(row_index) {}
+            Selection() = default;
 
             /**
-             * @brief Accesses a cell for reading or writing by column name.
-             * @param col_name The name of the column.
-             * @return CellAccess An access object for the cell, allowing read/write operations.
-             * @throws std::invalid_argument If the column name does not exist.
+             * @brief Creates a selection over size rows with no row selected.
              */
-            CellAccess operator[](std::string_view col_name) {
-                auto it = table_->col_map.find(col_name);
-                if (it == table_->col_map.end()) {
-                    throw std::invalid_argument("Column not found: " + std::string(col_name));
-                }
-                return CellAccess(table_, row_index_, it->second);
+            static Selection none(size_t size)
+            {
+                Selection selection;
+                selection.words_.assign((size + 63) / 64, 0);
+                selection.size_ = size;
+                return selection;
             }
 
             /**
-             * @brief Retrieves a cell value with type safety.
-             * @tparam T The type to retrieve (must be convertible to CellValue).
-             * @param col_name The name of the column.
-             * @return T The value converted to type T.
-             * @throws std::invalid_argument If the column name does not exist.
-             * @throws std::out_of_range If the row index is invalid.
-             * @throws std::runtime_error If the value cannot be converted to T.
+             * @brief Creates a selection over size rows with every row selected.
              */
-            template <ConvertibleToCellValue T>
-            T get(std::string_view col_name) const {
-                return table_->get<T>(static_cast<int>(row_index_), col_name);
+            static Selection all(size_t size)
+            {
+                Selection selection;
+                selection.words_.assign((size + 63) / 64, ~uint64_t(0));
+                if (size % 64 != 0)
+                    selection.words_.back() = (uint64_t(1) << (size % 64)) - 1;
+                selection.size_ = size;
+                return selection;
             }
 
-            /**
-             * @brief Streams the row to an output stream.
-             *
-             * Outputs the row as a comma-separated list of cell values, using the table's
-             * cell_to_string function to convert values to strings.
-             *
-             * @param os The output stream to write to.
-             * @param row The Row object to stream.
-             * @return std::ostream& The output stream for chaining.
-             * @throws std::out_of_range If the row index is invalid.
-             */
-            friend std::ostream& operator<<(std::ostream& os, const Row& row) {
-                if (row.row_index_ >= row.table_->rows.size()) {
-                    os << "<Invalid Row>";
-                    return os;
-                }
-                const auto& row_data = row.table_->rows[row.row_index_];
-                for (size_t i = 0; i < row_data.size(); ++i) {
-                    os << CSVTable::cell_to_string(row_data[i]);
-                    if (i < row_data.size() - 1) {
-                        os << ",";
-                    }
-                }
-                return os;
-            }
+            /// Number of rows the selection covers.
+            size_t size() const { return size_; }
 
-        private:
-            CSVTable* table_;      ///< Pointer to the parent table
-            size_t row_index_;     ///< Index of the row
-        };
+            /// Whether row i is selected.
+            bool test(size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
 
-        // Nested iterator class for rows
-        class RowIterator {
-        public:
-            RowIterator(CSVTable* table, size_t index) : table_(table), index_(index) {}
+            /// Selects or deselects row i.
+            void set(size_t i, bool selected = true)
+            {
+                uint64_t bit = uint64_t(1) << (i & 63);
+                words_[i >> 6] = selected ? (words_[i >> 6] | bit) : (words_[i >> 6] & ~bit);
+            }
 
-            Row operator*() const {
-                return Row(table_, index_);
+            /// Number of selected rows.
+            size_t count() const
+            {
+                size_t total = 0;
+                for (uint64_t word : words_)
+                    total += std::popcount(word);
+                return total;
             }
 
-            Row operator->() const {
-                return Row(table_, index_);
+            /// Indices of the selected rows, in ascending order.
+            std::vector<int> indices() const
+            {
+                std::vector<int> result;
+                result.reserve(count());
+                for (size_t w = 0; w < words_.size(); ++w)
+                {
+                    for (uint64_t word = words_[w]; word != 0; word &= word - 1)
+                        result.push_back(static_cast<int>(w * 64 + std::countr_zero(word)));
+                }
+                return result;
             }
 
-            RowIterator& operator++() {
-                ++index_;
+            /// The bitmap words; bits past size() are zero.
+            const std::vector<uint64_t> &words() const { return words_; }
+
+            Selection &operator&=(const Selection &other)
+            {
+                check_size(other);
+                for (size_t w = 0; w < words_.size(); ++w)
+                    words_[w] &= other.words_[w];
                 return *this;
             }
 
-            bool operator!=(const RowIterator& other) const {
-                return index_ != other.index_;
+            Selection &operator|=(const Selection &other)
+            {
+                check_size(other);
+                for (size_t w = 0; w < words_.size(); ++w)
+                    words_[w] |= other.words_[w];
+                return *this;
             }
 
-            bool operator==(const RowIterator& other) const {
-                return index_ == other.index_;
+        private:
+            friend class CSVTable;
+            std::vector<uint64_t> words_;
+            size_t size_ = 0;
+
+            void check_size(const Selection &other) const
+            {
+                if (other.size_ != size_)
+                {
+                    throw std::invalid_argument("Selections cover different numbers of rows");
+                }
             }
+        };
 
-            size_t index() const {
-                return index_;
+    private:
+        /**
+         * @brief A whole file held read-only in memory: memory-mapped where the platform supports it,
+         * otherwise read into a buffer.
+         */
+        class MappedFile
+        {
+        public:
+            /**
+             * @brief Maps a file, or returns nullptr if it cannot be opened.
+             */
+            static std::shared_ptr<const MappedFile> open(const std::string &path)
+            {
+                auto file = std::shared_ptr<MappedFile>(new MappedFile());
+#if M2_CSV_HAS_MMAP
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0)
+                {
+                    return nullptr;
+                }
+                struct stat st{};
+                if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+                {
+                    void *addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (addr != MAP_FAILED)
+                    {
+                        file->data_ = static_cast<const char *>(addr);
+                        file->size_ = static_cast<size_t>(st.st_size);
+                        file->mapped_ = true;
+                        ::close(fd);
+                        return file;
+                    }
+                }
+                ::close(fd);
+#endif
+                std::ifstream in(path, std::ios::binary | std::ios::ate);
+                if (!in.is_open())
+                {
+                    return nullptr;
+                }
+                file->size_ = static_cast<size_t>(in.tellg());
+                file->buffer_ = std::make_unique_for_overwrite<char[]>(file->size_);
+                in.seekg(0);
+                in.read(file->buffer_.get(), static_cast<std::streamsize>(file->size_));
+                file->data_ = file->buffer_.get();
+                return in ? file : nullptr;
             }
 
-            Row row() const {
-                return Row(table_, index_);
+            ~MappedFile()
+            {
+#if M2_CSV_HAS_MMAP
+                if (mapped_)
+                {
+                    ::munmap(const_cast<char *>(data_), size_);
+                }
+#endif
             }
 
-        private:
-            CSVTable* table_;
-            size_t index_;
-        };
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
 
-        // Const iterator class for const CSVTable objects
-        class ConstRowIterator {
-        public:
-            ConstRowIterator(const CSVTable* table, size_t index) : table_(table), index_(index) {}
+            const char *data() const { return data_; }
+            size_t size() const { return size_; }
 
-            Row operator*() const {
-                return Row(const_cast<CSVTable*>(table_), index_);
-            }
+        private:
+            const char *data_ = nullptr;
+            size_t size_ = 0;
+            bool mapped_ = false;
+            std::unique_ptr<char[]> buffer_;
 
-            Row operator->() const {
-                return Row(const_cast<CSVTable*>(table_), index_);
-            }
+            MappedFile() = default;
+        };
 
-            ConstRowIterator& operator++() {
-                ++index_;
-                return *this;
-            }
+        /**
+         * @brief Sequential reads from a snapshot file. Every read is bounds-checked, so a truncated or
+         * corrupt file throws std::runtime_error instead of reading past the end.
+         */
+        struct SnapshotReader
+        {
+            std::shared_ptr<const MappedFile> file;
+            size_t pos = 0;
 
-            bool operator!=(const ConstRowIterator& other) const {
-                return index_ != other.index_;
+            std::string_view bytes(size_t n)
+            {
+                if (n > file->size() - pos)
+                {
+                    throw std::runtime_error("Snapshot file is truncated or corrupt");
+                }
+                std::string_view result(file->data() + pos, n);
+                pos += n;
+                return result;
             }
 
-            bool operator==(const ConstRowIterator& other) const {
-                return index_ == other.index_;
+            template <typename T>
+            T read()
+            {
+                T value;
+                std::memcpy(&value, bytes(sizeof(T)).data(), sizeof(T));
+                return value;
             }
 
-            size_t index() const {
-                return index_;
+            template <typename T>
+            void read_array(T *out, size_t n)
+            {
+                if (n > (file->size() - pos) / sizeof(T))
+                {
+                    throw std::runtime_error("Snapshot file is truncated or corrupt");
+                }
+                std::memcpy(out, bytes(n * sizeof(T)).data(), n * sizeof(T));
             }
 
-            Row row() const {
-                return Row(const_cast<CSVTable*>(table_), index_);
-            }
+            std::string_view read_text() { return bytes(read<uint64_t>()); }
 
-        private:
-            const CSVTable* table_;
-            size_t index_;
+            /// Checks that count items of item_size bytes can still follow, before anything is allocated for them.
+            void require(uint64_t count, size_t item_size) const
+            {
+                if (count > (file->size() - pos) / item_size)
+                {
+                    throw std::runtime_error("Snapshot file is truncated or corrupt");
+                }
+            }
         };
 
-        // Begin and end methods for non-const objects
-        RowIterator begin() {
-            return RowIterator(this, 0);
+        template <typename T>
+        static void write_pod(std::ostream &out, const T &value)
+        {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(T));
         }
 
-        RowIterator end() {
-            return RowIterator(this, rows.size());
+        template <typename T>
+        static void write_array(std::ostream &out, const T *data, size_t n)
+        {
+            out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(n * sizeof(T)));
         }
 
-        // Begin and end methods for const objects
-        ConstRowIterator begin() const {
-            return ConstRowIterator(this, 0);
+        static void write_text(std::ostream &out, std::string_view text)
+        {
+            write_pod(out, static_cast<uint64_t>(text.size()));
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
         }
 
-        ConstRowIterator end() const {
-            return ConstRowIterator(this, rows.size());
-        }
+        /**
+         * @brief Thrown by parse_record when a field does not match its declared type.
+         */
+        struct FieldParseError
+        {
+            size_t row;
+            size_t field;
+            std::string value;
+        };
 
-        ConstRowIterator cend() const {
-            return end();
-        }
+        /**
+         * @brief Column layout of a CSV file after applying a schema.
+         */
+        struct CSVHeader
+        {
+            std::vector<std::string> file_col_names; ///< Columns as they appear in the file
+            std::vector<std::string> col_names;      ///< Columns kept in the table
+            std::vector<ColumnType> plan;            ///< Declared type per file column; empty to infer all
+        };
 
-        ConstRowIterator cbegin() const {
-            return begin();
-        }
+        /**
+         * @brief Count, mean, sum of squared deviations (m2), min and max of a run of values.
+         *
+         * Values are added with Welford's update, and partial results for separate blocks are combined
+         * with merge (Chan et al.), so the moments are numerically stable in one pass.
+         */
+        struct Moments
+        {
+            size_t count = 0;
+            double mean = 0.0;
+            double m2 = 0.0;
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
 
-         /**
-         * @brief Reads a CSV file into the table, initializing or appending data.
-         * @param filename The path to the CSV file.
-         * @throws std::runtime_error If the file cannot be opened, is empty, or has mismatched columns when appending.
+            void add(double x)
+            {
+                ++count;
+                double delta = x - mean;
+                mean += delta / count;
+                m2 += delta * (x - mean);
+                min = std::min(min, x);
+                max = std::max(max, x);
+            }
+
+            void merge(const Moments &other)
+            {
+                if (other.count == 0)
+                    return;
+                size_t total = count + other.count;
+                double delta = other.mean - mean;
+                m2 += other.m2 + delta * delta * count * other.count / total;
+                mean += delta * other.count / total;
+                count = total;
+                min = std::min(min, other.min);
+                max = std::max(max, other.max);
+            }
+
+            /// Sample variance; requires count >= 2.
+            double variance() const { return m2 / (count - 1); }
+
+            /**
+             * @brief Moments of contiguous values. Four independent Welford lanes run side by side, so the
+             * loop has no serial dependency between neighbouring values and the compiler can vectorize it.
+             */
+            static Moments of(std::span<const double> values)
+            {
+                constexpr size_t lanes = 4;
+                std::array<double, lanes> mean{}, m2{}, lo, hi;
+                lo.fill(std::numeric_limits<double>::infinity());
+                hi.fill(-std::numeric_limits<double>::infinity());
+                const size_t full = values.size() / lanes * lanes;
+                for (size_t i = 0; i < full; i += lanes)
+                {
+                    const double inv_count = 1.0 / static_cast<double>(i / lanes + 1);
+                    for (size_t l = 0; l < lanes; ++l)
+                    {
+                        double x = values[i + l];
+                        double delta = x - mean[l];
+                        mean[l] += delta * inv_count;
+                        m2[l] += delta * (x - mean[l]);
+                        lo[l] = std::min(lo[l], x);
+                        hi[l] = std::max(hi[l], x);
+                    }
+                }
+                Moments result;
+                for (size_t l = 0; l < lanes && full > 0; ++l)
+                {
+                    result.merge(Moments{full / lanes, mean[l], m2[l], lo[l], hi[l]});
+                }
+                for (size_t i = full; i < values.size(); ++i)
+                {
+                    result.add(values[i]);
+                }
+                return result;
+            }
+        };
+
+    public:
+
+        /**
+         * @brief A single column of a columnar table: a typed value buffer plus a validity bitmap.
+         *
+         * All non-missing cells of a typed column share one CellValue alternative and are stored
+         * contiguously. Empty strings (the table's missing-value marker) are recorded as nulls in the
+         * bitmap and read back as std::string(""). A column whose cells mix alternatives is stored as
+         * Type::Mixed, which keeps the CellValue itself.
+         *
+         * A String column stores std::string_view cells whose characters live in bump-allocated blocks
+         * owned by the column, so building one costs a few large allocations instead of one per string,
+         * and it is freed block by block. Copies, gather() and append() share the blocks instead of copying
+         * the characters. Overwritten strings keep their space until the column is destroyed.
+         *
+         * A Categorical column holds strings as uint32_t codes into a dictionary of its distinct values.
+         * Its cells read back as std::string, and copies of the column share the dictionary until one of
+         * them adds a value. Writes that add a new value must not run concurrently with other access.
          */
-        void read_file(std::string_view filename)
+        class Column
         {
-            std::ifstream file(filename.data());
-            if (!file.is_open())
+        public:
+            /// Column types; the order matches the alternatives of the storage variant.
+            enum class Type { Mixed, String, Int, Double, Bool, UInt64, Categorical };
+
+            /// Element type of the value buffer that backs a column of type T (bool is stored as uint8_t, and
+            /// strings as views into the column's string blocks).
+            template <ConvertibleToCellValue T>
+            using storage_type = std::conditional_t<std::is_same_v<T, bool>, uint8_t,
+                                                    std::conditional_t<std::is_same_v<T, std::string>, std::string_view, T>>;
+
+            Column() = default;
+
+            /**
+             * @brief Constructs an empty column of the given type.
+             * @param type The column type.
+             */
+            explicit Column(Type type) : type_(type)
             {
-                throw std::runtime_error("Cannot open file: " + std::string(filename));
+                reset_storage();
             }
 
-            std::string line;
-            if (!std::getline(file, line))
+            /**
+             * @brief Maps a CellValue alternative to its column type.
+             */
+            template <ConvertibleToCellValue T>
+            static constexpr Type type_of()
             {
-                throw std::runtime_error("Empty file or missing header: " + std::string(filename));
+                if constexpr (std::is_same_v<T, std::string>)
+                    return Type::String;
+                else if constexpr (std::is_same_v<T, int>)
+                    return Type::Int;
+                else if constexpr (std::is_same_v<T, double>)
+                    return Type::Double;
+                else if constexpr (std::is_same_v<T, bool>)
+                    return Type::Bool;
+                else
+                    return Type::UInt64;
             }
 
-            // Parse header
-            std::vector<std::string> new_col_names;
-            auto fields = std::views::split(line, ',') |
-                          std::views::transform([](auto&& rng)
-                                                {
-                                                    std::string s(rng.begin(), rng.end());
-                                                    if (!s.empty() && s.front() == '"' && s.back() == '"')
-                                                    {
-                                                        s = s.substr(1, s.size() - 2);
-                                                    }
-                                                    return s;
-                                                });
-            for (const auto& field : fields)
+            /**
+             * @brief Returns the column type a non-missing CellValue would be stored as.
+             */
+            static Type type_of(const CellValue &value)
             {
-                new_col_names.push_back(field);
+                return static_cast<Type>(value.index() + 1);
             }
 
-            // If table is empty, initialize with new headers
-            if (col_names.empty())
+            /**
+             * @brief Checks whether a value is the table's missing-value marker (an empty string).
+             */
+            static bool is_missing(const CellValue &value)
             {
-                col_names = new_col_names;
-                for (size_t i = 0; i < col_names.size(); ++i)
-                {
-                    col_map[col_names[i]] = i;
-                }
+                return std::holds_alternative<std::string>(value) && std::get<std::string>(value).empty();
             }
-            // Otherwise, verify headers match
-            else
+
+            /**
+             * @brief Builds a column holding n copies of a value.
+             * @param n The number of cells.
+             * @param value The value of every cell.
+             * @return Column A column of type type_of<T>().
+             */
+            template <ConvertibleToCellValue T>
+            static Column filled(size_t n, const T &value)
             {
-                if (new_col_names.size() != col_names.size() ||
-                    !std::equal(new_col_names.begin(), new_col_names.end(), col_names.begin()))
+                Column column(type_of<T>());
+                bool valid = !is_missing(CellValue(value));
+                if constexpr (std::is_same_v<T, std::string>)
+                    column.data_ = std::vector<std::string_view>(n, column.strings_.store(value));
+                else
+                    column.data_ = std::vector<storage_type<T>>(n, static_cast<storage_type<T>>(value));
+                column.validity_.assign((n + 63) / 64, valid ? ~uint64_t(0) : 0);
+                if (valid && n % 64 != 0)
                 {
-                    throw std::runtime_error("Column headers in " + std::string(filename) + " do not match existing table");
+                    column.validity_.back() = (uint64_t(1) << (n % 64)) - 1; // Bits past the end stay clear
                 }
+                column.size_ = n;
+                column.null_count_ = valid ? 0 : n;
+                return column;
             }
 
-            // Read and append rows with progress reporting
-            size_t row_count = 0;
-            size_t progress_interval = 10000;  // Report every 10K rows
-            auto start_time = std::chrono::steady_clock::now();
+            /**
+             * @brief Builds a column of type type_of<T>() from a value buffer and a validity bitmap.
+             * @param values The cells; null cells may hold any value.
+             * @param validity One bit per cell (1 = valid), with the bits past the last cell clear.
+             */
+            template <NumericCellValue T>
+            static Column from_values(std::vector<storage_type<T>> values, std::vector<uint64_t> validity)
+            {
+                Column column(type_of<T>());
+                column.size_ = values.size();
+                column.data_ = std::move(values);
+                column.validity_ = std::move(validity);
+                column.recount_nulls();
+                return column;
+            }
 
-            while (std::getline(file, line))
+            /**
+             * @brief Builds a column from n cells, inferring the narrowest type that holds all of them.
+             * @param n The number of cells.
+             * @param cell_at Callable returning the i-th cell as a CellValue (or a reference to one).
+             * @return Column A typed column, or a Mixed column if the cells' types differ.
+             */
+            template <typename CellAt>
+            static Column infer(size_t n, CellAt &&cell_at)
             {
-                std::vector<CellValue> row;
-                auto fields = std::views::split(line, ',') |
-                              std::views::transform([](auto&& rng)
-                                                    {
-                                                        std::string s(rng.begin(), rng.end());
-                                                        if (!s.empty() && s.front() == '"' && s.back() == '"')
-                                                        {
-                                                            s = s.substr(1, s.size() - 2);
-                                                        }
-                                                        return parse_cell(s);
-                                                    });
-                row.assign(fields.begin(), fields.end());
-                while (row.size() < col_names.size())
+                std::optional<Type> type;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const CellValue &value = cell_at(i);
+                    if (is_missing(value))
+                        continue;
+                    if (!type)
+                        type = type_of(value);
+                    else if (*type != type_of(value))
+                    {
+                        type = Type::Mixed;
+                        break;
+                    }
+                }
+                Column column(type.value_or(Type::String));
+                column.reserve(n);
+                for (size_t i = 0; i < n; ++i)
                 {
-                    row.emplace_back(std::string(""));
+                    column.push_back(cell_at(i));
                 }
-                rows.push_back(std::move(row));
+                return column;
+            }
 
-                // Progress reporting
-                row_count++;
-                if (row_count % progress_interval == 0) {
-                    auto now = std::chrono::steady_clock::now();
-                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-                    double rows_per_sec = row_count * 1000.0 / (elapsed + 1);
-                    std::cerr << "\rReading CSV: " << row_count << " rows ("
-                              << std::fixed << std::setprecision(0) << rows_per_sec << " rows/sec)"
-                              << std::flush;
+            /**
+             * @brief Builds a Categorical column holding the cells of another column.
+             * @throws std::runtime_error If a non-missing cell is not a string.
+             */
+            static Column categorical(const Column &source)
+            {
+                if (source.type_ == Type::Categorical)
+                {
+                    return source;
+                }
+                if (source.type_ != Type::String && source.type_ != Type::Mixed && source.null_count_ != source.size_)
+                {
+                    throw std::runtime_error("Type mismatch: categorical columns hold strings");
+                }
+                Column column(Type::Categorical);
+                column.reserve(source.size_);
+                for (size_t i = 0; i < source.size_; ++i)
+                {
+                    CellValue value = source.get(i);
+                    if (!std::holds_alternative<std::string>(value))
+                    {
+                        throw std::runtime_error("Type mismatch: categorical columns hold strings");
+                    }
+                    column.push_back(value);
                 }
+                return column;
             }
-            if (row_count > 0) {
-                std::cerr << "\rRead CSV: " << row_count << " rows total" << std::string(20, ' ') << std::endl;
+
+            Type type() const { return type_; }
+            size_t size() const { return size_; }
+            size_t null_count() const { return null_count_; }
+
+            /**
+             * @brief Returns the code buffer of a Categorical column; null cells hold an unspecified code.
+             * @throws std::runtime_error If the column is not Categorical.
+             */
+            const std::vector<uint32_t> &codes() const
+            {
+                if (type_ != Type::Categorical)
+                {
+                    throw std::runtime_error("Type mismatch: column is not categorical");
+                }
+                return std::get<std::vector<uint32_t>>(data_);
             }
-        }
-    
 
-        /**
-         * @brief Sets the type of a column, converting values if possible.
-         * @tparam T The target type for the column.
-         * @param col_name The name of the column.
-         * @param skip_errors If true, replace invalid values with default_value; otherwise, throw an exception.
-         * @param default_value The default value to use for invalid conversions.
-         * @throws std::invalid_argument If the column does not exist.
-         * @throws std::runtime_error If conversion fails and skip_errors is false.
-         */
-        template <ConvertibleToCellValue T>
-        void set_column_type(std::string_view col_name, bool skip_errors = false, const T &default_value = T())
-        {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end())
+            /**
+             * @brief Returns the distinct values of a Categorical column, indexed by code.
+             * @throws std::runtime_error If the column is not Categorical.
+             */
+            const std::vector<std::string> &categories() const
             {
-                throw std::invalid_argument("Column not found: " + std::string(col_name));
+                codes();
+                return dictionary_->values;
             }
-            int col_index = it->second;
 
-            for (auto &row : rows)
+            /**
+             * @brief Returns the code of a value in a Categorical column, or std::nullopt if no cell holds it.
+             */
+            std::optional<uint32_t> code_of(std::string_view value) const
             {
-                auto &cell = row[col_index];
-                if (std::holds_alternative<std::string>(cell))
+                if (type_ != Type::Categorical)
                 {
-                    auto str = std::get<std::string>(cell);
-                    if (str.empty() || str == "NA" || str == "NaN" || str == "#N/A")
-                    {
-                        if (skip_errors)
-                        {
-                            cell = default_value;
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid value in column " + std::string(col_name) + ": empty or NA");
-                        }
-                        continue;
-                    }
-                    try
-                    {
-                        if constexpr (std::is_same_v<T, int>)
-                        {
-                            size_t pos;
-                            cell = std::stoi(str, &pos);
-                            if (pos != str.size())
-                                throw std::invalid_argument("stoi did not consume entire string");
-                        }
-                        else if constexpr (std::is_same_v<T, uint64_t>)
-                        {
-                            cell = std::stoull(str);
-                        }
-                        else if constexpr (std::is_same_v<T, double>)
-                        {
-                            cell = std::stod(str);
-                        }
-                        else if constexpr (std::is_same_v<T, bool>)
-                        {
-                            if (str == "true" ||"1" == str)
-                                cell = true;
-                            else if (str == "false" || "0" == str)
-                                cell = false;
-                            else
-                                throw std::runtime_error("Invalid boolean value");
-                        }
-                        else if constexpr (std::is_same_v<T, std::string>)
-                        {
-                            cell = str;
-                        }
-                        else if constexpr (std::is_same_v<T, uint64_t>)
-                        {
-                            cell = std::stoull(str);
-                        }
-                    }
-                    catch (const std::exception &e)
-                    {
-                        if (skip_errors)
-                        {
-                            cell = default_value;
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Conversion error in column " + std::string(col_name) + ": " + str);
-                        }
-                    }
-                }
-                else
-                {
-                    try
-                    {
-                        cell = convert_cell<T>(cell);
-                    }
-                    catch (const std::exception &e)
-                    {
-                        if (skip_errors)
-                        {
-                            cell = default_value;
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Type mismatch in column " + std::string(col_name) + ": " + e.what());
-                        }
-                    }
+                    return std::nullopt;
                 }
+                auto it = dictionary_->codes.find(value);
+                return it == dictionary_->codes.end() ? std::nullopt : std::optional<uint32_t>(it->second);
             }
-        }
 
-        /**
-         * @brief Retrieves a value from the table with type safety.
-         * @tparam T The type to retrieve.
-         * @param row The row index.
-         * @param col_name The column name.
-         * @return T The value cast to type T.
-         * @throws std::out_of_range If the row index is invalid.
-         * @throws std::invalid_argument If the column does not exist.
-         * @throws std::runtime_error If the type does not match or conversion fails.
-         */
-        template <ConvertibleToCellValue T>
-        T get(int row, std::string_view col_name) const
-        {
-            if (row < 0 || static_cast<size_t>(row) >= rows.size())
+            /**
+             * @brief Checks the validity bitmap for a cell.
+             */
+            bool is_null(size_t i) const
             {
-                throw std::out_of_range("Row index out of range");
+                return ((validity_[i >> 6] >> (i & 63)) & 1) == 0;
             }
-            auto it = col_map.find(col_name);
-            if (it == col_map.end())
+
+            /**
+             * @brief Returns the validity bitmap, one bit per cell (1 = valid), 64 cells per word.
+             */
+            const std::vector<uint64_t> &validity() const { return validity_; }
+
+            /**
+             * @brief Returns the contiguous value buffer of a typed column.
+             *
+             * Null cells hold an unspecified value; consult is_null() or validity().
+             *
+             * @throws std::runtime_error If the column is not of type type_of<T>().
+             */
+            template <ConvertibleToCellValue T>
+            const std::vector<storage_type<T>> &values() const
             {
-                throw std::invalid_argument("Column name not found: " + std::string(col_name));
+                if (type_ != type_of<T>())
+                {
+                    throw std::runtime_error("Type mismatch: column is not stored as the requested type");
+                }
+                return std::get<std::vector<storage_type<T>>>(data_);
             }
-            return convert_cell<T>(rows[row][it->second]);
-        }
 
-        /**
-         * @brief Adds a new column with a default value.
-         * @tparam T The type of the default value.
-         * @param col_name The name of the new column.
-         * @param default_value The default value for the new column.
-         * @throws std::invalid_argument If the column already exists.
-         */
-        template <ConvertibleToCellValue T>
-        void add_column(std::string_view col_name, const T &default_value = T())
-        {
-            if (col_map.contains(col_name))
+            /**
+             * @brief Reads a cell as a CellValue. Null cells read back as std::string("").
+             */
+            CellValue get(size_t i) const
             {
-                throw std::invalid_argument("Column already exists: " + std::string(col_name));
+                if (is_null(i))
+                {
+                    return std::string("");
+                }
+                return std::visit([this, i](const auto &vec) -> CellValue
+                                  {
+                                      using V = typename std::decay_t<decltype(vec)>::value_type;
+                                      if constexpr (std::is_same_v<V, uint8_t>)
+                                          return static_cast<bool>(vec[i]);
+                                      else if constexpr (std::is_same_v<V, uint32_t>)
+                                          return dictionary_->values[vec[i]];
+                                      else if constexpr (std::is_same_v<V, std::string_view>)
+                                          return std::string(vec[i]);
+                                      else
+                                          return vec[i]; },
+                                  data_);
             }
-            col_map[std::string(col_name)] = col_names.size();
-            col_names.emplace_back(col_name);
-            for (auto &row : rows)
+
+            /**
+             * @brief Reads a cell converted to T, with the same rules as convert_cell<T>.
+             */
+            template <ConvertibleToCellValue T>
+            T get_as(size_t i) const
             {
-                row.emplace_back(default_value);
+                if (type_ == type_of<T>() && !is_null(i))
+                {
+                    return static_cast<T>(std::get<std::vector<storage_type<T>>>(data_)[i]);
+                }
+                return convert_cell<T>(get(i));
             }
-        }
 
-        /**
-         * @brief Deletes a column from the table.
-         * @param col_name The name of the column to delete.
-         * @throws std::invalid_argument If the column does not exist.
-         */
-        void delete_column(std::string_view col_name)
-        {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end())
+            /**
+             * @brief Hashes a value so that equal values hash alike whether they sit in a typed column,
+             * a Mixed column or a row.
+             */
+            template <ConvertibleToCellValue T>
+            static size_t hash_value(const T &value)
             {
-                throw std::invalid_argument("Column name not found: " + std::string(col_name));
+                if constexpr (std::is_same_v<T, int>)
+                {
+                    if (value >= 0) // Same hash as the equal uint64_t
+                        return hash_value(static_cast<uint64_t>(value));
+                }
+                else if constexpr (std::is_same_v<T, double>)
+                {
+                    if (std::isnan(value)) // All NaNs are the same value
+                        return hash_value(std::string("NaN")) + 1;
+                }
+                else if constexpr (std::is_same_v<T, std::string>)
+                {
+                    return hash_text(value);
+                }
+                return std::hash<T>{}(value) ^ (static_cast<size_t>(type_of<T>()) * 0x9e3779b97f4a7c15ULL);
             }
-            int col_index = it->second;
-            col_names.erase(col_names.begin() + col_index);
-            col_map.erase(it);
-            for (auto &[name, index] : col_map)
+
+            /// hash_value of a string, without constructing one.
+            static size_t hash_text(std::string_view value)
             {
-                if (index > col_index)
-                    --index;
+                return std::hash<std::string_view>{}(value) ^ (static_cast<size_t>(Type::String) * 0x9e3779b97f4a7c15ULL);
             }
-            for (auto &row : rows)
+
+            /**
+             * @brief Compares two values for key equality: int and uint64_t compare by value, NaN equals NaN,
+             * and other values of different types differ.
+             */
+            static bool same_value(const CellValue &a, const CellValue &b)
             {
-                row.erase(row.begin() + col_index);
+                return std::visit([](const auto &x, const auto &y)
+                                  {
+                                      using X = std::decay_t<decltype(x)>;
+                                      using Y = std::decay_t<decltype(y)>;
+                                      if constexpr (std::is_same_v<X, Y>)
+                                          return same_value(x, y);
+                                      else if constexpr ((std::is_same_v<X, int> && std::is_same_v<Y, uint64_t>) ||
+                                                         (std::is_same_v<X, uint64_t> && std::is_same_v<Y, int>))
+                                          return std::cmp_equal(x, y);
+                                      else
+                                          return false; },
+                                  a, b);
             }
-        }
 
-        /**
-         * @brief Deletes multiple columns from the table.
-         *
-         * Removes the specified columns from the table by calling delete_column for each
-         * column name. All specified columns must exist, or an exception is thrown.
-         *
-         * @param col_names A vector of column names to delete.
-         * @throws std::invalid_argument If any column name does not exist.
-         */
-        void delete_columns(const std::vector<std::string_view>& col_names) {
-            for (const auto& name : col_names) {
-                delete_column(name);
+            template <typename V>
+                requires(!std::is_same_v<V, CellValue>)
+            static bool same_value(const V &x, const V &y)
+            {
+                if constexpr (std::is_same_v<V, double>)
+                    return x == y || (std::isnan(x) && std::isnan(y));
+                else
+                    return x == y;
             }
-        }
 
-        /**
-         * @brief Appends a new row to the table.
-         * @param values The values for the new row.
-         */
-        void append_row(std::vector<CellValue> values)
-        {
-            while (values.size() < col_names.size())
+            static size_t hash_value(const CellValue &value)
             {
-                values.emplace_back(std::string(""));
+                return std::visit([](const auto &v)
+                                  { return hash_value(v); },
+                                  value);
             }
-            values.resize(col_names.size());
-            rows.push_back(std::move(values));
-        }
-
-        /**
-         * @brief Filters rows based on a predicate.
-         * @param predicate A function that takes a row index and the table, returning true if the row should be kept.
-         * @return std::vector<int> The indices of the matching rows.
-         */
-        std::vector<int> filter_rows(const std::function<bool(int, const CSVTable &)> &predicate) const
-        {
-            std::vector<int> matching_rows;
-            matching_rows.reserve(rows.size() / 10);  // Reserve some space (assume ~10% match)
 
-            for (int i : std::views::iota(0, static_cast<int>(rows.size())))
+            /**
+             * @brief Hashes a cell without materializing it; equals hash_value(get(i)).
+             */
+            size_t hash(size_t i) const
             {
-                if (predicate(i, *this))
+                if (is_null(i))
                 {
-                    matching_rows.push_back(i);
+                    return hash_value(std::string());
                 }
+                return std::visit([this, i](const auto &vec) -> size_t
+                                  {
+                                      using V = typename std::decay_t<decltype(vec)>::value_type;
+                                      if constexpr (std::is_same_v<V, uint8_t>)
+                                          return hash_value(static_cast<bool>(vec[i]));
+                                      else if constexpr (std::is_same_v<V, uint32_t>)
+                                          return dictionary_->hashes[vec[i]];
+                                      else if constexpr (std::is_same_v<V, std::string_view>)
+                                          return hash_text(vec[i]);
+                                      else
+                                          return hash_value(vec[i]); },
+                                  data_);
             }
-            return matching_rows;
-        }
-
-        /**
-         * @brief Creates a new table with rows that match a predicate.
-         * @param predicate A function that takes a row index and the table, returning true if the row should be included.
-         * @return CSVTable A new table with the filtered rows.
-         */
-        CSVTable filter_table(const std::function<bool(int, const CSVTable &)> &predicate) const
-        {
-            auto matching_rows = filter_rows(predicate);
-            return sub_table(matching_rows);
-        }
-
-        /**
-         * @brief Creates a new table with rows that match a predicate (optimized, with progress).
-         * @param predicate A function that takes a row index and the table, returning true if the row should be included.
-         * @param show_progress If true, display progress to stderr.
-         * @param expected_selectivity Expected fraction of rows to match (0.0 to 1.0). Default 0.5 (50%).
-         * @return CSVTable A new table with the filtered rows.
-         */
-        CSVTable filter_table_fast(const std::function<bool(int, const CSVTable &)> &predicate, bool show_progress = false, double expected_selectivity = 0.5) const
-        {
-            std::vector<std::vector<CellValue>> selected_rows;
-            size_t reserve_size = static_cast<size_t>(rows.size() * std::clamp(expected_selectivity, 0.0, 1.0));
-            selected_rows.reserve(std::max(size_t(1), reserve_size));  // Reserve based on expected selectivity
 
-            size_t progress_interval = show_progress ? std::max(size_t(1), rows.size() / 100) : rows.size() + 1;
-            auto start_time = std::chrono::steady_clock::now();
-
-            for (size_t i = 0; i < rows.size(); ++i)
+            /**
+             * @brief Compares cell i of this column with cell j of another; equals same_value(get(i), other.get(j)).
+             */
+            bool equal(size_t i, const Column &other, size_t j) const
             {
-                // Progress reporting
-                if (show_progress && (i % progress_interval == 0 || i == rows.size() - 1)) {
-                    double progress = (i + 1) * 100.0 / rows.size();
-                    auto now = std::chrono::steady_clock::now();
-                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-                    double rows_per_sec = (i + 1) * 1000.0 / (elapsed + 1);
-
-                    std::cerr << "\rFiltering: " << std::fixed << std::setprecision(1)
-                              << progress << "% (" << (i + 1) << "/" << rows.size()
-                              << " rows, " << selected_rows.size() << " match, "
-                              << std::setprecision(0) << rows_per_sec << " rows/sec)"
-                              << std::flush;
+                if (is_text() && other.is_text())
+                {
+                    if (is_null(i) || other.is_null(j))
+                    {
+                        return is_null(i) == other.is_null(j);
+                    }
+                    if (type_ == Type::Categorical && other.type_ == Type::Categorical && dictionary_ == other.dictionary_)
+                    {
+                        return codes()[i] == other.codes()[j];
+                    }
+                    return text(i) == other.text(j);
                 }
-
-                if (predicate(i, *this))
+                if (type_ != other.type_ || type_ == Type::Mixed)
+                {
+                    return same_value(get(i), other.get(j));
+                }
+                if (is_null(i) || other.is_null(j))
                 {
-                    selected_rows.push_back(rows[i]);
+                    return is_null(i) == other.is_null(j);
                 }
+                return std::visit([&](const auto &vec)
+                                  {
+                                      using Vec = std::decay_t<decltype(vec)>;
+                                      return same_value(vec[i], std::get<Vec>(other.data_)[j]); },
+                                  data_);
             }
 
-            if (show_progress) {
-                std::cerr << std::endl;
+            /**
+             * @brief Orders two cells as compare_values does (null cells read as ""), without copying them.
+             */
+            std::partial_ordering compare(size_t i, const Column &other, size_t j) const
+            {
+                if (is_text() && other.is_text())
+                {
+                    std::string_view a = is_null(i) ? std::string_view() : text(i);
+                    std::string_view b = other.is_null(j) ? std::string_view() : other.text(j);
+                    return a <=> b;
+                }
+                if (type_ != other.type_ || type_ == Type::Mixed || is_null(i) || other.is_null(j))
+                {
+                    return compare_values(get(i), other.get(j));
+                }
+                return std::visit([&](const auto &vec) -> std::partial_ordering
+                                  {
+                                      using Vec = std::decay_t<decltype(vec)>;
+                                      if constexpr (std::is_arithmetic_v<typename Vec::value_type>)
+                                          return vec[i] <=> std::get<Vec>(other.data_)[j];
+                                      else
+                                          return compare_values(get(i), other.get(j)); },
+                                  data_);
             }
 
-            return CSVTable(col_names, col_map, std::move(selected_rows));
-        }
-
-        /**
-         * @brief Filters rows in-place to conserve memory (modifies the table).
-         * @param predicate A function that takes a row index and the table, returning true if the row should be kept.
-         * @param show_progress If true, display progress to stderr.
-         * @return size_t The number of rows remaining after filtering.
-         */
-        size_t filter_in_place(const std::function<bool(int, const CSVTable &)> &predicate, bool show_progress = false)
-        {
-            size_t progress_interval = show_progress ? std::max(size_t(1), rows.size() / 100) : rows.size() + 1;
-            auto start_time = std::chrono::steady_clock::now();
-
-            size_t write_idx = 0;
-            for (size_t read_idx = 0; read_idx < rows.size(); ++read_idx)
+            /**
+             * @brief Writes a cell. A value of another type retypes an all-null column, otherwise
+             * the column is promoted to Mixed.
+             */
+            void set(size_t i, const CellValue &value)
             {
-                // Progress reporting
-                if (show_progress && (read_idx % progress_interval == 0 || read_idx == rows.size() - 1)) {
-                    double progress = (read_idx + 1) * 100.0 / rows.size();
-                    auto now = std::chrono::steady_clock::now();
-                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-                    double rows_per_sec = (read_idx + 1) * 1000.0 / (elapsed + 1);
-
-                    std::cerr << "\rFiltering in-place: " << std::fixed << std::setprecision(1)
-                              << progress << "% (" << (read_idx + 1) << "/" << rows.size()
-                              << " rows, " << write_idx << " kept, "
-                              << std::setprecision(0) << rows_per_sec << " rows/sec)"
-                              << std::flush;
+                if (is_missing(value))
+                {
+                    if (!is_null(i))
+                    {
+                        set_valid(i, false);
+                        ++null_count_;
+                    }
+                    return;
                 }
-
-                if (predicate(read_idx, *this))
+                if (type_ == Type::Categorical && std::holds_alternative<std::string>(value))
                 {
-                    if (write_idx != read_idx) {
-                        rows[write_idx] = std::move(rows[read_idx]);
+                    std::get<std::vector<uint32_t>>(data_)[i] = intern(std::get<std::string>(value));
+                }
+                else if (type_ != Type::Mixed && type_of(value) != type_)
+                {
+                    if (null_count_ == size_)
+                    {
+                        type_ = type_of(value);
+                        reset_storage();
                     }
-                    ++write_idx;
+                    else
+                    {
+                        promote_to_mixed();
+                    }
+                }
+                std::visit([this, i, &value](auto &vec)
+                           {
+                               using V = typename std::decay_t<decltype(vec)>::value_type;
+                               if constexpr (std::is_same_v<V, CellValue>)
+                                   vec[i] = value;
+                               else if constexpr (std::is_same_v<V, uint8_t>)
+                                   vec[i] = std::get<bool>(value);
+                               else if constexpr (std::is_same_v<V, std::string_view>)
+                                   vec[i] = strings_.store(std::get<std::string>(value));
+                               else if constexpr (!std::is_same_v<V, uint32_t>) // Categorical codes are set above
+                                   vec[i] = std::get<V>(value); },
+                           data_);
+                if (is_null(i))
+                {
+                    set_valid(i, true);
+                    --null_count_;
                 }
             }
 
-            if (show_progress) {
-                std::cerr << std::endl;
-            }
-
-            // Resize to actual number of kept rows
-            rows.resize(write_idx);
-            return write_idx;
-        }
-
-        /**
-         * @brief Creates a sub-table with selected rows.
-         * @param row_indices The indices of the rows to include.
-         * @return CSVTable A new table with the selected rows.
-         * @throws std::out_of_range If any row index is invalid.
-         */
-        CSVTable sub_table(const std::vector<int> &row_indices) const
-        {
-            std::vector<std::vector<CellValue>> selected_rows;
-            selected_rows.reserve(row_indices.size());  // Reserve exact size
-
-            for (int idx : row_indices)
+            /**
+             * @brief Appends a cell.
+             */
+            void push_back(const CellValue &value)
             {
-                if (static_cast<size_t>(idx) >= rows.size())
+                std::visit([](auto &vec)
+                           { vec.emplace_back(); },
+                           data_);
+                if (size_ % 64 == 0)
                 {
-                    throw std::out_of_range("Invalid row index: " + std::to_string(idx));
+                    validity_.push_back(0);
                 }
-                selected_rows.push_back(rows[idx]);
+                ++size_;
+                ++null_count_;
+                set(size_ - 1, value);
             }
-            return CSVTable(col_names, col_map, std::move(selected_rows));
-        }
 
-        /**
-         * @brief Modifies rows using a provided function.
-         * @param modifier A function that takes a row index and the table, modifying the row in place.
-         */
-        void modify(const std::function<void(int, CSVTable &)> &modifier)
-        {
-            for (size_t i : std::views::iota(0u, rows.size()))
+            /**
+             * @brief Appends a value, writing straight into the typed buffer when it matches the column type.
+             */
+            template <ConvertibleToCellValue T>
+            void push_back_value(T value)
             {
-                modifier(i, *this);
+                bool missing = false;
+                if constexpr (std::is_same_v<T, std::string>)
+                {
+                    missing = value.empty();
+                }
+                if (type_ != type_of<T>() || missing)
+                {
+                    push_back(CellValue(std::move(value)));
+                    return;
+                }
+                if constexpr (std::is_same_v<T, std::string>)
+                    std::get<std::vector<std::string_view>>(data_).push_back(strings_.store(value));
+                else
+                    std::get<std::vector<storage_type<T>>>(data_).push_back(static_cast<storage_type<T>>(value));
+                if (size_ % 64 == 0)
+                {
+                    validity_.push_back(0);
+                }
+                set_valid(size_++, true);
             }
-        }
-
-        /**
-         * @brief Drops rows with missing values in specified columns.
-         * @param columns The columns to check for missing values. If empty, checks all columns.
-         * @throws std::invalid_argument If any specified column does not exist.
-         */
-        void dropna(const std::vector<std::string> &columns = {})
-        {
-            static constexpr std::array missing_values = {"NA", "NaN", "#N/A", ""};
-            auto cols_to_check = columns.empty() ? col_names : columns;
 
-            for (const auto &col : cols_to_check)
+            /**
+             * @brief Appends a null cell.
+             */
+            void push_null()
             {
-                if (!col_map.contains(col))
+                std::visit([](auto &vec)
+                           { vec.emplace_back(); },
+                           data_);
+                if (size_ % 64 == 0)
                 {
-                    throw std::invalid_argument("Column name not found: " + col);
+                    validity_.push_back(0);
                 }
+                ++size_;
+                ++null_count_;
             }
 
-            std::vector<std::vector<CellValue>> new_rows;
-            for (const auto &row : rows)
+            /**
+             * @brief Appends n values of a numeric column's own type, with an Arrow-style validity bitmap.
+             * @param bitmap One bit per value starting at bit bitmap_offset (least significant first, 1 = valid),
+             * or nullptr when every value is valid.
+             * @throws std::runtime_error If the column is not of type type_of<T>().
+             */
+            template <typename T>
+                requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+            void append_values(const T *values, size_t n, const uint8_t *bitmap, size_t bitmap_offset)
             {
-                bool keep_row = true;
-                for (const auto &col : cols_to_check)
+                if (type_ != type_of<T>())
                 {
-                    int col_index = col_map.at(col);
-                    if (std::holds_alternative<std::string>(row[col_index]))
-                    {
-                        auto value = std::get<std::string>(row[col_index]);
-                        if (std::ranges::contains(missing_values, value))
-                        {
-                            keep_row = false;
-                            break;
-                        }
-                    }
+                    throw std::runtime_error("Type mismatch: column is not stored as the requested type");
                 }
-                if (keep_row)
+                auto &vec = std::get<std::vector<T>>(data_);
+                vec.insert(vec.end(), values, values + n);
+                validity_.resize((size_ + n + 63) / 64, 0);
+                for (size_t i = 0; i < n; ++i)
                 {
-                    new_rows.push_back(row);
+                    const size_t bit = bitmap_offset + i;
+                    if (bitmap && ((bitmap[bit >> 3] >> (bit & 7)) & 1) == 0)
+                        ++null_count_;
+                    else
+                        validity_[(size_ + i) >> 6] |= uint64_t(1) << ((size_ + i) & 63);
                 }
+                size_ += n;
             }
-            rows = std::move(new_rows);
-        }
 
-        /**
-         * @brief Renames columns based on a mapping.
-         * @param rename_map A map from old column names to new column names.
-         * @throws std::invalid_argument If an old column does not exist or a new column name already exists.
-         */
-        void rename_columns(const std::unordered_map<std::string, std::string, string_hash, string_equal> &rename_map)
-        {
-            for (const auto &[old_name, new_name] : rename_map)
+            /**
+             * @brief Calls f(i) for each valid cell, in order, walking the validity bitmap a word at a time.
+             */
+            template <typename F>
+            void for_each_valid(F &&f) const
             {
-                auto it = col_map.find(old_name);
-                if (it == col_map.end())
+                for (size_t w = 0; w < validity_.size(); ++w)
                 {
-                    throw std::invalid_argument("Column name not found: " + old_name);
+                    for (uint64_t word = validity_[w]; word != 0; word &= word - 1)
+                        f(w * 64 + std::countr_zero(word));
                 }
-                if (col_map.contains(new_name))
+            }
+
+            /**
+             * @brief Calls f(i) for each null cell, in order, skipping words without nulls.
+             */
+            template <typename F>
+            void for_each_null(F &&f) const
+            {
+                for (size_t w = 0; w < validity_.size(); ++w)
                 {
-                    throw std::invalid_argument("New column name already exists: " + new_name);
+                    uint64_t word = ~validity_[w];
+                    if (w + 1 == validity_.size() && size_ % 64 != 0)
+                        word &= (uint64_t(1) << (size_ % 64)) - 1;
+                    for (; word != 0; word &= word - 1)
+                        f(w * 64 + std::countr_zero(word));
                 }
-                int col_index = it->second;
-                col_map.erase(it);
-                col_map[new_name] = col_index;
-                col_names[col_index] = new_name;
             }
-        }
 
-        /**
-         * @brief Sorts the table by a column.
-         * @tparam T The type of the column to sort by.
-         * @param col_name The name of the column to sort by.
-         * @param ascending If true, sort in ascending order; otherwise, descending.
-         * @throws std::invalid_argument If the column does not exist.
-         * @throws std::runtime_error If conversion fails.
-         */
-        template <ConvertibleToCellValue T>
-        void sort_by_column(std::string_view col_name, bool ascending)
-        {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end())
+            /**
+             * @brief Writes value into every null cell; valid cells are not visited.
+             */
+            void fill_nulls(const CellValue &value)
             {
-                throw std::invalid_argument("Column not found: " + std::string(col_name));
+                if (null_count_ == 0 || is_missing(value))
+                {
+                    return;
+                }
+                // Each bitmap word is copied before its bits are visited, so set() may clear them
+                for_each_null([&](size_t i)
+                              { set(i, value); });
             }
-            int col_index = it->second;
-
-            std::ranges::sort(rows, [this, col_index, ascending](const auto &a, const auto &b)
-                              {
-                                  T val_a = convert_cell<T>(a[col_index]);
-                                  T val_b = convert_cell<T>(b[col_index]);
-                                  return ascending ? (val_a < val_b) : (val_a > val_b); });
-        }
 
-        /**
-         * @brief Fills missing values in specified columns with a given value.
-         * @tparam T The type of the fill value.
-         * @param columns The columns to fill.
-         * @param fill_value The value to use for filling.
-         * @throws std::invalid_argument If any specified column does not exist.
-         */
-        template <ConvertibleToCellValue T>
-        void fillna(const std::vector<std::string> &columns, const T &fill_value)
-        {
-            static constexpr std::array missing_values = {"NA", "NaN", "#N/A", ""};
-            for (const auto &col : columns)
+            /**
+             * @brief Appends all cells of another column.
+             */
+            void append(Column &&other)
             {
-                if (!col_map.contains(col))
+                if (size_ == 0 && (type_ != Type::Categorical || other.type_ == Type::Categorical))
                 {
-                    throw std::invalid_argument("Column name not found: " + col);
+                    *this = std::move(other);
+                    return;
                 }
-                int col_index = col_map.at(col);
-                for (auto &row : rows)
+                reserve(size_ + other.size_);
+                if (type_ == Type::Categorical && other.type_ == Type::Categorical)
+                {
+                    // Translate the other dictionary once, then copy codes
+                    std::vector<std::string_view> values(other.dictionary_->values.begin(), other.dictionary_->values.end());
+                    append_encoded(values, other.size_, [&other](size_t i)
+                                   { return other.is_null(i) ? std::nullopt : std::optional<size_t>(other.codes()[i]); });
+                    return;
+                }
+                if (type_ == other.type_)
                 {
-                    if (std::holds_alternative<std::string>(row[col_index]))
+                    // Same buffer type: move the values over and shift the validity words into place.
+                    // String views stay valid because the other column's blocks are shared.
+                    strings_.share(other.strings_);
+                    std::visit([&other](auto &vec)
+                               {
+                                   auto &other_vec = std::get<std::decay_t<decltype(vec)>>(other.data_);
+                                   vec.insert(vec.end(), std::make_move_iterator(other_vec.begin()),
+                                              std::make_move_iterator(other_vec.end())); },
+                               data_);
+                    const size_t shift = size_ % 64;
+                    validity_.resize((size_ + other.size_ + 63) / 64, 0);
+                    for (size_t w = 0; w < other.validity_.size(); ++w)
                     {
-                        auto value = std::get<std::string>(row[col_index]);
-                        if (std::ranges::contains(missing_values, value))
+                        const size_t dst = size_ / 64 + w;
+                        validity_[dst] |= other.validity_[w] << shift;
+                        if (shift != 0 && dst + 1 < validity_.size())
                         {
-                            row[col_index] = fill_value;
+                            validity_[dst + 1] |= other.validity_[w] >> (64 - shift);
                         }
                     }
+                    size_ += other.size_;
+                    null_count_ += other.null_count_;
+                    return;
                 }
-            }
-        }
-
-        /**
-         * @brief Drops duplicate rows based on specified columns.
-         * @param columns The columns to consider for duplicates. If empty, considers all columns.
-         * @throws std::invalid_argument If any specified column does not exist.
-         */
-        void drop_duplicates(const std::vector<std::string> &columns = {})
-        {
-            auto cols_to_check = columns.empty() ? col_names : columns;
-            for (const auto &col : cols_to_check)
-            {
-                if (!col_map.contains(col))
+                for (size_t i = 0; i < other.size_; ++i)
                 {
-                    throw std::invalid_argument("Column name not found: " + col);
+                    push_back(other.get(i));
                 }
             }
 
-            std::unordered_set<std::string> seen;
-            std::vector<std::vector<CellValue>> new_rows;
-            for (const auto &row : rows)
+            /**
+             * @brief Appends n cells to a Categorical column from codes into another list of values, such as
+             * an Arrow dictionary, interning each listed value once.
+             * @param values The values the codes refer to.
+             * @param code_at Callable returning the i-th cell's index into values, or std::nullopt for a null cell.
+             */
+            template <typename CodeAt>
+            void append_encoded(const std::vector<std::string_view> &values, size_t n, CodeAt &&code_at)
             {
-                std::stringstream key;
-                for (const auto &col : cols_to_check)
+                codes();
+                std::vector<uint32_t> remap;
+                remap.reserve(values.size());
+                for (std::string_view value : values)
                 {
-                    key << cell_to_string(row[col_map.at(col)]) << "|";
+                    remap.push_back(intern(std::string(value)));
                 }
-                auto row_key = key.str();
-                if (seen.insert(row_key).second)
+                reserve(size_ + n);
+                auto &codes = std::get<std::vector<uint32_t>>(data_);
+                for (size_t i = 0; i < n; ++i)
                 {
-                    new_rows.push_back(row);
+                    push_null();
+                    std::optional<size_t> code = code_at(i);
+                    if (code && !values[*code].empty()) // Empty strings are missing, as in set()
+                    {
+                        codes.back() = remap[*code];
+                        set_valid(size_ - 1, true);
+                        --null_count_;
+                    }
                 }
             }
-            rows = std::move(new_rows);
-        }
 
-        /**
-         * @brief Merges this table with another table based on common columns.
-         * @param other The other table to merge with.
-         * @param on_columns The columns to merge on.
-         * @param how The type of merge ("inner", "left", "right", "outer").
-         * @return CSVTable The merged table.
-         * @throws std::invalid_argument If on_columns are invalid or how is invalid.
-         */
-        CSVTable merge(const CSVTable &other, const std::vector<std::string> &on_columns, std::string_view how) const
-        {
-            if (!std::ranges::contains(std::array{"inner", "left", "right", "outer"}, how))
+            /**
+             * @brief Reserves capacity for n cells.
+             */
+            void reserve(size_t n)
             {
-                throw std::invalid_argument("Invalid join type: " + std::string(how));
+                std::visit([n](auto &vec)
+                           { vec.reserve(n); },
+                           data_);
+                validity_.reserve((n + 63) / 64);
             }
 
-            for (const auto &col : on_columns)
+            /**
+             * @brief Removes the cell at index i, shifting later cells down.
+             */
+            void erase(size_t i)
             {
-                if (!col_map.contains(col))
+                std::vector<char> keep(size_, 1);
+                keep[i] = 0;
+                retain(keep);
+            }
+
+            /**
+             * @brief Keeps the cells whose keep flag is non-zero, preserving their order.
+             * @param keep One flag per cell.
+             */
+            void retain(const std::vector<char> &keep)
+            {
+                std::vector<uint64_t> new_validity;
+                new_validity.reserve(validity_.size());
+                size_t write_idx = 0;
+                std::visit([&](auto &vec)
+                           {
+                               for (size_t read_idx = 0; read_idx < size_; ++read_idx)
+                               {
+                                   if (!keep[read_idx])
+                                       continue;
+                                   if (write_idx != read_idx)
+                                       vec[write_idx] = std::move(vec[read_idx]);
+                                   if (write_idx % 64 == 0)
+                                       new_validity.push_back(0);
+                                   if (!is_null(read_idx))
+                                       new_validity.back() |= uint64_t(1) << (write_idx & 63);
+                                   ++write_idx;
+                               }
+                               vec.resize(write_idx); },
+                           data_);
+                validity_ = std::move(new_validity);
+                size_ = write_idx;
+                recount_nulls();
+            }
+
+            /// Index that gather() turns into a null cell.
+            static constexpr size_t npos = static_cast<size_t>(-1);
+
+            /**
+             * @brief Builds a new column from the cells at the given indices, in that order.
+             * @param indices Cell indices; each must be smaller than size() or equal to npos (a null cell).
+             */
+            template <typename Indices>
+            Column gather(const Indices &indices) const
+            {
+                Column out(type_);
+                out.dictionary_ = dictionary_;
+                out.strings_ = strings_;
+                std::visit([&](const auto &vec)
+                           {
+                               auto &out_vec = std::get<std::decay_t<decltype(vec)>>(out.data_);
+                               out_vec.reserve(std::size(indices));
+                               out.validity_.reserve((std::size(indices) + 63) / 64);
+                               for (auto idx : indices)
+                               {
+                                   size_t src = static_cast<size_t>(idx);
+                                   out_vec.push_back(src == npos ? typename std::decay_t<decltype(vec)>::value_type() : vec[src]);
+                                   if (out.size_ % 64 == 0)
+                                       out.validity_.push_back(0);
+                                   if (src != npos && !is_null(src))
+                                       out.validity_.back() |= uint64_t(1) << (out.size_ & 63);
+                                   ++out.size_;
+                               } },
+                           data_);
+                out.recount_nulls();
+                return out;
+            }
+
+        private:
+            friend class CSVTable; // Snapshot reads and writes
+            using Storage = std::variant<std::vector<CellValue>, std::vector<std::string_view>, std::vector<int>,
+                                         std::vector<double>, std::vector<uint8_t>, std::vector<uint64_t>,
+                                         std::vector<uint32_t>>;
+
+            /// Distinct values of a Categorical column, with their codes and hashes (hash_value of the string).
+            struct Dictionary
+            {
+                std::vector<std::string> values;
+                std::vector<size_t> hashes;
+                std::unordered_map<std::string, uint32_t, string_hash, string_equal> codes;
+            };
+
+            /**
+             * @brief Bump allocator for the characters of a String column.
+             *
+             * Blocks are shared by copies and never written below their fill point, so a copy sees only
+             * bytes that are already final. Only the arena that allocated a block keeps filling it.
+             */
+            class StringArena
+            {
+            public:
+                StringArena() = default;
+                StringArena(const StringArena &other) : blocks_(other.blocks_) {}
+                StringArena(StringArena &&other) noexcept { swap(other); }
+                StringArena &operator=(const StringArena &other)
                 {
-                    throw std::invalid_argument("Column not found in left table: " + col);
+                    if (this != &other)
+                    {
+                        blocks_ = other.blocks_;
+                        next_ = end_ = nullptr;
+                    }
+                    return *this;
                 }
-                if (!other.col_map.contains(col))
+                StringArena &operator=(StringArena &&other) noexcept
                 {
-                    throw std::invalid_argument("Column not found in right table: " + col);
+                    StringArena moved(std::move(other));
+                    swap(moved);
+                    return *this;
                 }
-            }
 
-            std::vector<std::string> new_col_names = col_names;
-            std::unordered_map<std::string, int, string_hash, string_equal> new_col_map = col_map;
-            std::vector<std::string> other_to_new_names;
-            size_t non_key_cols = 0;
-            for (const auto &col : other.col_names)
-            {
-                if (std::find(on_columns.begin(), on_columns.end(), col) == on_columns.end())
+                /**
+                 * @brief Copies a string into the arena and returns a view of the copy.
+                 */
+                std::string_view store(std::string_view value)
                 {
-                    std::string new_name = col;
-                    int suffix = 0;
-                    while (new_col_map.contains(new_name))
+                    if (value.empty())
+                    {
+                        return {};
+                    }
+                    if (static_cast<size_t>(end_ - next_) < value.size())
                     {
-                        new_name = col + "_other" + (suffix ? std::to_string(suffix) : "");
-                        suffix++;
+                        // Blocks double up to max_block_size; longer strings get a block of their own
+                        size_t size = std::max(value.size(), std::min(max_block_size, min_block_size << std::min<size_t>(blocks_.size(), 8)));
+                        blocks_.push_back(std::make_shared_for_overwrite<char[]>(size));
+                        next_ = blocks_.back().get();
+                        end_ = next_ + size;
                     }
-                    other_to_new_names.push_back(new_name);
-                    new_col_names.push_back(new_name);
-                    new_col_map[new_name] = new_col_names.size() - 1;
-                    non_key_cols++;
+                    char *begin = next_;
+                    std::memcpy(begin, value.data(), value.size());
+                    next_ += value.size();
+                    return {begin, value.size()};
                 }
-                else
+
+                /**
+                 * @brief Keeps another arena's blocks alive, so views into them stay valid here.
+                 */
+                void share(const StringArena &other)
+                {
+                    blocks_.insert(blocks_.end(), other.blocks_.begin(), other.blocks_.end());
+                }
+
+                /**
+                 * @brief Keeps a block owned elsewhere (such as a mapped file) alive for views into it.
+                 */
+                void adopt(std::shared_ptr<char[]> block)
                 {
-                    other_to_new_names.push_back(col);
+                    blocks_.push_back(std::move(block));
                 }
+
+            private:
+                static constexpr size_t min_block_size = 4096;
+                static constexpr size_t max_block_size = size_t(1) << 20;
+
+                std::vector<std::shared_ptr<char[]>> blocks_;
+                char *next_ = nullptr; // Free space of the last block, when this arena allocated it
+                char *end_ = nullptr;
+
+                void swap(StringArena &other) noexcept
+                {
+                    blocks_.swap(other.blocks_);
+                    std::swap(next_, other.next_);
+                    std::swap(end_, other.end_);
+                }
+            };
+
+            Type type_ = Type::Mixed;
+            Storage data_;
+            StringArena strings_;                    // String only
+            std::shared_ptr<Dictionary> dictionary_; // Categorical only
+            std::vector<uint64_t> validity_;
+            size_t size_ = 0;
+            size_t null_count_ = 0;
+
+            bool is_text() const { return type_ == Type::String || type_ == Type::Categorical; }
+
+            /// A non-null cell of a String or Categorical column.
+            std::string_view text(size_t i) const
+            {
+                return type_ == Type::String ? std::get<std::vector<std::string_view>>(data_)[i]
+                                             : std::string_view(dictionary_->values[codes()[i]]);
             }
 
-            std::vector<std::vector<CellValue>> new_rows;
-            std::unordered_map<std::string, std::vector<size_t>> this_key_map;
-            for (size_t i = 0; i < rows.size(); ++i)
+            /// Returns the code of a value, adding it to the dictionary (unsharing it first) if it is new.
+            uint32_t intern(const std::string &value)
             {
-                std::stringstream key;
-                for (const auto &col : on_columns)
+                if (auto it = dictionary_->codes.find(value); it != dictionary_->codes.end())
+                {
+                    return it->second;
+                }
+                if (dictionary_.use_count() > 1)
+                {
+                    dictionary_ = std::make_shared<Dictionary>(*dictionary_);
+                }
+                if (dictionary_->values.size() > std::numeric_limits<uint32_t>::max())
                 {
-                    key << cell_to_string(rows[i][col_map.at(col)]) << "|";
+                    throw std::runtime_error("Too many categories in a categorical column");
                 }
-                this_key_map[key.str()].push_back(i);
+                uint32_t code = static_cast<uint32_t>(dictionary_->values.size());
+                dictionary_->values.push_back(value);
+                dictionary_->hashes.push_back(hash_value(value));
+                dictionary_->codes.emplace(value, code);
+                return code;
+            }
+
+            void set_valid(size_t i, bool valid)
+            {
+                uint64_t bit = uint64_t(1) << (i & 63);
+                validity_[i >> 6] = valid ? (validity_[i >> 6] | bit) : (validity_[i >> 6] & ~bit);
             }
 
-            std::unordered_map<std::string, std::vector<size_t>> other_key_map;
-            for (size_t i = 0; i < other.rows.size(); ++i)
+            void recount_nulls()
             {
-                std::stringstream key;
-                for (const auto &col : on_columns)
+                size_t valid = 0;
+                for (uint64_t word : validity_)
                 {
-                    key << cell_to_string(other.rows[i][other.col_map.at(col)]) << "|";
+                    valid += std::popcount(word);
                 }
-                other_key_map[key.str()].push_back(i);
+                null_count_ = size_ - valid;
             }
 
-            if (how == "inner" || how == "left" || how == "outer")
+            // Re-create the value buffer for type_, keeping size_ placeholder cells
+            void reset_storage()
             {
-                for (const auto &[key, this_indices] : this_key_map)
+                switch (type_)
                 {
-                    bool has_match = other_key_map.contains(key);
-                    auto other_indices = has_match ? other_key_map.at(key) : std::vector<size_t>{};
-
-                    if (how == "inner" && !has_match)
-                        continue;
-
-                    for (size_t this_idx : this_indices)
+                case Type::Mixed:
+                    data_.emplace<0>(size_);
+                    break;
+                case Type::String:
+                    data_.emplace<1>(size_);
+                    break;
+                case Type::Int:
+                    data_.emplace<2>(size_);
+                    break;
+                case Type::Double:
+                    data_.emplace<3>(size_);
+                    break;
+                case Type::Bool:
+                    data_.emplace<4>(size_);
+                    break;
+                case Type::UInt64:
+                    data_.emplace<5>(size_);
+                    break;
+                case Type::Categorical:
+                    data_.emplace<6>(size_);
+                    if (!dictionary_)
                     {
-                        if (has_match)
-                        {
-                            for (size_t other_idx : other_indices)
-                            {
-                                std::vector<CellValue> new_row(new_col_names.size());
-                                for (const auto &col : col_names)
-                                {
-                                    new_row[new_col_map.at(col)] = rows[this_idx][col_map.at(col)];
-                                }
-                                for (size_t i = 0; i < other.col_names.size(); ++i)
-                                {
-                                    if (std::find(on_columns.begin(), on_columns.end(), other.col_names[i]) == on_columns.end())
-                                    {
-                                        new_row[new_col_map.at(other_to_new_names[i])] = other.rows[other_idx][i];
-                                    }
-                                }
-                                new_rows.push_back(std::move(new_row));
-                            }
-                        }
-                        else
-                        {
-                            std::vector<CellValue> new_row(new_col_names.size());
-                            for (const auto &col : col_names)
-                            {
-                                new_row[new_col_map.at(col)] = rows[this_idx][col_map.at(col)];
-                            }
-                            for (size_t i = 0; i < non_key_cols; ++i)
-                            {
-                                new_row[new_col_map.at(other_to_new_names[on_columns.size() + i])] = std::string("");
-                            }
-                            new_rows.push_back(std::move(new_row));
-                        }
+                        dictionary_ = std::make_shared<Dictionary>();
                     }
+                    break;
                 }
             }
 
-            if (how == "right" || how == "outer")
+            void promote_to_mixed()
             {
-                for (const auto &[key, other_indices] : other_key_map)
+                std::vector<CellValue> mixed;
+                mixed.reserve(size_);
+                for (size_t i = 0; i < size_; ++i)
                 {
-                    bool has_match = this_key_map.contains(key);
-                    if (has_match && how != "outer")
-                        continue;
+                    mixed.push_back(get(i));
+                }
+                data_ = std::move(mixed);
+                type_ = Type::Mixed;
+                strings_ = StringArena();
+                dictionary_.reset();
+            }
 
-                    for (size_t other_idx : other_indices)
+            /**
+             * @brief Writes the column as read_snapshot reads it: type, size, validity bitmap, then the
+             * value buffer. Strings are one blob plus size() + 1 offsets, Categorical columns their
+             * dictionary plus codes, and Mixed cells are tagged values.
+             */
+            void write_snapshot(std::ostream &out) const
+            {
+                write_pod(out, static_cast<uint8_t>(type_));
+                write_pod(out, static_cast<uint64_t>(size_));
+                write_array(out, validity_.data(), validity_.size());
+                switch (type_)
+                {
+                case Type::Mixed:
+                    for (const CellValue &value : std::get<std::vector<CellValue>>(data_))
                     {
-                        std::vector<CellValue> new_row(new_col_names.size());
-                        for (const auto &col : on_columns)
-                        {
-                            new_row[new_col_map.at(col)] = other.rows[other_idx][other.col_map.at(col)];
-                        }
-                        for (const auto &col : col_names)
-                        {
-                            if (std::find(on_columns.begin(), on_columns.end(), col) == on_columns.end())
-                            {
-                                new_row[new_col_map.at(col)] = std::string("");
-                            }
-                        }
-                        for (size_t i = 0; i < other.col_names.size(); ++i)
+                        write_pod(out, static_cast<uint8_t>(value.index()));
+                        std::visit([&](const auto &v)
+                                   {
+                                       using V = std::decay_t<decltype(v)>;
+                                       if constexpr (std::is_same_v<V, std::string>)
+                                           write_text(out, v);
+                                       else
+                                           write_pod(out, v); },
+                                   value);
+                    }
+                    break;
+                case Type::String:
+                {
+                    const auto &views = std::get<std::vector<std::string_view>>(data_);
+                    std::vector<uint64_t> offsets(size_ + 1, 0);
+                    for (size_t i = 0; i < size_; ++i)
+                    {
+                        offsets[i + 1] = offsets[i] + views[i].size();
+                    }
+                    write_pod(out, offsets.back());
+                    for (std::string_view view : views)
+                    {
+                        out.write(view.data(), static_cast<std::streamsize>(view.size()));
+                    }
+                    write_array(out, offsets.data(), offsets.size());
+                    break;
+                }
+                case Type::Categorical:
+                    write_pod(out, static_cast<uint64_t>(dictionary_->values.size()));
+                    for (const auto &value : dictionary_->values)
+                    {
+                        write_text(out, value);
+                    }
+                    write_array(out, codes().data(), size_);
+                    break;
+                default:
+                    std::visit([&](const auto &vec)
+                               {
+                                   if constexpr (std::is_arithmetic_v<typename std::decay_t<decltype(vec)>::value_type>)
+                                       write_array(out, vec.data(), vec.size()); },
+                               data_);
+                    break;
+                }
+            }
+
+            /**
+             * @brief Reads a column written by write_snapshot. Numeric buffers are copied out of the file in
+             * one block; string cells are views into the file, which their blocks keep mapped.
+             * @throws std::runtime_error If the data is truncated or inconsistent.
+             */
+            static Column read_snapshot(SnapshotReader &in)
+            {
+                const auto raw_type = in.read<uint8_t>();
+                if (raw_type > static_cast<uint8_t>(Type::Categorical))
+                {
+                    throw std::runtime_error("Snapshot file is truncated or corrupt");
+                }
+                Column column(static_cast<Type>(raw_type));
+                column.size_ = in.read<uint64_t>();
+                in.require(column.size_ / 64 + (column.size_ % 64 != 0), sizeof(uint64_t));
+                column.validity_.resize((column.size_ + 63) / 64);
+                in.read_array(column.validity_.data(), column.validity_.size());
+                if (column.size_ % 64 != 0)
+                {
+                    column.validity_.back() &= (uint64_t(1) << (column.size_ % 64)) - 1;
+                }
+                column.recount_nulls();
+                const size_t n = column.size_;
+                auto corrupt = []
+                { return std::runtime_error("Snapshot file is truncated or corrupt"); };
+                switch (column.type_)
+                {
+                case Type::Mixed:
+                {
+                    in.require(n, sizeof(uint8_t)); // Every cell has at least its type tag
+                    std::vector<CellValue> cells(n);
+                    for (auto &cell : cells)
+                    {
+                        switch (in.read<uint8_t>())
                         {
-                            if (std::find(on_columns.begin(), on_columns.end(), other.col_names[i]) == on_columns.end())
-                            {
-                                new_row[new_col_map.at(other_to_new_names[i])] = other.rows[other_idx][i];
-                            }
+                        case 0: cell = std::string(in.read_text()); break;
+                        case 1: cell = in.read<int>(); break;
+                        case 2: cell = in.read<double>(); break;
+                        case 3: cell = in.read<bool>(); break;
+                        case 4: cell = in.read<uint64_t>(); break;
+                        default: throw corrupt();
                         }
-                        new_rows.push_back(std::move(new_row));
                     }
+                    column.data_ = std::move(cells);
+                    break;
+                }
+                case Type::String:
+                {
+                    std::string_view blob = in.bytes(in.read<uint64_t>());
+                    in.require(n, sizeof(uint64_t));
+                    std::vector<uint64_t> offsets(n + 1);
+                    in.read_array(offsets.data(), offsets.size());
+                    auto &views = std::get<std::vector<std::string_view>>(column.data_);
+                    views.resize(n);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > blob.size())
+                            throw corrupt();
+                        views[i] = blob.substr(offsets[i], offsets[i + 1] - offsets[i]);
+                    }
+                    column.strings_.adopt(std::shared_ptr<char[]>(in.file, const_cast<char *>(blob.data())));
+                    break;
+                }
+                case Type::Categorical:
+                {
+                    const auto count = in.read<uint64_t>();
+                    in.require(count, sizeof(uint64_t)); // Every value has at least its length
+                    for (uint64_t code = 0; code < count; ++code)
+                    {
+                        std::string value(in.read_text());
+                        column.dictionary_->hashes.push_back(hash_value(value));
+                        column.dictionary_->codes.emplace(value, static_cast<uint32_t>(code));
+                        column.dictionary_->values.push_back(std::move(value));
+                    }
+                    auto &codes = std::get<std::vector<uint32_t>>(column.data_);
+                    in.require(n, sizeof(uint32_t));
+                    codes.resize(n);
+                    in.read_array(codes.data(), n);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        if (!column.is_null(i) && codes[i] >= count)
+                            throw corrupt();
+                    }
+                    break;
+                }
+                default:
+                    std::visit([&](auto &vec)
+                               {
+                                   if constexpr (std::is_arithmetic_v<typename std::decay_t<decltype(vec)>::value_type>)
+                                   {
+                                       in.require(n, sizeof(typename std::decay_t<decltype(vec)>::value_type));
+                                       vec.resize(n);
+                                       in.read_array(vec.data(), n);
+                                   } },
+                               column.data_);
+                    break;
                 }
+                return column;
             }
-
-            return CSVTable(std::move(new_col_names), std::move(new_col_map), std::move(new_rows));
-        }
+        };
 
         /**
-         * @brief Joins this table with another table based on row indices.
-         * @param other The other table to join with.
-         * @param how The type of join ("inner", "left", "right", "outer").
-         * @return CSVTable The joined table.
-         * @throws std::invalid_argument If how is invalid.
+         * @brief Typed access to one column through an index resolved once, for hot loops.
+         *
+         * Obtained from table.column<T>(name). Reads convert like get<T>; a columnar column stored as T is
+         * read straight from its buffer. operator[] does not check the row index, at() does. A handle from
+         * a non-const table can also write cells. The handle is invalidated by any change to the table's
+         * columns, storage mode or number of rows.
+         *
+         * @code
+         * auto value = table.column<double>("value");
+         * auto rows = table.filter_rows([&](int r) { return value[r] > 100.0; });
+         * @endcode
          */
-        CSVTable join(const CSVTable &other, std::string_view how) const
+        template <ConvertibleToCellValue T>
+        class ColumnHandle
         {
-            if (!std::ranges::contains(std::array{"inner", "left", "right", "outer"}, how))
+        public:
+            /**
+             * @brief Iterates over the column's values converted to T, in row order.
+             */
+            class iterator
             {
-                throw std::invalid_argument("Invalid join type: " + std::string(how));
-            }
+            public:
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
 
-            std::vector<std::string> new_col_names;
-            std::vector<std::pair<int, int>> column_sources;
-            for (const auto &col : col_names)
-            {
-                new_col_names.push_back(col);
-                column_sources.push_back({0, col_map.at(col)});
-            }
-            for (const auto &col : other.col_names)
-            {
-                std::string new_name = col;
-                int suffix = 0;
-                while (std::find(new_col_names.begin(), new_col_names.end(), new_name) != new_col_names.end())
+                iterator() = default;
+                T operator*() const { return (*handle_)[row_]; }
+                iterator &operator++()
                 {
-                    new_name = col + "_other" + (suffix ? std::to_string(suffix) : "");
-                    suffix++;
+                    ++row_;
+                    return *this;
                 }
-                new_col_names.push_back(new_name);
-                column_sources.push_back({1, other.col_map.at(col)});
-            }
+                iterator operator++(int)
+                {
+                    iterator previous = *this;
+                    ++row_;
+                    return previous;
+                }
+                bool operator==(const iterator &other) const { return row_ == other.row_; }
 
-            size_t N;
-            if (how == "inner")
+            private:
+                friend class ColumnHandle;
+                const ColumnHandle *handle_ = nullptr;
+                size_t row_ = 0;
+                iterator(const ColumnHandle *handle, size_t row) : handle_(handle), row_(row) {}
+            };
+
+            /**
+             * @brief Reads a cell without checking the row index.
+             * @throws std::runtime_error If the value cannot be converted, as in get<T>.
+             */
+            T operator[](size_t row) const
             {
-                N = std::min(rows.size(), other.rows.size());
+                if (data_ && ((validity_[row >> 6] >> (row & 63)) & 1))
+                {
+                    return static_cast<T>(data_[row]);
+                }
+                return table_->template value_as<T>(row, col_);
             }
-            else if (how == "left")
+
+            /**
+             * @brief Reads a cell.
+             * @throws std::out_of_range If the row index is invalid.
+             * @throws std::runtime_error If the value cannot be converted, as in get<T>.
+             */
+            T at(size_t row) const
             {
-                N = rows.size();
+                if (row >= size_)
+                {
+                    throw std::out_of_range("Row index out of range");
+                }
+                return (*this)[row];
             }
-            else if (how == "right")
+
+            /**
+             * @brief Writes a cell, as table[row][col] = value does.
+             * @throws std::out_of_range If the row index is invalid.
+             * @throws std::runtime_error If the handle was obtained from a const table.
+             */
+            void set(size_t row, const T &value)
             {
-                N = other.rows.size();
+                if (!writable_)
+                {
+                    throw std::runtime_error("Column handle is read-only");
+                }
+                if (row >= size_)
+                {
+                    throw std::out_of_range("Row index out of range");
+                }
+                writable_->set_cell(row, col_, value);
+                bind(); // A write can retype the column or move its buffer
             }
-            else
+
+            /**
+             * @brief Checks whether a cell holds the missing-value marker.
+             */
+            bool is_missing(size_t row) const
             {
-                N = std::max(rows.size(), other.rows.size());
+                return Column::is_missing(table_->cell_at(row, col_));
             }
 
-            std::vector<CellValue> default_this(col_names.size(), std::string(""));
-            std::vector<CellValue> default_other(other.col_names.size(), std::string(""));
+            /**
+             * @brief Checks whether values() is available: the table is columnar and the column is stored as T.
+             */
+            bool contiguous() const { return data_ != nullptr; }
 
-            std::vector<std::vector<CellValue>> new_rows;
-            for (size_t i = 0; i < N; ++i)
+            /**
+             * @brief Returns the column's value buffer; null cells hold an unspecified value.
+             * @throws std::runtime_error If the column is not stored contiguously as T (see contiguous()).
+             */
+            std::span<const Column::storage_type<T>> values() const
             {
-                const std::vector<CellValue> &this_row = (i < rows.size()) ? rows[i] : default_this;
-                const std::vector<CellValue> &other_row = (i < other.rows.size()) ? other.rows[i] : default_other;
-                std::vector<CellValue> new_row;
-                for (const auto &[table, orig_index] : column_sources)
+                if (!data_)
                 {
-                    if (table == 0)
-                    {
-                        new_row.push_back(this_row[orig_index]);
-                    }
-                    else
-                    {
-                        new_row.push_back(other_row[orig_index]);
-                    }
+                    throw std::runtime_error("Column is not stored as a contiguous buffer of the requested type");
                 }
-                new_rows.push_back(std::move(new_row));
+                return {data_, size_};
             }
 
-            std::unordered_map<std::string, int, string_hash, string_equal> new_col_map;
-            for (size_t i = 0; i < new_col_names.size(); ++i)
-            {
-                new_col_map[new_col_names[i]] = i;
-            }
+            size_t size() const { return size_; }
+            int index() const { return col_; }
+            iterator begin() const { return iterator(this, 0); }
+            iterator end() const { return iterator(this, size_); }
 
-            return CSVTable(std::move(new_col_names), std::move(new_col_map), std::move(new_rows));
-        }
+        private:
+            friend class CSVTable;
 
-        /**
-         * @brief Saves the table to a CSV file.
-         * @param filename The path to save the file.
-         * @throws std::runtime_error If the file cannot be opened for writing.
-         */
-        void save_to_file(std::string_view filename) const
-        {
-            std::ofstream file(filename.data());
-            if (!file.is_open())
-            {
-                throw std::runtime_error("Cannot open file for writing: " + std::string(filename));
-            }
+            const CSVTable *table_;
+            CSVTable *writable_;
+            int col_;
+            size_t size_;
+            const Column::storage_type<T> *data_ = nullptr; // Typed columnar buffer, when there is one
+            const uint64_t *validity_ = nullptr;
 
-            // Write headers without quotes
-            for (size_t i : std::views::iota(0u, col_names.size()))
+            ColumnHandle(const CSVTable &table, CSVTable *writable, int col)
+                : table_(&table), writable_(writable), col_(col), size_(table.row_count())
             {
-                file << col_names[i];
-                if (i < col_names.size() - 1)
-                    file << ",";
+                bind();
             }
-            file << "\n";
 
-            // Write rows without quotes
-            for (const auto &row : rows)
+            void bind()
             {
-                for (size_t i : std::views::iota(0u, row.size()))
-                {
-                    file << cell_to_string(row[i]);
-                    if (i < row.size() - 1)
-                        file << ",";
-                }
-                file << "\n";
+                const bool typed = table_->mode == StorageMode::Columnar && table_->cols[col_].type() == Column::type_of<T>();
+                data_ = typed ? table_->cols[col_].template values<T>().data() : nullptr;
+                validity_ = typed ? table_->cols[col_].validity().data() : nullptr;
             }
-        }
+        };
 
         /**
-         * @brief Reads a Parquet file into the table.
-         * @param filename The path to the Parquet file.
-         * @throws std::runtime_error If the file cannot be opened or read.
+         * @brief Base of the typed expressions built from col<T>(name), literals and operators, such as
+         * CSVTable::col<double>("price") * CSVTable::col<int>("qty").
+         *
+         * An expression is a tree of types, so each one compiles to its own evaluator. bind() resolves the
+         * columns once: a columnar column stored as the requested type is read in place, and any other
+         * column is converted once into a buffer of that type (throwing as get<T> does if a cell does not
+         * convert). The evaluator then runs plain loops over typed buffers, which the compiler can
+         * vectorize, and combines validity bitmaps a word at a time.
+         *
+         * Operands are int, double, bool or uint64_t. +, -, *, / and unary - follow C++ promotion rules;
+         * comparisons, &&, || and ! give bool. A result is missing when an operand is missing (an empty or
+         * NA cell), and integer division by zero is missing too.
+         *
+         * compute_column() writes an expression into a column, select() evaluates a bool expression into a
+         * Selection, and LazyTable::with_column and LazyTable::filter take expressions as stages.
          */
-        void read_parquet(std::string_view filename)
+        struct ExprNode;
+
+        template <typename E>
+        static constexpr bool is_expression = std::derived_from<E, ExprNode>;
+
+        // An operator builds an expression when one operand is an expression and the other is one or a literal
+        template <typename L, typename R>
+        static constexpr bool expression_operands = (is_expression<L> || is_expression<R>) &&
+                                                    (is_expression<L> || NumericCellValue<L>) &&
+                                                    (is_expression<R> || NumericCellValue<R>);
+
+        struct ExprNode
         {
-            try {
-                // Open the Parquet file
-                std::shared_ptr<arrow::io::ReadableFile> infile;
-                PARQUET_ASSIGN_OR_THROW(
-                    infile,
-                    arrow::io::ReadableFile::Open(std::string(filename))
-                );
-
-                // Create a Parquet reader
-                std::unique_ptr<parquet::arrow::FileReader> reader;
-                PARQUET_THROW_NOT_OK(
-                    parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader)
-                );
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator+(const L &lhs, const R &rhs) { return make_binary<std::plus<>>(lhs, rhs); }
 
-                // Read the entire file as a table
-                std::shared_ptr<arrow::Table> table;
-                PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator-(const L &lhs, const R &rhs) { return make_binary<std::minus<>>(lhs, rhs); }
 
-                // Extract column names
-                std::vector<std::string> new_col_names;
-                for (int i = 0; i < table->num_columns(); ++i) {
-                    new_col_names.push_back(table->schema()->field(i)->name());
-                }
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator*(const L &lhs, const R &rhs) { return make_binary<std::multiplies<>>(lhs, rhs); }
 
-                // Initialize or verify column names
-                if (col_names.empty()) {
-                    col_names = new_col_names;
-                    for (size_t i = 0; i < col_names.size(); ++i) {
-                        col_map[col_names[i]] = i;
-                    }
-                } else {
-                    if (new_col_names != col_names) {
-                        throw std::runtime_error("Column names in Parquet file do not match existing table");
-                    }
-                }
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator/(const L &lhs, const R &rhs) { return make_binary<std::divides<>>(lhs, rhs); }
 
-                // Convert Arrow table to CSVTable rows
-                size_t num_rows = table->num_rows();
-                size_t num_cols = table->num_columns();
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator==(const L &lhs, const R &rhs) { return make_binary<std::equal_to<>>(lhs, rhs); }
 
-                // Pre-extract all column arrays (MUCH faster!)
-                std::vector<std::shared_ptr<arrow::Array>> column_arrays;
-                column_arrays.reserve(num_cols);
-                for (int col_idx = 0; col_idx < table->num_columns(); ++col_idx) {
-                    auto chunked_array = table->column(col_idx);
-                    column_arrays.push_back(chunked_array->chunk(0));
-                }
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator!=(const L &lhs, const R &rhs) { return make_binary<std::not_equal_to<>>(lhs, rhs); }
 
-                // Reserve space for all rows
-                rows.reserve(num_rows);
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator<(const L &lhs, const R &rhs) { return make_binary<std::less<>>(lhs, rhs); }
 
-                // Progress reporting
-                size_t progress_interval = std::max(size_t(1), num_rows / 100);  // Report every 1%
-                auto start_time = std::chrono::steady_clock::now();
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator<=(const L &lhs, const R &rhs) { return make_binary<std::less_equal<>>(lhs, rhs); }
 
-                for (size_t row_idx = 0; row_idx < num_rows; ++row_idx) {
-                    std::vector<CellValue> row;
-                    row.reserve(num_cols);
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator>(const L &lhs, const R &rhs) { return make_binary<std::greater<>>(lhs, rhs); }
 
-                    for (size_t col_idx = 0; col_idx < num_cols; ++col_idx) {
-                        CellValue cell_value = arrow_value_to_cell(column_arrays[col_idx], row_idx);
-                        row.push_back(cell_value);
-                    }
-                    rows.push_back(std::move(row));
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator>=(const L &lhs, const R &rhs) { return make_binary<std::greater_equal<>>(lhs, rhs); }
 
-                    // Progress reporting
-                    if (row_idx % progress_interval == 0 || row_idx == num_rows - 1) {
-                        double progress = (row_idx + 1) * 100.0 / num_rows;
-                        auto now = std::chrono::steady_clock::now();
-                        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-                        double rows_per_sec = (row_idx + 1) * 1000.0 / (elapsed + 1);
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator&&(const L &lhs, const R &rhs) { return make_binary<std::logical_and<>>(lhs, rhs); }
 
-                        std::cerr << "\rReading Parquet: " << std::fixed << std::setprecision(1)
-                                  << progress << "% (" << (row_idx + 1) << "/" << num_rows
-                                  << " rows, " << std::setprecision(0) << rows_per_sec << " rows/sec)"
-                                  << std::flush;
-                    }
-                }
-                std::cerr << std::endl;
-            } catch (const parquet::ParquetException& e) {
-                throw std::runtime_error("Parquet error: " + std::string(e.what()));
-            } catch (const arrow::Status& status) {
-                throw std::runtime_error("Arrow error: " + status.ToString());
+            template <typename L, typename R>
+                requires expression_operands<L, R>
+            friend auto operator||(const L &lhs, const R &rhs) { return make_binary<std::logical_or<>>(lhs, rhs); }
+
+            template <typename E>
+                requires is_expression<E>
+            friend auto operator-(const E &operand) { return UnaryExpr<std::negate<>, E>(operand); }
+
+            template <typename E>
+                requires is_expression<E>
+            friend auto operator!(const E &operand) { return UnaryExpr<std::logical_not<>, E>(operand); }
+
+        private:
+            // Wraps a literal operand, so operators can combine expressions with plain values
+            template <typename T>
+            static auto as_expression(const T &operand)
+            {
+                if constexpr (is_expression<T>)
+                    return operand;
+                else
+                    return LiteralExpr<T>(operand);
             }
-        }
+
+            template <typename Op, typename L, typename R>
+            static auto make_binary(const L &lhs, const R &rhs)
+            {
+                return BinaryExpr<Op, decltype(as_expression(lhs)), decltype(as_expression(rhs))>(as_expression(lhs), as_expression(rhs));
+            }
+        };
 
         /**
-         * @brief Saves the table to a Parquet file.
-         * @param filename The path to save the Parquet file.
-         * @throws std::runtime_error If the file cannot be written.
+         * @brief An expression reading a column as T; created by col<T>(name).
          */
-        void save_to_parquet(std::string_view filename) const
+        template <NumericCellValue T>
+        class ColumnExpr : public ExprNode
         {
-            try {
-                // Build Arrow schema and arrays
-                std::vector<std::shared_ptr<arrow::Field>> fields;
-                std::vector<std::shared_ptr<arrow::Array>> arrays;
+        public:
+            using value_type = T;
+
+            explicit ColumnExpr(std::string_view col_name) : name_(col_name) {}
+
+            /// The column bound to a table; null cells hold an unspecified value.
+            class Bound
+            {
+            public:
+                Bound(Bound &&) = default;
+                T operator[](size_t row) const { return static_cast<T>(data_[row]); }
 
-                for (size_t col_idx = 0; col_idx < col_names.size(); ++col_idx) {
-                    auto [field, array] = build_arrow_column(col_idx);
-                    fields.push_back(field);
-                    arrays.push_back(array);
+                /// Clears the bits of null cells in words covering rows [begin, end), begin a multiple of 64.
+                void mask(uint64_t *words, size_t begin, size_t end) const
+                {
+                    for (size_t w = begin / 64; w < (end + 63) / 64; ++w)
+                        words[w] &= validity_[w];
                 }
 
-                auto schema = arrow::schema(fields);
-                auto table = arrow::Table::Make(schema, arrays);
+            private:
+                friend class ColumnExpr;
+                std::vector<Column::storage_type<T>> owned_;
+                std::vector<uint64_t> owned_validity_;
+                const Column::storage_type<T> *data_ = nullptr;
+                const uint64_t *validity_ = nullptr;
 
-                // Open output file
-                std::shared_ptr<arrow::io::FileOutputStream> outfile;
-                PARQUET_ASSIGN_OR_THROW(
-                    outfile,
-                    arrow::io::FileOutputStream::Open(std::string(filename))
-                );
+                Bound() = default;
+            };
 
-                // Write the table to Parquet
-                PARQUET_THROW_NOT_OK(
-                    parquet::arrow::WriteTable(*table, arrow::default_memory_pool(), outfile, rows.size())
-                );
-            } catch (const parquet::ParquetException& e) {
-                throw std::runtime_error("Parquet error: " + std::string(e.what()));
-            } catch (const arrow::Status& status) {
-                throw std::runtime_error("Arrow error: " + status.ToString());
+            /**
+             * @brief Resolves the column in a table, converting it unless it is a columnar column stored as T.
+             * @throws std::invalid_argument If the column does not exist, or a cell cannot be converted to T (as in get<T>).
+             */
+            Bound bind(const CSVTable &table) const
+            {
+                const int col = table.get_column_index(name_);
+                Bound bound;
+                if (table.mode == StorageMode::Columnar && table.cols[col].type() == Column::type_of<T>())
+                {
+                    bound.data_ = table.cols[col].template values<T>().data();
+                    bound.validity_ = table.cols[col].validity().data();
+                    return bound;
+                }
+                const size_t n = table.row_count();
+                bound.owned_.resize(n);
+                bound.owned_validity_.assign((n + 63) / 64, 0);
+                for (size_t r = 0; r < n; ++r)
+                {
+                    if (table.mode == StorageMode::Columnar ? table.cols[col].is_null(r) : missing(table.rows[r][col]))
+                        continue;
+                    bound.owned_[r] = static_cast<Column::storage_type<T>>(table.template value_as<T>(r, col));
+                    bound.owned_validity_[r >> 6] |= uint64_t(1) << (r & 63);
+                }
+                bound.data_ = bound.owned_.data();
+                bound.validity_ = bound.owned_validity_.data();
+                return bound;
             }
-        }
 
-        /**
-         * @brief Streams the table to an output stream.
-         * @param os The output stream.
-         * @param table The table to stream.
-         * @return std::ostream& The output stream.
-         */
-        friend std::ostream &operator<<(std::ostream &os, const CSVTable &table)
-        {
-            for (size_t i : std::views::iota(0u, table.col_names.size()))
+            /// Evaluates the expression for one row of a row view with value(name), such as LazyTable::LazyRow.
+            template <typename Row>
+            std::optional<T> evaluate(const Row &row) const
             {
-                os << table.col_names[i];
-                if (i < table.col_names.size() - 1)
-                    os << ",";
+                CellValue value = row.value(name_);
+                if (missing(value))
+                    return std::nullopt;
+                return convert_cell<T>(value);
             }
-            os << "\n";
-            for (const auto &row : table.rows)
+
+            void columns(std::vector<std::string> &out) const
             {
-                for (size_t i : std::views::iota(0u, row.size()))
-                {
-                    os << cell_to_string(row[i]);
-                    if (i < row.size() - 1)
-                        os << ",";
-                }
-                os << "\n";
+                if (!std::ranges::contains(out, name_))
+                    out.push_back(name_);
             }
-            return os;
-        }
+
+        private:
+            std::string name_;
+
+            static bool missing(const CellValue &value)
+            {
+                return std::holds_alternative<std::string>(value) && is_na_string(std::get<std::string>(value));
+            }
+        };
 
         /**
-         * @brief Gets the rows of the table.
-         * @return std::vector<std::vector<CellValue>>& A reference to the rows.
+         * @brief A constant operand of an expression.
          */
-        std::vector<std::vector<CellValue>> &get_rows()
+        template <NumericCellValue T>
+        class LiteralExpr : public ExprNode
         {
-            return rows;
-        }
+        public:
+            using value_type = T;
 
-        /**
-         * @brief Deletes a row from the table by its index.
-         *
-         * This function removes the row at the specified index from the table.
-         * If the index is out of range, it throws a std::out_of_range exception.
-         *
-         * @param index The zero-based index of the row to delete.
-         * @throws std::out_of_range If the index is greater than or equal to the number of rows.
-         */
-        void delete_row(size_t index) {
-            if (index < rows.size()) {
-                rows.erase(rows.begin() + index);
-            } else {
-                throw std::out_of_range("Index out of range");
-            }
-        }
+            explicit LiteralExpr(T value) : value_(value) {}
 
-        /**
-         * @brief Removes rows from the table that satisfy a given condition.
-         *
-         * This function removes all rows from the table for which the provided condition function returns true.
-         * The condition function should take a const reference to a row (std::vector<CellValue>) and return a boolean.
-         *
-         * @param condition A function that takes a row and returns true if the row should be removed.
-         */
-        void remove_rows(std::function<bool(const std::vector<CellValue>&)> condition) {
-            rows.erase(std::remove_if(rows.begin(), rows.end(), condition), rows.end());
-        }
+            struct Bound
+            {
+                T value;
+                T operator[](size_t) const { return value; }
+                void mask(uint64_t *, size_t, size_t) const {}
+            };
+
+            Bound bind(const CSVTable &) const { return {value_}; }
+
+            template <typename Row>
+            std::optional<T> evaluate(const Row &) const { return value_; }
+
+            void columns(std::vector<std::string> &) const {}
+
+        private:
+            T value_;
+        };
 
         /**
-         * @brief Gets the column names of the table.
-         * @return const std::vector<std::string>& A reference to the column names.
+         * @brief An operator applied to two expressions.
          */
-        auto get_col_names() const -> const std::vector<std::string> &
+        template <typename Op, typename L, typename R>
+        class BinaryExpr : public ExprNode
         {
-            return col_names;
-        }
+        public:
+            using value_type = decltype(Op{}(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()));
+            static_assert(NumericCellValue<value_type>, "Expression result must be int, double, bool or uint64_t");
+
+            BinaryExpr(L lhs, R rhs) : lhs_(std::move(lhs)), rhs_(std::move(rhs)) {}
+
+            struct Bound
+            {
+                typename L::Bound lhs;
+                typename R::Bound rhs;
+
+                value_type operator[](size_t row) const
+                {
+                    if constexpr (integer_division)
+                    {
+                        auto divisor = rhs[row];
+                        return divisor == 0 ? value_type() : Op{}(lhs[row], divisor);
+                    }
+                    else
+                        return Op{}(lhs[row], rhs[row]);
+                }
+
+                void mask(uint64_t *words, size_t begin, size_t end) const
+                {
+                    lhs.mask(words, begin, end);
+                    rhs.mask(words, begin, end);
+                    if constexpr (integer_division)
+                    {
+                        for (size_t r = begin; r < end; ++r)
+                            if (rhs[r] == 0)
+                                words[r >> 6] &= ~(uint64_t(1) << (r & 63));
+                    }
+                }
+            };
+
+            Bound bind(const CSVTable &table) const { return {lhs_.bind(table), rhs_.bind(table)}; }
+
+            template <typename Row>
+            std::optional<value_type> evaluate(const Row &row) const
+            {
+                auto lhs = lhs_.evaluate(row);
+                auto rhs = rhs_.evaluate(row);
+                if (!lhs || !rhs || (integer_division && *rhs == 0))
+                    return std::nullopt;
+                return Op{}(*lhs, *rhs);
+            }
+
+            void columns(std::vector<std::string> &out) const
+            {
+                lhs_.columns(out);
+                rhs_.columns(out);
+            }
+
+        private:
+            static constexpr bool integer_division = std::is_same_v<Op, std::divides<>> && std::is_integral_v<value_type>;
+            L lhs_;
+            R rhs_;
+        };
 
         /**
-         * @brief Gets the number of rows in the table.
-         * @return size_t The number of rows.
+         * @brief An operator applied to one expression.
          */
-        size_t num_rows() const
+        template <typename Op, typename E>
+        class UnaryExpr : public ExprNode
         {
-            return rows.size();
-        }
+        public:
+            using value_type = decltype(Op{}(std::declval<typename E::value_type>()));
+            static_assert(NumericCellValue<value_type>, "Expression result must be int, double, bool or uint64_t");
+
+            explicit UnaryExpr(E operand) : operand_(std::move(operand)) {}
+
+            struct Bound
+            {
+                typename E::Bound operand;
+                value_type operator[](size_t row) const { return Op{}(operand[row]); }
+                void mask(uint64_t *words, size_t begin, size_t end) const { operand.mask(words, begin, end); }
+            };
+
+            Bound bind(const CSVTable &table) const { return {operand_.bind(table)}; }
+
+            template <typename Row>
+            std::optional<value_type> evaluate(const Row &row) const
+            {
+                auto operand = operand_.evaluate(row);
+                if (!operand)
+                    return std::nullopt;
+                return Op{}(*operand);
+            }
+
+            void columns(std::vector<std::string> &out) const { operand_.columns(out); }
+
+        private:
+            E operand_;
+        };
 
         /**
-         * @brief Check if a column exists in the table.
-         * @param col_name The name of the column to check.
-         * @return bool True if the column exists, false otherwise.
+         * @brief Starts an expression reading a column as T (see ExprNode).
+         * @code
+         * table.compute_column("notional", CSVTable::col<double>("price") * CSVTable::col<int>("qty"));
+         * @endcode
          */
-        bool has_column(std::string_view col_name) const
+        template <NumericCellValue T>
+        static ColumnExpr<T> col(std::string_view col_name)
         {
-            return col_map.contains(std::string(col_name));
+            return ColumnExpr<T>(col_name);
         }
 
         /**
-         * @brief Appends the rows of another CSVTable to this table.
-         * 
-         * If this table is empty, it adopts the columns and rows of the other table.
-         * If the other table is empty, no changes are made.
-         * If both tables are non-empty, the columns must match exactly (same names and order).
-         * 
-         * @param other The CSVTable to append to this table.
-         * @throws std::invalid_argument If the columns do not match when both tables are non-empty.
+         * @brief Assigner class for setting cell values.
          */
-        void append_table(const CSVTable& other) {
-            if (other.col_names.empty()) {
-                // Do nothing if the other table is empty
-                return;
+        struct CellAssigner
+        {
+            CSVTable &table;
+            int row_index;
+            int col_index;
+
+            CellAssigner(CSVTable &t, int ri, int ci) : table(t), row_index(ri), col_index(ci) {}
+
+            /**
+             * @brief Assigns a value to the cell.
+             * @tparam T The type of the value to assign.
+             * @param value The value to set.
+             */
+            template <ConvertibleToCellValue T>
+            void operator=(const T &value)
+            {
+                table.set_cell(row_index, col_index, value);
             }
-            if (col_names.empty()) {
-                // If this table is empty, set columns and rows from the other table
-                col_names = other.col_names;
-                col_map = other.col_map;
-                rows = other.rows;
-            } else {
-                // Check if columns match exactly
-                if (col_names != other.col_names) {
-                    throw std::invalid_argument("Columns do not match for appending");
+
+            /**
+             * @brief Returns the cell's string representation, or "Invalid cell" for an out-of-range cell.
+             */
+            std::string to_string() const
+            {
+                if (row_index < 0 || static_cast<size_t>(row_index) >= table.row_count() ||
+                    col_index < 0 || static_cast<size_t>(col_index) >= table.col_names.size())
+                {
+                    return "Invalid cell";
                 }
-                // Append rows from the other table
-                rows.insert(rows.end(), other.rows.begin(), other.rows.end());
+                return CSVTable::cell_to_string(table.cell_at(row_index, col_index));
             }
-        }
 
+            /**
+             * @brief Streams the cell value to an output stream.
+             * @param os The output stream.
+             * @param assigner The assigner object.
+             * @return std::ostream& The output stream.
+             */
+            friend std::ostream &operator<<(std::ostream &os, const CellAssigner &assigner)
+            {
+                os << assigner.to_string();
+                return os;
+            }
+        };
 
         /**
-         * @brief Performs a binary search on the specified column to find the row with the value equal to the given value,
-         * or the first row with a value greater than the given value if no exact match is found.
-         *
-         * The table must be sorted by the specified column using sort_by_column<T> with the same type T before calling this method.
-         *
-         * @tparam T The type to which the column values are converted for comparison.
-         * @param col_name The name of the column to search on.
-         * @param value The value to search for.
-         * @return ConstRowIterator An iterator to the found row, or the end iterator if no such row exists.
-         * @throws std::invalid_argument If the column name is not found.
-         * @throws std::runtime_error If conversion of cell values fails.
+         * @brief Proxy class for row-based indexing in the table.
          */
-        template <typename T>
-        ConstRowIterator lower_bound(std::string_view col_name, const T& value) const {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end()) {
-                throw std::invalid_argument("Column name not found: " + std::string(col_name));
-            }
-            int col_index = it->second;
+        struct CellProxy
+        {
+            CSVTable &table;
+            int row_index;
 
-            auto comp = [col_index](const std::vector<CellValue>& row, const T& val) {
-                T row_val = CSVTable::convert_cell<T>(row[col_index]);
-                return row_val < val;
-            };
+            CellProxy(CSVTable &t, int ri) : table(t), row_index(ri) {}
 
-            auto vec_it = std::lower_bound(rows.cbegin(), rows.cend(), value, comp);
-            size_t index = std::distance(rows.cbegin(), vec_it);
-            return ConstRowIterator(this, index);
+            /**
+             * @brief Accesses a column in the row.
+             * @param col_name The name of the column.
+             * @return CellAssigner An assigner for the cell at the specified row and column.
+             * @throws std::out_of_range If the row index is invalid.
+             * @throws std::invalid_argument If the column name is not found.
+             */
+            CellAssigner operator[](std::string_view col_name)
+            {
+                if (row_index < 0 || static_cast<size_t>(row_index) >= table.row_count())
+                {
+                    throw std::out_of_range("Row index out of range");
+                }
+                auto it = table.col_map.find(col_name);
+                if (it == table.col_map.end())
+                {
+                    throw std::invalid_argument("Column name not found: " + std::string(col_name));
+                }
+                return CellAssigner(table, row_index, it->second);
+            }
+        };
+
+        /**
+         * @brief Accesses a row in the table.
+         * @param row_index The index of the row.
+         * @return CellProxy A proxy for the specified row.
+         */
+        CellProxy operator[](int row_index)
+        {
+            return CellProxy(*this, row_index);
         }
 
         /**
-         * @brief Finds a row in the table where the specified column matches the given value.
-         *
-         * This method performs a binary search on the specified column to locate a row
-         * where the column's value matches the provided value. The column must be sorted
-         * in ascending order for the search to work correctly.
+         * @brief Converts a CellValue to its string representation.
+         * @param value The CellValue to convert.
+         * @return std::string The string representation of the value.
          *
-         * @tparam T The type of the value to search for. It must match the type of the column's values.
-         * @param col_name The name of the column to search in.
-         * @param value The value to search for in the specified column.
-         * @return ConstRowIterator An iterator pointing to the row where the column value matches the given value.
-         *         If no match is found, it returns the end iterator.
-         * @throws std::invalid_argument If the specified column name does not exist in the table.
+         * Doubles use the shortest text that parses back to the same value. Whole numbers that a double
+         * holds exactly (below 2^53 in magnitude) are written in full, without a fractional part or an
+         * exponent: 100000, not 1e+05.
          */
-        template <typename T>
-        ConstRowIterator find(std::string_view col_name, const T& value) const {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end()) {
-                throw std::invalid_argument("Column not found: " + std::string(col_name));
+        static std::string cell_to_string(const CellValue &value)
+        {
+            if (const auto *str = std::get_if<std::string>(&value))
+            {
+                return *str;
             }
-            int col_index = it->second;
-
-            auto comp = [col_index](const auto& row, const T& val) {
-                return CSVTable::convert_cell<T>(row[col_index]) < val;
-            };
+            std::string out;
+            append_cell_text(out, value);
+            return out;
+        }
 
-            auto vec_it = std::lower_bound(rows.begin(), rows.end(), value, comp);
+        /**
+         * @brief Appends the string representation of a CellValue (as cell_to_string) to out.
+         */
+        static void append_cell_text(std::string &out, const CellValue &value)
+        {
+            std::visit([&out](const auto &v)
+                       {
+                           using T = std::decay_t<decltype(v)>;
+                           if constexpr (std::is_same_v<T, std::string>)
+                               out.append(v);
+                           else
+                               append_number(out, v); },
+                       value);
+        }
 
-            if (vec_it != rows.end() && CSVTable::convert_cell<T>((*vec_it)[col_index]) == value) {
-                size_t index = std::distance(rows.begin(), vec_it);
-                return ConstRowIterator(this, index);
-            } else {
-                return ConstRowIterator(this, rows.size());
+        /**
+         * @brief Appends a field to a CSV line, quoting it per RFC 4180 if it contains a comma, quote or line break.
+         */
+        static void append_csv_field(std::string &out, std::string_view text)
+        {
+            if (text.find_first_of(",\"\r\n") == std::string_view::npos)
+            {
+                out.append(text);
+                return;
             }
+            out.push_back('"');
+            for (char c : text)
+            {
+                if (c == '"')
+                    out.push_back('"');
+                out.push_back(c);
+            }
+            out.push_back('"');
         }
 
         /**
-         * @brief Sets all values in a specified column to a single value.
-         * @tparam T The type of the value to set (must be convertible to CellValue).
-         * @param col_name The name of the column to set.
-         * @param value The value to set for the entire column.
-         * @throws std::invalid_argument If the column does not exist.
+         * @brief Checks whether a string is a missing-value marker ("", "NA", "NaN" or "#N/A").
          */
-        template <ConvertibleToCellValue T>
-        void set_column_to_value(std::string_view col_name, T value) {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end()) {
-                throw std::invalid_argument("Column not found: " + std::string(col_name));
+        static bool is_na_string(std::string_view str)
+        {
+            return str.empty() || str == "NA" || str == "NaN" || str == "#N/A";
+        }
+
+        /**
+         * @brief Checks whether every character of a string is an ASCII digit.
+         *
+         * Tests eight bytes per step: a byte is a digit when its high nibble is 3 both
+         * before and after adding 6.
+         */
+        static bool is_all_digits(std::string_view str)
+        {
+            constexpr uint64_t high_nibbles = 0xF0F0F0F0F0F0F0F0ULL;
+            constexpr uint64_t threes = 0x3030303030303030ULL;
+            constexpr uint64_t sixes = 0x0606060606060606ULL;
+            const char *p = str.data();
+            size_t n = str.size();
+            for (; n >= 8; p += 8, n -= 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, p, sizeof(word));
+                if ((word & high_nibbles) != threes || ((word + sixes) & high_nibbles) != threes)
+                {
+                    return false;
+                }
             }
-            int col_index = it->second;
-            for (auto &row : rows) {
-                row[col_index] = value;
+            for (; n > 0; ++p, --n)
+            {
+                if (*p < '0' || *p > '9')
+                {
+                    return false;
+                }
             }
+            return true;
         }
 
         /**
-        * @brief Returns a column as a vector of the specified type.
-        * 
-        * This function retrieves all values from the specified column and converts them
-        * to the type T. The function assumes that all values in the column can be 
-        * successfully converted to T. If the column does not exist, it throws a 
-        * std::invalid_argument exception.
-        * 
-        * @tparam T The type to which the column values should be converted.
-        * @param col_name The name of the column to retrieve.
-        * @return std::vector<T> A vector containing the column values converted to type T.
-        * @throws std::invalid_argument If the column does not exist.
-        * @throws std::runtime_error If a value cannot be converted to type T.
-        */
+         * @brief Parses a string as T without throwing or allocating (except for T = std::string).
+         * @tparam T The target type.
+         * @param str The string to parse. Leading whitespace and a leading '+' are accepted for numbers.
+         * @return std::optional<T> The value, or std::nullopt if str is not entirely a valid T.
+         *
+         * Booleans accept "true"/"false" and "1"/"0". Unsigned values reject a minus sign.
+         */
         template <ConvertibleToCellValue T>
-        std::vector<T> get_column_as(std::string_view col_name) const {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end()) {
+        static std::optional<T> try_parse(std::string_view str)
+        {
+            if constexpr (std::is_same_v<T, std::string>)
+            {
+                return std::string(str);
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                if (str == "true" || str == "1")
+                    return true;
+                if (str == "false" || str == "0")
+                    return false;
+                return std::nullopt;
+            }
+            else
+            {
+                str = numeric_text(str);
+                T value{};
+                auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+                if (str.empty() || ec != std::errc() || ptr != str.data() + str.size())
+                {
+                    return std::nullopt;
+                }
+                return value;
+            }
+        }
+
+        /**
+         * @brief Parses a string to CellValue with type inference.
+         * @param str The string to parse.
+         * @return CellValue The parsed value.
+         *
+         * Tries int, then uint64_t, then double, without exceptions or temporary strings.
+         * Short all-digit fields take a direct accumulation path.
+         */
+        static CellValue parse_cell(std::string_view str)
+        {
+            if (is_na_string(str))
+            {
+                return std::string("");
+            }
+            if (str == "true")
+                return true;
+            if (str == "false")
+                return false;
+
+            std::string_view number = numeric_text(str);
+            if (!number.empty())
+            {
+                bool negative = number.front() == '-';
+                std::string_view digits = negative ? number.substr(1) : number;
+                if (!digits.empty() && is_all_digits(digits))
+                {
+                    if (digits.size() <= 9)
+                    {
+                        // At most 9 digits always fits in an int
+                        int value = 0;
+                        for (char c : digits)
+                        {
+                            value = value * 10 + (c - '0');
+                        }
+                        return negative ? -value : value;
+                    }
+                    if (auto i = try_parse<int>(number))
+                        return *i;
+                    if (!negative)
+                    {
+                        if (auto u = try_parse<uint64_t>(number))
+                            return *u;
+                    }
+                }
+                if (auto d = try_parse<double>(number))
+                    return *d;
+            }
+            return std::string(str);
+        }
+
+        /**
+         * @brief Converts a CellValue to type T, handling string conversions.
+         * @param value The CellValue to convert.
+         * @return T The converted value or default_value if conversion fails.
+         */
+        template <ConvertibleToCellValue T>
+        static T convert_cell(const CellValue &value)
+        {
+            if (std::holds_alternative<T>(value))
+            {
+                return std::get<T>(value);
+            }
+            else if (std::holds_alternative<std::string>(value))
+            {
+                const auto &str = std::get<std::string>(value);
+                if (is_na_string(str))
+                {
+                    throw std::runtime_error("Cannot convert empty or NA string to type T");
+                }
+                if constexpr (std::is_same_v<T, std::string>)
+                {
+                    return str;
+                }
+                else
+                {
+                    if (auto result = try_parse<T>(str))
+                    {
+                        return *result;
+                    }
+                    if constexpr (std::is_same_v<T, bool>)
+                    {
+                        throw std::runtime_error("Invalid boolean string: " + str);
+                    }
+                    throw std::invalid_argument("Cannot convert string to requested type: " + str);
+                }
+            }
+            if constexpr (std::is_same_v<T, double>)
+            {
+                if (std::holds_alternative<int>(value))
+                {
+                    return static_cast<double>(std::get<int>(value));
+                }
+                else if (std::holds_alternative<uint64_t>(value))
+                {
+                    return static_cast<double>(std::get<uint64_t>(value));
+                }
+            }
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                if (std::holds_alternative<int>(value))
+                {
+                    return std::get<int>(value) != 0;
+                }
+                else if (std::holds_alternative<uint64_t>(value))
+                {
+                    return std::get<uint64_t>(value) != 0;
+                }
+            }
+            if constexpr (std::is_same_v<T, uint64_t>)
+            {
+                if (std::holds_alternative<int>(value))
+                {
+                    return static_cast<uint64_t>(std::get<int>(value));
+                }
+                else if (std::holds_alternative<double>(value))
+                {
+                    return static_cast<uint64_t>(std::get<double>(value));
+                }
+            }
+            throw std::runtime_error("Type mismatch: Cannot convert CellValue to the requested type");
+        }
+
+        /**
+         * @brief Applies a function to each value in a specified column, transforming the values in place.
+         *
+         * This method applies the provided function `func` to each value in the column specified by `col_name`.
+         * The column values are converted to type `T` if stored as strings, using a default value if conversion fails.
+         *
+         * @tparam T The type of the values in the column.
+         * @tparam Func The type of the function to apply.
+         * @param col_name The name of the column to transform.
+         * @param func The function to apply to each value.
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        template <typename T, typename Func>
+        void apply_to_column(std::string_view col_name, Func func)
+        {
+            auto it = col_map.find(std::string(col_name));
+            if (it == col_map.end())
+            {
                 throw std::invalid_argument("Column not found: " + std::string(col_name));
             }
             int col_index = it->second;
-            std::vector<T> column_values;
-            column_values.reserve(rows.size());  // Reserve space for efficiency
-            for (const auto& row : rows) {
-                column_values.push_back(convert_cell<T>(row[col_index]));
+            indexes.erase(col_index);
+            if (mode == StorageMode::Columnar)
+            {
+                Column &column = cols[col_index];
+                for (size_t i = 0; i < column.size(); ++i)
+                {
+                    try{
+                        T value = column.get_as<T>(i);
+                        column.set(i, func(value));
+                    }
+                    catch (const std::runtime_error &e)
+                    {
+                        // conversion to type failed
+                        column.set(i, func(""));
+                    }
+                }
+                return;
+            }
+            for (auto &row : rows)
+            {
+                try{
+                    T value = convert_cell<T>(row[col_index]);
+                    row[col_index] = func(value);
+                }
+                catch (const std::runtime_error &e)
+                {
+                    // conversion to type failed
+                    row[col_index] = func("");
+                }
+            }
+        }
+
+        /**
+         * @brief Applies a function to each value in a column on several threads (see ExecutionPolicy).
+         *
+         * func is called concurrently for different rows and must not touch other shared state without
+         * synchronization. In columnar storage the results are computed in parallel and stored afterwards,
+         * since storing a value of a different type changes the column's type.
+         *
+         * @tparam T The type of the values in the column.
+         * @tparam Func The type of the function to apply.
+         * @param col_name The name of the column to transform.
+         * @param func The function to apply to each value.
+         * @param policy The number of threads to use.
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        template <typename T, typename Func>
+        void apply_to_column(std::string_view col_name, Func func, ExecutionPolicy policy)
+        {
+            const size_t num_threads = policy.threads();
+            if (num_threads <= 1)
+            {
+                apply_to_column<T>(col_name, func);
+                return;
+            }
+            auto it = col_map.find(std::string(col_name));
+            if (it == col_map.end())
+            {
+                throw std::invalid_argument("Column not found: " + std::string(col_name));
+            }
+            const size_t col_index = it->second;
+            indexes.erase(static_cast<int>(col_index));
+            auto transform = [&func](auto &&read) -> CellValue
+            {
+                try
+                {
+                    T value = read();
+                    return func(value);
+                }
+                catch (const std::runtime_error &)
+                {
+                    // conversion to type failed
+                    return func("");
+                }
+            };
+            const size_t n = row_count();
+            const size_t num_blocks = (n + rows_per_parallel_block - 1) / rows_per_parallel_block;
+            if (mode == StorageMode::Columnar)
+            {
+                Column &column = cols[col_index];
+                std::vector<CellValue> results(n);
+                parallel_for(num_blocks, num_threads, [&](size_t b)
+                {
+                    const size_t end = std::min(n, (b + 1) * rows_per_parallel_block);
+                    for (size_t i = b * rows_per_parallel_block; i < end; ++i)
+                    {
+                        results[i] = transform([&] { return column.get_as<T>(i); });
+                    }
+                });
+                for (size_t i = 0; i < n; ++i)
+                {
+                    column.set(i, results[i]);
+                }
+                return;
+            }
+            parallel_for(num_blocks, num_threads, [&](size_t b)
+            {
+                const size_t end = std::min(n, (b + 1) * rows_per_parallel_block);
+                for (size_t i = b * rows_per_parallel_block; i < end; ++i)
+                {
+                    CellValue &cell = rows[i][col_index];
+                    cell = transform([&] { return convert_cell<T>(cell); });
+                }
+            });
+        }
+
+        /**
+         * @brief Evaluates a typed expression for every row and stores the results in a column (see ExprNode).
+         *
+         * The column is added after the last one if it does not exist, and replaced otherwise. It gets the
+         * expression's value type, and rows whose result is missing hold the missing marker.
+         *
+         * @param col_name The column to write.
+         * @param expr The expression, e.g. CSVTable::col<double>("price") * CSVTable::col<int>("qty").
+         * @param num_threads Threads to evaluate on (0 = hardware concurrency).
+         * @throws std::invalid_argument If a column of the expression does not exist, or a cell cannot be
+         *         converted to the type its column is read as (as in get<T>).
+         */
+        template <typename E>
+            requires is_expression<E>
+        void compute_column(std::string_view col_name, const E &expr, size_t num_threads = 1)
+        {
+            using T = typename E::value_type;
+            auto [values, validity] = evaluate_expression(expr, num_threads);
+            auto it = col_map.find(col_name);
+            const size_t col_index = it == col_map.end() ? col_names.size() : it->second;
+            if (it == col_map.end())
+            {
+                col_map[std::string(col_name)] = col_index;
+                col_names.emplace_back(col_name);
+                if (mode == StorageMode::Columnar)
+                    cols.emplace_back();
+                else
+                    for (auto &row : rows)
+                        row.emplace_back();
+            }
+            indexes.erase(static_cast<int>(col_index));
+            if (mode == StorageMode::Columnar)
+            {
+                cols[col_index] = Column::from_values<T>(std::move(values), std::move(validity));
+                return;
+            }
+            for (size_t r = 0; r < rows.size(); ++r)
+            {
+                const bool valid = (validity[r >> 6] >> (r & 63)) & 1;
+                rows[r][col_index] = valid ? CellValue(static_cast<T>(values[r])) : CellValue(std::string(""));
+            }
+        }
+
+        /**
+         * @brief Constructor for an empty table.
+         */
+        CSVTable() = default;
+
+        /**
+         * @brief Constructor to load a CSV file.
+         * @param filename The path to the CSV file.
+         * @throws std::runtime_error If the file cannot be opened or is empty.
+         */
+        CSVTable(std::string_view filename)
+        {
+            read_file(filename);
+        }
+
+        /**
+         * @brief Constructor to load a CSV file into the given storage layout.
+         * @param filename The path to the CSV file.
+         * @param storage The storage layout to read into.
+         * @throws std::runtime_error If the file cannot be opened or is empty.
+         */
+        CSVTable(std::string_view filename, StorageMode storage) : mode(storage)
+        {
+            read_file(filename);
+        }
+
+        /**
+         * @brief Constructor for sub-tables or copies.
+         * @param column_names The list of column names.
+         * @param column_map The mapping from column names to indices.
+         * @param selected_rows The selected rows of data.
+         */
+        CSVTable(const std::vector<std::string> &column_names,
+                 const std::unordered_map<std::string, int, string_hash, string_equal> &column_map,
+                 const std::vector<std::vector<CellValue>> &selected_rows)
+            : col_names(column_names), col_map(column_map), rows(selected_rows) {}
+
+
+        /**
+         * @brief A proxy class for accessing and modifying a cell value in a Row.
+         *
+         * Allows reading and writing a cell value by reference, supporting type-safe
+         * assignments to the cell in the parent CSVTable.
+         */
+        class CellAccess {
+        public:
+            /**
+             * @brief Constructs a CellAccess for a specific cell.
+             * @param table Pointer to the parent CSVTable.
+             * @param row_index The index of the row.
+             * @param col_index The index of the column.
+             */
+            CellAccess(CSVTable* table, size_t row_index, int col_index)
+                : table_(table), row_index_(row_index), col_index_(col_index) {}
+
+            /**
+             * @brief Reads the cell value.
+             * @return CellValue The current value of the cell.
+             * @throws std::out_of_range If the row or column index is invalid.
+             */
+            operator CellValue() const {
+                check_bounds();
+                return table_->cell_at(row_index_, col_index_);
+            }
+
+            /**
+             * @brief Assigns a new value to the cell.
+             * @tparam T The type of the value to assign (must be convertible to CellValue).
+             * @param value The value to set.
+             * @return CellAccess& Reference to this access object for chaining.
+             * @throws std::out_of_range If the row or column index is invalid.
+             */
+            template <ConvertibleToCellValue T>
+            CellAccess& operator=(const T& value) {
+                check_bounds();
+                table_->set_cell(row_index_, col_index_, value);
+                return *this;
+            }
+
+        private:
+            void check_bounds() const {
+                if (row_index_ >= table_->row_count()) {
+                    throw std::out_of_range("Row index out of range: " + std::to_string(row_index_));
+                }
+                if (col_index_ >= static_cast<int>(table_->row_width(row_index_))) {
+                    throw std::out_of_range("Column index out of range: " + std::to_string(col_index_));
+                }
+            }
+
+            CSVTable* table_;      ///< Pointer to the parent table
+            size_t row_index_;     ///< Index of the row
+            int col_index_;        ///< Index of the column
+        };
+
+        /**
+         * @brief A class representing a single row in a CSVTable.
+         *
+         * Allows access to cell values by column name using operator[], supporting both
+         * reading and writing. Provides type-safe retrieval of values via get<T>.
+         */
+        class Row {
+        public:
+            /**
+             * @brief Constructs a Row object.
+             * @param table Pointer to the parent CSVTable.
+             * @param row_index The index of the row in the table.
+             */
+            Row(CSVTable* table, size_t row_index)
+                : table_(table), row_index_(row_index) {}
+
+            /**
+             * @brief Accesses a cell for reading or writing by column name.
+             * @param col_name The name of the column.
+             * @return CellAccess An access object for the cell, allowing read/write operations.
+             * @throws std::invalid_argument If the column name does not exist.
+             */
+            CellAccess operator[](std::string_view col_name) {
+                auto it = table_->col_map.find(col_name);
+                if (it == table_->col_map.end()) {
+                    throw std::invalid_argument("Column not found: " + std::string(col_name));
+                }
+                return CellAccess(table_, row_index_, it->second);
+            }
+
+            /**
+             * @brief Retrieves a cell value with type safety.
+             * @tparam T The type to retrieve (must be convertible to CellValue).
+             * @param col_name The name of the column.
+             * @return T The value converted to type T.
+             * @throws std::invalid_argument If the column name does not exist.
+             * @throws std::out_of_range If the row index is invalid.
+             * @throws std::runtime_error If the value cannot be converted to T.
+             */
+            template <ConvertibleToCellValue T>
+            T get(std::string_view col_name) const {
+                return table_->get<T>(static_cast<int>(row_index_), col_name);
+            }
+
+            /**
+             * @brief Streams the row to an output stream.
+             *
+             * Outputs the row as a comma-separated list of cell values, using the table's
+             * cell_to_string function to convert values to strings.
+             *
+             * @param os The output stream to write to.
+             * @param row The Row object to stream.
+             * @return std::ostream& The output stream for chaining.
+             * @throws std::out_of_range If the row index is invalid.
+             */
+            friend std::ostream& operator<<(std::ostream& os, const Row& row) {
+                row.write(os);
+                return os;
+            }
+
+        private:
+            void write(std::ostream& os) const {
+                if (row_index_ >= table_->row_count()) {
+                    os << "<Invalid Row>";
+                    return;
+                }
+                table_->write_row(os, row_index_);
+            }
+
+            CSVTable* table_;      ///< Pointer to the parent table
+            size_t row_index_;     ///< Index of the row
+        };
+
+        /**
+         * @brief A read-only row of a const CSVTable, as handed out by TableView iteration.
+         *
+         * Like Row, but operator[] returns the cell's value, so the table cannot be written through it.
+         */
+        class ConstRow {
+        public:
+            /**
+             * @brief Constructs a ConstRow object.
+             * @param table Pointer to the parent CSVTable.
+             * @param row_index The index of the row in the table.
+             */
+            ConstRow(const CSVTable* table, size_t row_index)
+                : table_(table), row_index_(row_index) {}
+
+            /**
+             * @brief Reads a cell by column name.
+             * @param col_name The name of the column.
+             * @return CellValue The cell's value.
+             * @throws std::invalid_argument If the column name does not exist.
+             * @throws std::out_of_range If the row index is invalid.
+             */
+            CellValue operator[](std::string_view col_name) const {
+                auto it = table_->col_map.find(col_name);
+                if (it == table_->col_map.end()) {
+                    throw std::invalid_argument("Column not found: " + std::string(col_name));
+                }
+                if (row_index_ >= table_->row_count()) {
+                    throw std::out_of_range("Row index out of range: " + std::to_string(row_index_));
+                }
+                return table_->cell_at(row_index_, it->second);
+            }
+
+            /**
+             * @brief Retrieves a cell value with type safety (see Row::get).
+             */
+            template <ConvertibleToCellValue T>
+            T get(std::string_view col_name) const {
+                return table_->get<T>(static_cast<int>(row_index_), col_name);
+            }
+
+            /**
+             * @brief Streams the row as a comma-separated list of cell values (see Row).
+             */
+            friend std::ostream& operator<<(std::ostream& os, const ConstRow& row) {
+                row.write(os);
+                return os;
+            }
+
+        private:
+            void write(std::ostream& os) const {
+                if (row_index_ >= table_->row_count()) {
+                    os << "<Invalid Row>";
+                    return;
+                }
+                table_->write_row(os, row_index_);
+            }
+
+            const CSVTable* table_; ///< Pointer to the parent table
+            size_t row_index_;      ///< Index of the row
+        };
+
+        // Nested iterator class for rows
+        class RowIterator {
+        public:
+            RowIterator(CSVTable* table, size_t index) : table_(table), index_(index) {}
+
+            Row operator*() const {
+                return Row(table_, index_);
+            }
+
+            Row operator->() const {
+                return Row(table_, index_);
+            }
+
+            RowIterator& operator++() {
+                ++index_;
+                return *this;
+            }
+
+            bool operator!=(const RowIterator& other) const {
+                return index_ != other.index_;
+            }
+
+            bool operator==(const RowIterator& other) const {
+                return index_ == other.index_;
+            }
+
+            size_t index() const {
+                return index_;
+            }
+
+            Row row() const {
+                return Row(table_, index_);
+            }
+
+        private:
+            CSVTable* table_;
+            size_t index_;
+        };
+
+        // Const iterator class for const CSVTable objects
+        class ConstRowIterator {
+        public:
+            ConstRowIterator(const CSVTable* table, size_t index) : table_(table), index_(index) {}
+
+            Row operator*() const {
+                return Row(const_cast<CSVTable*>(table_), index_);
+            }
+
+            Row operator->() const {
+                return Row(const_cast<CSVTable*>(table_), index_);
+            }
+
+            ConstRowIterator& operator++() {
+                ++index_;
+                return *this;
+            }
+
+            bool operator!=(const ConstRowIterator& other) const {
+                return index_ != other.index_;
+            }
+
+            bool operator==(const ConstRowIterator& other) const {
+                return index_ == other.index_;
+            }
+
+            size_t index() const {
+                return index_;
+            }
+
+            Row row() const {
+                return Row(const_cast<CSVTable*>(table_), index_);
+            }
+
+        private:
+            const CSVTable* table_;
+            size_t index_;
+        };
+
+        // Begin and end methods for non-const objects
+        RowIterator begin() {
+            return RowIterator(this, 0);
+        }
+
+        RowIterator end() {
+            return RowIterator(this, row_count());
+        }
+
+        // Begin and end methods for const objects
+        ConstRowIterator begin() const {
+            return ConstRowIterator(this, 0);
+        }
+
+        ConstRowIterator end() const {
+            return ConstRowIterator(this, row_count());
+        }
+
+        ConstRowIterator cend() const {
+            return end();
+        }
+
+        ConstRowIterator cbegin() const {
+            return begin();
+        }
+
+         /**
+         * @brief Reads a CSV file into the table, initializing or appending data.
+         *
+         * If snapshot_path(filename) holds a snapshot saved from the current version of the file (see
+         * save_snapshot), it is loaded in place of parsing the CSV; the rows are those of the table that
+         * was saved, which need not be the file's. A snapshot that is stale, or whose body is truncated or
+         * corrupt, is ignored and the CSV is parsed.
+         * @param filename The path to the CSV file.
+         * @throws std::runtime_error If the file cannot be opened, is empty, or has mismatched columns when appending.
+         */
+        void read_file(std::string_view filename)
+        {
+            read_file(filename, 1);
+        }
+
+        /**
+         * @brief Reads a CSV file using several threads to tokenize and parse the rows.
+         * @param filename The path to the CSV file.
+         * @param num_threads The number of parser threads; 0 uses std::thread::hardware_concurrency(), 1 reads serially.
+         * @param chunk_size The target chunk size in bytes. Chunks always end on a record boundary.
+         * @throws std::runtime_error If the file cannot be opened, is empty, or has mismatched columns when appending.
+         *
+         * The file is split at newlines outside quoted fields, each chunk is parsed on a worker,
+         * and the row blocks are appended in file order, so the result matches a serial read. A current
+         * snapshot is used in place of the CSV, as in read_file(filename).
+         */
+        void read_file(std::string_view filename, size_t num_threads, size_t chunk_size = default_chunk_size)
+        {
+            OperationReporter report(observer(), "read_file", filename, 0, progress_interval);
+            if (!read_current_snapshot(filename, report))
+            {
+                read_csv(filename, nullptr, num_threads, chunk_size, report);
+            }
+            index_new_rows();
+            report.finish();
+        }
+
+        /**
+         * @brief Reads a CSV file, parsing each field directly into the type declared by a schema.
+         * @param filename The path to the CSV file.
+         * @param schema Declared types by column name. Unlisted columns are inferred; ColumnType::Skip drops a column.
+         * @param num_threads The number of parser threads; 0 uses std::thread::hardware_concurrency(), 1 reads serially.
+         * @param chunk_size The target chunk size in bytes for parallel reads.
+         * @throws std::invalid_argument If the schema names a column that is not in the file.
+         * @throws std::runtime_error If the file cannot be opened, headers do not match when appending, or a
+         *         field cannot be parsed as its declared type. The message names the row (0-based, counted
+         *         from the first data row in the file) and the column; no rows from the file are kept,
+         *         and a table that had no columns is left without them.
+         *
+         * Missing values ("", "NA", "NaN", "#N/A") become empty cells. Skipped columns are
+         * tokenized but never converted or stored.
+         */
+        void read_file(std::string_view filename, const Schema &schema, size_t num_threads = 1, size_t chunk_size = default_chunk_size)
+        {
+            OperationReporter report(observer(), "read_file", filename, 0, progress_interval);
+            read_csv(filename, &schema, num_threads, chunk_size, report);
+            index_new_rows();
+            report.finish();
+        }
+
+        /**
+         * @brief Pull-style reader that yields a CSV file as a sequence of tables of at most batch_size rows.
+         *
+         * Only one batch is held in memory at a time, and the file itself is read through
+         * CSVRecordReader, so memory use is bounded by the batch size rather than the file size.
+         * Every batch has the file's header (after applying the schema) and the storage mode
+         * passed to the constructor.
+         */
+        class BatchReader
+        {
+        public:
+            /**
+             * @brief Opens a CSV file for batched reading.
+             * @param filename The path to the CSV file.
+             * @param batch_size The maximum number of rows per batch.
+             * @param schema Optional declared column types, as for read_file(filename, schema).
+             * @param storage The storage mode of the batches.
+             * @throws std::invalid_argument If batch_size is 0 or the schema names a missing column.
+             * @throws std::runtime_error If the file cannot be opened or has no header.
+             */
+            explicit BatchReader(std::string_view filename, size_t batch_size = default_batch_size,
+                                 const Schema &schema = {}, StorageMode storage = StorageMode::Row)
+                : filename_(filename), batch_size_(batch_size), storage_(storage),
+                  reader_(std::make_unique<CSVRecordReader>(filename_))
+            {
+                if (batch_size_ == 0)
+                {
+                    throw std::invalid_argument("Batch size must be positive");
+                }
+                if (!reader_->is_open())
+                {
+                    throw std::runtime_error("Cannot open file: " + filename_);
+                }
+                std::string_view record;
+                if (!reader_->next_record(record))
+                {
+                    throw std::runtime_error("Empty file or missing header: " + filename_);
+                }
+                header_ = parse_header(record, filename_, schema.empty() ? nullptr : &schema);
+            }
+
+            /**
+             * @brief Gets the column names every batch will have.
+             */
+            const std::vector<std::string> &get_col_names() const { return header_.col_names; }
+
+            /**
+             * @brief Gets the number of data rows read so far.
+             */
+            size_t rows_read() const { return rows_read_; }
+
+            /**
+             * @brief Reads the next batch, replacing the contents of batch.
+             * @param batch Receives up to batch_size rows. Its columns are reset to the file header.
+             * @return bool False once the file is exhausted (batch is then empty).
+             * @throws std::runtime_error If a field cannot be parsed as its declared type.
+             */
+            bool next(CSVTable &batch)
+            {
+                if (batch.mode != storage_ || batch.col_names != header_.col_names)
+                {
+                    batch = CSVTable();
+                    batch.mode = storage_;
+                    batch.adopt_header(header_, filename_);
+                }
+                else
+                {
+                    batch.truncate_rows(0);
+                }
+
+                std::string_view record;
+                size_t count = 0;
+                while (count < batch_size_ && reader_->next_record(record))
+                {
+                    try
+                    {
+                        batch.push_row(parse_record(record, header_.col_names.size(), header_.plan, fields_, unescaped_));
+                    }
+                    catch (FieldParseError &e)
+                    {
+                        e.row = rows_read_ + count;
+                        throw conversion_error(filename_, header_, e);
+                    }
+                    ++count;
+                }
+                rows_read_ += count;
+                return count > 0;
+            }
+
+        private:
+            std::string filename_;
+            size_t batch_size_;
+            StorageMode storage_;
+            std::unique_ptr<CSVRecordReader> reader_;
+            CSVHeader header_;
+            size_t rows_read_ = 0;
+            std::vector<std::string_view> fields_;
+            std::deque<std::string> unescaped_;
+        };
+
+        /**
+         * @brief Streams a CSV file through a callback one batch at a time.
+         * @param filename The path to the CSV file.
+         * @param batch_size The maximum number of rows per batch.
+         * @param on_batch Called with each batch. It may modify the batch (e.g. filter_in_place) before passing it on.
+         * @param schema Optional declared column types, as for read_file(filename, schema).
+         * @return size_t The total number of rows read from the file.
+         * @throws std::runtime_error If the file cannot be opened or a field cannot be parsed as its declared type.
+         *
+         * The same batch table is reused between calls, so memory use stays bounded by batch_size.
+         * Typical pipelines append each batch with save_to_file(out, true) or a ParquetWriter.
+         */
+        static size_t read_file_batches(std::string_view filename, size_t batch_size,
+                                        const std::function<void(CSVTable &)> &on_batch, const Schema &schema = {})
+        {
+            BatchReader reader(filename, batch_size, schema);
+            CSVTable batch;
+            OperationReporter report(default_observer(), "read_file_batches", filename, 0, progress_interval);
+            size_t reported = 0;
+            while (reader.next(batch))
+            {
+                on_batch(batch);
+                report.add(reader.rows_read() - reported);
+                reported = reader.rows_read();
+            }
+            report.finish();
+            return reader.rows_read();
+        }
+    
+
+        /**
+         * @brief Sets the type of a column, converting values if possible.
+         * @tparam T The target type for the column.
+         * @param col_name The name of the column.
+         * @param skip_errors If true, replace invalid values with default_value; otherwise, throw an exception.
+         * @param default_value The default value to use for invalid conversions.
+         * @throws std::invalid_argument If the column does not exist.
+         * @throws std::runtime_error If conversion fails and skip_errors is false.
+         */
+        template <ConvertibleToCellValue T>
+        void set_column_type(std::string_view col_name, bool skip_errors = false, const T &default_value = T())
+        {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end())
+            {
+                throw std::invalid_argument("Column not found: " + std::string(col_name));
+            }
+            int col_index = it->second;
+            indexes.erase(col_index);
+
+            auto convert = [&](CellValue &cell)
+            {
+                if (std::holds_alternative<std::string>(cell))
+                {
+                    const auto &str = std::get<std::string>(cell);
+                    if (is_na_string(str))
+                    {
+                        if (skip_errors)
+                        {
+                            cell = default_value;
+                        }
+                        else
+                        {
+                            throw std::runtime_error("Invalid value in column " + std::string(col_name) + ": empty or NA");
+                        }
+                        return;
+                    }
+                    if constexpr (!std::is_same_v<T, std::string>)
+                    {
+                        if (auto parsed = try_parse<T>(str))
+                        {
+                            cell = *parsed;
+                        }
+                        else if (skip_errors)
+                        {
+                            cell = default_value;
+                        }
+                        else
+                        {
+                            throw std::runtime_error("Conversion error in column " + std::string(col_name) + ": " + str);
+                        }
+                    }
+                }
+                else
+                {
+                    try
+                    {
+                        cell = convert_cell<T>(cell);
+                    }
+                    catch (const std::exception &e)
+                    {
+                        if (skip_errors)
+                        {
+                            cell = default_value;
+                        }
+                        else
+                        {
+                            throw std::runtime_error("Type mismatch in column " + std::string(col_name) + ": " + e.what());
+                        }
+                    }
+                }
+            };
+
+            if (mode == StorageMode::Columnar)
+            {
+                Column &column = cols[col_index];
+                Column converted(Column::type_of<T>());
+                converted.reserve(column.size());
+                for (size_t i = 0; i < column.size(); ++i)
+                {
+                    CellValue cell = column.get(i);
+                    convert(cell);
+                    converted.push_back(cell);
+                }
+                column = std::move(converted);
+                return;
+            }
+            for (auto &row : rows)
+            {
+                convert(row[col_index]);
+            }
+        }
+
+        /**
+         * @brief Retrieves a value from the table with type safety.
+         * @tparam T The type to retrieve.
+         * @param row The row index.
+         * @param col_name The column name.
+         * @return T The value cast to type T.
+         * @throws std::out_of_range If the row index is invalid.
+         * @throws std::invalid_argument If the column does not exist.
+         * @throws std::runtime_error If the type does not match or conversion fails.
+         */
+        template <ConvertibleToCellValue T>
+        T get(int row, std::string_view col_name) const
+        {
+            if (row < 0 || static_cast<size_t>(row) >= row_count())
+            {
+                throw std::out_of_range("Row index out of range");
+            }
+            auto it = col_map.find(col_name);
+            if (it == col_map.end())
+            {
+                throw std::invalid_argument("Column name not found: " + std::string(col_name));
+            }
+            return value_as<T>(row, it->second);
+        }
+
+        /**
+         * @brief Adds a new column with a default value.
+         * @tparam T The type of the default value.
+         * @param col_name The name of the new column.
+         * @param default_value The default value for the new column.
+         * @throws std::invalid_argument If the column already exists.
+         */
+        template <ConvertibleToCellValue T>
+        void add_column(std::string_view col_name, const T &default_value = T())
+        {
+            if (col_map.contains(col_name))
+            {
+                throw std::invalid_argument("Column already exists: " + std::string(col_name));
+            }
+            if (mode == StorageMode::Columnar)
+            {
+                cols.push_back(Column::filled(row_count(), default_value));
+            }
+            else
+            {
+                for (auto &row : rows)
+                {
+                    row.emplace_back(default_value);
+                }
+            }
+            col_map[std::string(col_name)] = col_names.size();
+            col_names.emplace_back(col_name);
+        }
+
+        /**
+         * @brief Deletes a column from the table.
+         * @param col_name The name of the column to delete.
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        void delete_column(std::string_view col_name)
+        {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end())
+            {
+                throw std::invalid_argument("Column name not found: " + std::string(col_name));
+            }
+            int col_index = it->second;
+            col_names.erase(col_names.begin() + col_index);
+            col_map.erase(it);
+            for (auto &[name, index] : col_map)
+            {
+                if (index > col_index)
+                    --index;
+            }
+            std::unordered_map<int, ColumnIndex> shifted;
+            for (auto &[index_col, index] : indexes)
+            {
+                if (index_col != col_index)
+                    shifted.emplace(index_col > col_index ? index_col - 1 : index_col, std::move(index));
+            }
+            indexes = std::move(shifted);
+            if (mode == StorageMode::Columnar)
+            {
+                cols.erase(cols.begin() + col_index);
+                return;
+            }
+            for (auto &row : rows)
+            {
+                row.erase(row.begin() + col_index);
+            }
+        }
+
+        /**
+         * @brief Deletes multiple columns from the table.
+         *
+         * Removes the specified columns from the table by calling delete_column for each
+         * column name. All specified columns must exist, or an exception is thrown.
+         *
+         * @param col_names A vector of column names to delete.
+         * @throws std::invalid_argument If any column name does not exist.
+         */
+        void delete_columns(const std::vector<std::string_view>& col_names) {
+            for (const auto& name : col_names) {
+                delete_column(name);
+            }
+        }
+
+        /**
+         * @brief Appends a new row to the table.
+         * @param values The values for the new row.
+         */
+        void append_row(std::vector<CellValue> values)
+        {
+            while (values.size() < col_names.size())
+            {
+                values.emplace_back(std::string(""));
+            }
+            values.resize(col_names.size());
+            push_row(std::move(values));
+            if (!indexes.empty())
+            {
+                index_new_rows();
+            }
+        }
+
+        /**
+         * @brief Reserves storage for a total of num_rows rows, so that appending up to that many does not
+         * reallocate.
+         * @param num_rows The number of rows to reserve room for.
+         */
+        void reserve(size_t num_rows)
+        {
+            reserve_rows(num_rows);
+        }
+
+        /// The values of one column for append_columns(): a span of one CellValue alternative, or of CellValues.
+        using ColumnSpan = std::variant<std::span<const std::string>, std::span<const int>, std::span<const double>,
+                                        std::span<const bool>, std::span<const uint64_t>, std::span<const CellValue>>;
+
+        /**
+         * @brief Appends rows given column by column.
+         *
+         * Typed spans are written straight into matching columnar buffers, without building a row per value.
+         * Empty strings are missing values, as in append_row.
+         *
+         * @param columns One span per column, in column order, all of the same length.
+         * @throws std::invalid_argument If the number of spans differs from the number of columns or the
+         *         spans differ in length. The table is unchanged.
+         */
+        void append_columns(const std::vector<ColumnSpan> &columns)
+        {
+            if (columns.size() != col_names.size())
+            {
+                throw std::invalid_argument("append_columns expects " + std::to_string(col_names.size()) +
+                                            " columns, got " + std::to_string(columns.size()));
+            }
+            if (columns.empty())
+            {
+                return;
+            }
+            const size_t n = std::visit([](const auto &values)
+                                        { return values.size(); },
+                                        columns[0]);
+            for (size_t c = 0; c < columns.size(); ++c)
+            {
+                size_t length = std::visit([](const auto &values)
+                                           { return values.size(); },
+                                           columns[c]);
+                if (length != n)
+                {
+                    throw std::invalid_argument("Column " + col_names[c] + " has " + std::to_string(length) +
+                                                " values, expected " + std::to_string(n));
+                }
+            }
+            reserve_rows(row_count() + n);
+            if (mode == StorageMode::Row)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    std::vector<CellValue> &row = rows.emplace_back();
+                    row.reserve(columns.size());
+                    for (const auto &column : columns)
+                    {
+                        std::visit([&](const auto &values)
+                                   { row.emplace_back(values[i]); },
+                                   column);
+                    }
+                }
+            }
+            else
+            {
+                for (size_t c = 0; c < columns.size(); ++c)
+                {
+                    std::visit([&](const auto &values)
+                               {
+                                   for (const auto &value : values)
+                                   {
+                                       if constexpr (std::is_same_v<std::decay_t<decltype(value)>, CellValue>)
+                                           cols[c].push_back(value);
+                                       else
+                                           cols[c].push_back_value(value);
+                                   } },
+                               columns[c]);
+                }
+            }
+            if (!indexes.empty())
+            {
+                index_new_rows();
+            }
+        }
+
+        /**
+         * @brief Collects values column by column and appends them to a table as rows in one step.
+         *
+         * Values go into typed column buffers as they are added, and commit() moves the buffers into the
+         * table, so no per-row vectors are built. The columns are those of the table when the builder was
+         * created; the table must not gain or lose columns before commit().
+         *
+         * @code
+         * auto builder = table.builder();
+         * builder.append<int>("id", ids).append<double>("px", prices);
+         * builder.push_back("sym", std::string("AAPL"));
+         * builder.commit();
+         * @endcode
+         */
+        class Builder
+        {
+        public:
+            /**
+             * @brief Adds a value to the end of a column.
+             * @throws std::invalid_argument If the column does not exist.
+             */
+            template <ConvertibleToCellValue T>
+            Builder &push_back(std::string_view col_name, T value)
+            {
+                columns_[table_->get_column_index(col_name)].push_back_value(std::move(value));
+                return *this;
+            }
+
+            /**
+             * @brief Adds values to the end of a column.
+             * @throws std::invalid_argument If the column does not exist.
+             */
+            template <ConvertibleToCellValue T>
+            Builder &append(std::string_view col_name, std::span<const T> values)
+            {
+                Column &column = columns_[table_->get_column_index(col_name)];
+                column.reserve(column.size() + values.size());
+                for (const T &value : values)
+                {
+                    column.push_back_value(value);
+                }
+                return *this;
+            }
+
+            /**
+             * @brief Returns the number of values added to a column since the last commit.
+             * @throws std::invalid_argument If the column does not exist.
+             */
+            size_t size(std::string_view col_name) const
+            {
+                return columns_[table_->get_column_index(col_name)].size();
+            }
+
+            /**
+             * @brief Appends the collected values to the table as rows and empties the builder.
+             * @throws std::invalid_argument If the columns hold different numbers of values. Nothing is
+             *         appended and the builder keeps its values.
+             */
+            void commit()
+            {
+                CSVTable &table = *table_;
+                const size_t n = columns_.empty() ? 0 : columns_[0].size();
+                for (size_t c = 0; c < columns_.size(); ++c)
+                {
+                    if (columns_[c].size() != n)
+                    {
+                        throw std::invalid_argument("Column " + table.col_names[c] + " has " +
+                                                    std::to_string(columns_[c].size()) + " values, expected " + std::to_string(n));
+                    }
+                }
+                if (table.mode == StorageMode::Columnar)
+                {
+                    for (size_t c = 0; c < columns_.size(); ++c)
+                    {
+                        table.cols[c].append(std::move(columns_[c]));
+                    }
+                }
+                else
+                {
+                    table.rows.reserve(table.rows.size() + n);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        std::vector<CellValue> &row = table.rows.emplace_back();
+                        row.reserve(columns_.size());
+                        for (const Column &column : columns_)
+                        {
+                            row.push_back(column.get(i));
+                        }
+                    }
+                }
+                columns_.assign(columns_.size(), Column(Column::Type::String));
+                if (!table.indexes.empty())
+                {
+                    table.index_new_rows();
+                }
+            }
+
+        private:
+            friend class CSVTable;
+
+            CSVTable *table_;
+            std::vector<Column> columns_; // All-null String columns take the type of their first value
+
+            explicit Builder(CSVTable &table)
+                : table_(&table), columns_(table.col_names.size(), Column(Column::Type::String)) {}
+        };
+
+        /**
+         * @brief Returns a Builder that appends to this table.
+         */
+        Builder builder()
+        {
+            return Builder(*this);
+        }
+
+        /**
+         * @brief A row predicate for filter_rows and the other filters: a callable taking (row index, table), or
+         * only the row index, as a lambda that reads through captured column handles does.
+         */
+        class RowPredicate
+        {
+        public:
+            template <typename F>
+                requires std::is_invocable_r_v<bool, F &, int, const CSVTable &>
+            RowPredicate(F predicate) : predicate_(std::move(predicate)) {}
+
+            template <typename F>
+                requires(!std::is_invocable_r_v<bool, F &, int, const CSVTable &> && std::is_invocable_r_v<bool, F &, int>)
+            RowPredicate(F predicate)
+                : predicate_([predicate = std::move(predicate)](int row, const CSVTable &) mutable
+                             { return predicate(row); }) {}
+
+            bool operator()(int row, const CSVTable &table) const { return predicate_(row, table); }
+
+        private:
+            std::function<bool(int, const CSVTable &)> predicate_;
+        };
+
+        /**
+         * @brief Filters rows based on a predicate.
+         * @param predicate A function that takes a row index and the table, returning true if the row should be kept.
+         * @return std::vector<int> The indices of the matching rows.
+         */
+        std::vector<int> filter_rows(const RowPredicate &predicate) const
+        {
+            std::vector<int> matching_rows;
+            matching_rows.reserve(row_count() / 10);  // Reserve some space (assume ~10% match)
+
+            for (int i : std::views::iota(0, static_cast<int>(row_count())))
+            {
+                if (predicate(i, *this))
+                {
+                    matching_rows.push_back(i);
+                }
+            }
+            return matching_rows;
+        }
+
+        /**
+         * @brief Creates a new table with rows that match a predicate.
+         * @param predicate A function that takes a row index and the table, returning true if the row should be included.
+         * @return CSVTable A new table with the filtered rows.
+         */
+        CSVTable filter_table(const RowPredicate &predicate) const
+        {
+            auto matching_rows = filter_rows(predicate);
+            return sub_table(matching_rows);
+        }
+
+        /**
+         * @brief Creates a new table with rows that match a predicate (optimized, with progress).
+         * @param predicate A function that takes a row index and the table, returning true if the row should be included.
+         * @param show_progress If true, report progress to the table's observer (by default a stderr progress line).
+         * @param expected_selectivity Expected fraction of rows to match (0.0 to 1.0). Default 0.5 (50%).
+         * @return CSVTable A new table with the filtered rows.
+         */
+        CSVTable filter_table_fast(const RowPredicate &predicate, bool show_progress = false, double expected_selectivity = 0.5) const
+        {
+            // Columnar tables collect indices and gather each column once at the end
+            const bool columnar = mode == StorageMode::Columnar;
+            const size_t total_rows = row_count();
+            std::vector<std::vector<CellValue>> selected_rows;
+            std::vector<int> selected_indices;
+            size_t reserve_size = static_cast<size_t>(total_rows * std::clamp(expected_selectivity, 0.0, 1.0));
+            if (columnar) {
+                selected_indices.reserve(std::max(size_t(1), reserve_size));
+            } else {
+                selected_rows.reserve(std::max(size_t(1), reserve_size));  // Reserve based on expected selectivity
+            }
+
+            // With an observer, rows are filtered in blocks of one progress interval, so the loop stays untouched
+            OperationReporter report(show_progress ? observer() : nullptr, "filter_table_fast", "", total_rows);
+            const size_t block = report.active() ? report.interval() : std::max(size_t(1), total_rows);
+            for (size_t begin = 0; begin < total_rows; begin += block)
+            {
+                const size_t end = std::min(total_rows, begin + block);
+                const size_t matched_before = columnar ? selected_indices.size() : selected_rows.size();
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (predicate(i, *this))
+                    {
+                        if (columnar) {
+                            selected_indices.push_back(static_cast<int>(i));
+                        } else {
+                            selected_rows.push_back(rows[i]);
+                        }
+                    }
+                }
+                report.add(end - begin, (columnar ? selected_indices.size() : selected_rows.size()) - matched_before);
+            }
+            report.finish();
+
+            if (columnar) {
+                return sub_table(selected_indices);
+            }
+            return CSVTable(col_names, col_map, std::move(selected_rows));
+        }
+
+        /**
+         * @brief Filters rows in-place to conserve memory (modifies the table).
+         * @param predicate A function that takes a row index and the table, returning true if the row should be kept.
+         * @param show_progress If true, report progress to the table's observer (by default a stderr progress line).
+         * @return size_t The number of rows remaining after filtering.
+         */
+        size_t filter_in_place(const RowPredicate &predicate, bool show_progress = false)
+        {
+            // Columnar tables are marked first and compacted once at the end
+            const bool columnar = mode == StorageMode::Columnar;
+            const size_t total_rows = row_count();
+            std::vector<char> keep(columnar ? total_rows : 0, 0);
+
+            OperationReporter report(show_progress ? observer() : nullptr, "filter_in_place", "", total_rows);
+            const size_t block = report.active() ? report.interval() : std::max(size_t(1), total_rows);
+            size_t write_idx = 0;
+            for (size_t begin = 0; begin < total_rows; begin += block)
+            {
+                const size_t end = std::min(total_rows, begin + block);
+                const size_t kept_before = write_idx;
+                for (size_t read_idx = begin; read_idx < end; ++read_idx)
+                {
+                    if (predicate(read_idx, *this))
+                    {
+                        if (columnar) {
+                            keep[read_idx] = 1;
+                        } else if (write_idx != read_idx) {
+                            rows[write_idx] = std::move(rows[read_idx]);
+                        }
+                        ++write_idx;
+                    }
+                }
+                report.add(end - begin, write_idx - kept_before);
+            }
+            report.finish();
+
+            // Resize to actual number of kept rows
+            if (columnar) {
+                retain_rows(keep);
+            } else {
+                indexes.clear();
+                rows.resize(write_idx);
+            }
+            return write_idx;
+        }
+
+        /**
+         * @brief Creates a new table with rows that match a predicate, evaluating it on several threads.
+         *
+         * Rows are split into blocks that are filtered concurrently and concatenated in row order, so the
+         * result matches the serial overload. The predicate must follow the ExecutionPolicy contract.
+         * @param predicate A function that takes a row index and the table, returning true if the row should be included.
+         * @param policy The number of threads to use.
+         * @param show_progress If true, report progress to the table's observer (by default a stderr progress line).
+         * @return CSVTable A new table with the filtered rows.
+         */
+        CSVTable filter_table_fast(const RowPredicate &predicate, ExecutionPolicy policy, bool show_progress = false) const
+        {
+            const size_t num_threads = policy.threads();
+            if (num_threads <= 1)
+            {
+                return filter_table_fast(predicate, show_progress);
+            }
+            const size_t total_rows = row_count();
+            const size_t num_blocks = (total_rows + rows_per_parallel_block - 1) / rows_per_parallel_block;
+            std::vector<std::vector<int>> block_matches(num_blocks);
+            OperationReporter progress(show_progress ? observer() : nullptr, "filter_table_fast", "", total_rows);
+            parallel_for(num_blocks, num_threads, [&](size_t b)
+            {
+                const size_t begin = b * rows_per_parallel_block;
+                const size_t end = std::min(total_rows, begin + rows_per_parallel_block);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (predicate(static_cast<int>(i), *this))
+                    {
+                        block_matches[b].push_back(static_cast<int>(i));
+                    }
+                }
+                progress.add(end - begin, block_matches[b].size());
+            });
+            progress.finish();
+
+            std::vector<int> selected_indices;
+            for (const auto &block : block_matches)
+            {
+                selected_indices.insert(selected_indices.end(), block.begin(), block.end());
+            }
+            if (mode == StorageMode::Columnar)
+            {
+                return sub_table(selected_indices);
+            }
+            // Copy the selected rows in parallel too; each block writes its own output range
+            std::vector<size_t> offsets(num_blocks + 1, 0);
+            for (size_t b = 0; b < num_blocks; ++b)
+            {
+                offsets[b + 1] = offsets[b] + block_matches[b].size();
+            }
+            std::vector<std::vector<CellValue>> selected_rows(selected_indices.size());
+            parallel_for(num_blocks, num_threads, [&](size_t b)
+            {
+                for (size_t k = 0; k < block_matches[b].size(); ++k)
+                {
+                    selected_rows[offsets[b] + k] = rows[block_matches[b][k]];
+                }
+            });
+            return CSVTable(col_names, col_map, std::move(selected_rows));
+        }
+
+        /**
+         * @brief Filters rows in-place, evaluating the predicate on several threads (modifies the table).
+         *
+         * All rows are marked in parallel first and then compacted, so the predicate always sees the
+         * unmodified table. The predicate must follow the ExecutionPolicy contract.
+         * @param predicate A function that takes a row index and the table, returning true if the row should be kept.
+         * @param policy The number of threads to use.
+         * @param show_progress If true, report progress to the table's observer (by default a stderr progress line).
+         * @return size_t The number of rows remaining after filtering.
+         */
+        size_t filter_in_place(const RowPredicate &predicate, ExecutionPolicy policy, bool show_progress = false)
+        {
+            const size_t num_threads = policy.threads();
+            if (num_threads <= 1)
+            {
+                return filter_in_place(predicate, show_progress);
+            }
+            const size_t total_rows = row_count();
+            const size_t num_blocks = (total_rows + rows_per_parallel_block - 1) / rows_per_parallel_block;
+            std::vector<char> keep(total_rows, 0);
+            OperationReporter progress(show_progress ? observer() : nullptr, "filter_in_place", "", total_rows);
+            const CSVTable &self = *this;
+            parallel_for(num_blocks, num_threads, [&](size_t b)
+            {
+                const size_t begin = b * rows_per_parallel_block;
+                const size_t end = std::min(total_rows, begin + rows_per_parallel_block);
+                size_t kept = 0;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    keep[i] = predicate(static_cast<int>(i), self);
+                    kept += keep[i];
+                }
+                progress.add(end - begin, kept);
+            });
+            progress.finish();
+            retain_rows(keep);
+            return row_count();
+        }
+
+        /**
+         * @brief Evaluates a declarative filter into a selection bitmap.
+         *
+         * Typed columnar columns are compared in tight loops over their value buffers; row storage and
+         * Mixed columns compare cell by cell. Missing cells never match (see ColumnPredicate).
+         * @param filter The filter to evaluate.
+         * @return Selection The matching rows.
+         * @throws std::invalid_argument If a filter column does not exist.
+         */
+        Selection select(const Filter &filter) const
+        {
+            Selection result = Selection::none(row_count());
+            if (filter.kind_ == Filter::Kind::Predicate)
+            {
+                auto it = col_map.find(filter.predicate_.column);
+                if (it == col_map.end())
+                {
+                    throw std::invalid_argument("Column not found: " + filter.predicate_.column);
+                }
+                select_predicate(filter.predicate_, it->second, result.words_.data());
+                return result;
+            }
+            for (size_t i = 0; i < filter.children_.size(); ++i)
+            {
+                Selection part = select(filter.children_[i]);
+                if (i == 0)
+                    result = std::move(part);
+                else if (filter.kind_ == Filter::Kind::And)
+                    result &= part;
+                else
+                    result |= part;
+            }
+            return result;
+        }
+
+        /**
+         * @brief Evaluates a bool expression into a Selection of the rows where it is true (see ExprNode).
+         * @param expr The expression, e.g. CSVTable::col<double>("price") * CSVTable::col<int>("qty") > 1000.0.
+         * @param num_threads Threads to evaluate on (0 = hardware concurrency).
+         * @return Selection The rows where the expression is true; rows where it is missing are not selected.
+         * @throws std::invalid_argument If a column of the expression does not exist, or a cell cannot be
+         *         converted to the type its column is read as (as in get<T>).
+         */
+        template <typename E>
+            requires is_expression<E>
+        Selection select(const E &expr, size_t num_threads = 1) const
+        {
+            static_assert(std::is_same_v<typename E::value_type, bool>, "select needs a bool expression");
+            auto [values, validity] = evaluate_expression(expr, num_threads);
+            Selection result = Selection::none(row_count());
+            for (size_t r = 0; r < values.size(); ++r)
+            {
+                result.words_[r >> 6] |= uint64_t(values[r]) << (r & 63);
+            }
+            for (size_t w = 0; w < validity.size(); ++w)
+            {
+                result.words_[w] &= validity[w];
+            }
+            return result;
+        }
+
+        /**
+         * @brief Creates a new table with the rows matching a declarative filter.
+         * @param filter The filter to evaluate.
+         * @return CSVTable A new table with the matching rows.
+         * @throws std::invalid_argument If a filter column does not exist.
+         */
+        CSVTable filter_table(const Filter &filter) const
+        {
+            return sub_table(select(filter));
+        }
+
+        /**
+         * @brief Keeps only the rows matching a declarative filter (modifies the table).
+         * @param filter The filter to evaluate.
+         * @return size_t The number of rows remaining after filtering.
+         * @throws std::invalid_argument If a filter column does not exist.
+         */
+        size_t filter_in_place(const Filter &filter)
+        {
+            return filter_in_place(select(filter));
+        }
+
+        /**
+         * @brief Keeps only the selected rows (modifies the table).
+         * @param selection A selection covering every row of the table.
+         * @return size_t The number of rows remaining after filtering.
+         * @throws std::invalid_argument If the selection does not cover the table's rows.
+         */
+        size_t filter_in_place(const Selection &selection)
+        {
+            if (selection.size() != row_count())
+            {
+                throw std::invalid_argument("Selection does not match the number of rows");
+            }
+            std::vector<char> keep(row_count());
+            for (size_t r = 0; r < keep.size(); ++r)
+            {
+                keep[r] = selection.test(r);
+            }
+            retain_rows(keep);
+            return row_count();
+        }
+
+        /**
+         * @brief Creates a sub-table with the selected rows.
+         * @param selection A selection covering every row of the table.
+         * @return CSVTable A new table with the selected rows.
+         * @throws std::invalid_argument If the selection does not cover the table's rows.
+         */
+        CSVTable sub_table(const Selection &selection) const
+        {
+            if (selection.size() != row_count())
+            {
+                throw std::invalid_argument("Selection does not match the number of rows");
+            }
+            return sub_table(selection.indices());
+        }
+
+        /**
+         * @brief Creates a sub-table with selected rows.
+         * @param row_indices The indices of the rows to include.
+         * @return CSVTable A new table with the selected rows.
+         * @throws std::out_of_range If any row index is invalid.
+         */
+        CSVTable sub_table(const std::vector<int> &row_indices) const
+        {
+            if (mode == StorageMode::Columnar)
+            {
+                for (int idx : row_indices)
+                {
+                    if (idx < 0 || static_cast<size_t>(idx) >= row_count())
+                    {
+                        throw std::out_of_range("Invalid row index: " + std::to_string(idx));
+                    }
+                }
+                CSVTable result = empty_copy();
+                for (const auto &column : cols)
+                {
+                    result.cols.push_back(column.gather(row_indices));
+                }
+                return result;
+            }
+            std::vector<std::vector<CellValue>> selected_rows;
+            selected_rows.reserve(row_indices.size());  // Reserve exact size
+
+            for (int idx : row_indices)
+            {
+                if (static_cast<size_t>(idx) >= rows.size())
+                {
+                    throw std::out_of_range("Invalid row index: " + std::to_string(idx));
+                }
+                selected_rows.push_back(rows[idx]);
+            }
+            return CSVTable(col_names, col_map, std::move(selected_rows));
+        }
+
+        /**
+         * @brief Creates a view of all rows, for copy-free filtering, sorting and statistics.
+         * @return TableView A view referencing this table.
+         */
+        TableView view() const
+        {
+            return TableView(*this);
+        }
+
+        /**
+         * @brief Creates a view of the rows matching a declarative filter.
+         * @param filter The filter to evaluate.
+         * @return TableView A view referencing this table.
+         * @throws std::invalid_argument If a filter column does not exist.
+         */
+        TableView view(const Filter &filter) const
+        {
+            return TableView(*this, select(filter));
+        }
+
+        /**
+         * @brief Groups the rows by the values of key columns, for aggregation with GroupBy::agg.
+         * @param keys The key columns.
+         * @return GroupBy A grouping referencing this table.
+         * @throws std::invalid_argument If keys is empty or a key column does not exist.
+         */
+        GroupBy group_by(const std::vector<std::string> &keys) const
+        {
+            if (keys.empty())
+            {
+                throw std::invalid_argument("group_by needs at least one key column");
+            }
+            std::vector<int> key_cols;
+            for (const auto &key : keys)
+            {
+                if (!col_map.contains(key))
+                {
+                    throw std::invalid_argument("Column name not found: " + key);
+                }
+                key_cols.push_back(col_map.at(key));
+            }
+            return GroupBy(*this, std::move(key_cols));
+        }
+
+        /**
+         * @brief Starts a lazy query over this table; see LazyTable.
+         * @return LazyTable A plan referencing this table, which must outlive it.
+         */
+        LazyTable lazy() const
+        {
+            return LazyTable(*this);
+        }
+
+        /**
+         * @brief Starts a lazy query over a CSV file, which is read by collect() with only the needed columns.
+         * @param filename The path to the CSV file.
+         * @param schema Optional declared column types, as for read_file(filename, schema).
+         * @param storage The storage mode of the result.
+         * @return LazyTable A plan reading the file.
+         */
+        static LazyTable scan_csv(std::string_view filename, Schema schema = {}, StorageMode storage = StorageMode::Columnar)
+        {
+            return LazyTable(LazyTable::Source::Csv, std::string(filename), std::move(schema), storage);
+        }
+
+        /**
+         * @brief Starts a lazy query over a Parquet file, which is read by collect() with projection and predicate pushdown.
+         * @param filename The path to the Parquet file.
+         * @param storage The storage mode of the result.
+         * @return LazyTable A plan reading the file.
+         */
+        static LazyTable scan_parquet(std::string_view filename, StorageMode storage = StorageMode::Columnar)
+        {
+            return LazyTable(LazyTable::Source::Parquet, std::string(filename), {}, storage);
+        }
+
+        /**
+         * @brief Modifies rows using a provided function.
+         * @param modifier A function that takes a row index and the table, modifying the row in place.
+         */
+        void modify(const std::function<void(int, CSVTable &)> &modifier)
+        {
+            for (size_t i : std::views::iota(0u, row_count()))
+            {
+                modifier(i, *this);
+            }
+        }
+
+        /**
+         * @brief Modifies rows using a provided function, on several threads in row storage.
+         *
+         * The modifier must follow the ExecutionPolicy contract: it may only write cells of the row it is
+         * called for. Columnar tables run serially, because a write may change a column's type. Any column
+         * may be written, so the parallel path drops the table's indexes before starting the workers.
+         * @param modifier A function that takes a row index and the table, modifying the row in place.
+         * @param policy The number of threads to use.
+         */
+        void modify(const std::function<void(int, CSVTable &)> &modifier, ExecutionPolicy policy)
+        {
+            const size_t num_threads = policy.threads();
+            if (num_threads <= 1 || mode == StorageMode::Columnar)
+            {
+                modify(modifier);
+                return;
+            }
+            indexes.clear();
+            const size_t n = row_count();
+            const size_t num_blocks = (n + rows_per_parallel_block - 1) / rows_per_parallel_block;
+            parallel_for(num_blocks, num_threads, [&](size_t b)
+            {
+                const size_t end = std::min(n, (b + 1) * rows_per_parallel_block);
+                for (size_t i = b * rows_per_parallel_block; i < end; ++i)
+                {
+                    modifier(static_cast<int>(i), *this);
+                }
+            });
+        }
+
+        /**
+         * @brief Selects the rows with no missing value (a null, "", "NA", "NaN" or "#N/A") in the given columns.
+         *
+         * In columnar storage the validity bitmaps are ANDed a word at a time; only string and mixed
+         * columns look at their cells, for the NA strings.
+         *
+         * @param columns The columns to check. If empty, checks all columns.
+         * @throws std::invalid_argument If any specified column does not exist.
+         */
+        Selection notna(const std::vector<std::string> &columns = {}) const
+        {
+            const auto &cols_to_check = columns.empty() ? col_names : columns;
+            for (const auto &col : cols_to_check)
+            {
+                if (!col_map.contains(col))
+                {
+                    throw std::invalid_argument("Column name not found: " + col);
+                }
+            }
+
+            const size_t n = row_count();
+            Selection selection = Selection::all(n);
+            for (const auto &col : cols_to_check)
+            {
+                const int col_index = col_map.at(col);
+                if (mode == StorageMode::Columnar)
+                {
+                    const Column &column = cols[col_index];
+                    const auto &validity = column.validity();
+                    for (size_t w = 0; w < selection.words_.size(); ++w)
+                    {
+                        selection.words_[w] &= validity[w];
+                    }
+                    clear_na_strings(column, selection);
+                    continue;
+                }
+                for (size_t r = 0; r < n; ++r)
+                {
+                    const CellValue &cell = rows[r][col_index];
+                    if (std::holds_alternative<std::string>(cell) && is_na_string(std::get<std::string>(cell)))
+                    {
+                        selection.set(r, false);
+                    }
+                }
+            }
+            return selection;
+        }
+
+        /**
+         * @brief Drops rows with missing values in specified columns.
+         * @param columns The columns to check for missing values. If empty, checks all columns.
+         * @throws std::invalid_argument If any specified column does not exist.
+         */
+        void dropna(const std::vector<std::string> &columns = {})
+        {
+            Selection keep = notna(columns);
+            if (keep.count() != row_count())
+            {
+                filter_in_place(keep);
+            }
+        }
+
+        /**
+         * @brief Renames columns based on a mapping.
+         * @param rename_map A map from old column names to new column names.
+         * @throws std::invalid_argument If an old column does not exist or a new column name already exists.
+         */
+        void rename_columns(const std::unordered_map<std::string, std::string, string_hash, string_equal> &rename_map)
+        {
+            for (const auto &[old_name, new_name] : rename_map)
+            {
+                auto it = col_map.find(old_name);
+                if (it == col_map.end())
+                {
+                    throw std::invalid_argument("Column name not found: " + old_name);
+                }
+                if (col_map.contains(new_name))
+                {
+                    throw std::invalid_argument("New column name already exists: " + new_name);
+                }
+                int col_index = it->second;
+                col_map.erase(it);
+                col_map[new_name] = col_index;
+                col_names[col_index] = new_name;
+            }
+        }
+
+        /**
+         * @brief Sorts the table by a column.
+         *
+         * The keys are converted to T once and a permutation of the rows is sorted, with an LSD radix sort
+         * for int, uint64_t, double and bool keys (always stable). The rows are then moved (or, in columnar
+         * storage, gathered) into their new order in one pass.
+         *
+         * @tparam T The type of the column to sort by.
+         * @param col_name The name of the column to sort by.
+         * @param ascending If true, sort in ascending order; otherwise, descending.
+         * @param stable If true, rows with equal keys keep their order (string keys only; radix sorts are always stable).
+         * @param num_threads Number of worker threads (0 = hardware concurrency).
+         * @throws std::invalid_argument If the column does not exist.
+         * @throws std::runtime_error If conversion fails.
+         */
+        template <ConvertibleToCellValue T>
+        void sort_by_column(std::string_view col_name, bool ascending, bool stable = false, size_t num_threads = 1)
+        {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end())
+            {
+                throw std::invalid_argument("Column not found: " + std::string(col_name));
+            }
+            int col_index = it->second;
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            const size_t n = row_count();
+            std::vector<size_t> order(n);
+            std::iota(order.begin(), order.end(), size_t(0));
+            auto for_blocks = [&](auto &&body)
+            {
+                parallel_for((n + rows_per_parallel_block - 1) / rows_per_parallel_block, num_threads, [&](size_t block)
+                {
+                    body(block * rows_per_parallel_block, std::min(n, (block + 1) * rows_per_parallel_block));
+                });
+            };
+            if constexpr (std::is_same_v<T, std::string>)
+            {
+                std::vector<std::string> keys(n);
+                for_blocks([&](size_t begin, size_t end)
+                {
+                    for (size_t r = begin; r < end; ++r)
+                        keys[r] = value_as<T>(r, col_index);
+                });
+                auto less = [&keys, ascending](size_t a, size_t b)
+                { return ascending ? keys[a] < keys[b] : keys[b] < keys[a]; };
+                sort_indices(order, less, stable, num_threads);
+            }
+            else
+            {
+                std::vector<uint64_t> keys(n);
+                for_blocks([&](size_t begin, size_t end)
+                {
+                    for (size_t r = begin; r < end; ++r)
+                    {
+                        uint64_t bits = sortable_bits(value_as<T>(r, col_index));
+                        keys[r] = ascending ? bits : ~bits;
+                    }
+                });
+                radix_sort_indices(order, keys, num_threads);
+            }
+            apply_permutation(order, num_threads);
+        }
+
+        /**
+         * @brief A sort key for sort_by_columns.
+         */
+        struct SortKey
+        {
+            std::string column;
+            bool ascending = true;
+        };
+
+        /**
+         * @brief Sorts the table by several columns, each ascending or descending. The sort is stable.
+         *
+         * The keys are ordered like ColumnPredicate values: numbers by value, strings lexicographically, and
+         * numbers below strings in a column holding both. Missing values come last in either direction.
+         * Integer and double keys are radix sorted; each key is sorted stably from the last to the first,
+         * and the rows are moved into their final order once.
+         *
+         * @param keys The sort keys, most significant first.
+         * @param num_threads Number of worker threads (0 = hardware concurrency).
+         * @throws std::invalid_argument If keys is empty or a column does not exist.
+         */
+        void sort_by_columns(const std::vector<SortKey> &keys, size_t num_threads = 1)
+        {
+            if (keys.empty())
+            {
+                throw std::invalid_argument("sort_by_columns needs at least one key");
+            }
+            for (const auto &key : keys)
+            {
+                if (!col_map.contains(key.column))
+                {
+                    throw std::invalid_argument("Column not found: " + key.column);
+                }
+            }
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            std::vector<size_t> order(row_count());
+            std::iota(order.begin(), order.end(), size_t(0));
+            for (auto key = keys.rbegin(); key != keys.rend(); ++key)
+            {
+                sort_indices_by_column(order, col_map.at(key->column), key->ascending, num_threads);
+            }
+            apply_permutation(order, num_threads);
+        }
+
+        /**
+         * @brief Fills missing values in specified columns with a given value.
+         * @tparam T The type of the fill value.
+         * @param columns The columns to fill.
+         * @param fill_value The value to use for filling.
+         * @throws std::invalid_argument If any specified column does not exist.
+         */
+        template <ConvertibleToCellValue T>
+        void fillna(const std::vector<std::string> &columns, const T &fill_value)
+        {
+            for (const auto &col : columns)
+            {
+                if (!col_map.contains(col))
+                {
+                    throw std::invalid_argument("Column name not found: " + col);
+                }
+                int col_index = col_map.at(col);
+                indexes.erase(col_index);
+                if (mode == StorageMode::Columnar)
+                {
+                    // Nulls come from the bitmap; only string and mixed columns can also hold NA strings
+                    Column &column = cols[col_index];
+                    Selection na_strings = Selection::all(column.size());
+                    clear_na_strings(column, na_strings);
+                    column.fill_nulls(fill_value);
+                    if (na_strings.count() != column.size())
+                    {
+                        for (size_t i = 0; i < column.size(); ++i)
+                        {
+                            if (!na_strings.test(i))
+                                column.set(i, fill_value);
+                        }
+                    }
+                    continue;
+                }
+                for (auto &row : rows)
+                {
+                    CellValue &cell = row[col_index];
+                    if (std::holds_alternative<std::string>(cell) && is_na_string(std::get<std::string>(cell)))
+                    {
+                        cell = fill_value;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Drops duplicate rows based on specified columns.
+         *
+         * Rows are compared on their typed values (an int 1 and a string "1" differ), through a hash of
+         * the key cells. The survivors are moved into place, keeping their order. With num_threads > 1
+         * the rows are scattered into partitions by key hash in one pass, and each partition is deduplicated
+         * on its own thread.
+         *
+         * @param columns The columns to consider for duplicates. If empty, considers all columns.
+         * @param keep Which occurrence of each key survives: "first" or "last".
+         * @param num_threads Number of worker threads (0 = hardware concurrency).
+         * @throws std::invalid_argument If any specified column does not exist or keep is invalid.
+         */
+        void drop_duplicates(const std::vector<std::string> &columns = {}, std::string_view keep = "first",
+                             size_t num_threads = 1)
+        {
+            if (keep != "first" && keep != "last")
+            {
+                throw std::invalid_argument("Invalid keep mode: " + std::string(keep));
+            }
+            auto cols_to_check = columns.empty() ? col_names : columns;
+            std::vector<int> key_cols;
+            for (const auto &col : cols_to_check)
+            {
+                if (!col_map.contains(col))
+                {
+                    throw std::invalid_argument("Column name not found: " + col);
+                }
+                key_cols.push_back(col_map.at(col));
+            }
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            size_t n = row_count();
+            size_t partitions = n < rows_per_parallel_block ? 1 : num_threads;
+            size_t num_blocks = (n + rows_per_parallel_block - 1) / rows_per_parallel_block;
+            std::vector<size_t> hashes(n);
+            std::vector<size_t> offsets(num_blocks * partitions + 1, 0); // rows per (partition, block)
+            parallel_for(num_blocks, num_threads, [&](size_t block)
+            {
+                size_t end = std::min(n, (block + 1) * rows_per_parallel_block);
+                for (size_t r = block * rows_per_parallel_block; r < end; ++r)
+                {
+                    hashes[r] = hash_key(r, key_cols);
+                    ++offsets[hashes[r] % partitions * num_blocks + block + 1];
+                }
+            });
+
+            // Scatter the rows into one bucket per partition, each in row order, so that every partition
+            // thread reads only its own rows.
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            std::vector<size_t> bucketed(n);
+            parallel_for(num_blocks, num_threads, [&](size_t block)
+            {
+                std::vector<size_t> pos(partitions);
+                for (size_t part = 0; part < partitions; ++part)
+                    pos[part] = offsets[part * num_blocks + block];
+                size_t end = std::min(n, (block + 1) * rows_per_parallel_block);
+                for (size_t r = block * rows_per_parallel_block; r < end; ++r)
+                {
+                    bucketed[pos[hashes[r] % partitions]++] = r;
+                }
+            });
+
+            std::vector<char> keep_row(n, 0);
+            parallel_for(partitions, num_threads, [&](size_t part)
+            {
+                auto hash = [&](size_t r) { return hashes[r]; };
+                auto equal = [&](size_t a, size_t b)
+                { return hashes[a] == hashes[b] && keys_equal(a, key_cols, *this, b, key_cols); };
+                std::unordered_set<size_t, decltype(hash), decltype(equal)> seen(0, hash, equal);
+                auto bucket = std::span(bucketed).subspan(offsets[part * num_blocks],
+                                                          offsets[(part + 1) * num_blocks] - offsets[part * num_blocks]);
+                if (keep == "first")
+                {
+                    for (size_t r : bucket)
+                        keep_row[r] = seen.insert(r).second;
+                }
+                else
+                {
+                    for (size_t r : std::views::reverse(bucket))
+                        keep_row[r] = seen.insert(r).second;
+                }
+            });
+            retain_rows(keep_row);
+        }
+
+        /**
+         * @brief Merges this table with another table based on common columns.
+         *
+         * Keys are compared on their typed values, as in drop_duplicates. Rows follow the left table
+         * ("right": the right table), each with its matches in the other table's order, and an outer join
+         * appends the unmatched right rows. When both tables are sorted ascending on the key columns (e.g.
+         * by sort_by_column) this order is produced by a sort-merge join; otherwise the smaller table is
+         * hashed and the larger one probes it, in parallel blocks when num_threads > 1. Either way the
+         * result is the same. Cells with no matching row are missing values, which are nulls in columnar
+         * storage.
+         *
+         * @param other The other table to merge with.
+         * @param on_columns The columns to merge on.
+         * @param how The type of merge ("inner", "left", "right", "outer").
+         * @param num_threads Number of worker threads for hashing, probing and building the result
+         *                    (0 = hardware concurrency).
+         * @return CSVTable The merged table, in this table's storage mode.
+         * @throws std::invalid_argument If on_columns are invalid or how is invalid.
+         */
+        CSVTable merge(const CSVTable &other, const std::vector<std::string> &on_columns, std::string_view how,
+                       size_t num_threads = 1) const
+        {
+            if (!std::ranges::contains(std::array{"inner", "left", "right", "outer"}, how))
+            {
+                throw std::invalid_argument("Invalid join type: " + std::string(how));
+            }
+
+            std::vector<int> keys[2];
+            for (const auto &col : on_columns)
+            {
+                if (!col_map.contains(col))
+                {
+                    throw std::invalid_argument("Column not found in left table: " + col);
+                }
+                if (!other.col_map.contains(col))
+                {
+                    throw std::invalid_argument("Column not found in right table: " + col);
+                }
+                keys[0].push_back(col_map.at(col));
+                keys[1].push_back(other.col_map.at(col));
+            }
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            // Output columns: all left columns, then the right non-key columns. Each takes its cell from the
+            // left row, or from the right row (key columns of right-only rows) when there is no left row.
+            std::vector<std::string> new_col_names = col_names;
+            std::unordered_map<std::string, int, string_hash, string_equal> new_col_map = col_map;
+            std::vector<std::array<int, 2>> sources;
+            for (size_t c = 0; c < col_names.size(); ++c)
+            {
+                auto key = std::ranges::find(keys[0], static_cast<int>(c));
+                sources.push_back({static_cast<int>(c), key == keys[0].end() ? -1 : keys[1][key - keys[0].begin()]});
+            }
+            for (size_t c = 0; c < other.col_names.size(); ++c)
+            {
+                if (std::ranges::contains(keys[1], static_cast<int>(c)))
+                {
+                    continue;
+                }
+                const std::string &col = other.col_names[c];
+                std::string new_name = col;
+                int suffix = 0;
+                while (new_col_map.contains(new_name))
+                {
+                    new_name = col + "_other" + (suffix ? std::to_string(suffix) : "");
+                    suffix++;
+                }
+                new_col_names.push_back(new_name);
+                new_col_map[new_name] = new_col_names.size() - 1;
+                sources.push_back({-1, static_cast<int>(c)});
+            }
+
+            JoinIndices matches = sorted_for_merge_join(keys[0], other, keys[1])
+                                      ? merge_join_indices(other, keys, how)
+                                      : hash_join_indices(other, keys, how, num_threads);
+
+            const CSVTable *tables[2] = {this, &other};
+            const size_t n = matches[0].size();
+            CSVTable result;
+            result.col_names = std::move(new_col_names);
+            result.col_map = std::move(new_col_map);
+            result.mode = mode;
+            if (mode == StorageMode::Columnar)
+            {
+                result.cols.resize(sources.size());
+                parallel_for(sources.size(), num_threads, [&](size_t c)
+                {
+                    auto [left_col, right_col] = sources[c];
+                    int side = left_col >= 0 ? 0 : 1;
+                    Column column = tables[side]->gather_column(side == 0 ? left_col : right_col, matches[side]);
+                    if (side == 0 && right_col >= 0)
+                    {
+                        for (size_t i = 0; i < n; ++i)
+                        {
+                            if (matches[0][i] == Column::npos)
+                                column.set(i, other.cell_at(matches[1][i], right_col));
+                        }
+                    }
+                    result.cols[c] = std::move(column);
+                });
+                return result;
+            }
+
+            result.rows.resize(n);
+            parallel_for((n + rows_per_parallel_block - 1) / rows_per_parallel_block, num_threads, [&](size_t block)
+            {
+                size_t end = std::min(n, (block + 1) * rows_per_parallel_block);
+                for (size_t i = block * rows_per_parallel_block; i < end; ++i)
+                {
+                    auto &row = result.rows[i];
+                    row.reserve(sources.size());
+                    for (auto [left_col, right_col] : sources)
+                    {
+                        if (left_col >= 0 && matches[0][i] != Column::npos)
+                            row.push_back(cell_at(matches[0][i], left_col));
+                        else if (right_col >= 0 && matches[1][i] != Column::npos)
+                            row.push_back(other.cell_at(matches[1][i], right_col));
+                        else
+                            row.emplace_back(std::string(""));
+                    }
+                }
+            });
+            return result;
+        }
+
+        /**
+         * @brief Joins this table with another table based on row indices.
+         * @param other The other table to join with.
+         * @param how The type of join ("inner", "left", "right", "outer").
+         * @return CSVTable The joined table.
+         * @throws std::invalid_argument If how is invalid.
+         */
+        CSVTable join(const CSVTable &other, std::string_view how) const
+        {
+            if (!std::ranges::contains(std::array{"inner", "left", "right", "outer"}, how))
+            {
+                throw std::invalid_argument("Invalid join type: " + std::string(how));
+            }
+
+            std::vector<std::string> new_col_names;
+            std::vector<std::pair<int, int>> column_sources;
+            for (const auto &col : col_names)
+            {
+                new_col_names.push_back(col);
+                column_sources.push_back({0, col_map.at(col)});
+            }
+            for (const auto &col : other.col_names)
+            {
+                std::string new_name = col;
+                int suffix = 0;
+                while (std::find(new_col_names.begin(), new_col_names.end(), new_name) != new_col_names.end())
+                {
+                    new_name = col + "_other" + (suffix ? std::to_string(suffix) : "");
+                    suffix++;
+                }
+                new_col_names.push_back(new_name);
+                column_sources.push_back({1, other.col_map.at(col)});
+            }
+
+            size_t N;
+            if (how == "inner")
+            {
+                N = std::min(row_count(), other.row_count());
+            }
+            else if (how == "left")
+            {
+                N = row_count();
+            }
+            else if (how == "right")
+            {
+                N = other.row_count();
+            }
+            else
+            {
+                N = std::max(row_count(), other.row_count());
+            }
+
+            std::vector<CellValue> default_this(col_names.size(), std::string(""));
+            std::vector<CellValue> default_other(other.col_names.size(), std::string(""));
+
+            std::vector<std::vector<CellValue>> new_rows;
+            std::vector<CellValue> this_scratch, other_scratch;
+            for (size_t i = 0; i < N; ++i)
+            {
+                const std::vector<CellValue> &this_row = (i < row_count()) ? row_ref(i, this_scratch) : default_this;
+                const std::vector<CellValue> &other_row = (i < other.row_count()) ? other.row_ref(i, other_scratch) : default_other;
+                std::vector<CellValue> new_row;
+                for (const auto &[table, orig_index] : column_sources)
+                {
+                    if (table == 0)
+                    {
+                        new_row.push_back(this_row[orig_index]);
+                    }
+                    else
+                    {
+                        new_row.push_back(other_row[orig_index]);
+                    }
+                }
+                new_rows.push_back(std::move(new_row));
+            }
+
+            std::unordered_map<std::string, int, string_hash, string_equal> new_col_map;
+            for (size_t i = 0; i < new_col_names.size(); ++i)
+            {
+                new_col_map[new_col_names[i]] = i;
+            }
+
+            return CSVTable(std::move(new_col_names), std::move(new_col_map), std::move(new_rows));
+        }
+
+        /**
+         * @brief Saves the table to a CSV file.
+         * @param filename The path to save the file.
+         * @param append If true, append rows to an existing file; the header is only written if the file is new or empty.
+         * @param num_threads Threads used to format rows; 0 uses std::thread::hardware_concurrency(). Output is identical for any value.
+         * @throws std::runtime_error If the file cannot be opened or written.
+         *
+         * Cells are formatted with std::to_chars into a reusable buffer that is written in large
+         * blocks. Fields containing commas, quotes or line breaks are quoted per RFC 4180.
+         */
+        void save_to_file(std::string_view filename, bool append = false, size_t num_threads = 1) const
+        {
+            save_csv(filename, append, num_threads, nullptr);
+        }
+
+    private:
+        /**
+         * @brief Writes the table, or the given rows of it, to a CSV file (see save_to_file).
+         */
+        void save_csv(std::string_view filename, bool append, size_t num_threads, const std::vector<int> *row_indices) const
+        {
+            std::string path(filename);
+            std::error_code ec;
+            bool write_header = !append || !std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0;
+            std::ofstream file(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Cannot open file for writing: " + std::string(filename));
+            }
+            write_csv(file, write_header, num_threads, row_indices);
+            file.flush();
+            if (!file)
+            {
+                throw std::runtime_error("Error writing file: " + std::string(filename));
+            }
+        }
+
+    public:
+
+        /**
+         * @brief Gets the path where read_file looks for a snapshot of a CSV file: the file name plus ".snapshot".
+         */
+        static std::string snapshot_path(std::string_view filename)
+        {
+            return std::string(filename) + ".snapshot";
+        }
+
+        /**
+         * @brief Saves the table in the native snapshot format, which load_snapshot reads back with little
+         * more than a memory map.
+         *
+         * The file holds the column names and the typed column buffers and validity bitmaps of columnar
+         * storage (a row table is converted first); string characters are stored once as a blob. Indexes
+         * are not saved. With a source file, the file also records its size, modification time and a hash
+         * of its first and last 64KB, so read_file(source) loads snapshot_path(source) in place of parsing
+         * while the source is unchanged. The snapshot is written to a temporary file and renamed into place.
+         *
+         * Only the source is checked, not the table: whatever the table holds when it is saved - including
+         * rows filtered out, sorted or modified since it was read from source - is what read_file(source)
+         * returns later. Save a changed table without a source, or under another path, to keep read_file
+         * returning the CSV's contents.
+         *
+         * @param filename The snapshot path, usually snapshot_path(source).
+         * @param source The CSV file the table was read from, or empty for none.
+         * @throws std::runtime_error If the file cannot be written or the source cannot be read.
+         */
+        void save_snapshot(std::string_view filename, std::string_view source = "") const
+        {
+            if (mode == StorageMode::Row)
+            {
+                CSVTable columnar = *this;
+                columnar.set_storage_mode(StorageMode::Columnar);
+                columnar.save_snapshot(filename, source);
+                return;
+            }
+            SourceFingerprint fingerprint;
+            if (!source.empty())
+            {
+                auto current = fingerprint_of(source);
+                if (!current)
+                {
+                    throw std::runtime_error("Cannot read file: " + std::string(source));
+                }
+                fingerprint = *current;
+            }
+            const std::string path(filename), temp_path = path + ".tmp";
+            {
+                std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+                if (!out.is_open())
+                {
+                    throw std::runtime_error("Cannot open file for writing: " + temp_path);
+                }
+                out.write(snapshot_magic.data(), snapshot_magic.size());
+                write_pod(out, snapshot_version);
+                write_pod(out, fingerprint.size);
+                write_pod(out, fingerprint.mtime_ns);
+                write_pod(out, fingerprint.hash);
+                write_pod(out, static_cast<uint64_t>(cols.size()));
+                for (size_t c = 0; c < cols.size(); ++c)
+                {
+                    write_text(out, col_names[c]);
+                    cols[c].write_snapshot(out);
+                }
+                out.flush();
+                if (!out)
+                {
+                    std::error_code ec;
+                    std::filesystem::remove(temp_path, ec);
+                    throw std::runtime_error("Error writing file: " + temp_path);
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(temp_path, path, ec);
+            if (ec)
+            {
+                throw std::runtime_error("Cannot replace file: " + path);
+            }
+        }
+
+        /**
+         * @brief Reads a snapshot written by save_snapshot, appending its rows as read_file does.
+         *
+         * The file is memory-mapped. Numeric columns are copied out in one block each and string cells
+         * point into the mapping, which stays mapped while any column refers to it. In row storage the
+         * columns are converted to rows afterwards.
+         *
+         * @param filename The snapshot path.
+         * @throws std::runtime_error If the file cannot be opened, is not a snapshot of this format version,
+         *         is truncated or corrupt, or has different columns than a non-empty table.
+         */
+        void load_snapshot(std::string_view filename)
+        {
+            auto file = MappedFile::open(std::string(filename));
+            if (!file)
+            {
+                throw std::runtime_error("Cannot open file: " + std::string(filename));
+            }
+            SnapshotReader in{file};
+            if (!read_snapshot_header(in))
+            {
+                throw std::runtime_error("Not a snapshot file of this version: " + std::string(filename));
+            }
+            append_snapshot(in);
+            index_new_rows();
+        }
+
+    private:
+        static constexpr std::string_view snapshot_magic = "M2CSVSNP";
+        static constexpr uint32_t snapshot_version = 1; // Also detects files written with the other byte order
+
+        /// Identifies a version of a source file: its size, modification time and a hash of its first and last 64KB.
+        struct SourceFingerprint
+        {
+            uint64_t size = 0;
+            int64_t mtime_ns = 0;
+            uint64_t hash = 0;
+
+            bool operator==(const SourceFingerprint &) const = default;
+        };
+
+        static uint64_t fnv1a(std::string_view data, uint64_t hash = 14695981039346656037ULL)
+        {
+            for (unsigned char c : data)
+            {
+                hash = (hash ^ c) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        static std::optional<SourceFingerprint> fingerprint_of(std::string_view filename)
+        {
+            const std::string path(filename);
+            std::error_code ec;
+            SourceFingerprint fingerprint;
+            fingerprint.size = std::filesystem::file_size(path, ec);
+            auto mtime = std::filesystem::last_write_time(path, ec);
+            std::ifstream in(path, std::ios::binary);
+            if (ec || !in.is_open())
+            {
+                return std::nullopt;
+            }
+            fingerprint.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+            constexpr uint64_t sample = 1 << 16;
+            std::string buffer(std::min(fingerprint.size, sample), '\0');
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            fingerprint.hash = fnv1a(buffer);
+            if (fingerprint.size > sample)
+            {
+                in.seekg(static_cast<std::streamoff>(fingerprint.size - sample));
+                in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                fingerprint.hash = fnv1a(buffer, fingerprint.hash);
+            }
+            if (!in)
+            {
+                return std::nullopt;
+            }
+            return fingerprint;
+        }
+
+        /**
+         * @brief Reads the snapshot header, returning the source fingerprint, or std::nullopt if the file is
+         * not a snapshot of this format version.
+         */
+        static std::optional<SourceFingerprint> read_snapshot_header(SnapshotReader &in)
+        {
+            const size_t header_size = snapshot_magic.size() + sizeof(uint32_t) + 3 * sizeof(uint64_t);
+            if (in.file->size() < header_size || in.bytes(snapshot_magic.size()) != snapshot_magic ||
+                in.read<uint32_t>() != snapshot_version)
+            {
+                return std::nullopt;
+            }
+            SourceFingerprint fingerprint;
+            fingerprint.size = in.read<uint64_t>();
+            fingerprint.mtime_ns = in.read<int64_t>();
+            fingerprint.hash = in.read<uint64_t>();
+            return fingerprint;
+        }
+
+        /**
+         * @brief Appends the columns that follow a snapshot header.
+         */
+        void append_snapshot(SnapshotReader &in)
+        {
+            append_table(read_snapshot_table(in, mode));
+        }
+
+        /**
+         * @brief Decodes the columns that follow a snapshot header into a new table of the given storage mode.
+         * @throws std::runtime_error If the data is truncated or corrupt.
+         */
+        static CSVTable read_snapshot_table(SnapshotReader &in, StorageMode storage)
+        {
+            CSVTable loaded;
+            loaded.mode = StorageMode::Columnar;
+            const auto num_cols = in.read<uint64_t>();
+            for (uint64_t c = 0; c < num_cols; ++c)
+            {
+                std::string name(in.read_text());
+                Column column = Column::read_snapshot(in);
+                if ((c > 0 && column.size() != loaded.cols.front().size()) || loaded.col_map.contains(name))
+                {
+                    throw std::runtime_error("Snapshot file is truncated or corrupt");
+                }
+                loaded.col_map[name] = static_cast<int>(c);
+                loaded.col_names.push_back(std::move(name));
+                loaded.cols.push_back(std::move(column));
+            }
+            if (storage == StorageMode::Row)
+            {
+                loaded.set_storage_mode(StorageMode::Row);
+            }
+            return loaded;
+        }
+
+        /**
+         * @brief Loads snapshot_path(filename) if it exists and was saved from the current version of filename.
+         *
+         * A snapshot whose body fails to decode is ignored, leaving the table unchanged, so the caller
+         * parses the CSV instead.
+         * @param report Receives the rows and bytes loaded, and the decoding time as the "snapshot" phase.
+         * @return bool True if the snapshot was loaded.
+         */
+        bool read_current_snapshot(std::string_view filename, OperationReporter &report)
+        {
+            std::error_code ec;
+            const std::string path = snapshot_path(filename);
+            if (!std::filesystem::exists(path, ec))
+            {
+                return false;
+            }
+            auto file = MappedFile::open(path);
+            if (!file)
+            {
+                return false;
+            }
+            SnapshotReader in{file};
+            auto saved = read_snapshot_header(in);
+            if (!saved || saved->size == 0 || saved != fingerprint_of(filename))
+            {
+                return false;
+            }
+            PhaseTimer decode(report, "snapshot");
+            std::optional<CSVTable> loaded;
+            try
+            {
+                loaded.emplace(read_snapshot_table(in, mode));
+            }
+            catch (const std::runtime_error &)
+            {
+                return false;
+            }
+            if (!col_names.empty())
+            {
+                check_header(loaded->col_names, filename);
+            }
+            const size_t rows_loaded = loaded->row_count();
+            append_table(std::move(*loaded));
+            decode.stop();
+            report.add(rows_loaded, 0, file->size());
+            return true;
+        }
+
+    public:
+
+        /**
+         * @brief Reads a Parquet file into the table.
+         * @param filename The path to the Parquet file.
+         * @param num_threads Number of threads converting columns (columnar mode) or row blocks (row mode).
+         *                    0 uses the hardware concurrency; 1 converts serially.
+         * @throws std::runtime_error If the file cannot be opened or read.
+         */
+        void read_parquet(std::string_view filename, size_t num_threads = 1)
+        {
+            try {
+                OperationReporter report(observer(), "read_parquet", filename, 0);
+                PhaseTimer read(report, "read");
+                auto reader = open_parquet_reader(filename);
+
+                // Read the entire file as a table
+                std::shared_ptr<arrow::Table> table;
+                PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+                read.stop();
+                PhaseTimer convert(report, "convert");
+                append_arrow_table(*table, num_threads, report);
+                index_new_rows();
+                convert.stop();
+                add_file_bytes(report, filename);
+                report.finish();
+            } catch (const parquet::ParquetException& e) {
+                throw std::runtime_error("Parquet error: " + std::string(e.what()));
+            } catch (const arrow::Status& status) {
+                throw std::runtime_error("Arrow error: " + status.ToString());
+            }
+        }
+
+        /**
+         * @brief Reads selected columns of the rows matching all predicates from a Parquet file.
+         *
+         * Only the projected and predicate columns are decoded. Row groups whose min/max statistics
+         * show that no row can match are skipped without being read; the remaining rows are then
+         * filtered exactly.
+         * @param filename The path to the Parquet file.
+         * @param columns The columns to load, in order. Empty loads every column.
+         * @param predicates Conditions that a row must all satisfy. Predicate columns need not be projected.
+         * @param num_threads Number of conversion threads, as for read_parquet(filename, num_threads).
+         * @throws std::invalid_argument If a column or predicate column is not in the file.
+         * @throws std::runtime_error If the file cannot be opened or read.
+         */
+        void read_parquet(std::string_view filename, const std::vector<std::string>& columns,
+                          const std::vector<ColumnPredicate>& predicates = {}, size_t num_threads = 1)
+        {
+            try {
+                OperationReporter report(observer(), "read_parquet", filename, 0);
+                PhaseTimer read(report, "read");
+                auto reader = open_parquet_reader(filename);
+                std::shared_ptr<arrow::Schema> file_schema;
+                PARQUET_THROW_NOT_OK(reader->GetSchema(&file_schema));
+
+                // Resolve the projection, then any predicate columns it leaves out
+                std::vector<std::string> read_names = columns;
+                if (read_names.empty()) {
+                    for (const auto& field : file_schema->fields()) {
+                        read_names.push_back(field->name());
+                    }
+                }
+                const size_t projected = read_names.size();
+                for (const auto& predicate : predicates) {
+                    if (std::ranges::find(read_names, predicate.column) == read_names.end()) {
+                        read_names.push_back(predicate.column);
+                    }
+                }
+                std::vector<int> field_indices;
+                for (const auto& name : read_names) {
+                    int index = file_schema->GetFieldIndex(name);
+                    if (index < 0) {
+                        throw std::invalid_argument("Column not found: " + name);
+                    }
+                    field_indices.push_back(index);
+                }
+
+                // Skip row groups whose statistics rule out every predicate match
+                auto metadata = reader->parquet_reader()->metadata();
+                std::vector<int> row_groups;
+                for (int g = 0; g < metadata->num_row_groups(); ++g) {
+                    auto row_group = metadata->RowGroup(g);
+                    bool may_match = true;
+                    for (const auto& predicate : predicates) {
+                        int leaf = metadata->schema()->ColumnIndex(predicate.column);
+                        int field = file_schema->GetFieldIndex(predicate.column);
+                        if (leaf < 0) {
+                            continue;
+                        }
+                        auto range = column_chunk_range(*row_group->ColumnChunk(leaf), file_schema->field(field)->type()->id());
+                        if (range && !range_may_match(range->first, range->second, predicate)) {
+                            may_match = false;
+                            break;
+                        }
+                    }
+                    if (may_match) {
+                        row_groups.push_back(g);
+                    }
+                }
+
+                std::shared_ptr<arrow::Table> read_table;
+                PARQUET_THROW_NOT_OK(reader->ReadRowGroups(row_groups, field_indices, &read_table));
+
+                // Put the columns in the requested order
+                std::vector<std::shared_ptr<arrow::Field>> fields;
+                std::vector<std::shared_ptr<arrow::ChunkedArray>> arrays;
+                for (const auto& name : read_names) {
+                    int index = read_table->schema()->GetFieldIndex(name);
+                    fields.push_back(read_table->schema()->field(index));
+                    arrays.push_back(read_table->column(index));
+                }
+                auto table = arrow::Table::Make(arrow::schema(fields), arrays, read_table->num_rows());
+                read.stop();
+                PhaseTimer convert(report, "convert");
+
+                if (predicates.empty()) {
+                    append_arrow_table(*table, num_threads, report);
+                    index_new_rows();
+                    convert.stop();
+                    add_file_bytes(report, filename);
+                    report.finish();
+                    return;
+                }
+
+                CSVTable part;
+                part.mode = mode;
+                part.observer_ = observer_;
+                part.append_arrow_table(*table, num_threads, report);
+                std::vector<std::pair<size_t, const ColumnPredicate*>> tests;
+                for (const auto& predicate : predicates) {
+                    tests.emplace_back(part.col_map.at(predicate.column), &predicate);
+                }
+                std::vector<char> keep(part.row_count());
+                for (size_t r = 0; r < keep.size(); ++r) {
+                    keep[r] = std::ranges::all_of(tests, [&](const auto& test)
+                                                  { return cell_matches(part.cell_at(r, test.first), *test.second); });
+                }
+                part.retain_rows(keep);
+                while (part.col_names.size() > projected) {
+                    part.delete_column(std::string(part.col_names.back()));
+                }
+                if (col_names.empty()) {
+                    *this = std::move(part);
+                } else {
+                    append_table(part);
+                }
+                convert.stop();
+                add_file_bytes(report, filename);
+                report.finish();
+            } catch (const parquet::ParquetException& e) {
+                throw std::runtime_error("Parquet error: " + std::string(e.what()));
+            } catch (const arrow::Status& status) {
+                throw std::runtime_error("Arrow error: " + status.ToString());
+            }
+        }
+
+    private:
+        /**
+         * @brief Counts a file's size as the bytes an operation consumed, when someone is listening.
+         */
+        static void add_file_bytes(OperationReporter& report, std::string_view filename)
+        {
+            if (report.active()) {
+                std::error_code error;
+                const auto size = std::filesystem::file_size(filename, error);
+                report.add(0, 0, error ? 0 : static_cast<size_t>(size));
+            }
+        }
+
+        /**
+         * @brief Opens a Parquet file for reading through Arrow.
+         * @throws parquet::ParquetException If the file cannot be opened.
+         */
+        static std::unique_ptr<parquet::arrow::FileReader> open_parquet_reader(std::string_view filename)
+        {
+            std::shared_ptr<arrow::io::ReadableFile> infile;
+            PARQUET_ASSIGN_OR_THROW(
+                infile,
+                arrow::io::ReadableFile::Open(std::string(filename))
+            );
+
+            std::unique_ptr<parquet::arrow::FileReader> reader;
+            PARQUET_THROW_NOT_OK(
+                parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader)
+            );
+            return reader;
+        }
+
+        /**
+         * @brief Appends the rows of an Arrow table, taking its column names if the table is empty.
+         * @param report Receives the table's row count and progress as rows are converted.
+         * @throws std::runtime_error If the column names do not match the existing table.
+         */
+        void append_arrow_table(const arrow::Table& table, size_t num_threads, OperationReporter& report)
+        {
+            // Extract column names
+            std::vector<std::string> new_col_names;
+            for (int i = 0; i < table.num_columns(); ++i) {
+                new_col_names.push_back(table.schema()->field(i)->name());
+            }
+
+            // Initialize or verify column names
+            if (col_names.empty()) {
+                col_names = new_col_names;
+                for (size_t i = 0; i < col_names.size(); ++i) {
+                    col_map[col_names[i]] = i;
+                }
+                if (mode == StorageMode::Columnar) {
+                    cols.assign(col_names.size(), Column(Column::Type::String));
+                }
+            } else {
+                if (new_col_names != col_names) {
+                    throw std::runtime_error("Column names in Parquet file do not match existing table");
+                }
+            }
+
+            // Convert Arrow table to CSVTable rows
+            size_t num_rows = table.num_rows();
+            size_t num_cols = table.num_columns();
+
+            if (num_threads == 0) {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            report.set_total(num_rows);
+
+            // Convert column-at-a-time across every chunk (row group), so type dispatch
+            // happens once per chunk rather than once per cell
+            if (mode == StorageMode::Columnar) {
+                std::vector<Column> converted(num_cols);
+                parallel_for(num_cols, num_threads, [&](size_t c)
+                {
+                    converted[c] = arrow_to_column(*table.column(static_cast<int>(c)));
+                    // Report columns as their share of the rows
+                    size_t share = (c + 1) * num_rows / num_cols - c * num_rows / num_cols;
+                    report.add(share);
+                });
+                for (size_t c = 0; c < num_cols; ++c) {
+                    cols[c].append(std::move(converted[c]));
+                }
+            } else {
+                std::vector<std::vector<int64_t>> chunk_starts(num_cols);
+                for (size_t c = 0; c < num_cols; ++c) {
+                    int64_t offset = 0;
+                    for (const auto& chunk : table.column(static_cast<int>(c))->chunks()) {
+                        chunk_starts[c].push_back(offset);
+                        offset += chunk->length();
+                    }
+                }
+
+                // Rows are split into blocks; each block is filled column by column
+                size_t row_offset = rows.size();
+                rows.resize(row_offset + num_rows);
+                size_t num_blocks = (num_rows + parquet_block_rows - 1) / parquet_block_rows;
+                parallel_for(num_blocks, num_threads, [&](size_t b)
+                {
+                    size_t begin = b * parquet_block_rows;
+                    size_t end = std::min(num_rows, begin + parquet_block_rows);
+                    for (size_t r = begin; r < end; ++r) {
+                        rows[row_offset + r].resize(num_cols);
+                    }
+                    for (size_t c = 0; c < num_cols; ++c) {
+                        fill_rows_from_arrow(*table.column(static_cast<int>(c)), chunk_starts[c], c, begin, end, row_offset);
+                    }
+                    report.add(end - begin);
+                });
+            }
+        }
+
+        /**
+         * @brief Orders two cell values: numbers by value, strings lexicographically.
+         * @return unordered for a string and a number, or when a double is NaN.
+         */
+        static std::partial_ordering compare_values(const CellValue& a, const CellValue& b)
+        {
+            const bool a_string = std::holds_alternative<std::string>(a);
+            const bool b_string = std::holds_alternative<std::string>(b);
+            if (a_string || b_string) {
+                if (a_string && b_string) {
+                    return std::get<std::string>(a) <=> std::get<std::string>(b);
+                }
+                return std::partial_ordering::unordered;
+            }
+            if (std::holds_alternative<double>(a) || std::holds_alternative<double>(b)) {
+                auto as_double = [](const CellValue& v)
+                {
+                    return std::visit([](const auto& x) -> double
+                    {
+                        if constexpr (std::is_same_v<std::decay_t<decltype(x)>, std::string>) {
+                            return 0.0; // strings are handled above
+                        } else {
+                            return static_cast<double>(x);
+                        }
+                    }, v);
+                };
+                return as_double(a) <=> as_double(b);
+            }
+            // int, bool and uint64_t compare exactly
+            return std::visit([](const auto& x, const auto& y) -> std::partial_ordering
+            {
+                using X = std::decay_t<decltype(x)>;
+                using Y = std::decay_t<decltype(y)>;
+                if constexpr (std::is_integral_v<X> && std::is_integral_v<Y>) {
+                    // std::cmp_* reject bool, so widen it first
+                    auto widen = [](auto v) { if constexpr (std::is_same_v<decltype(v), bool>) { return int(v); } else { return v; } };
+                    if (std::cmp_less(widen(x), widen(y))) {
+                        return std::partial_ordering::less;
+                    }
+                    return std::cmp_equal(widen(x), widen(y)) ? std::partial_ordering::equivalent : std::partial_ordering::greater;
+                } else {
+                    return std::partial_ordering::unordered;
+                }
+            }, a, b);
+        }
+
+        /**
+         * @brief Checks whether a cell satisfies a predicate. Missing cells never match.
+         */
+        static bool cell_matches(const CellValue& cell, const ColumnPredicate& predicate)
+        {
+            if (std::holds_alternative<std::string>(cell) && std::get<std::string>(cell).empty()) {
+                return false;
+            }
+            std::partial_ordering order = compare_values(cell, predicate.value);
+            if (order == std::partial_ordering::unordered) {
+                return false;
+            }
+            switch (predicate.op) {
+                case CompareOp::Eq: return order == 0;
+                case CompareOp::Ne: return order != 0;
+                case CompareOp::Lt: return order < 0;
+                case CompareOp::Le: return order <= 0;
+                case CompareOp::Gt: return order > 0;
+                case CompareOp::Ge: return order >= 0;
+            }
+            return false;
+        }
+
+        /**
+         * @brief A Filter with its column names resolved to indices, for evaluating it row by row.
+         */
+        struct BoundFilter
+        {
+            const Filter* filter = nullptr;
+            int col = -1;                        ///< Predicate column
+            std::vector<BoundFilter> children{}; ///< Operands of && and ||
+        };
+
+        /**
+         * @brief Resolves the columns of a filter.
+         * @throws std::invalid_argument If a filter column does not exist.
+         */
+        BoundFilter bind_filter(const Filter& filter) const
+        {
+            BoundFilter bound{&filter};
+            if (filter.kind_ == Filter::Kind::Predicate) {
+                auto it = col_map.find(filter.predicate_.column);
+                if (it == col_map.end()) {
+                    throw std::invalid_argument("Column not found: " + filter.predicate_.column);
+                }
+                bound.col = it->second;
+            }
+            for (const Filter& child : filter.children_) {
+                bound.children.push_back(bind_filter(child));
+            }
+            return bound;
+        }
+
+        /**
+         * @brief Evaluates a bound filter for one row, with the same rules as select().
+         */
+        bool row_matches(const BoundFilter& bound, size_t r) const
+        {
+            switch (bound.filter->kind_) {
+                case Filter::Kind::Predicate:
+                    return mode == StorageMode::Columnar ? cell_matches(cols[bound.col].get(r), bound.filter->predicate_)
+                                                         : cell_matches(rows[r][bound.col], bound.filter->predicate_);
+                case Filter::Kind::And:
+                    return std::ranges::all_of(bound.children, [&](const BoundFilter& child) { return row_matches(child, r); });
+                default:
+                    return std::ranges::any_of(bound.children, [&](const BoundFilter& child) { return row_matches(child, r); });
+            }
+        }
+
+        /**
+         * @brief Checks whether any value in [min, max] can satisfy a predicate.
+         * @return true when the range cannot be compared with the predicate value.
+         */
+        static bool range_may_match(const CellValue& min, const CellValue& max, const ColumnPredicate& predicate)
+        {
+            std::partial_ordering vs_min = compare_values(predicate.value, min);
+            std::partial_ordering vs_max = compare_values(predicate.value, max);
+            if (vs_min == std::partial_ordering::unordered || vs_max == std::partial_ordering::unordered) {
+                return true;
+            }
+            switch (predicate.op) {
+                case CompareOp::Eq: return vs_min >= 0 && vs_max <= 0;
+                case CompareOp::Ne: return !(vs_min == 0 && vs_max == 0);
+                case CompareOp::Lt: return vs_min > 0;
+                case CompareOp::Le: return vs_min >= 0;
+                case CompareOp::Gt: return vs_max < 0;
+                case CompareOp::Ge: return vs_max <= 0;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Reads the min/max statistics of a column chunk as cell values.
+         * @param chunk The column chunk metadata of one row group.
+         * @param arrow_type The Arrow type of the column, used to recover unsigned values.
+         * @return The (min, max) pair, or nullopt if the chunk has no usable statistics.
+         */
+        static std::optional<std::pair<CellValue, CellValue>> column_chunk_range(const parquet::ColumnChunkMetaData& chunk,
+                                                                                 arrow::Type::type arrow_type)
+        {
+            if (!chunk.is_stats_set()) {
+                return std::nullopt;
+            }
+            std::shared_ptr<parquet::Statistics> stats = chunk.statistics();
+            if (!stats || !stats->HasMinMax()) {
+                return std::nullopt;
+            }
+            const bool is_unsigned = arrow_type == arrow::Type::UINT8 || arrow_type == arrow::Type::UINT16 ||
+                                     arrow_type == arrow::Type::UINT32 || arrow_type == arrow::Type::UINT64;
+            switch (chunk.type()) {
+                case parquet::Type::BOOLEAN: {
+                    auto typed = std::static_pointer_cast<parquet::BoolStatistics>(stats);
+                    return std::pair<CellValue, CellValue>(typed->min(), typed->max());
+                }
+                case parquet::Type::INT32: {
+                    auto typed = std::static_pointer_cast<parquet::Int32Statistics>(stats);
+                    if (is_unsigned) {
+                        return std::pair<CellValue, CellValue>(uint64_t(uint32_t(typed->min())), uint64_t(uint32_t(typed->max())));
+                    }
+                    return std::pair<CellValue, CellValue>(int(typed->min()), int(typed->max()));
+                }
+                case parquet::Type::INT64: {
+                    auto typed = std::static_pointer_cast<parquet::Int64Statistics>(stats);
+                    if (is_unsigned) {
+                        return std::pair<CellValue, CellValue>(uint64_t(typed->min()), uint64_t(typed->max()));
+                    }
+                    // int64 bounds outside the int range compare as doubles
+                    auto bound = [](int64_t v) -> CellValue
+                    {
+                        if (v >= 0) {
+                            return static_cast<uint64_t>(v);
+                        }
+                        if (std::in_range<int>(v)) {
+                            return static_cast<int>(v);
+                        }
+                        return static_cast<double>(v);
+                    };
+                    return std::pair<CellValue, CellValue>(bound(typed->min()), bound(typed->max()));
+                }
+                case parquet::Type::FLOAT: {
+                    auto typed = std::static_pointer_cast<parquet::FloatStatistics>(stats);
+                    return std::pair<CellValue, CellValue>(double(typed->min()), double(typed->max()));
+                }
+                case parquet::Type::DOUBLE: {
+                    auto typed = std::static_pointer_cast<parquet::DoubleStatistics>(stats);
+                    return std::pair<CellValue, CellValue>(typed->min(), typed->max());
+                }
+                case parquet::Type::BYTE_ARRAY: {
+                    if (arrow_type != arrow::Type::STRING && arrow_type != arrow::Type::DICTIONARY) {
+                        return std::nullopt;
+                    }
+                    auto typed = std::static_pointer_cast<parquet::ByteArrayStatistics>(stats);
+                    auto text = [](const parquet::ByteArray& v)
+                    { return std::string(reinterpret_cast<const char*>(v.ptr), v.len); };
+                    return std::pair<CellValue, CellValue>(text(typed->min()), text(typed->max()));
+                }
+                default:
+                    return std::nullopt;
+            }
+        }
+
+    public:
+        /**
+         * @brief Saves the table to a Parquet file.
+         * @param filename The path to save the Parquet file.
+         * @param options Row-group size, compression and dictionary settings.
+         * @throws std::runtime_error If the file cannot be written.
+         */
+        void save_to_parquet(std::string_view filename, const ParquetWriteOptions& options = ParquetWriteOptions()) const
+        {
+            ParquetWriter writer(filename, options);
+            writer.write(*this);
+            writer.close();
+        }
+
+        /**
+         * @brief Writes a Parquet file incrementally from a sequence of tables with the same columns.
+         *
+         * The Arrow schema is fixed by the first non-empty table written. Later tables are converted
+         * to it; a cell that does not fit a column's type (other than an int in a double column) throws
+         * rather than being lost, so use a schema-typed read when batches may infer differently. Row
+         * groups written before the failing one stay in the file. Each write() adds one or more row
+         * groups of at most options.row_group_size rows, and only one row group at a time is converted
+         * to Arrow arrays.
+         * Dictionary encoding of string columns is decided from the first table written.
+         */
+        class ParquetWriter
+        {
+        public:
+            /**
+             * @brief Prepares a Parquet file for writing. The file is created by the first write().
+             * @param filename The path of the Parquet file.
+             * @param options Row-group size, compression and dictionary settings.
+             */
+            explicit ParquetWriter(std::string_view filename, const ParquetWriteOptions& options = ParquetWriteOptions())
+                : filename_(filename), options_(options) {}
+
+            ~ParquetWriter()
+            {
+                try
+                {
+                    close();
+                }
+                catch (...)
+                {
+                }
+            }
+
+            ParquetWriter(const ParquetWriter &) = delete;
+            ParquetWriter &operator=(const ParquetWriter &) = delete;
+
+            /**
+             * @brief Appends the rows of a table to the file.
+             * @param table The rows to write; its columns must match the first table written.
+             * @throws std::runtime_error If the writer is closed, the columns differ, a cell does not fit its column's
+             * Parquet type, or the file cannot be written.
+             */
+            void write(const CSVTable &table)
+            {
+                if (closed_)
+                {
+                    throw std::runtime_error("Parquet writer is already closed: " + filename_);
+                }
+                if (!col_names_.empty() && table.col_names != col_names_)
+                {
+                    throw std::runtime_error("Columns do not match the Parquet file being written: " + filename_);
+                }
+                col_names_ = table.col_names;
+                if (table.row_count() == 0)
+                {
+                    // Wait for data before fixing the column types
+                    return;
+                }
+                try {
+                    if (!writer_) {
+                        types_.clear();
+                        for (size_t col_idx = 0; col_idx < col_names_.size(); ++col_idx) {
+                            types_.push_back(table.detect_arrow_type(col_idx));
+                        }
+                    }
+                    const size_t group_rows = std::max<size_t>(1, options_.row_group_size);
+                    for (size_t begin = 0; begin < table.row_count(); begin += group_rows) {
+                        size_t end = std::min(table.row_count(), begin + group_rows);
+                        std::vector<std::shared_ptr<arrow::Field>> fields;
+                        std::vector<std::shared_ptr<arrow::Array>> arrays;
+                        for (size_t col_idx = 0; col_idx < col_names_.size(); ++col_idx) {
+                            auto [field, array] = table.build_arrow_column(col_idx, types_[col_idx], begin, end);
+                            fields.push_back(field);
+                            arrays.push_back(array);
+                        }
+                        auto schema = arrow::schema(fields);
+                        if (!writer_) {
+                            open(*schema, table);
+                        }
+                        auto arrow_table = arrow::Table::Make(schema, arrays);
+                        PARQUET_THROW_NOT_OK(writer_->WriteTable(*arrow_table, static_cast<int64_t>(end - begin)));
+                    }
+                    rows_written_ += table.row_count();
+                } catch (const parquet::ParquetException& e) {
+                    throw std::runtime_error("Parquet error: " + std::string(e.what()));
+                } catch (const arrow::Status& status) {
+                    throw std::runtime_error("Arrow error: " + status.ToString());
+                }
+            }
+
+            /**
+             * @brief Finishes the file. Called by the destructor if not called explicitly.
+             *
+             * If only empty tables were written, an empty file with string columns is created.
+             * @throws std::runtime_error If the file cannot be finalized.
+             */
+            void close()
+            {
+                if (closed_)
+                {
+                    return;
+                }
+                closed_ = true;
+                try {
+                    if (!writer_ && !col_names_.empty()) {
+                        std::vector<std::shared_ptr<arrow::Field>> fields;
+                        for (const auto& name : col_names_) {
+                            fields.push_back(arrow::field(name, arrow::utf8()));
+                        }
+                        open(*arrow::schema(fields), CSVTable());
+                    }
+                    if (writer_) {
+                        PARQUET_THROW_NOT_OK(writer_->Close());
+                        PARQUET_THROW_NOT_OK(outfile_->Close());
+                    }
+                } catch (const parquet::ParquetException& e) {
+                    throw std::runtime_error("Parquet error: " + std::string(e.what()));
+                } catch (const arrow::Status& status) {
+                    throw std::runtime_error("Arrow error: " + status.ToString());
+                }
+            }
+
+            /**
+             * @brief Gets the number of rows written so far.
+             */
+            size_t rows_written() const { return rows_written_; }
+
+        private:
+            std::string filename_;
+            ParquetWriteOptions options_;
+            std::vector<std::string> col_names_;
+            std::vector<arrow::Type::type> types_;
+            std::shared_ptr<arrow::io::FileOutputStream> outfile_;
+            std::unique_ptr<parquet::arrow::FileWriter> writer_;
+            size_t rows_written_ = 0;
+            bool closed_ = false;
+
+            /**
+             * @brief Creates the file with writer properties built from the options.
+             * @param schema The Arrow schema of every row group.
+             * @param sample Rows used to measure the cardinality of string columns.
+             */
+            void open(const arrow::Schema &schema, const CSVTable &sample)
+            {
+                parquet::WriterProperties::Builder builder;
+                builder.compression(arrow_codec(options_.codec));
+                if (options_.compression_level) {
+                    builder.compression_level(*options_.compression_level);
+                }
+                builder.max_row_group_length(static_cast<int64_t>(std::max<size_t>(1, options_.row_group_size)));
+                if (!options_.dictionary) {
+                    builder.disable_dictionary();
+                } else {
+                    for (size_t col_idx = 0; col_idx < types_.size() && col_idx < sample.col_names.size(); ++col_idx) {
+                        if (types_[col_idx] == arrow::Type::STRING) {
+                            const std::string& name = col_names_[col_idx];
+                            if (sample.low_cardinality(col_idx, options_.dictionary_max_ratio, options_.row_group_size)) {
+                                builder.enable_dictionary(name);
+                            } else {
+                                builder.disable_dictionary(name);
+                            }
+                        }
+                    }
+                }
+                PARQUET_ASSIGN_OR_THROW(outfile_, arrow::io::FileOutputStream::Open(filename_));
+                // Storing the Arrow schema lets readers restore dictionary (categorical) columns
+                auto arrow_properties = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+                PARQUET_ASSIGN_OR_THROW(writer_, parquet::arrow::FileWriter::Open(schema, arrow::default_memory_pool(), outfile_,
+                                                                                  builder.build(), arrow_properties));
+            }
+
+            static arrow::Compression::type arrow_codec(ParquetWriteOptions::Codec codec)
+            {
+                switch (codec) {
+                    case ParquetWriteOptions::Codec::Snappy: return arrow::Compression::SNAPPY;
+                    case ParquetWriteOptions::Codec::Gzip: return arrow::Compression::GZIP;
+                    case ParquetWriteOptions::Codec::Zstd: return arrow::Compression::ZSTD;
+                    case ParquetWriteOptions::Codec::Lz4: return arrow::Compression::LZ4;
+                    default: return arrow::Compression::UNCOMPRESSED;
+                }
+            }
+        };
+
+        /**
+         * @brief A read-only view of selected rows of a table, stored as row indices into the parent.
+         *
+         * Filtering, sorting and statistics on a view work on the indices and the parent's cells, so no
+         * rows are copied until materialize() is called. The parent must outlive the view and must not
+         * have rows added, removed or reordered while the view is in use.
+         */
+        class TableView
+        {
+        public:
+            /**
+             * @brief Views every row of a table.
+             */
+            explicit TableView(const CSVTable &table) : table_(&table), rows_(table.row_count())
+            {
+                std::iota(rows_.begin(), rows_.end(), 0);
+            }
+
+            /**
+             * @brief Views the given rows of a table, in the given order.
+             * @throws std::out_of_range If any row index is invalid.
+             */
+            TableView(const CSVTable &table, std::vector<int> row_indices) : table_(&table), rows_(std::move(row_indices))
+            {
+                for (int idx : rows_)
+                {
+                    if (idx < 0 || static_cast<size_t>(idx) >= table.row_count())
+                    {
+                        throw std::out_of_range("Invalid row index: " + std::to_string(idx));
+                    }
+                }
+            }
+
+            /**
+             * @brief Views the selected rows of a table.
+             * @throws std::invalid_argument If the selection does not cover the table's rows.
+             */
+            TableView(const CSVTable &table, const Selection &selection) : table_(&table)
+            {
+                if (selection.size() != table.row_count())
+                {
+                    throw std::invalid_argument("Selection does not match the number of rows");
+                }
+                rows_ = selection.indices();
+            }
+
+            /// Iterates the rows of the view as read-only rows of the parent table.
+            class Iterator
+            {
+            public:
+                Iterator(const TableView *view, size_t index) : view_(view), index_(index) {}
+
+                ConstRow operator*() const { return row(); }
+                ConstRow operator->() const { return row(); }
+
+                Iterator &operator++()
+                {
+                    ++index_;
+                    return *this;
+                }
+
+                bool operator!=(const Iterator &other) const { return index_ != other.index_; }
+                bool operator==(const Iterator &other) const { return index_ == other.index_; }
+
+                /// Position in the view.
+                size_t index() const { return index_; }
+
+                /// Row of the parent table at this position.
+                ConstRow row() const { return ConstRow(view_->table_, view_->rows_[index_]); }
+
+            private:
+                const TableView *view_;
+                size_t index_;
+            };
+
+            Iterator begin() const { return Iterator(this, 0); }
+            Iterator end() const { return Iterator(this, rows_.size()); }
+
+            /// Number of rows in the view.
+            size_t num_rows() const { return rows_.size(); }
+
+            auto get_col_names() const -> const std::vector<std::string> & { return table_->get_col_names(); }
+
+            /// Parent row index of each view row.
+            const std::vector<int> &row_indices() const { return rows_; }
+
+            /// The viewed table.
+            const CSVTable &parent() const { return *table_; }
+
+            /**
+             * @brief Retrieves a value by view row and column name (see CSVTable::get).
+             * @throws std::out_of_range If the row is outside the view.
+             */
+            template <ConvertibleToCellValue T>
+            T get(int row, std::string_view col_name) const
+            {
+                if (row < 0 || static_cast<size_t>(row) >= rows_.size())
+                {
+                    throw std::out_of_range("Row index out of range: " + std::to_string(row));
+                }
+                return table_->get<T>(rows_[row], col_name);
+            }
+
+            /**
+             * @brief Narrows the view to the rows matching a predicate.
+             * @param predicate Called with the parent row index and the parent table, as for CSVTable::filter_rows.
+             */
+            TableView filter(const RowPredicate &predicate) const
+            {
+                std::vector<int> kept;
+                for (int idx : rows_)
+                {
+                    if (predicate(idx, *table_))
+                    {
+                        kept.push_back(idx);
+                    }
+                }
+                return TableView(table_, std::move(kept));
+            }
+
+            /**
+             * @brief Narrows the view to the rows matching a declarative filter.
+             *
+             * Only the view's rows are evaluated, with the filter's columns resolved once.
+             * @throws std::invalid_argument If a filter column does not exist.
+             */
+            TableView filter(const Filter &filter) const
+            {
+                const BoundFilter bound = table_->bind_filter(filter);
+                std::vector<int> kept;
+                for (int idx : rows_)
+                {
+                    if (table_->row_matches(bound, idx))
+                    {
+                        kept.push_back(idx);
+                    }
+                }
+                return TableView(table_, std::move(kept));
+            }
+
+            /**
+             * @brief Returns a view of the same rows ordered by a column (ties keep their view order).
+             * @tparam T The type the column is compared as.
+             * @throws std::invalid_argument If the column does not exist.
+             */
+            template <ConvertibleToCellValue T>
+            TableView sort_by_column(std::string_view col_name, bool ascending) const
+            {
+                std::vector<T> keys = get_column_as<T>(col_name);
+                std::vector<size_t> order(rows_.size());
+                std::iota(order.begin(), order.end(), size_t(0));
+                std::ranges::stable_sort(order, [&keys, ascending](size_t a, size_t b)
+                                         { return ascending ? (keys[a] < keys[b]) : (keys[b] < keys[a]); });
+                std::vector<int> sorted;
+                sorted.reserve(order.size());
+                for (size_t i : order)
+                {
+                    sorted.push_back(rows_[i]);
+                }
+                return TableView(table_, std::move(sorted));
+            }
+
+            /**
+             * @brief Retrieves the view's values of a column converted to T (see CSVTable::get_column_as).
+             */
+            template <ConvertibleToCellValue T>
+            std::vector<T> get_column_as(std::string_view col_name) const
+            {
+                size_t col_index = table_->get_column_index(col_name);
+                std::vector<T> values;
+                values.reserve(rows_.size());
+                for (int idx : rows_)
+                {
+                    values.push_back(table_->value_as<T>(idx, col_index));
+                }
+                return values;
+            }
+
+            /// @name Statistics over the view's rows, as for the CSVTable functions of the same names.
+            /// Missing cells are skipped as the table's statistics skip them; the two-column statistics skip
+            /// a row when either of its cells is missing.
+            ///@{
+            double mean(std::string_view col_name) const
+            {
+                std::vector<double> scratch;
+                return mean_of(table_->doubles(table_->get_column_index(col_name), scratch, &rows_, true), col_name);
+            }
+
+            double median(std::string_view col_name) const
+            {
+                return median_of(table_->present_doubles(table_->get_column_index(col_name), &rows_), col_name);
+            }
+
+            double standard_deviation(std::string_view col_name) const
+            {
+                std::vector<double> scratch;
+                return standard_deviation_of(table_->doubles(table_->get_column_index(col_name), scratch, &rows_, true), col_name);
+            }
+
+            double squared_error(std::string_view col_name) const
+            {
+                std::vector<double> scratch;
+                return squared_error_of(table_->doubles(table_->get_column_index(col_name), scratch, &rows_, true), col_name);
+            }
+
+            double percentile(std::string_view col_name, double p) const
+            {
+                return percentile_of(table_->present_doubles(table_->get_column_index(col_name), &rows_), col_name, p);
+            }
+
+            double correlation(std::string_view col_name1, std::string_view col_name2) const
+            {
+                std::vector<double> scratch[2];
+                auto [col1, col2] = table_->paired_doubles(table_->get_column_index(col_name1),
+                                                           table_->get_column_index(col_name2), scratch, &rows_);
+                return correlation_of(col1, col2, col_name1, col_name2);
+            }
+
+            double r_squared(std::string_view col_name1, std::string_view col_name2) const
+            {
+                std::vector<double> scratch[2];
+                auto [col1, col2] = table_->paired_doubles(table_->get_column_index(col_name1),
+                                                           table_->get_column_index(col_name2), scratch, &rows_);
+                return r_squared_of(col1, col2, col_name1, col_name2);
+            }
+
+            double rmse(std::string_view col_name1, std::string_view col_name2) const
+            {
+                std::vector<double> scratch[2];
+                auto [col1, col2] = table_->paired_doubles(table_->get_column_index(col_name1),
+                                                           table_->get_column_index(col_name2), scratch, &rows_);
+                return rmse_of(col1, col2, col_name1);
+            }
+            ///@}
+
+            /**
+             * @brief Saves the view's rows to a CSV file, formatting straight from the parent's cells.
+             * @param filename The path to the CSV file.
+             * @param append Append to an existing file (see CSVTable::save_to_file).
+             * @param num_threads Threads used to format rows.
+             * @throws std::runtime_error If the file cannot be written.
+             */
+            void save_to_file(std::string_view filename, bool append = false, size_t num_threads = 1) const
+            {
+                table_->save_csv(filename, append, num_threads, &rows_);
+            }
+
+            /**
+             * @brief Saves the view's rows to a Parquet file. Only one row group is copied out at a time.
+             * @param filename The path to save the Parquet file.
+             * @param options Row-group size, compression and dictionary settings.
+             * @throws std::runtime_error If the file cannot be written.
+             */
+            void save_to_parquet(std::string_view filename, const ParquetWriteOptions &options = ParquetWriteOptions()) const
+            {
+                ParquetWriter writer(filename, options);
+                const size_t group_rows = std::max<size_t>(1, options.row_group_size);
+                if (rows_.empty())
+                {
+                    writer.write(table_->empty_copy());
+                }
+                for (size_t begin = 0; begin < rows_.size(); begin += group_rows)
+                {
+                    size_t end = std::min(rows_.size(), begin + group_rows);
+                    writer.write(table_->sub_table(std::vector<int>(rows_.begin() + begin, rows_.begin() + end)));
+                }
+                writer.close();
+            }
+
+            /**
+             * @brief Copies the viewed rows into a new table.
+             */
+            CSVTable materialize() const
+            {
+                return table_->sub_table(rows_);
+            }
+
+        private:
+            const CSVTable *table_;
+            std::vector<int> rows_;
+
+            TableView(const CSVTable *table, std::vector<int> rows) : table_(table), rows_(std::move(rows)) {}
+        };
+
+        /**
+         * @brief Rows of a table grouped by key columns; created by CSVTable::group_by.
+         *
+         * agg() aggregates in one pass over the rows. Groups are found through a hash of the typed key cells,
+         * or, when the table is sorted on the keys, by streaming over runs of equal keys. With several threads
+         * each thread aggregates a contiguous range of rows into its own groups, and the partial aggregates
+         * are merged at the end. The referenced table must outlive the GroupBy.
+         */
+        class GroupBy
+        {
+        public:
+            /**
+             * @brief Computes aggregates per group.
+             * @param aggregations The aggregates to compute.
+             * @param num_threads Number of worker threads (0 = hardware concurrency).
+             * @return CSVTable One row per group in order of first appearance: the key columns, then one
+             *         column per aggregate (Count as uint64_t, the others as double; missing for empty groups).
+             * @throws std::invalid_argument If a column does not exist, an output name repeats, a percentile
+             *         is outside [0, 1], or an aggregate other than Count has no column.
+             * @throws std::runtime_error If a value cannot be converted to double (std::invalid_argument for
+             *         non-numeric strings), as in get<double>.
+             */
+            CSVTable agg(const std::vector<Aggregation> &aggregations, size_t num_threads = 1) const
+            {
+                const CSVTable &table = *table_;
+                std::vector<int> value_cols;
+                std::vector<std::string> names;
+                for (size_t k : keys_)
+                {
+                    names.push_back(table.col_names[k]);
+                }
+                for (const auto &aggregation : aggregations)
+                {
+                    if (aggregation.column.empty())
+                    {
+                        if (aggregation.op != AggOp::Count)
+                        {
+                            throw std::invalid_argument("Only Count can aggregate without a column");
+                        }
+                        value_cols.push_back(-1);
+                    }
+                    else if (!table.col_map.contains(aggregation.column))
+                    {
+                        throw std::invalid_argument("Column name not found: " + aggregation.column);
+                    }
+                    else
+                    {
+                        value_cols.push_back(table.col_map.at(aggregation.column));
+                    }
+                    if (aggregation.op == AggOp::Percentile && !(aggregation.percentile >= 0.0 && aggregation.percentile <= 1.0))
+                    {
+                        throw std::invalid_argument("Percentile p must be in [0, 1], got: " + std::to_string(aggregation.percentile));
+                    }
+                    std::string name = output_name(aggregation);
+                    if (std::ranges::contains(names, name))
+                    {
+                        throw std::invalid_argument("Duplicate output column: " + name);
+                    }
+                    names.push_back(std::move(name));
+                }
+                if (num_threads == 0)
+                {
+                    num_threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+
+                const size_t n = table.row_count();
+                std::vector<int> key_kinds(keys_.size(), -1);
+                const bool sorted = table.sorted_on(keys_, key_kinds);
+                const size_t parts = n < rows_per_parallel_block ? 1 : std::min(num_threads, n / rows_per_parallel_block);
+                std::vector<Groups> partials(parts);
+                parallel_for(parts, num_threads, [&](size_t part)
+                {
+                    aggregate(partials[part], part * n / parts, (part + 1) * n / parts, sorted, aggregations, value_cols);
+                });
+
+                Groups groups = std::move(partials[0]);
+                const size_t width = aggregations.size();
+                auto hash = [&](size_t r) { return table.hash_key(r, keys_); };
+                auto equal = [&](size_t a, size_t b) { return table.keys_equal(a, keys_, table, b, keys_); };
+                std::unordered_map<size_t, size_t, decltype(hash), decltype(equal)> group_of(0, hash, equal);
+                if (!sorted)
+                {
+                    for (size_t g = 0; g < groups.first_rows.size(); ++g)
+                    {
+                        group_of.emplace(groups.first_rows[g], g);
+                    }
+                }
+                for (size_t part = 1; part < parts; ++part)
+                {
+                    Groups &partial = partials[part];
+                    for (size_t g = 0; g < partial.first_rows.size(); ++g)
+                    {
+                        size_t target;
+                        if (sorted)
+                        {
+                            // Only a run of equal keys crossing the range boundary continues the last group
+                            bool continues = g == 0 && !groups.first_rows.empty() &&
+                                             equal(groups.first_rows.back(), partial.first_rows[0]);
+                            target = continues ? groups.first_rows.size() - 1 : groups.add(partial.first_rows[g], width);
+                        }
+                        else
+                        {
+                            auto [it, inserted] = group_of.try_emplace(partial.first_rows[g], groups.first_rows.size());
+                            target = inserted ? groups.add(partial.first_rows[g], width) : it->second;
+                        }
+                        groups.row_counts[target] += partial.row_counts[g];
+                        for (size_t a = 0; a < width; ++a)
+                        {
+                            groups.accumulators[target * width + a].merge(std::move(partial.accumulators[g * width + a]));
+                        }
+                    }
+                    partial = Groups();
+                }
+
+                std::vector<std::vector<CellValue>> rows(groups.first_rows.size());
+                for (size_t g = 0; g < rows.size(); ++g)
+                {
+                    rows[g].reserve(names.size());
+                    for (size_t k : keys_)
+                    {
+                        rows[g].push_back(table.cell_at(groups.first_rows[g], k));
+                    }
+                    for (size_t a = 0; a < width; ++a)
+                    {
+                        rows[g].push_back(value_cols[a] < 0 ? CellValue(static_cast<uint64_t>(groups.row_counts[g]))
+                                                            : groups.accumulators[g * width + a].result(aggregations[a]));
+                    }
+                }
+                std::unordered_map<std::string, int, string_hash, string_equal> result_map;
+                for (size_t c = 0; c < names.size(); ++c)
+                {
+                    result_map[names[c]] = c;
+                }
+                CSVTable result(std::move(names), std::move(result_map), std::move(rows));
+                if (table.mode == StorageMode::Columnar)
+                {
+                    result.set_storage_mode(StorageMode::Columnar);
+                }
+                return result;
+            }
+
+        private:
+            friend class CSVTable;
+
+            /**
+             * @brief Running aggregate of one column in one group (Welford mean and variance).
+             */
+            struct Accumulator
+            {
+                Moments moments;
+                double sum = 0.0;
+                std::vector<double> values; // Percentile only
+
+                void add(double x, bool keep_value)
+                {
+                    moments.add(x);
+                    sum += x;
+                    if (keep_value)
+                        values.push_back(x);
+                }
+
+                void merge(Accumulator &&other)
+                {
+                    moments.merge(other.moments);
+                    sum += other.sum;
+                    values.insert(values.end(), other.values.begin(), other.values.end());
+                }
+
+                CellValue result(const Aggregation &aggregation)
+                {
+                    if (aggregation.op == AggOp::Count)
+                        return static_cast<uint64_t>(moments.count);
+                    if (moments.count == 0 || (aggregation.op == AggOp::Std && moments.count < 2))
+                        return std::string("");
+                    switch (aggregation.op)
+                    {
+                    case AggOp::Sum:
+                        return sum;
+                    case AggOp::Mean:
+                        return moments.mean;
+                    case AggOp::Min:
+                        return moments.min;
+                    case AggOp::Max:
+                        return moments.max;
+                    case AggOp::Std:
+                        return std::sqrt(moments.variance());
+                    default:
+                        return percentile_of(std::move(values), aggregation.column, aggregation.percentile);
+                    }
+                }
+            };
+
+            /**
+             * @brief Groups found in a range of rows: first row of each group, its row count, and
+             * accumulators[group * aggregations + aggregation].
+             */
+            struct Groups
+            {
+                std::vector<size_t> first_rows;
+                std::vector<size_t> row_counts;
+                std::vector<Accumulator> accumulators;
+
+                size_t add(size_t first_row, size_t width)
+                {
+                    first_rows.push_back(first_row);
+                    row_counts.push_back(0);
+                    accumulators.resize(accumulators.size() + width);
+                    return first_rows.size() - 1;
+                }
+            };
+
+            const CSVTable *table_;
+            std::vector<int> keys_;
+
+            GroupBy(const CSVTable &table, std::vector<int> keys) : table_(&table), keys_(std::move(keys)) {}
+
+            static std::string output_name(const Aggregation &aggregation)
+            {
+                if (!aggregation.output_name.empty())
+                    return aggregation.output_name;
+                static constexpr std::array op_names = {"sum", "count", "mean", "min", "max", "std"};
+                std::string suffix = aggregation.op == AggOp::Percentile
+                                         ? "p" + std::to_string(static_cast<int>(std::lround(aggregation.percentile * 100)))
+                                         : op_names[static_cast<size_t>(aggregation.op)];
+                return aggregation.column.empty() ? suffix : aggregation.column + "_" + suffix;
+            }
+
+            /**
+             * @brief Aggregates rows [begin, end) into groups.
+             */
+            void aggregate(Groups &groups, size_t begin, size_t end, bool sorted,
+                           const std::vector<Aggregation> &aggregations, const std::vector<int> &value_cols) const
+            {
+                const CSVTable &table = *table_;
+                const size_t width = aggregations.size();
+                auto hash = [&](size_t r) { return table.hash_key(r, keys_); };
+                auto equal = [&](size_t a, size_t b) { return table.keys_equal(a, keys_, table, b, keys_); };
+                std::unordered_map<size_t, size_t, decltype(hash), decltype(equal)> group_of(0, hash, equal);
+                for (size_t r = begin; r < end; ++r)
+                {
+                    size_t g;
+                    if (sorted)
+                    {
+                        bool same = !groups.first_rows.empty() && equal(groups.first_rows.back(), r);
+                        g = same ? groups.first_rows.size() - 1 : groups.add(r, width);
+                    }
+                    else
+                    {
+                        auto [it, inserted] = group_of.try_emplace(r, groups.first_rows.size());
+                        g = inserted ? groups.add(r, width) : it->second;
+                    }
+                    ++groups.row_counts[g];
+                    for (size_t a = 0; a < width; ++a)
+                    {
+                        double value;
+                        if (value_cols[a] >= 0 && table.numeric_cell(r, value_cols[a], value))
+                        {
+                            groups.accumulators[g * width + a].add(value, aggregations[a].op == AggOp::Percentile);
+                        }
+                    }
+                }
+            }
+        };
+
+        /**
+         * @brief A query recorded as a plan of stages and run by collect().
+         *
+         * Created by table.lazy(), CSVTable::scan_csv() or CSVTable::scan_parquet(). Stages run in order,
+         * with these optimizations:
+         * - Declarative filters that only read source columns (not ones replaced by with_column) run first,
+         *   over the source, using column kernels and indexes. For a Parquet scan, filters that are
+         *   conjunctions of predicates are pushed into read_parquet; for a CSV scan, filters are applied to
+         *   each batch while reading, so rows that fail them are never stored.
+         * - Only the columns that later stages read or output are loaded from a file or copied from a table.
+         *   A predicate or with_column stage that does not declare its columns may read any column.
+         * - Adjacent filter, with_column and select stages run as one pass over the rows, and a with_column
+         *   value is only computed when a later stage reads it or it is part of the output.
+         *
+         * @code
+         * CSVTable result = CSVTable::scan_parquet("trades.parquet")
+         *                       .filter(CSVTable::Filter("qty", CSVTable::CompareOp::Gt, 0))
+         *                       .with_column("notional", [](const auto &row) { return row.template get<double>("px") * row.template get<int>("qty"); }, {"px", "qty"})
+         *                       .group_by({"sym"}, {{"notional", CSVTable::AggOp::Sum}})
+         *                       .collect();
+         * @endcode
+         */
+        class LazyTable
+        {
+            // Column names a stage can read, mapped to an input column index or -(k + 1) for computed column k.
+            // A stage sees few columns, so a linear search is cheaper than hashing the name on every read.
+            struct NameMap
+            {
+                std::vector<std::pair<std::string, int>> entries;
+
+                const int *find(std::string_view col_name) const
+                {
+                    for (const auto &[name, slot] : entries)
+                        if (name == col_name)
+                            return &slot;
+                    return nullptr;
+                }
+
+                int at(std::string_view col_name) const { return *find(col_name); } // Names are checked by optimize()
+
+                void set(const std::string &col_name, int slot)
+                {
+                    for (auto &[name, existing] : entries)
+                        if (name == col_name)
+                        {
+                            existing = slot;
+                            return;
+                        }
+                    entries.emplace_back(col_name, slot);
+                }
+            };
+            struct Pass;
+            struct RowState;
+
+        public:
+            /**
+             * @brief A row as seen by a predicate or with_column stage: the source row plus the columns added
+             * by earlier with_column stages.
+             */
+            class LazyRow
+            {
+            public:
+                /**
+                 * @brief Reads a column of the row converted to T, as get<T> does.
+                 * @throws std::invalid_argument If the stage cannot see the column (see LazyTable).
+                 */
+                template <ConvertibleToCellValue T>
+                T get(std::string_view col_name) const
+                {
+                    int slot = resolve(col_name);
+                    return slot >= 0 ? pass_->input->template value_as<T>(row_, slot) : convert_cell<T>(computed(-slot - 1));
+                }
+
+                /**
+                 * @brief Reads a column of the row.
+                 * @throws std::invalid_argument If the stage cannot see the column (see LazyTable).
+                 */
+                CellValue value(std::string_view col_name) const
+                {
+                    int slot = resolve(col_name);
+                    return slot >= 0 ? pass_->input->cell_at(row_, slot) : computed(-slot - 1);
+                }
+
+                /// Index of the row in the table the pass reads.
+                size_t row() const { return row_; }
+
+            private:
+                friend class LazyTable;
+                const Pass *pass_;
+                RowState *state_;
+                const NameMap *names_;
+                size_t row_;
+
+                LazyRow(const Pass *pass, RowState *state, const NameMap *names, size_t row)
+                    : pass_(pass), state_(state), names_(names), row_(row) {}
+
+                int resolve(std::string_view col_name) const
+                {
+                    const int *slot = names_->find(col_name);
+                    if (!slot)
+                    {
+                        throw std::invalid_argument("Column not visible to this stage: " + std::string(col_name));
+                    }
+                    return *slot;
+                }
+
+                // Computes column k on first use for this row, reading only the columns its stage may see
+                const CellValue &computed(size_t k) const
+                {
+                    if (!state_->done[k])
+                    {
+                        const Computed &column = pass_->computed[k];
+                        state_->values[k] = (*column.compute)(LazyRow(pass_, state_, &column.names, row_));
+                        state_->done[k] = 1;
+                    }
+                    return state_->values[k];
+                }
+            };
+
+            using RowFilter = std::function<bool(const LazyRow &)>;
+            using RowValue = std::function<CellValue(const LazyRow &)>;
+
+            /**
+             * @brief Keeps the rows matching a declarative filter.
+             */
+            LazyTable &filter(Filter filter)
+            {
+                Stage stage(Stage::Kind::Filter);
+                stage.filter.emplace(std::move(filter));
+                stages_.push_back(std::move(stage));
+                return *this;
+            }
+
+            /**
+             * @brief Keeps the rows for which a predicate returns true.
+             * @param predicate Called once per row; with collect(num_threads > 1) it must be safe to call concurrently.
+             * @param reads The columns the predicate reads, or empty if it may read any column. Reading an
+             *        undeclared column throws std::invalid_argument.
+             */
+            LazyTable &filter(RowFilter predicate, std::vector<std::string> reads = {})
+            {
+                Stage stage(Stage::Kind::Predicate);
+                stage.predicate = std::move(predicate);
+                stage.columns = std::move(reads);
+                stages_.push_back(std::move(stage));
+                return *this;
+            }
+
+            /**
+             * @brief Keeps the rows where a bool expression is true (see ExprNode); it reads only its columns.
+             */
+            template <typename E>
+                requires is_expression<E>
+            LazyTable &filter(const E &expr)
+            {
+                static_assert(std::is_same_v<typename E::value_type, bool>, "filter needs a bool expression");
+                std::vector<std::string> reads;
+                expr.columns(reads);
+                return filter([expr](const LazyRow &row) { return expr.evaluate(row).value_or(false); }, std::move(reads));
+            }
+
+            /**
+             * @brief Keeps only the given columns, in that order.
+             */
+            LazyTable &select(std::vector<std::string> columns)
+            {
+                Stage stage(Stage::Kind::Select);
+                stage.columns = std::move(columns);
+                stages_.push_back(std::move(stage));
+                return *this;
+            }
+
+            /**
+             * @brief Adds a column computed from each row, or replaces the column of that name.
+             * @param compute Called per row, as for filter(predicate, reads).
+             * @param reads The columns compute reads, or empty if it may read any column.
+             */
+            LazyTable &with_column(std::string col_name, RowValue compute, std::vector<std::string> reads = {})
+            {
+                Stage stage(Stage::Kind::WithColumn);
+                stage.name = std::move(col_name);
+                stage.compute = std::move(compute);
+                stage.columns = std::move(reads);
+                stages_.push_back(std::move(stage));
+                return *this;
+            }
+
+            /**
+             * @brief Adds or replaces a column with the value of an expression (see ExprNode); it reads only its columns.
+             */
+            template <typename E>
+                requires is_expression<E>
+            LazyTable &with_column(std::string col_name, const E &expr)
+            {
+                std::vector<std::string> reads;
+                expr.columns(reads);
+                return with_column(std::move(col_name), [expr](const LazyRow &row) -> CellValue
+                {
+                    auto value = expr.evaluate(row);
+                    return value ? CellValue(*value) : CellValue(std::string(""));
+                }, std::move(reads));
+            }
+
+            /**
+             * @brief Groups the rows by key columns and aggregates them, as group_by(keys).agg(aggregations).
+             */
+            LazyTable &group_by(std::vector<std::string> keys, std::vector<Aggregation> aggregations)
+            {
+                Stage stage(Stage::Kind::GroupBy);
+                stage.columns = std::move(keys);
+                stage.aggregations = std::move(aggregations);
+                stages_.push_back(std::move(stage));
+                return *this;
+            }
+
+            /**
+             * @brief Sorts the rows, as sort_by_columns(keys).
+             */
+            LazyTable &sort_by(std::vector<SortKey> keys)
+            {
+                Stage stage(Stage::Kind::Sort);
+                stage.sort_keys = std::move(keys);
+                stages_.push_back(std::move(stage));
+                return *this;
+            }
+
+            /**
+             * @brief Describes the optimized plan, one step per line.
+             * @throws std::invalid_argument If a stage names a column that does not exist at that point.
+             * @throws std::runtime_error If a source file cannot be opened.
+             */
+            std::string explain() const
+            {
+                Plan plan = optimize(source_columns());
+                std::string out;
+                if (source_ == Source::Table)
+                    out = "scan table";
+                else
+                    out = std::string(source_ == Source::Csv ? "scan csv " : "scan parquet ") + filename_;
+                out += " columns=" + (plan.needed ? join(*plan.needed) : std::string("*"));
+                if (!plan.pushed.empty())
+                {
+                    out += " pushdown=";
+                    for (size_t i = 0; i < plan.pushed.size(); ++i)
+                        out += (i ? " && " : "") + describe(Filter(plan.pushed[i]));
+                }
+                out += "\n";
+                if (plan.source_filter)
+                {
+                    out += (source_ == Source::Csv ? "filter batches " : "filter ") + describe(*plan.source_filter) + "\n";
+                }
+                for (size_t i = 0; i < plan.stages.size();)
+                {
+                    if (!plan.stages[i]->rowwise())
+                    {
+                        out += describe(*plan.stages[i++]) + "\n";
+                        continue;
+                    }
+                    out += "pass";
+                    for (; i < plan.stages.size() && plan.stages[i]->rowwise(); ++i)
+                    {
+                        out += " | " + describe(*plan.stages[i]);
+                    }
+                    out += "\n";
+                }
+                return out;
+            }
+
+            /**
+             * @brief Runs the plan.
+             * @param num_threads Threads for the row-wise passes, group-by, sort and file reads (0 = hardware
+             *        concurrency). Predicates and with_column functions then run concurrently.
+             * @return CSVTable The result, in the storage mode of the source.
+             * @throws std::invalid_argument If a stage names a column that does not exist at that point.
+             * @throws std::runtime_error If a file cannot be read or a value cannot be converted.
+             */
+            CSVTable collect(size_t num_threads = 1) const
+            {
+                if (num_threads == 0)
+                {
+                    num_threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+                Plan plan = optimize(source_columns());
+                CSVTable owned;
+                const CSVTable *current = table_;
+                std::optional<Selection> pre;
+                if (source_ != Source::Table)
+                {
+                    owned = load(plan, num_threads);
+                    current = &owned;
+                }
+                else if (plan.source_filter)
+                {
+                    pre = table_->select(*plan.source_filter);
+                }
+
+                for (size_t i = 0;;)
+                {
+                    size_t j = i;
+                    while (j < plan.stages.size() && plan.stages[j]->rowwise())
+                    {
+                        ++j;
+                    }
+                    const bool last = j == plan.stages.size();
+                    const bool borrowed = current != &owned;
+                    // A pass also copies a borrowed table that is about to be sorted or returned
+                    if (j > i || pre || (borrowed && (last || plan.stages[j]->kind == Stage::Kind::Sort)))
+                    {
+                        std::vector<const Stage *> run(plan.stages.begin() + i, plan.stages.begin() + j);
+                        CSVTable next = run_pass(*current, run, pre ? &*pre : nullptr, plan.live[j], num_threads);
+                        owned = std::move(next);
+                        current = &owned;
+                        pre.reset();
+                    }
+                    if (last)
+                    {
+                        return owned;
+                    }
+                    const Stage &barrier = *plan.stages[j];
+                    if (barrier.kind == Stage::Kind::GroupBy)
+                    {
+                        CSVTable grouped = current->group_by(barrier.columns).agg(barrier.aggregations, num_threads);
+                        owned = std::move(grouped);
+                        current = &owned;
+                    }
+                    else
+                    {
+                        owned.sort_by_columns(barrier.sort_keys, num_threads);
+                    }
+                    i = j + 1;
+                }
+            }
+
+        private:
+            friend class CSVTable;
+
+            enum class Source { Table, Csv, Parquet };
+
+            struct Stage
+            {
+                enum class Kind { Filter, Predicate, WithColumn, Select, GroupBy, Sort };
+
+                Kind kind;
+                std::optional<Filter> filter;
+                RowFilter predicate;
+                RowValue compute;
+                std::string name;
+                std::vector<std::string> columns; // Select list, declared reads or group-by keys
+                std::vector<Aggregation> aggregations;
+                std::vector<SortKey> sort_keys;
+
+                explicit Stage(Kind kind) : kind(kind) {}
+
+                bool rowwise() const { return kind != Kind::GroupBy && kind != Kind::Sort; }
+            };
+
+            /// The stages after hoisting filters to the source, with the columns live before each stage.
+            struct Plan
+            {
+                std::vector<const Stage *> stages;
+                std::optional<std::vector<std::string>> needed; // Source columns to load; nullopt for all
+                std::vector<ColumnPredicate> pushed;              // Pushed into read_parquet
+                std::optional<Filter> source_filter;              // Run over the source before the stages
+                std::vector<std::optional<std::vector<std::string>>> live; // live[i]: columns stage i onwards need; nullopt for all
+            };
+
+            /// A computed column of a pass: its function and the columns that function may read.
+            struct Computed
+            {
+                const RowValue *compute;
+                NameMap names;
+            };
+
+            struct Pass
+            {
+                const CSVTable *input;
+                std::vector<Computed> computed;
+            };
+
+            /// Computed values of the current row; done[k] once column k has been computed.
+            struct RowState
+            {
+                std::vector<CellValue> values;
+                std::vector<char> done;
+            };
+
+            Source source_ = Source::Table;
+            const CSVTable *table_ = nullptr;
+            std::string filename_;
+            Schema schema_;
+            StorageMode storage_ = StorageMode::Row;
+            std::vector<Stage> stages_;
+
+            explicit LazyTable(const CSVTable &table) : table_(&table) {}
+
+            LazyTable(Source source, std::string filename, Schema schema, StorageMode storage)
+                : source_(source), filename_(std::move(filename)), schema_(std::move(schema)), storage_(storage) {}
+
+            std::vector<std::string> source_columns() const
+            {
+                if (source_ == Source::Table)
+                {
+                    return table_->col_names;
+                }
+                if (source_ == Source::Csv)
+                {
+                    return BatchReader(filename_, 1).get_col_names();
+                }
+                try
+                {
+                    std::shared_ptr<arrow::Schema> file_schema;
+                    PARQUET_THROW_NOT_OK(open_parquet_reader(filename_)->GetSchema(&file_schema));
+                    std::vector<std::string> names;
+                    for (const auto &field : file_schema->fields())
+                    {
+                        names.push_back(field->name());
+                    }
+                    return names;
+                }
+                catch (const parquet::ParquetException &e)
+                {
+                    throw std::runtime_error("Parquet error: " + std::string(e.what()));
+                }
+            }
+
+            /**
+             * @brief Checks the column names of every stage, hoists source filters and computes liveness.
+             */
+            Plan optimize(const std::vector<std::string> &source) const
+            {
+                Plan plan;
+                // Forward: validate names; hoist filters over unmodified source columns up to the first group-by
+                std::vector<std::string> visible = source;
+                std::unordered_set<std::string> replaced;
+                bool grouped = false;
+                auto require = [&](const std::string &col)
+                {
+                    if (!std::ranges::contains(visible, col))
+                        throw std::invalid_argument("Column name not found: " + col);
+                };
+                for (const Stage &stage : stages_)
+                {
+                    switch (stage.kind)
+                    {
+                    case Stage::Kind::Filter:
+                    {
+                        std::vector<std::string> cols;
+                        filter_columns(*stage.filter, cols);
+                        std::ranges::for_each(cols, require);
+                        if (!grouped && std::ranges::none_of(cols, [&](const auto &col)
+                                                             { return replaced.contains(col); }))
+                        {
+                            plan.source_filter = plan.source_filter ? std::move(*plan.source_filter) && *stage.filter : *stage.filter;
+                            continue;
+                        }
+                        break;
+                    }
+                    case Stage::Kind::Predicate:
+                        std::ranges::for_each(stage.columns, require);
+                        break;
+                    case Stage::Kind::WithColumn:
+                        std::ranges::for_each(stage.columns, require);
+                        if (!std::ranges::contains(visible, stage.name))
+                            visible.push_back(stage.name);
+                        replaced.insert(stage.name);
+                        break;
+                    case Stage::Kind::Select:
+                        std::ranges::for_each(stage.columns, require);
+                        visible = stage.columns;
+                        break;
+                    case Stage::Kind::GroupBy:
+                        std::ranges::for_each(stage.columns, require);
+                        for (const auto &aggregation : stage.aggregations)
+                        {
+                            if (!aggregation.column.empty())
+                                require(aggregation.column);
+                        }
+                        visible = stage.columns;
+                        for (const auto &aggregation : stage.aggregations)
+                        {
+                            visible.push_back(GroupBy::output_name(aggregation));
+                        }
+                        grouped = true;
+                        break;
+                    case Stage::Kind::Sort:
+                        for (const auto &key : stage.sort_keys)
+                            require(key.column);
+                        break;
+                    }
+                    plan.stages.push_back(&stage);
+                }
+
+                // Parquet reads take conjunctions of predicates; other filters run over the loaded rows
+                if (source_ == Source::Parquet && plan.source_filter)
+                {
+                    std::vector<Filter> rest;
+                    const Filter &filter = *plan.source_filter;
+                    auto parts = filter.kind_ == Filter::Kind::And ? filter.children_ : std::vector<Filter>{filter};
+                    for (const Filter &part : parts)
+                    {
+                        if (part.kind_ == Filter::Kind::Predicate)
+                            plan.pushed.push_back(part.predicate_);
+                        else
+                            rest.push_back(part);
+                    }
+                    plan.source_filter.reset();
+                    for (Filter &part : rest)
+                    {
+                        plan.source_filter = plan.source_filter ? std::move(*plan.source_filter) && std::move(part) : std::move(part);
+                    }
+                }
+
+                // Backward: the columns each stage onwards reads or outputs
+                plan.live.resize(plan.stages.size() + 1);
+                std::optional<std::unordered_set<std::string>> live;
+                auto add = [&](const std::vector<std::string> &cols)
+                {
+                    if (live)
+                        live->insert(cols.begin(), cols.end());
+                };
+                auto record = [&](size_t i)
+                {
+                    if (!live)
+                        return;
+                    plan.live[i].emplace();
+                    for (const auto &col : source)
+                        if (live->contains(col))
+                            plan.live[i]->push_back(col);
+                    for (const auto &col : *live)
+                        if (!std::ranges::contains(source, col))
+                            plan.live[i]->push_back(col);
+                };
+                for (size_t i = plan.stages.size(); i-- > 0;)
+                {
+                    record(i + 1);
+                    const Stage &stage = *plan.stages[i];
+                    switch (stage.kind)
+                    {
+                    case Stage::Kind::Filter:
+                    {
+                        std::vector<std::string> cols;
+                        filter_columns(*stage.filter, cols);
+                        add(cols);
+                        break;
+                    }
+                    case Stage::Kind::WithColumn:
+                        if (live && !live->contains(stage.name))
+                            break; // Never read, so never computed
+                        if (live)
+                            live->erase(stage.name);
+                        [[fallthrough]];
+                    case Stage::Kind::Predicate:
+                        if (stage.columns.empty())
+                            live.reset();
+                        add(stage.columns);
+                        break;
+                    case Stage::Kind::Select:
+                        if (live)
+                            std::erase_if(*live, [&](const auto &col)
+                                          { return !std::ranges::contains(stage.columns, col); });
+                        else
+                            live.emplace(stage.columns.begin(), stage.columns.end());
+                        break;
+                    case Stage::Kind::GroupBy:
+                        live.emplace(stage.columns.begin(), stage.columns.end());
+                        for (const auto &aggregation : stage.aggregations)
+                            if (!aggregation.column.empty())
+                                live->insert(aggregation.column);
+                        break;
+                    case Stage::Kind::Sort:
+                        for (const auto &key : stage.sort_keys)
+                            if (live)
+                                live->insert(key.column);
+                        break;
+                    }
+                }
+                if (plan.source_filter)
+                {
+                    std::vector<std::string> cols;
+                    filter_columns(*plan.source_filter, cols);
+                    add(cols);
+                }
+                record(0);
+                plan.needed = plan.live[0];
+                return plan;
+            }
+
+            /**
+             * @brief Reads the source file, loading only the needed columns and applying the hoisted filters.
+             */
+            CSVTable load(Plan &plan, size_t num_threads) const
+            {
+                CSVTable result;
+                result.mode = storage_;
+                if (source_ == Source::Parquet)
+                {
+                    // An empty projection would read every column
+                    std::vector<std::string> columns = plan.needed ? *plan.needed : std::vector<std::string>();
+                    if (plan.needed && columns.empty())
+                        columns.push_back(source_columns().front());
+                    result.read_parquet(filename_, columns, plan.pushed, num_threads);
+                    if (plan.source_filter)
+                    {
+                        result = result.sub_table(result.select(*plan.source_filter));
+                    }
+                    plan.source_filter.reset();
+                    return result;
+                }
+                Schema schema = schema_;
+                if (plan.needed)
+                {
+                    for (const auto &col : source_columns())
+                        if (!std::ranges::contains(*plan.needed, col))
+                            schema[col] = ColumnType::Skip;
+                }
+                if (!plan.source_filter)
+                {
+                    result.read_file(filename_, schema, num_threads);
+                    return result;
+                }
+                // Filter each batch as it is read, so only matching rows are kept
+                BatchReader reader(filename_, default_batch_size, schema, storage_);
+                CSVTable batch;
+                while (reader.next(batch))
+                {
+                    result.append_table(batch.sub_table(batch.select(*plan.source_filter)));
+                }
+                if (result.col_names.empty())
+                {
+                    result.read_file(filename_, schema, num_threads); // No data rows
+                }
+                plan.source_filter.reset();
+                return result;
+            }
+
+            /**
+             * @brief Runs adjacent row-wise stages as one pass over input.
+             * @param pre Rows to consider, or nullptr for all.
+             * @param live_out Columns to output, or nullopt for all.
+             */
+            static CSVTable run_pass(const CSVTable &input, const std::vector<const Stage *> &stages, const Selection *pre,
+                                     const std::optional<std::vector<std::string>> &live_out, size_t num_threads)
+            {
+                NameMap names;
+                std::vector<std::string> order = input.col_names;
+                for (size_t c = 0; c < order.size(); ++c)
+                {
+                    names.set(order[c], static_cast<int>(c));
+                }
+                auto restrict = [&](const std::vector<std::string> &reads)
+                {
+                    if (reads.empty())
+                        return names;
+                    NameMap visible;
+                    for (const auto &col : reads)
+                        visible.set(col, names.at(col));
+                    return visible;
+                };
+                Pass pass{&input, {}};
+                std::vector<std::pair<const Stage *, NameMap>> tests;
+                for (const Stage *stage : stages)
+                {
+                    switch (stage->kind)
+                    {
+                    case Stage::Kind::Filter:
+                    case Stage::Kind::Predicate:
+                        tests.emplace_back(stage, restrict(stage->columns));
+                        break;
+                    case Stage::Kind::WithColumn:
+                        pass.computed.push_back({&stage->compute, restrict(stage->columns)});
+                        if (!names.find(stage->name))
+                            order.push_back(stage->name);
+                        names.set(stage->name, -static_cast<int>(pass.computed.size()));
+                        break;
+                    default: // Select
+                    {
+                        NameMap selected;
+                        for (const auto &col : stage->columns)
+                            selected.set(col, names.at(col));
+                        names = std::move(selected);
+                        order = stage->columns;
+                        break;
+                    }
+                    }
+                }
+                std::vector<std::string> out_names;
+                std::vector<int> out_slots;
+                for (const auto &col : order)
+                {
+                    if (!live_out || std::ranges::contains(*live_out, col))
+                    {
+                        out_names.push_back(col);
+                        out_slots.push_back(names.at(col));
+                    }
+                }
+
+                // Each block keeps its matching rows and the computed output values for them
+                const size_t n = input.row_count();
+                const size_t num_blocks = std::max<size_t>(1, (n + rows_per_parallel_block - 1) / rows_per_parallel_block);
+                std::vector<std::vector<size_t>> kept(num_blocks);
+                std::vector<std::vector<std::vector<CellValue>>> values(num_blocks, std::vector<std::vector<CellValue>>(out_slots.size()));
+                parallel_for(num_blocks, num_threads, [&](size_t b)
+                {
+                    RowState state{std::vector<CellValue>(pass.computed.size()), std::vector<char>(pass.computed.size())};
+                    const size_t end = std::min(n, (b + 1) * rows_per_parallel_block);
+                    for (size_t r = b * rows_per_parallel_block; r < end; ++r)
+                    {
+                        if (pre && !pre->test(r))
+                            continue;
+                        std::ranges::fill(state.done, 0);
+                        bool keep = std::ranges::all_of(tests, [&](const auto &test)
+                        {
+                            LazyRow row(&pass, &state, &test.second, r);
+                            return test.first->kind == Stage::Kind::Filter ? row_matches(*test.first->filter, row)
+                                                                           : test.first->predicate(row);
+                        });
+                        if (!keep)
+                            continue;
+                        kept[b].push_back(r);
+                        for (size_t j = 0; j < out_slots.size(); ++j)
+                        {
+                            if (out_slots[j] < 0)
+                                values[b][j].push_back(LazyRow(&pass, &state, &names, r).computed(-out_slots[j] - 1));
+                        }
+                    }
+                });
+                std::vector<size_t> rows;
+                std::vector<std::vector<CellValue>> computed(out_slots.size());
+                for (size_t b = 0; b < num_blocks; ++b)
+                {
+                    rows.insert(rows.end(), kept[b].begin(), kept[b].end());
+                    for (size_t j = 0; j < out_slots.size(); ++j)
+                        computed[j].insert(computed[j].end(), std::make_move_iterator(values[b][j].begin()),
+                                           std::make_move_iterator(values[b][j].end()));
+                }
+
+                CSVTable result;
+                result.mode = input.mode;
+                result.col_names = out_names;
+                for (size_t j = 0; j < out_names.size(); ++j)
+                {
+                    result.col_map[out_names[j]] = static_cast<int>(j);
+                }
+                if (input.mode == StorageMode::Columnar)
+                {
+                    result.cols.resize(out_slots.size());
+                    parallel_for(out_slots.size(), num_threads, [&](size_t j)
+                    {
+                        result.cols[j] = out_slots[j] >= 0 ? input.gather_column(out_slots[j], rows)
+                                                           : Column::infer(rows.size(), [&](size_t i) -> const CellValue &
+                                                                           { return computed[j][i]; });
+                    });
+                    return result;
+                }
+                result.rows.resize(rows.size());
+                for (size_t i = 0; i < rows.size(); ++i)
+                {
+                    auto &row = result.rows[i];
+                    row.reserve(out_slots.size());
+                    for (size_t j = 0; j < out_slots.size(); ++j)
+                        row.push_back(out_slots[j] >= 0 ? input.rows[rows[i]][out_slots[j]] : std::move(computed[j][i]));
+                }
+                return result;
+            }
+
+            static bool row_matches(const Filter &filter, const LazyRow &row)
+            {
+                switch (filter.kind_)
+                {
+                case Filter::Kind::Predicate:
+                    return cell_matches(row.value(filter.predicate_.column), filter.predicate_);
+                case Filter::Kind::And:
+                    return std::ranges::all_of(filter.children_, [&](const Filter &child)
+                                               { return row_matches(child, row); });
+                default:
+                    return std::ranges::any_of(filter.children_, [&](const Filter &child)
+                                               { return row_matches(child, row); });
+                }
+            }
+
+            static void filter_columns(const Filter &filter, std::vector<std::string> &out)
+            {
+                if (filter.kind_ == Filter::Kind::Predicate)
+                {
+                    if (!std::ranges::contains(out, filter.predicate_.column))
+                        out.push_back(filter.predicate_.column);
+                    return;
+                }
+                for (const Filter &child : filter.children_)
+                    filter_columns(child, out);
+            }
+
+            static std::string join(const std::vector<std::string> &names)
+            {
+                std::string out = "[";
+                for (size_t i = 0; i < names.size(); ++i)
+                    out += (i ? ", " : "") + names[i];
+                return out + "]";
+            }
+
+            static std::string describe(const Filter &filter)
+            {
+                if (filter.kind_ == Filter::Kind::Predicate)
+                {
+                    static constexpr std::array op_names = {"==", "!=", "<", "<=", ">", ">="};
+                    const CellValue &value = filter.predicate_.value;
+                    std::string text = cell_to_string(value);
+                    if (std::holds_alternative<std::string>(value))
+                        text = "\"" + text + "\"";
+                    return filter.predicate_.column + " " + op_names[static_cast<size_t>(filter.predicate_.op)] + " " + text;
+                }
+                std::string out = "(";
+                for (size_t i = 0; i < filter.children_.size(); ++i)
+                    out += (i ? (filter.kind_ == Filter::Kind::And ? " && " : " || ") : "") + describe(filter.children_[i]);
+                return out + ")";
+            }
+
+            static std::string describe(const Stage &stage)
+            {
+                switch (stage.kind)
+                {
+                case Stage::Kind::Filter: return "filter " + describe(*stage.filter);
+                case Stage::Kind::Predicate: return "filter <predicate>";
+                case Stage::Kind::WithColumn: return "with_column " + stage.name;
+                case Stage::Kind::Select: return "select " + join(stage.columns);
+                case Stage::Kind::GroupBy:
+                {
+                    std::vector<std::string> outputs;
+                    for (const auto &aggregation : stage.aggregations)
+                        outputs.push_back(GroupBy::output_name(aggregation));
+                    return "group_by " + join(stage.columns) + " agg " + join(outputs);
+                }
+                default:
+                {
+                    std::vector<std::string> keys;
+                    for (const auto &key : stage.sort_keys)
+                        keys.push_back(key.column + (key.ascending ? "" : " desc"));
+                    return "sort " + join(keys);
+                }
+                }
+            }
+        };
+        /**
+         * @brief Streams the table to an output stream.
+         * @param os The output stream.
+         * @param table The table to stream.
+         * @return std::ostream& The output stream.
+         */
+        friend std::ostream &operator<<(std::ostream &os, const CSVTable &table)
+        {
+            table.write_csv(os, true);
+            return os;
+        }
+
+        /**
+         * @brief Gets the rows of the table.
+         *
+         * A columnar table is switched back to row storage first, since the rows are exposed directly.
+         *
+         * @return std::vector<std::vector<CellValue>>& A reference to the rows.
+         */
+        std::vector<std::vector<CellValue>> &get_rows()
+        {
+            set_storage_mode(StorageMode::Row);
+            return rows;
+        }
+
+        /**
+         * @brief Deletes a row from the table by its index.
+         *
+         * This function removes the row at the specified index from the table.
+         * If the index is out of range, it throws a std::out_of_range exception.
+         *
+         * @param index The zero-based index of the row to delete.
+         * @throws std::out_of_range If the index is greater than or equal to the number of rows.
+         */
+        void delete_row(size_t index) {
+            if (index < row_count()) {
+                indexes.clear();
+                if (mode == StorageMode::Columnar) {
+                    for (auto& column : cols) {
+                        column.erase(index);
+                    }
+                } else {
+                    rows.erase(rows.begin() + index);
+                }
+            } else {
+                throw std::out_of_range("Index out of range");
+            }
+        }
+
+        /**
+         * @brief Removes rows from the table that satisfy a given condition.
+         *
+         * This function removes all rows from the table for which the provided condition function returns true.
+         * The condition function should take a const reference to a row (std::vector<CellValue>) and return a boolean.
+         *
+         * @param condition A function that takes a row and returns true if the row should be removed.
+         */
+        void remove_rows(std::function<bool(const std::vector<CellValue>&)> condition) {
+            if (mode == StorageMode::Columnar) {
+                std::vector<char> keep(row_count());
+                std::vector<CellValue> scratch;
+                for (size_t i = 0; i < keep.size(); ++i) {
+                    keep[i] = !condition(row_ref(i, scratch));
+                }
+                retain_rows(keep);
+                return;
+            }
+            indexes.clear();
+            rows.erase(std::remove_if(rows.begin(), rows.end(), condition), rows.end());
+        }
+
+        /**
+         * @brief Gets the column names of the table.
+         * @return const std::vector<std::string>& A reference to the column names.
+         */
+        auto get_col_names() const -> const std::vector<std::string> &
+        {
+            return col_names;
+        }
+
+        /**
+         * @brief Gets the number of rows in the table.
+         * @return size_t The number of rows.
+         */
+        size_t num_rows() const
+        {
+            return row_count();
+        }
+
+        /**
+         * @brief Check if a column exists in the table.
+         * @param col_name The name of the column to check.
+         * @return bool True if the column exists, false otherwise.
+         */
+        bool has_column(std::string_view col_name) const
+        {
+            return col_map.contains(std::string(col_name));
+        }
+
+        /**
+         * @brief Appends the rows of another CSVTable to this table.
+         * 
+         * If this table is empty, it adopts the columns and rows of the other table.
+         * If the other table is empty, no changes are made.
+         * If both tables are non-empty, the columns must match exactly (same names and order).
+         * 
+         * @param other The CSVTable to append to this table.
+         * @throws std::invalid_argument If the columns do not match when both tables are non-empty.
+         */
+        void append_table(const CSVTable& other) {
+            append_table_impl(other);
+        }
+
+        /**
+         * @brief Appends the rows of another CSVTable to this table, moving them instead of copying.
+         *
+         * Behaves like append_table(const CSVTable&); rows (or columns, when both tables are columnar) are
+         * moved out of other, which is left as an empty table.
+         *
+         * @param other The CSVTable to append to this table.
+         * @throws std::invalid_argument If the columns do not match when both tables are non-empty.
+         */
+        void append_table(CSVTable&& other) {
+            if (&other == this) {
+                append_table_impl(std::as_const(other));
+                return;
+            }
+            append_table_impl(std::move(other));
+            other = CSVTable();
+        }
+
+        /**
+         * @brief Builds a secondary index over a column, replacing any existing index on it.
+         *
+         * A Hash index maps each key to its rows and answers equality lookups; a Sorted index keeps the rows
+         * in key order (missing and NaN keys left out) and answers equality and range lookups. Keys are the
+         * stored typed values. find, lower_bound, find_rows, Eq/Lt/Le/Gt/Ge filters on the column, and merge
+         * on it as a single key use a matching index automatically.
+         *
+         * Rows appended with append_row or append_table (or read into the table) are added to the index;
+         * a Sorted index sorts each batch of new rows and merges it in once.
+         * Any other change to the rows - removing or reordering rows, or writing a cell of the indexed column
+         * through the table - drops the index, so lookups fall back to scans and binary searches until it is
+         * created again. Writes that bypass the table (through get_rows() or column_data()) are not tracked.
+         *
+         * @param col_name The column to index.
+         * @param kind The kind of index.
+         * @param num_threads Number of worker threads for sorting a Sorted index (0 = hardware concurrency).
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        void create_index(std::string_view col_name, IndexKind kind = IndexKind::Hash, size_t num_threads = 1)
+        {
+            int col_index = get_column_index(col_name);
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            ColumnIndex index;
+            index.kind = kind;
+            build_index(index, col_index, num_threads);
+            indexes[col_index] = std::move(index);
+        }
+
+        /**
+         * @brief Removes the index on a column, if there is one.
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        void drop_index(std::string_view col_name)
+        {
+            indexes.erase(get_column_index(col_name));
+        }
+
+        /**
+         * @brief Returns the kind of the index on a column, or std::nullopt if it has none.
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        std::optional<IndexKind> index_kind(std::string_view col_name) const
+        {
+            const ColumnIndex *index = usable_index(get_column_index(col_name));
+            return index ? std::optional<IndexKind>(index->kind) : std::nullopt;
+        }
+
+        /**
+         * @brief Finds all rows whose cell in a column equals a value, in row order.
+         *
+         * Equality is that of Filter(col_name, CompareOp::Eq, value). A hash or sorted index on the column
+         * answers the lookup without a scan.
+         *
+         * @param col_name The column to search.
+         * @param value The value to look for.
+         * @return std::vector<int> The matching row indices.
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        template <ConvertibleToCellValue T>
+        std::vector<int> find_rows(std::string_view col_name, const T &value) const
+        {
+            int col_index = get_column_index(col_name);
+            const ColumnIndex *index = usable_index(col_index);
+            CellValue key(value);
+            if (index && index->kind == IndexKind::Hash && !Column::is_missing(key) && hash_compatible(*index, key))
+            {
+                auto it = index->rows_by_key.find(key);
+                return it == index->rows_by_key.end() ? std::vector<int>()
+                                                      : std::vector<int>(it->second.begin(), it->second.end());
+            }
+            return select(Filter(std::string(col_name), CompareOp::Eq, std::move(key))).indices();
+        }
+
+        /**
+         * @brief Performs a binary search on the specified column to find the row with the value equal to the given value,
+         * or the first row with a value greater than the given value if no exact match is found.
+         *
+         * The table must be sorted by the specified column using sort_by_column<T> with the same type T before calling this method,
+         * unless the column has a Sorted index (see create_index). The indexed search returns the first row in key
+         * order whose key is not less than value, comparing stored values like a Filter.
+         *
+         * @tparam T The type to which the column values are converted for comparison.
+         * @param col_name The name of the column to search on.
+         * @param value The value to search for.
+         * @return ConstRowIterator An iterator to the found row, or the end iterator if no such row exists.
+         * @throws std::invalid_argument If the column name is not found.
+         * @throws std::runtime_error If conversion of cell values fails.
+         */
+        template <typename T>
+        ConstRowIterator lower_bound(std::string_view col_name, const T& value) const {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end()) {
+                throw std::invalid_argument("Column name not found: " + std::string(col_name));
+            }
+            int col_index = it->second;
+
+            if (const ColumnIndex *index = usable_index(col_index); index && index->kind == IndexKind::Sorted) {
+                auto [first, last] = index_segment(*index, col_index, CellValue(value));
+                auto pos = std::lower_bound(first, last, CellValue(value), [&](size_t r, const CellValue &v)
+                                            { return compare_values(cell_at(r, col_index), v) < 0; });
+                return ConstRowIterator(this, pos == last ? row_count() : *pos);
+            }
+
+            if (mode == StorageMode::Columnar) {
+                return ConstRowIterator(this, lower_bound_index<T>(col_index, value));
+            }
+
+            auto comp = [col_index](const std::vector<CellValue>& row, const T& val) {
+                T row_val = CSVTable::convert_cell<T>(row[col_index]);
+                return row_val < val;
+            };
+
+            auto vec_it = std::lower_bound(rows.cbegin(), rows.cend(), value, comp);
+            size_t index = std::distance(rows.cbegin(), vec_it);
+            return ConstRowIterator(this, index);
+        }
+
+        /**
+         * @brief Finds a row in the table where the specified column matches the given value.
+         *
+         * This method performs a binary search on the specified column to locate a row
+         * where the column's value matches the provided value. The column must be sorted
+         * in ascending order for the search to work correctly, unless the column has an index (see create_index);
+         * an indexed lookup returns the first matching row, comparing stored values like find_rows.
+         *
+         * @tparam T The type of the value to search for. It must match the type of the column's values.
+         * @param col_name The name of the column to search in.
+         * @param value The value to search for in the specified column.
+         * @return ConstRowIterator An iterator pointing to the row where the column value matches the given value.
+         *         If no match is found, it returns the end iterator.
+         * @throws std::invalid_argument If the specified column name does not exist in the table.
+         */
+        template <typename T>
+        ConstRowIterator find(std::string_view col_name, const T& value) const {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end()) {
+                throw std::invalid_argument("Column not found: " + std::string(col_name));
+            }
+            int col_index = it->second;
+
+            if constexpr (ConvertibleToCellValue<T>) {
+                if (usable_index(col_index)) {
+                    auto matches = find_rows(col_name, value);
+                    return ConstRowIterator(this, matches.empty() ? row_count() : matches.front());
+                }
+            }
+
+            if (mode == StorageMode::Columnar) {
+                size_t index = lower_bound_index<T>(col_index, value);
+                if (index < row_count() && value_as<T>(index, col_index) == value) {
+                    return ConstRowIterator(this, index);
+                }
+                return ConstRowIterator(this, row_count());
+            }
+
+            auto comp = [col_index](const auto& row, const T& val) {
+                return CSVTable::convert_cell<T>(row[col_index]) < val;
+            };
+
+            auto vec_it = std::lower_bound(rows.begin(), rows.end(), value, comp);
+
+            if (vec_it != rows.end() && CSVTable::convert_cell<T>((*vec_it)[col_index]) == value) {
+                size_t index = std::distance(rows.begin(), vec_it);
+                return ConstRowIterator(this, index);
+            } else {
+                return ConstRowIterator(this, rows.size());
+            }
+        }
+
+        /**
+         * @brief Sets all values in a specified column to a single value.
+         * @tparam T The type of the value to set (must be convertible to CellValue).
+         * @param col_name The name of the column to set.
+         * @param value The value to set for the entire column.
+         * @throws std::invalid_argument If the column does not exist.
+         */
+        template <ConvertibleToCellValue T>
+        void set_column_to_value(std::string_view col_name, T value) {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end()) {
+                throw std::invalid_argument("Column not found: " + std::string(col_name));
+            }
+            int col_index = it->second;
+            indexes.erase(col_index);
+            if (mode == StorageMode::Columnar) {
+                cols[col_index] = Column::filled(row_count(), value);
+                return;
+            }
+            for (auto &row : rows) {
+                row[col_index] = value;
+            }
+        }
+
+        /**
+        * @brief Returns a column as a vector of the specified type.
+        * 
+        * This function retrieves all values from the specified column and converts them
+        * to the type T. The function assumes that all values in the column can be 
+        * successfully converted to T. If the column does not exist, it throws a 
+        * std::invalid_argument exception.
+        * 
+        * @tparam T The type to which the column values should be converted.
+        * @param col_name The name of the column to retrieve.
+        * @return std::vector<T> A vector containing the column values converted to type T.
+        * @throws std::invalid_argument If the column does not exist.
+        * @throws std::runtime_error If a value cannot be converted to type T.
+        */
+        template <ConvertibleToCellValue T>
+        std::vector<T> get_column_as(std::string_view col_name) const {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end()) {
+                throw std::invalid_argument("Column not found: " + std::string(col_name));
+            }
+            int col_index = it->second;
+            if (mode == StorageMode::Columnar) {
+                return column_as<T>(cols[col_index]);
+            }
+            std::vector<T> column_values;
+            column_values.reserve(rows.size());  // Reserve space for efficiency
+            for (const auto& row : rows) {
+                column_values.push_back(convert_cell<T>(row[col_index]));
+            }
+            return column_values;
+        }
+
+        /**
+         * @brief Keeps every nth row in the table, removing all others.
+         *
+         * This function modifies the table in-place by retaining only the rows whose
+         * zero-based indices are multiples of n (e.g., for n=2, keeps rows 0, 2, 4, etc.).
+         * If n is 0, the table is cleared. If n is 1, all rows are kept (no change).
+         *
+         * @param n The interval at which to keep rows (must be non-negative).
+         * @throws std::invalid_argument If n is negative.
+         */
+        void keep_every_nth_row(int n) {
+            if (n < 0) {
+                throw std::invalid_argument("n must be non-negative");
+            }
+            if (n == 0) {
+                indexes.clear();
+                rows.clear();
+                for (auto& column : cols) {
+                    column = Column(column.type());
+                }
+                return;
+            }
+            if (n == 1) {
+                return; // No change needed
+            }
+            indexes.clear();
+
+            if (mode == StorageMode::Columnar) {
+                std::vector<char> keep(row_count(), 0);
+                for (size_t i = 0; i < keep.size(); i += n) {
+                    keep[i] = 1;
+                }
+                retain_rows(keep);
+                return;
+            }
+
+            std::vector<std::vector<CellValue>> new_rows;
+            new_rows.reserve((rows.size() + n - 1) / n); // Reserve space for efficiency
+            for (size_t i = 0; i < rows.size(); i += n) {
+                new_rows.push_back(std::move(rows[i]));
+            }
+            rows = std::move(new_rows);
+        }
+
+    /**
+    * @brief Calculates the mean of a column, assuming double values.
+    *
+    * Computes the arithmetic mean of the values in the specified column, skipping missing
+    * cells (nulls and NA strings). The other values must be convertible to double.
+    *
+    * @param col_name The name of the column to compute the mean for.
+    * @return double The mean value of the column.
+    * @throws std::invalid_argument If the column does not exist or is empty.
+    * @throws std::runtime_error If any value cannot be converted to double.
+    */
+    double mean(std::string_view col_name) const {
+        std::vector<double> scratch;
+        return mean_of(doubles(get_column_index(col_name), scratch, nullptr, true), col_name);
+    }
+
+    /**
+     * @brief Calculates the median of a column, assuming double values.
+     *
+     * Computes the median of all values in the specified column by selecting the middle value
+     * (or average of two middle values for even-sized columns) with std::nth_element.
+     * Missing cells are skipped; the other values must be convertible to double.
+     *
+     * @param col_name The name of the column to compute the median for.
+     * @return double The median value of the column.
+     * @throws std::invalid_argument If the column does not exist or is empty.
+     * @throws std::runtime_error If any value cannot be converted to double.
+     */
+    double median(std::string_view col_name) const {
+        return median_of(present_doubles(get_column_index(col_name)), col_name);
+    }
+
+    /**
+     * @brief Calculates the standard deviation of a column, assuming double values.
+     *
+     * Computes the sample standard deviation of the values in the specified column, skipping
+     * missing cells. The other values must be convertible to double.
+     *
+     * @param col_name The name of the column to compute the standard deviation for.
+     * @return double The standard deviation of the column.
+     * @throws std::invalid_argument If the column does not exist or has fewer than 2 values.
+     * @throws std::runtime_error If any value cannot be converted to double.
+     */
+    double standard_deviation(std::string_view col_name) const {
+        std::vector<double> scratch;
+        return standard_deviation_of(doubles(get_column_index(col_name), scratch, nullptr, true), col_name);
+    }
+
+    /**
+     * @brief Calculates the Pearson correlation coefficient between two columns.
+     *
+     * Computes the correlation between two specified columns over the rows where both cells are
+     * present; rows with a missing cell in either column are skipped. The other values must be
+     * convertible to double. The coefficient ranges from -1 to 1, indicating the strength and
+     * direction of the linear relationship.
+     *
+     * @param col_name1 The name of the first column.
+     * @param col_name2 The name of the second column.
+     * @return double The Pearson correlation coefficient.
+     * @throws std::invalid_argument If either column does not exist or fewer than 2 rows have both values.
+     * @throws std::runtime_error If any value cannot be converted to double or if the standard deviation of either column is zero.
+     */
+    double correlation(std::string_view col_name1, std::string_view col_name2) const {
+        std::vector<double> scratch[2];
+        auto [col1, col2] = paired_doubles(get_column_index(col_name1), get_column_index(col_name2), scratch);
+        return correlation_of(col1, col2, col_name1, col_name2);
+    }
+
+    /**
+     * @brief Calculates the R-squared (coefficient of determination) between two columns.
+     *
+     * Computes the R-squared value to measure the proportion of variance in the dependent
+     * column (col_name2) explained by the independent column (col_name1), over the rows where
+     * both cells are present. The other values must be convertible to double.
+     *
+     * @param col_name1 The name of the independent (predictor) column.
+     * @param col_name2 The name of the dependent (actual) column.
+     * @return double The R-squared value, typically between 0 and 1.
+     * @throws std::invalid_argument If either column does not exist or fewer than 2 rows have both values.
+     * @throws std::runtime_error If any value cannot be converted to double or if the variance of the dependent column is zero.
+     */
+    double r_squared(std::string_view col_name1, std::string_view col_name2) const {
+        std::vector<double> scratch[2];
+        auto [col1, col2] = paired_doubles(get_column_index(col_name1), get_column_index(col_name2), scratch);
+        return r_squared_of(col1, col2, col_name1, col_name2);
+    }
+
+    /**
+     * @brief Calculates the Root Mean Squared Error (RMSE) between two columns.
+     *
+     * Computes the RMSE to measure the average magnitude of errors between predicted
+     * values in col_name1 and actual values in col_name2, over the rows where both cells are
+     * present. The other values must be convertible to double.
+     *
+     * @param col_name1 The name of the predicted column.
+     * @param col_name2 The name of the actual column.
+     * @return double The RMSE value.
+     * @throws std::invalid_argument If either column does not exist or fewer than 2 rows have both values.
+     * @throws std::runtime_error If any value cannot be converted to double.
+     */
+    double rmse(std::string_view col_name1, std::string_view col_name2) const {
+        std::vector<double> scratch[2];
+        auto [col1, col2] = paired_doubles(get_column_index(col_name1), get_column_index(col_name2), scratch);
+        return rmse_of(col1, col2, col_name1);
+    }
+
+    /**
+     * @brief Calculates the squared error of a column, assuming a mean of zero.
+     *
+     * Computes the sum of squared values in the specified column, assuming the mean is zero
+     * (i.e., no mean subtraction). Missing cells are skipped; the other values must be convertible to double.
+     *
+     * @param col_name The name of the column to compute the squared error for.
+     * @return double The sum of squared values in the column.
+     * @throws std::invalid_argument If the column does not exist or is empty.
+     * @throws std::runtime_error If any value cannot be converted to double.
+     */
+    double squared_error(std::string_view col_name) const {
+        std::vector<double> scratch;
+        return squared_error_of(doubles(get_column_index(col_name), scratch, nullptr, true), col_name);
+    }
+
+    /**
+     * @brief Calculates the specified percentile of a column, assuming double values.
+     *
+     * Computes the percentile (e.g., 0.25 for 25th percentile) of the values in the specified
+     * column, skipping missing cells; the other values must be convertible to double. Linear
+     * interpolation is used if the percentile falls between two values.
+     *
+     * @param col_name The name of the column to compute the percentile for.
+     * @param p The percentile to compute, in the range [0, 1] (e.g., 0.25 for 25th percentile).
+     * @return double The value at the specified percentile.
+     * @throws std::invalid_argument If the column does not exist, is empty, or p is not in [0, 1].
+     * @throws std::runtime_error If any value cannot be converted to double.
+     */
+    double percentile(std::string_view col_name, double p) const {
+        return percentile_of(present_doubles(get_column_index(col_name)), col_name, p);
+    }
+
+    /**
+     * @brief Adds a column holding a rolling aggregate of another column, e.g. a 20-row mean or the max over
+     * the last 5 seconds of timestamps.
+     *
+     * Each row's result covers the window ending at that row (see RollingWindow), so the table should be
+     * sorted by time (sort_by_column) first; a time column must be ascending within each partition. The
+     * window is updated incrementally, in O(1) amortized time per row: Sum, Mean and Std keep a running sum
+     * and Welford moments, Min and Max keep monotonic deques. Missing, NA and NaN cells are skipped; Count
+     * counts the non-missing cells in the window, and the other results are doubles.
+     *
+     * @param new_col_name The name of the new column.
+     * @param col_name The column to aggregate.
+     * @param op Sum, Count, Mean, Min, Max or Std.
+     * @param window The window and optional partition column.
+     * @param num_threads Number of worker threads; partitions are processed in parallel (0 = hardware concurrency).
+     * @throws std::invalid_argument If a column is missing or new_col_name exists, the window or op is invalid,
+     * or time_column is not ascending within a partition.
+     * @throws std::runtime_error If a value or time cannot be converted.
+     */
+    void add_rolling_column(std::string_view new_col_name, std::string_view col_name, AggOp op,
+                            const RollingWindow &window, size_t num_threads = 1) {
+        if (col_map.contains(new_col_name)) {
+            throw std::invalid_argument("Column already exists: " + std::string(new_col_name));
+        }
+        if ((window.rows == 0) == window.time_column.empty()) {
+            throw std::invalid_argument("Rolling window needs exactly one of rows and time_column");
+        }
+        if (!window.time_column.empty() && window.span == 0) {
+            throw std::invalid_argument("Rolling time window needs a positive span");
+        }
+        if (op == AggOp::Percentile) {
+            throw std::invalid_argument("Rolling percentiles are not supported");
+        }
+        const size_t value_col = get_column_index(col_name);
+        const int time_col = window.time_column.empty() ? -1 : get_column_index(window.time_column);
+        const int partition_col = window.partition_by.empty() ? -1 : get_column_index(window.partition_by);
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // Rows of each partition in table order, partitions in order of first appearance
+        std::vector<std::vector<size_t>> partitions;
+        if (partition_col < 0) {
+            partitions.emplace_back(row_count());
+            std::iota(partitions[0].begin(), partitions[0].end(), 0);
+        } else {
+            std::unordered_map<CellValue, size_t, CellValueHash, CellValueEqual> partition_of;
+            for (size_t r = 0; r < row_count(); ++r) {
+                auto [it, inserted] = partition_of.try_emplace(cell_at(r, partition_col), partitions.size());
+                if (inserted) {
+                    partitions.emplace_back();
+                }
+                partitions[it->second].push_back(r);
+            }
+        }
+
+        std::vector<CellValue> results(row_count(), std::string(""));
+        parallel_for(partitions.size(), num_threads, [&](size_t part) {
+            const std::vector<size_t> &part_rows = partitions[part];
+            const size_t n = part_rows.size();
+            std::vector<double> values(n);
+            std::vector<char> valid(n);
+            std::vector<uint64_t> times(time_col < 0 ? 0 : n);
+            for (size_t p = 0; p < n; ++p) {
+                valid[p] = numeric_cell(part_rows[p], value_col, values[p]);
+                if (time_col >= 0) {
+                    times[p] = value_as<uint64_t>(part_rows[p], time_col);
+                    if (p > 0 && times[p] < times[p - 1]) {
+                        throw std::invalid_argument("Rolling time column must be ascending: " + window.time_column);
+                    }
+                }
+            }
+
+            size_t count = 0;
+            double sum = 0.0, mean = 0.0, m2 = 0.0;
+            std::deque<size_t> min_queue, max_queue; // Positions with increasing / decreasing values
+            size_t start = 0;
+            for (size_t p = 0; p < n; ++p) {
+                if (valid[p]) {
+                    const double x = values[p];
+                    ++count;
+                    sum += x;
+                    double delta = x - mean;
+                    mean += delta / count;
+                    m2 += delta * (x - mean);
+                    while (!min_queue.empty() && values[min_queue.back()] >= x) min_queue.pop_back();
+                    while (!max_queue.empty() && values[max_queue.back()] <= x) max_queue.pop_back();
+                    min_queue.push_back(p);
+                    max_queue.push_back(p);
+                }
+                for (; time_col < 0 ? p - start >= window.rows : times[p] - times[start] >= window.span; ++start) {
+                    if (!valid[start]) {
+                        continue;
+                    }
+                    const double x = values[start];
+                    if (--count == 0) {
+                        sum = mean = m2 = 0.0;
+                    } else {
+                        sum -= x;
+                        double delta = x - mean;
+                        mean -= delta / count;
+                        m2 = std::max(0.0, m2 - delta * (x - mean));
+                    }
+                    if (min_queue.front() == start) min_queue.pop_front();
+                    if (max_queue.front() == start) max_queue.pop_front();
+                }
+
+                CellValue &result = results[part_rows[p]];
+                if (op == AggOp::Count) {
+                    result = static_cast<uint64_t>(count);
+                } else if (count >= std::max<size_t>(window.min_periods, op == AggOp::Std ? 2 : 1)) {
+                    switch (op) {
+                    case AggOp::Sum: result = sum; break;
+                    case AggOp::Mean: result = mean; break;
+                    case AggOp::Min: result = values[min_queue.front()]; break;
+                    case AggOp::Max: result = values[max_queue.front()]; break;
+                    default: result = std::sqrt(m2 / (count - 1)); break;
+                    }
+                }
+            }
+        });
+
+        if (mode == StorageMode::Columnar) {
+            cols.push_back(Column::infer(results.size(), [&](size_t i) -> const CellValue & { return results[i]; }));
+        } else {
+            for (size_t r = 0; r < rows.size(); ++r) {
+                rows[r].push_back(std::move(results[r]));
+            }
+        }
+        col_map[std::string(new_col_name)] = col_names.size();
+        col_names.emplace_back(new_col_name);
+    }
+
+    /**
+     * @brief Summarizes every numeric column, reading each column once.
+     *
+     * Returns a table with one row per int, double or uint64_t column, in column order, and the columns
+     * "column", "count", "mean", "std", "min", "25%", "50%", "75%" and "max". Missing, NA and NaN cells are
+     * skipped and not counted, and std is missing for columns with fewer than 2 values. Columns holding any
+     * other value (strings, bools) or no numeric values at all are left out. The moments come
+     * from one Welford pass and the quartiles from successive nth_element selections.
+     *
+     * @param num_threads Number of worker threads; columns are summarized in parallel (0 = hardware concurrency).
+     * @return CSVTable The summary table.
+     */
+    CSVTable describe(size_t num_threads = 1) const {
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::optional<std::vector<CellValue>>> summaries(col_names.size());
+        parallel_for(col_names.size(), num_threads, [&](size_t c) {
+            std::vector<double> values;
+            if (!numeric_values(c, values) || values.empty()) {
+                return;
+            }
+            std::vector<CellValue> row{col_names[c], static_cast<uint64_t>(values.size())};
+            Moments moments = Moments::of(values);
+            row.push_back(mean_of(values, col_names[c]));
+            row.push_back(moments.count < 2 ? CellValue(std::string("")) : CellValue(std::sqrt(moments.variance())));
+            row.push_back(moments.min);
+            size_t from = 0;
+            for (double p : {0.25, 0.5, 0.75}) {
+                row.push_back(select_percentile(values, p, from));
+                from = static_cast<size_t>(std::floor(p * (values.size() - 1)));
+            }
+            row.push_back(moments.max);
+            summaries[c] = std::move(row);
+        });
+
+        std::vector<std::string> names = {"column", "count", "mean", "std", "min", "25%", "50%", "75%", "max"};
+        std::unordered_map<std::string, int, string_hash, string_equal> result_map;
+        for (size_t c = 0; c < names.size(); ++c) {
+            result_map[names[c]] = c;
+        }
+        std::vector<std::vector<CellValue>> result_rows;
+        for (auto &summary : summaries) {
+            if (summary) {
+                result_rows.push_back(std::move(*summary));
+            }
+        }
+        CSVTable result(std::move(names), std::move(result_map), std::move(result_rows));
+        if (mode == StorageMode::Columnar) {
+            result.set_storage_mode(StorageMode::Columnar);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Get the column index for a column name (for caching in hot loops).
+     * @param col_name The column name.
+     * @return int The column index.
+     * @throws std::invalid_argument If the column does not exist.
+     */
+    int get_column_index(std::string_view col_name) const {
+        auto it = col_map.find(col_name);
+        if (it == col_map.end()) {
+            throw std::invalid_argument("Column not found: " + std::string(col_name));
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief Get value by row and pre-computed column index (faster than by name).
+     * @tparam T The type to retrieve.
+     * @param row The row index.
+     * @param col_index The column index (from get_column_index).
+     * @return T The value cast to type T.
+     * @throws std::out_of_range If the row index is invalid.
+     */
+    template <ConvertibleToCellValue T>
+    T get_by_index(int row, int col_index) const {
+        if (row < 0 || static_cast<size_t>(row) >= row_count()) {
+            throw std::out_of_range("Row index out of range");
+        }
+        return value_as<T>(row, col_index);
+    }
+
+    /**
+     * @brief Extract multiple columns at once to amortize map lookups.
+     * @tparam T The type to extract.
+     * @param col_names The column names to extract.
+     * @return std::vector<std::vector<T>> A vector of column vectors.
+     * @throws std::invalid_argument If any column does not exist.
+     */
+    template <ConvertibleToCellValue T>
+    std::vector<std::vector<T>> get_columns_as(const std::vector<std::string_view>& col_names) const {
+        // First, resolve all column indices
+        std::vector<int> col_indices;
+        col_indices.reserve(col_names.size());
+        for (const auto& col_name : col_names) {
+            auto it = col_map.find(col_name);
+            if (it == col_map.end()) {
+                throw std::invalid_argument("Column not found: " + std::string(col_name));
+            }
+            col_indices.push_back(it->second);
+        }
+
+        // Extract all columns
+        if (mode == StorageMode::Columnar) {
+            std::vector<std::vector<T>> result;
+            result.reserve(col_indices.size());
+            for (int col_index : col_indices) {
+                result.push_back(column_as<T>(cols[col_index]));
+            }
+            return result;
+        }
+        std::vector<std::vector<T>> result(col_names.size());
+        for (size_t i = 0; i < col_names.size(); ++i) {
+            result[i].reserve(rows.size());
+        }
+
+        for (const auto& row : rows) {
+            for (size_t i = 0; i < col_indices.size(); ++i) {
+                result[i].push_back(convert_cell<T>(row[col_indices[i]]));
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Retrieves a Row object for the specified row index.
+     *
+     * Returns a Row object that allows access to the row's values by column name.
+     *
+     * @param index The zero-based index of the row.
+     * @return Row A Row object representing the specified row.
+     * @throws std::out_of_range If the index is out of range.
+     */
+    Row get_row(size_t index)  {
+        if (index >= row_count()) {
+            throw std::out_of_range("Row index out of range: " + std::to_string(index));
+        }
+        return Row(this, index);
+    }
+
+    /**
+     * @brief Removes rows from the table that satisfy a predicate.
+     *
+     * Iterates over the table's rows and removes those for which the provided predicate
+     * returns true. The predicate takes a Row object representing the current row.
+     *
+     * @param predicate A function that takes a Row object and returns true if the row
+     *                  should be removed.
+     */
+    void remove_rows_if(std::function<bool(const Row&)> predicate) {
+        if (mode == StorageMode::Columnar) {
+            std::vector<char> keep(row_count());
+            for (size_t i = 0; i < keep.size(); ++i) {
+                keep[i] = !predicate(Row(this, i));
+            }
+            retain_rows(keep);
+            return;
+        }
+        std::vector<std::vector<CellValue>> new_rows;
+        new_rows.reserve(rows.size()); // Reserve space for efficiency
+        for (size_t i = 0; i < rows.size(); ++i) {
+            Row row(this, i);
+            if (!predicate(row)) {
+                new_rows.push_back(std::move(rows[i]));
+            }
+        }
+        rows = std::move(new_rows);
+    }
+
+    /**
+     * @brief Switches the table between row and columnar storage, converting the existing data.
+     *
+     * Columnar storage keeps each column in a typed contiguous buffer with a validity bitmap, which
+     * cuts memory use and speeds up column scans (get_column_as, statistics, sort_by_column).
+     * Each column gets the narrowest type that holds all of its non-missing cells; the row API
+     * (Row, CellAccess, get<T>, table[row][col]) keeps working in either mode.
+     *
+     * @param new_mode The storage layout to switch to.
+     */
+    void set_storage_mode(StorageMode new_mode) {
+        if (new_mode == mode) {
+            return;
+        }
+        if (new_mode == StorageMode::Columnar) {
+            static const CellValue missing = std::string("");
+            cols.clear();
+            cols.reserve(col_names.size());
+            for (size_t c = 0; c < col_names.size(); ++c) {
+                cols.push_back(Column::infer(rows.size(), [this, c](size_t r) -> const CellValue& {
+                    return c < rows[r].size() ? rows[r][c] : missing;
+                }));
+            }
+            rows.clear();
+            rows.shrink_to_fit();
+        } else {
+            size_t n = row_count();
+            rows.assign(n, {});
+            for (size_t r = 0; r < n; ++r) {
+                rows[r].reserve(cols.size());
+                for (const auto& column : cols) {
+                    rows[r].push_back(column.get(r));
+                }
+            }
+            cols.clear();
+            cols.shrink_to_fit();
+        }
+        mode = new_mode;
+    }
+
+    /**
+     * @brief Gets the current storage layout.
+     * @return StorageMode The storage layout.
+     */
+    StorageMode storage_mode() const {
+        return mode;
+    }
+
+    /**
+     * @brief Gets the typed storage of a column, for column kernels that scan contiguous memory.
+     * @param col_name The column name.
+     * @return const Column& The column's storage.
+     * @throws std::invalid_argument If the column does not exist.
+     * @throws std::runtime_error If the table is not in columnar storage mode.
+     */
+    const Column& column_data(std::string_view col_name) const {
+        int col_index = get_column_index(col_name);
+        if (mode != StorageMode::Columnar) {
+            throw std::runtime_error("Table is not in columnar storage mode");
+        }
+        return cols[col_index];
+    }
+
+    /**
+     * @brief Returns a typed handle to a column, resolving the name once (see ColumnHandle).
+     * @tparam T The type cells are read (and written) as.
+     * @param col_name The column name.
+     * @return ColumnHandle<T> A handle that can read and write cells.
+     * @throws std::invalid_argument If the column does not exist.
+     */
+    template <ConvertibleToCellValue T>
+    ColumnHandle<T> column(std::string_view col_name) {
+        return ColumnHandle<T>(*this, this, get_column_index(col_name));
+    }
+
+    /**
+     * @brief Returns a read-only typed handle to a column, resolving the name once (see ColumnHandle).
+     * @throws std::invalid_argument If the column does not exist.
+     */
+    template <ConvertibleToCellValue T>
+    ColumnHandle<T> column(std::string_view col_name) const {
+        return ColumnHandle<T>(*this, nullptr, get_column_index(col_name));
+    }
+
+    /**
+     * @brief Dictionary-encodes a string column: each cell becomes a uint32_t code into the column's
+     * distinct values (see Column::Type::Categorical).
+     *
+     * Cells still read and write as strings. Equality filters, hashing (group_by, drop_duplicates, merge
+     * keys) and key comparisons use the codes, and the column is written to Parquet as an Arrow dictionary
+     * array, so it reads back categorical. Switching to row storage turns it back into plain strings.
+     *
+     * @param col_name The column to encode.
+     * @throws std::invalid_argument If the column does not exist.
+     * @throws std::runtime_error If the table is not in columnar storage mode or the column holds non-strings.
+     */
+    void set_categorical(std::string_view col_name) {
+        int col_index = get_column_index(col_name);
+        if (mode != StorageMode::Columnar) {
+            throw std::runtime_error("Table is not in columnar storage mode");
+        }
+        cols[col_index] = Column::categorical(cols[col_index]);
+    }
+
+    /**
+     * @brief Sends this table's operation events to an observer instead of the default observer.
+     * @param observer The observer, or nullptr to report nothing for this table.
+     */
+    void set_observer(std::shared_ptr<Observer> observer) {
+        observer_ = std::move(observer);
+    }
+
+    /**
+     * @brief Makes this table report to the default observer again.
+     */
+    void reset_observer() {
+        observer_.reset();
+    }
+
+    /**
+     * @brief The observer this table reports to: its own (see set_observer) or the default one.
+     */
+    std::shared_ptr<Observer> observer() const {
+        if constexpr (!observers_enabled) {
+            return nullptr;
+        }
+        return observer_ ? *observer_ : default_observer();
+    }
+
+    /**
+     * @brief Sets the observer of tables without their own, and of read_file_batches.
+     * @param observer The observer, or nullptr to report nothing. Initially a ProgressObserver on stderr.
+     */
+    static void set_default_observer(std::shared_ptr<Observer> observer) {
+        std::lock_guard<std::mutex> lock(default_observer_mutex);
+        default_observer_ = std::move(observer);
+    }
+
+    /**
+     * @brief The observer of tables without their own (see set_default_observer).
+     */
+    static std::shared_ptr<Observer> default_observer() {
+        std::lock_guard<std::mutex> lock(default_observer_mutex);
+        return default_observer_;
+    }
+
+    private:
+#if defined(M2_CSV_NO_OBSERVERS)
+        static constexpr bool observers_enabled = false;
+#else
+        static constexpr bool observers_enabled = true;
+#endif
+        static inline std::mutex default_observer_mutex;
+        static inline std::shared_ptr<Observer> default_observer_ = std::make_shared<ProgressObserver>();
+
+        std::vector<std::string> col_names;
+        std::unordered_map<std::string, int, string_hash, string_equal> col_map;
+        std::vector<std::vector<CellValue>> rows;
+        StorageMode mode = StorageMode::Row;
+        std::vector<Column> cols;  ///< Per-column storage, used instead of rows in columnar mode
+
+        struct CellValueHash
+        {
+            size_t operator()(const CellValue &value) const { return Column::hash_value(value); }
+        };
+
+        struct CellValueEqual
+        {
+            bool operator()(const CellValue &a, const CellValue &b) const { return Column::same_value(a, b); }
+        };
+
+        /**
+         * @brief A secondary index over one column; see create_index.
+         */
+        struct ColumnIndex
+        {
+            IndexKind kind = IndexKind::Hash;
+            size_t rows_indexed = 0;
+            unsigned numeric_kinds = 0; ///< One bit per kind of number in the column: 1 int/uint64_t, 2 double, 4 bool
+            std::unordered_map<CellValue, std::vector<size_t>, CellValueHash, CellValueEqual> rows_by_key; ///< Hash
+            std::vector<size_t> order; ///< Sorted: rows with a non-missing, non-NaN key, in key order
+        };
+
+        std::unordered_map<int, ColumnIndex> indexes; ///< Secondary indexes by column index
+        std::optional<std::shared_ptr<Observer>> observer_; ///< Set by set_observer; empty uses the default observer
+
+        /**
+         * @brief Gets the number of rows in either storage layout.
+         */
+        size_t row_count() const
+        {
+            if (mode == StorageMode::Columnar)
+            {
+                return cols.empty() ? 0 : cols.front().size();
+            }
+            return rows.size();
+        }
+
+        // Row storage may keep trailing fields beyond the header; columnar rows are exactly as wide as the header
+        size_t row_width(size_t r) const
+        {
+            return mode == StorageMode::Columnar ? cols.size() : rows[r].size();
+        }
+
+        /**
+         * @brief Reads a cell in either storage layout.
+         */
+        CellValue cell_at(size_t r, size_t c) const
+        {
+            return mode == StorageMode::Columnar ? cols[c].get(r) : rows[r][c];
+        }
+
+        /**
+         * @brief Reads a cell converted to T in either storage layout (see convert_cell).
+         */
+        template <ConvertibleToCellValue T>
+        T value_as(size_t r, size_t c) const
+        {
+            return mode == StorageMode::Columnar ? cols[c].get_as<T>(r) : convert_cell<T>(rows[r][c]);
+        }
+
+        /**
+         * @brief Writes a cell in either storage layout.
+         */
+        void set_cell(size_t r, size_t c, const CellValue &value)
+        {
+            if (!indexes.empty())
+            {
+                indexes.erase(static_cast<int>(c));
+            }
+            if (mode == StorageMode::Columnar)
+            {
+                cols[c].set(r, value);
+            }
+            else
+            {
+                rows[r][c] = value;
+            }
+        }
+
+        static const char *column_type_name(ColumnType type)
+        {
+            switch (type)
+            {
+            case ColumnType::String: return "string";
+            case ColumnType::Int: return "int";
+            case ColumnType::Double: return "double";
+            case ColumnType::Bool: return "bool";
+            case ColumnType::UInt64: return "uint64_t";
+            case ColumnType::Categorical: return "categorical";
+            default: return "inferred";
+            }
+        }
+
+        /**
+         * @brief Shared implementation of the read_file overloads.
+         * @param schema Declared column types, or nullptr to infer every field.
+         * @param report Receives progress and phase timings; finished by the caller.
+         */
+        void read_csv(std::string_view filename, const Schema *schema, size_t num_threads, size_t chunk_size,
+                      OperationReporter &report)
+        {
+            CSVRecordReader reader{std::string(filename)};
+            if (!reader.is_open())
+            {
+                throw std::runtime_error("Cannot open file: " + std::string(filename));
+            }
+
+            std::string_view record;
+            if (!reader.next_record(record))
+            {
+                throw std::runtime_error("Empty file or missing header: " + std::string(filename));
+            }
+
+            CSVHeader header = parse_header(record, filename, schema);
+            const bool adopted = col_names.empty();
+            adopt_header(header, filename);
+            const auto &plan = header.plan;
+            std::vector<std::string_view> fields;
+            std::deque<std::string> unescaped;
+
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            const size_t initial_rows = row_count();
+            try
+            {
+                if (num_threads > 1)
+                {
+                    read_chunks_parallel(reader.remaining(), plan, num_threads, chunk_size, report);
+                    return;
+                }
+
+                // Rows and bytes are handed to the reporter in batches; phases are timed only on request
+                const bool timed = report.timed();
+                std::chrono::nanoseconds tokenize{}, parse{}, convert{};
+                auto tokenize_start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+                size_t row_count = 0;
+                size_t pending_rows = 0, pending_bytes = 0;
+
+                while (reader.next_record(record))
+                {
+                    // Fields are views into the file; only cells kept as strings allocate
+                    try
+                    {
+                        if (timed)
+                        {
+                            auto parse_start = std::chrono::steady_clock::now();
+                            auto row = parse_record(record, col_names.size(), plan, fields, unescaped);
+                            auto convert_start = std::chrono::steady_clock::now();
+                            push_row(std::move(row));
+                            auto convert_end = std::chrono::steady_clock::now();
+                            tokenize += parse_start - tokenize_start;
+                            parse += convert_start - parse_start;
+                            convert += convert_end - convert_start;
+                            tokenize_start = convert_end;
+                        }
+                        else
+                        {
+                            push_row(parse_record(record, col_names.size(), plan, fields, unescaped));
+                        }
+                    }
+                    catch (FieldParseError &e)
+                    {
+                        e.row = row_count;
+                        throw;
+                    }
+
+                    row_count++;
+                    if (report.active())
+                    {
+                        pending_bytes += record.size() + 1;
+                        if (++pending_rows == 1024)
+                        {
+                            report.add(pending_rows, 0, pending_bytes);
+                            pending_rows = pending_bytes = 0;
+                        }
+                    }
+                }
+                report.add(pending_rows, 0, pending_bytes);
+                if (timed)
+                {
+                    report.add_phase("tokenize", tokenize);
+                    report.add_phase("parse", parse);
+                    report.add_phase("convert", convert);
+                }
+            }
+            catch (const FieldParseError &e)
+            {
+                discard_read(initial_rows, adopted);
+                throw conversion_error(filename, header, e);
+            }
+            catch (...)
+            {
+                discard_read(initial_rows, adopted);
+                throw;
+            }
+        }
+
+        /**
+         * @brief Drops the rows of a failed read, and the columns it gave a table that had none.
+         */
+        void discard_read(size_t initial_rows, bool adopted)
+        {
+            truncate_rows(initial_rows);
+            if (adopted)
+            {
+                col_names.clear();
+                col_map.clear();
+                cols.clear();
+            }
+        }
+
+        /**
+         * @brief Parses a header record and resolves the schema against it.
+         * @throws std::invalid_argument If the schema names a column that is not in the file.
+         */
+        static CSVHeader parse_header(std::string_view record, std::string_view filename, const Schema *schema)
+        {
+            std::vector<std::string_view> fields;
+            std::deque<std::string> unescaped;
+            split_fields(record, fields, unescaped);
+
+            CSVHeader header;
+            header.file_col_names.assign(fields.begin(), fields.end());
+            if (schema == nullptr)
+            {
+                header.col_names = header.file_col_names;
+                return header;
+            }
+            for (const auto &[name, type] : *schema)
+            {
+                if (std::ranges::find(header.file_col_names, name) == header.file_col_names.end())
+                {
+                    throw std::invalid_argument("Schema column not found in " + std::string(filename) + ": " + name);
+                }
+            }
+            header.plan.reserve(header.file_col_names.size());
+            for (const auto &name : header.file_col_names)
+            {
+                auto it = schema->find(name);
+                header.plan.push_back(it == schema->end() ? ColumnType::Infer : it->second);
+                if (header.plan.back() != ColumnType::Skip)
+                {
+                    header.col_names.push_back(name);
+                }
+            }
+            return header;
+        }
+
+        /**
+         * @brief Initializes an empty table from a CSV header, or checks that it matches the existing columns.
+         * @throws std::runtime_error If the table already has different columns.
+         */
+        void adopt_header(const CSVHeader &header, std::string_view filename)
+        {
+            // If table is empty, initialize with new headers
+            if (col_names.empty())
+            {
+                col_names = header.col_names;
+                col_map.clear();
+                for (size_t i = 0; i < col_names.size(); ++i)
+                {
+                    col_map[col_names[i]] = i;
+                }
+                if (mode == StorageMode::Columnar)
+                {
+                    cols.clear();
+                    cols.reserve(col_names.size());
+                    for (ColumnType type : header.plan)
+                    {
+                        if (type != ColumnType::Skip)
+                        {
+                            static_assert(static_cast<int>(ColumnType::UInt64) == static_cast<int>(Column::Type::UInt64));
+                            cols.emplace_back(type == ColumnType::Infer         ? Column::Type::String
+                                              : type == ColumnType::Categorical ? Column::Type::Categorical
+                                                                                : static_cast<Column::Type>(type));
+                        }
+                    }
+                    cols.resize(col_names.size(), Column(Column::Type::String));
+                }
+            }
+            // Otherwise, verify headers match
+            else
+            {
+                check_header(header.col_names, filename);
+            }
+        }
+
+        /**
+         * @brief Checks that the columns read from a file match the columns of the table.
+         * @throws std::runtime_error If they differ.
+         */
+        void check_header(const std::vector<std::string> &names, std::string_view filename) const
+        {
+            if (names != col_names)
+            {
+                throw std::runtime_error("Column headers in " + std::string(filename) + " do not match existing table");
+            }
+        }
+
+        static std::runtime_error conversion_error(std::string_view filename, const CSVHeader &header, const FieldParseError &e)
+        {
+            return std::runtime_error("Conversion error in " + std::string(filename) + " at row " + std::to_string(e.row) +
+                                      ", column " + header.file_col_names[e.field] + ": cannot parse '" + e.value +
+                                      "' as " + column_type_name(header.plan[e.field]));
+        }
+
+        /**
+         * @brief Strips leading whitespace and a leading '+' so the text can be handed to std::from_chars.
+         */
+        static std::string_view numeric_text(std::string_view str)
+        {
+            size_t start = 0;
+            while (start < str.size() && std::isspace(static_cast<unsigned char>(str[start])))
+            {
+                ++start;
+            }
+            str.remove_prefix(start);
+            if (str.size() > 1 && str.front() == '+' && str[1] != '-')
+            {
+                str.remove_prefix(1);
+            }
+            return str;
+        }
+
+        static constexpr size_t progress_interval = 10000; // Report every 10K rows
+        static constexpr size_t parquet_block_rows = 65536; // Rows per Parquet conversion task in row mode
+        static constexpr size_t default_chunk_size = size_t{8} << 20;
+        static constexpr size_t default_batch_size = 65536;
+
+        /**
+         * @brief Parses the records in data on a pool of threads and appends them in order.
+         *
+         * Workers claim chunks from a shared counter and parse each into its own row block (per-chunk
+         * columns when the table is columnar, so no row blocks are kept), reporting rows as they go. The phases are splitting the data into chunks ("tokenize"), parsing them
+         * ("parse") and appending the blocks ("convert").
+         */
+        void read_chunks_parallel(std::string_view data, const std::vector<ColumnType> &plan, size_t num_threads, size_t chunk_size,
+                                  OperationReporter &report)
+        {
+            PhaseTimer tokenize(report, "tokenize");
+            std::vector<size_t> bounds = CSVRecordReader::chunk_bounds(data, chunk_size);
+            tokenize.stop();
+            size_t num_chunks = bounds.size() - 1;
+            const bool columnar = mode == StorageMode::Columnar;
+            std::vector<std::vector<std::vector<CellValue>>> blocks(columnar ? 0 : num_chunks);
+            std::vector<std::vector<Column>> column_blocks(columnar ? num_chunks : 0);
+            std::vector<size_t> block_rows(num_chunks, 0);
+
+            const size_t width = col_names.size();
+            PhaseTimer parse(report, "parse");
+            std::atomic<size_t> next_chunk{0};
+            std::atomic<size_t> parsed_rows{0};
+            std::mutex error_mutex;
+            std::exception_ptr error;
+            std::optional<size_t> parse_error_chunk;
+            FieldParseError parse_error{};
+
+            auto worker = [&]()
+            {
+                try
+                {
+                    std::vector<std::string_view> fields;
+                    std::deque<std::string> unescaped;
+                    size_t chunk;
+                    while ((chunk = next_chunk.fetch_add(1)) < num_chunks)
+                    {
+                        std::string_view part = data.substr(bounds[chunk], bounds[chunk + 1] - bounds[chunk]);
+                        if (columnar)
+                        {
+                            column_blocks[chunk].reserve(width);
+                            for (const Column &column : cols)
+                            {
+                                column_blocks[chunk].emplace_back(column.type());
+                            }
+                        }
+                        size_t pos = 0;
+                        size_t pending = 0;
+                        size_t pending_pos = 0;
+                        std::string_view record;
+                        while (CSVRecordReader::next_record(part, pos, record))
+                        {
+                            try
+                            {
+                                auto row = parse_record(record, width, plan, fields, unescaped);
+                                if (columnar)
+                                {
+                                    for (size_t c = 0; c < width; ++c)
+                                    {
+                                        column_blocks[chunk][c].push_back(c < row.size() ? row[c] : CellValue(std::string("")));
+                                    }
+                                }
+                                else
+                                {
+                                    blocks[chunk].push_back(std::move(row));
+                                }
+                                ++block_rows[chunk];
+                            }
+                            catch (FieldParseError &e)
+                            {
+                                // Keep the earliest error; chunks before it are still parsed so its row can be computed
+                                std::lock_guard<std::mutex> lock(error_mutex);
+                                if (!parse_error_chunk || chunk < *parse_error_chunk)
+                                {
+                                    parse_error_chunk = chunk;
+                                    e.row = block_rows[chunk];
+                                    parse_error = std::move(e);
+                                }
+                                next_chunk = num_chunks;
+                                return;
+                            }
+                            if (++pending == 1024 || pos >= part.size())
+                            {
+                                parsed_rows.fetch_add(pending);
+                                report.add(pending, 0, pos - pending_pos);
+                                pending = 0;
+                                pending_pos = pos;
+                            }
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                    next_chunk = num_chunks;
+                }
+            };
+
+            std::vector<std::thread> threads;
+            size_t extra_threads = std::min(num_threads, num_chunks) - (num_chunks > 0 ? 1 : 0);
+            threads.reserve(extra_threads);
+            for (size_t t = 0; t < extra_threads; ++t)
+            {
+                threads.emplace_back(worker);
+            }
+            worker();
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+            if (parse_error_chunk)
+            {
+                for (size_t chunk = 0; chunk < *parse_error_chunk; ++chunk)
+                {
+                    parse_error.row += block_rows[chunk];
+                }
+                throw parse_error;
+            }
+
+            parse.stop();
+
+            // Stitch the blocks together in file order
+            PhaseTimer convert(report, "convert");
+            size_t total_rows = parsed_rows.load();
+            if (!columnar)
+            {
+                reserve_rows(row_count() + total_rows);
+            }
+            for (auto &block : blocks)
+            {
+                rows.insert(rows.end(), std::make_move_iterator(block.begin()), std::make_move_iterator(block.end()));
+                std::vector<std::vector<CellValue>>().swap(block);
+            }
+            for (auto &block : column_blocks)
+            {
+                for (size_t c = 0; c < width; ++c)
+                {
+                    cols[c].append(std::move(block[c]));
+                }
+                std::vector<Column>().swap(block);
+            }
+        }
+
+        /**
+         * @brief Splits a CSV record into field views, following RFC 4180 quoting.
+         * @param record The record to split.
+         * @param fields Receives the fields; previous contents are discarded.
+         * @param unescaped Backing storage for quoted fields containing escaped ("") quotes.
+         *
+         * A field that starts with a double quote extends to its closing quote and may contain
+         * commas and newlines. Fields without escaped quotes are views into record; only fields
+         * with "" escapes are copied into unescaped.
+         */
+        static void split_fields(std::string_view record, std::vector<std::string_view> &fields, std::deque<std::string> &unescaped)
+        {
+            fields.clear();
+            unescaped.clear();
+            if (record.empty())
+            {
+                return;
+            }
+            constexpr auto npos = std::string_view::npos;
+            size_t start = 0;
+            while (true)
+            {
+                size_t next = npos;
+                std::string_view field;
+                bool quoted = false;
+                if (start < record.size() && record[start] == '"')
+                {
+                    // Find the closing quote, skipping "" escapes
+                    size_t close = start + 1;
+                    bool escaped = false;
+                    while ((close = record.find('"', close)) != npos && close + 1 < record.size() && record[close + 1] == '"')
+                    {
+                        escaped = true;
+                        close += 2;
+                    }
+                    size_t after = close == npos ? record.size() : close + 1;
+                    if (after == record.size() || record[after] == ',')
+                    {
+                        quoted = true;
+                        field = record.substr(start + 1, (close == npos ? record.size() : close) - start - 1);
+                        next = after == record.size() ? npos : after;
+                        if (escaped)
+                        {
+                            std::string &text = unescaped.emplace_back();
+                            text.reserve(field.size());
+                            for (size_t i = 0; i < field.size(); ++i)
+                            {
+                                text.push_back(field[i]);
+                                if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"')
+                                {
+                                    ++i;
+                                }
+                            }
+                            field = text;
+                        }
+                    }
+                }
+                if (!quoted)
+                {
+                    // Unquoted, or text after the closing quote: take the raw text up to the next comma
+                    next = record.find(',', start);
+                    field = record.substr(start, next == npos ? npos : next - start);
+                }
+                fields.push_back(field);
+                if (next == npos)
+                {
+                    break;
+                }
+                start = next + 1;
+            }
+        }
+
+        /**
+         * @brief Parses one CSV record into a row padded to width cells.
+         * @param plan Declared type per file column, or empty to infer every field.
+         * @throws FieldParseError If a field does not parse as its declared type.
+         */
+        static std::vector<CellValue> parse_record(std::string_view record, size_t width, const std::vector<ColumnType> &plan,
+                                                   std::vector<std::string_view> &fields, std::deque<std::string> &unescaped)
+        {
+            split_fields(record, fields, unescaped);
+            std::vector<CellValue> row;
+            if (plan.empty())
+            {
+                row.reserve(std::max(fields.size(), width));
+                for (std::string_view field : fields)
+                {
+                    row.push_back(parse_cell(field));
+                }
+            }
+            else
+            {
+                row.reserve(width);
+                for (size_t i = 0; i < plan.size(); ++i)
+                {
+                    if (plan[i] == ColumnType::Skip)
+                    {
+                        continue;
+                    }
+                    if (i >= fields.size())
+                    {
+                        break;
+                    }
+                    row.push_back(parse_typed_field(fields[i], plan[i], i));
+                }
+            }
+            while (row.size() < width)
+            {
+                row.emplace_back(std::string(""));
+            }
+            return row;
+        }
+
+        /**
+         * @brief Parses a field directly into its declared type; missing values become empty cells.
+         */
+        static CellValue parse_typed_field(std::string_view field, ColumnType type, size_t field_index)
+        {
+            if (type == ColumnType::Infer)
+            {
+                return parse_cell(field);
+            }
+            if (type == ColumnType::String || type == ColumnType::Categorical)
+            {
+                return std::string(field);
+            }
+            if (is_na_string(field))
+            {
+                return std::string("");
+            }
+            std::optional<CellValue> value;
+            switch (type)
+            {
+            case ColumnType::Int: value = try_parse<int>(field); break;
+            case ColumnType::Double: value = try_parse<double>(field); break;
+            case ColumnType::Bool: value = try_parse<bool>(field); break;
+            case ColumnType::UInt64: value = try_parse<uint64_t>(field); break;
+            default: break;
+            }
+            if (!value)
+            {
+                throw FieldParseError{0, field_index, std::string(field)};
+            }
+            return std::move(*value);
+        }
+
+        /**
+         * @brief Drops rows from index n onwards in either storage layout.
+         */
+        void truncate_rows(size_t n)
+        {
+            indexes.clear();
+            if (mode == StorageMode::Columnar)
+            {
+                std::vector<char> keep(row_count(), 0);
+                std::fill(keep.begin(), keep.begin() + std::min(n, keep.size()), 1);
+                retain_rows(keep);
+            }
+            else if (n < rows.size())
+            {
+                rows.resize(n);
+            }
+        }
+
+        /**
+         * @brief Appends a row in either storage layout. Columnar storage ignores fields beyond the header.
+         * Indexes are not updated; callers run index_new_rows once after appending their rows.
+         */
+        void push_row(std::vector<CellValue> &&values)
+        {
+            if (mode == StorageMode::Columnar)
+            {
+                for (size_t c = 0; c < cols.size(); ++c)
+                {
+                    cols[c].push_back(c < values.size() ? values[c] : CellValue(std::string("")));
+                }
+            }
+            else
+            {
+                rows.push_back(std::move(values));
+            }
+        }
+
+        void reserve_rows(size_t n)
+        {
+            if (mode == StorageMode::Columnar)
+            {
+                for (auto &column : cols)
+                {
+                    column.reserve(n);
+                }
+            }
+            else
+            {
+                rows.reserve(n);
+            }
+        }
+
+        /**
+         * @brief Appends the rows of other as append_table does, moving its rows or columns when it is an rvalue.
+         */
+        template <typename Table>
+        void append_table_impl(Table &&other)
+        {
+            constexpr bool move = !std::is_lvalue_reference_v<Table>;
+            if (other.col_names.empty())
+            {
+                return;
+            }
+            if (col_names.empty())
+            {
+                // An empty table adopts the columns and rows of the other table
+                col_names = other.col_names;
+                col_map = other.col_map;
+                if (mode == other.mode)
+                {
+                    rows = std::forward<Table>(other).rows;
+                    cols = std::forward<Table>(other).cols;
+                    return;
+                }
+                if (mode == StorageMode::Columnar)
+                {
+                    cols.assign(col_names.size(), Column(Column::Type::String));
+                }
+            }
+            else if (col_names != other.col_names)
+            {
+                throw std::invalid_argument("Columns do not match for appending");
+            }
+            if (mode == StorageMode::Row && other.mode == StorageMode::Row)
+            {
+                if constexpr (move)
+                    rows.insert(rows.end(), std::make_move_iterator(other.rows.begin()), std::make_move_iterator(other.rows.end()));
+                else
+                    rows.insert(rows.end(), other.rows.begin(), other.rows.end());
+            }
+            else if (mode == StorageMode::Columnar && other.mode == StorageMode::Columnar)
+            {
+                // Whole columns are appended; same-typed buffers are copied in bulk
+                for (size_t c = 0; c < cols.size(); ++c)
+                {
+                    if constexpr (move)
+                        cols[c].append(std::move(other.cols[c]));
+                    else
+                        cols[c].append(Column(other.cols[c]));
+                }
+            }
+            else
+            {
+                reserve_rows(row_count() + other.row_count());
+                for (size_t i = 0; i < other.row_count(); ++i)
+                {
+                    push_row(other.row_values(i));
+                }
+            }
+            if (!indexes.empty())
+            {
+                index_new_rows();
+            }
+        }
+
+        /**
+         * @brief Copies a row out of either storage layout.
+         */
+        std::vector<CellValue> row_values(size_t r) const
+        {
+            if (mode == StorageMode::Row)
+            {
+                return rows[r];
+            }
+            std::vector<CellValue> values;
+            values.reserve(cols.size());
+            for (const auto &column : cols)
+            {
+                values.push_back(column.get(r));
+            }
+            return values;
+        }
+
+        /**
+         * @brief Returns a row by reference; columnar rows are materialized into scratch.
+         */
+        const std::vector<CellValue> &row_ref(size_t r, std::vector<CellValue> &scratch) const
+        {
+            if (mode == StorageMode::Row)
+            {
+                return rows[r];
+            }
+            scratch = row_values(r);
+            return scratch;
+        }
+
+        /**
+         * @brief Hashes the key cells of row r; rows with equal keys (see keys_equal) hash alike,
+         * across tables and storage modes.
+         */
+        size_t hash_key(size_t r, const std::vector<int> &key_cols) const
+        {
+            size_t h = 0;
+            for (int c : key_cols)
+            {
+                size_t cell_hash = mode == StorageMode::Columnar ? cols[c].hash(r) : Column::hash_value(rows[r][c]);
+                h ^= cell_hash + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            }
+            return h;
+        }
+
+        /**
+         * @brief Compares the key cells of row r with those of row other_r of another table.
+         */
+        bool keys_equal(size_t r, const std::vector<int> &key_cols,
+                        const CSVTable &other, size_t other_r, const std::vector<int> &other_key_cols) const
+        {
+            for (size_t k = 0; k < key_cols.size(); ++k)
+            {
+                int c = key_cols[k];
+                int oc = other_key_cols[k];
+                bool equal;
+                if (mode == StorageMode::Row && other.mode == StorageMode::Row)
+                    equal = Column::same_value(rows[r][c], other.rows[other_r][oc]);
+                else if (mode == StorageMode::Columnar && other.mode == StorageMode::Columnar)
+                    equal = cols[c].equal(r, other.cols[oc], other_r);
+                else
+                    equal = Column::same_value(cell_at(r, c), other.cell_at(other_r, oc));
+                if (!equal)
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Orders a cell of this table against a cell of another, as compare_values does, without copying
+         * the cells when both tables use the same storage.
+         */
+        std::partial_ordering compare_cells(size_t r, int c, const CSVTable &other, size_t other_r, int oc) const
+        {
+            if (mode == StorageMode::Row && other.mode == StorageMode::Row)
+                return compare_values(rows[r][c], other.rows[other_r][oc]);
+            if (mode == StorageMode::Columnar && other.mode == StorageMode::Columnar)
+                return cols[c].compare(r, other.cols[oc], other_r);
+            return compare_values(cell_at(r, c), other.cell_at(other_r, oc));
+        }
+
+        /// Matching row pairs of a join: [0] left rows, [1] right rows, Column::npos for no row.
+        using JoinIndices = std::array<std::vector<size_t>, 2>;
+
+        /**
+         * @brief Hash join: builds a table of the smaller side's keys and probes it with the other side.
+         * A hash index (see create_index) on the non-primary side's single key is probed instead of building one.
+         * @return JoinIndices Pairs in the order of the primary side (left, or right for "right"), with
+         *         unmatched primary rows in place and, for "outer", unmatched right rows at the end.
+         */
+        JoinIndices hash_join_indices(const CSVTable &other, const std::vector<int> (&keys)[2], std::string_view how,
+                                      size_t num_threads) const
+        {
+            const CSVTable *tables[2] = {this, &other};
+            const size_t primary = how == "right" ? 1 : 0;
+            const bool keep_unmatched[2] = {how == "left" || how == "outer", how == "right" || how == "outer"};
+            const ColumnIndex *index = nullptr;
+            if (keys[0].size() == 1)
+            {
+                index = tables[1 - primary]->usable_index(keys[1 - primary][0]);
+                index = index && index->kind == IndexKind::Hash ? index : nullptr;
+            }
+            const size_t build = index ? 1 - primary : other.row_count() <= row_count() ? 1 : 0;
+            const size_t probe = 1 - build;
+            const size_t build_rows = tables[build]->row_count();
+            const size_t probe_rows = tables[probe]->row_count();
+
+            auto hash_all = [&](size_t side)
+            {
+                size_t rows_n = tables[side]->row_count();
+                std::vector<size_t> hashes(rows_n);
+                parallel_for((rows_n + rows_per_parallel_block - 1) / rows_per_parallel_block, num_threads, [&](size_t block)
+                {
+                    size_t end = std::min(rows_n, (block + 1) * rows_per_parallel_block);
+                    for (size_t r = block * rows_per_parallel_block; r < end; ++r)
+                    {
+                        hashes[r] = tables[side]->hash_key(r, keys[side]);
+                    }
+                });
+                return hashes;
+            };
+            std::vector<size_t> hashes[2];
+            if (!index)
+            {
+                hashes[build] = hash_all(build);
+                hashes[probe] = hash_all(probe);
+            }
+
+            // A key is (side, row); equal keys are chained in row order through next_in_group.
+            struct Key
+            {
+                size_t side;
+                size_t row;
+            };
+            auto key_hash = [&](const Key &k) { return hashes[k.side][k.row]; };
+            auto key_equal = [&](const Key &a, const Key &b)
+            {
+                return hashes[a.side][a.row] == hashes[b.side][b.row] &&
+                       tables[a.side]->keys_equal(a.row, keys[a.side], *tables[b.side], b.row, keys[b.side]);
+            };
+            std::unordered_map<Key, std::pair<size_t, size_t>, decltype(key_hash), decltype(key_equal)>
+                groups(index ? 0 : build_rows, key_hash, key_equal); // first and last row of each key
+            std::vector<size_t> next_in_group(index ? 0 : build_rows, Column::npos);
+            for (size_t r = 0; !index && r < build_rows; ++r)
+            {
+                auto [it, inserted] = groups.try_emplace(Key{build, r}, r, r);
+                if (!inserted)
+                {
+                    next_in_group[it->second.second] = r;
+                    it->second.second = r;
+                }
+            }
+
+            // Probe in blocks; each block's pairs are collected separately and concatenated in order.
+            size_t num_blocks = (probe_rows + rows_per_parallel_block - 1) / rows_per_parallel_block;
+            std::vector<JoinIndices> block_pairs(num_blocks);
+            parallel_for(num_blocks, num_threads, [&](size_t block)
+            {
+                auto &pairs = block_pairs[block];
+                size_t end = std::min(probe_rows, (block + 1) * rows_per_parallel_block);
+                for (size_t r = block * rows_per_parallel_block; r < end; ++r)
+                {
+                    const std::vector<size_t> *index_rows = nullptr;
+                    auto it = groups.end();
+                    if (index)
+                    {
+                        auto found = index->rows_by_key.find(tables[probe]->cell_at(r, keys[probe][0]));
+                        index_rows = found == index->rows_by_key.end() ? nullptr : &found->second;
+                    }
+                    else
+                    {
+                        it = groups.find(Key{probe, r});
+                    }
+                    if (!index_rows && it == groups.end())
+                    {
+                        if (keep_unmatched[probe])
+                        {
+                            pairs[probe].push_back(r);
+                            pairs[build].push_back(Column::npos);
+                        }
+                        continue;
+                    }
+                    auto emit = [&](size_t b)
+                    {
+                        pairs[probe].push_back(r);
+                        pairs[build].push_back(b);
+                    };
+                    if (index_rows)
+                        std::ranges::for_each(*index_rows, emit);
+                    else
+                        for (size_t b = it->second.first; b != Column::npos; b = next_in_group[b])
+                            emit(b);
+                }
+            });
+            JoinIndices pairs;
+            for (auto &block : block_pairs)
+            {
+                for (size_t side : {0, 1})
+                {
+                    pairs[side].insert(pairs[side].end(), block[side].begin(), block[side].end());
+                }
+            }
+            block_pairs.clear();
+
+            std::vector<char> build_matched(build_rows, 0);
+            for (size_t b : pairs[build])
+            {
+                if (b != Column::npos)
+                    build_matched[b] = 1;
+            }
+            if (probe == primary)
+            {
+                if (keep_unmatched[build])
+                {
+                    for (size_t b = 0; b < build_rows; ++b)
+                    {
+                        if (!build_matched[b])
+                        {
+                            pairs[probe].push_back(Column::npos);
+                            pairs[build].push_back(b);
+                        }
+                    }
+                }
+                return pairs;
+            }
+
+            // The build side is primary: counting-sort the pairs by build row (stable, so probe order is
+            // kept within a row), placing unmatched build rows where they belong and unmatched probe rows last.
+            std::vector<size_t> offsets(build_rows + 1, 0);
+            size_t unmatched_probe = 0;
+            for (size_t b : pairs[build])
+            {
+                if (b == Column::npos)
+                    ++unmatched_probe;
+                else
+                    ++offsets[b + 1];
+            }
+            for (size_t b = 0; b < build_rows; ++b)
+            {
+                if (!build_matched[b] && keep_unmatched[build])
+                    offsets[b + 1] = 1;
+                offsets[b + 1] += offsets[b];
+            }
+            JoinIndices ordered;
+            for (size_t side : {0, 1})
+            {
+                ordered[side].assign(offsets[build_rows] + unmatched_probe, Column::npos);
+            }
+            for (size_t b = 0; b < build_rows; ++b)
+            {
+                if (!build_matched[b] && keep_unmatched[build])
+                    ordered[build][offsets[b]++] = b;
+            }
+            size_t tail = offsets[build_rows];
+            for (size_t i = 0; i < pairs[build].size(); ++i)
+            {
+                size_t b = pairs[build][i];
+                size_t pos = b == Column::npos ? tail++ : offsets[b]++;
+                ordered[build][pos] = b;
+                ordered[probe][pos] = pairs[probe][i];
+            }
+            return ordered;
+        }
+
+        /**
+         * @brief Sort-merge join of two tables sorted ascending on their keys (see sorted_for_merge_join).
+         * @return JoinIndices Pairs in the same order as hash_join_indices: the primary side's rows in table
+         *         order, each with its matches in the other table's order, and for "outer" the unmatched
+         *         right rows at the end.
+         */
+        JoinIndices merge_join_indices(const CSVTable &other, const std::vector<int> (&keys)[2], std::string_view how) const
+        {
+            const bool right_primary = how == "right";
+            const bool keep_left = how == "left" || how == "outer";
+            const bool keep_right = how == "right" || how == "outer";
+            auto compare = [&](const CSVTable &a, size_t ra, const std::vector<int> &ka,
+                               const CSVTable &b, size_t rb, const std::vector<int> &kb)
+            {
+                for (size_t k = 0; k < ka.size(); ++k)
+                {
+                    auto order = a.compare_cells(ra, ka[k], b, rb, kb[k]);
+                    if (order != std::partial_ordering::equivalent)
+                        return order;
+                }
+                return std::partial_ordering::equivalent;
+            };
+            JoinIndices pairs;
+            std::vector<size_t> unmatched_right; // "outer": appended after the left-ordered pairs
+            auto emit = [&](size_t l, size_t r)
+            {
+                pairs[0].push_back(l);
+                pairs[1].push_back(r);
+            };
+            const size_t left_rows = row_count();
+            const size_t right_rows = other.row_count();
+            size_t i = 0, j = 0;
+            while (i < left_rows || j < right_rows)
+            {
+                auto order = i == left_rows    ? std::partial_ordering::greater
+                             : j == right_rows ? std::partial_ordering::less
+                                               : compare(*this, i, keys[0], other, j, keys[1]);
+                if (order == std::partial_ordering::less)
+                {
+                    if (keep_left)
+                        emit(i, Column::npos);
+                    ++i;
+                    continue;
+                }
+                if (order == std::partial_ordering::greater)
+                {
+                    if (right_primary)
+                        emit(Column::npos, j);
+                    else if (keep_right)
+                        unmatched_right.push_back(j);
+                    ++j;
+                    continue;
+                }
+                size_t i_end = i + 1, j_end = j + 1;
+                while (i_end < left_rows && compare(*this, i_end, keys[0], *this, i, keys[0]) == 0)
+                    ++i_end;
+                while (j_end < right_rows && compare(other, j_end, keys[1], other, j, keys[1]) == 0)
+                    ++j_end;
+                for (size_t outer = right_primary ? j : i; outer < (right_primary ? j_end : i_end); ++outer)
+                {
+                    for (size_t inner = right_primary ? i : j; inner < (right_primary ? i_end : j_end); ++inner)
+                        right_primary ? emit(inner, outer) : emit(outer, inner);
+                }
+                i = i_end;
+                j = j_end;
+            }
+            for (size_t r : unmatched_right)
+                emit(Column::npos, r);
+            return pairs;
+        }
+
+        /**
+         * @brief Checks whether both tables are sorted ascending on their key columns, with each key column
+         * holding one kind of value in both tables, so that ordering and key equality agree.
+         */
+        bool sorted_for_merge_join(const std::vector<int> &keys, const CSVTable &other, const std::vector<int> &other_keys) const
+        {
+            std::vector<int> key_kinds(keys.size(), -1);
+            return sorted_on(keys, key_kinds) && other.sorted_on(other_keys, key_kinds);
+        }
+
+        /**
+         * @brief Checks whether the rows are sorted ascending on key columns that each hold one kind of value
+         * (strings, integers, doubles or bools), so that runs of equal keys are adjacent. Cells are compared
+         * where they are stored, without copies.
+         * @param key_kinds The value kind of each key column, -1 if not yet known; updated.
+         */
+        bool sorted_on(const std::vector<int> &keys, std::vector<int> &key_kinds) const
+        {
+            for (size_t r = 0; r < row_count(); ++r)
+            {
+                for (size_t k = 0; k < keys.size(); ++k)
+                {
+                    int kind = key_kind(r, keys[k]);
+                    if (key_kinds[k] == -1)
+                        key_kinds[k] = kind;
+                    else if (key_kinds[k] != kind)
+                        return false;
+                }
+                for (size_t k = 0; r > 0 && k < keys.size(); ++k)
+                {
+                    auto order = compare_cells(r - 1, keys[k], *this, r, keys[k]);
+                    if (order == std::partial_ordering::less)
+                        break;
+                    if (order != std::partial_ordering::equivalent)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief The kind of a key cell for sorted_on: 0 = string (or missing), 1 = int or uint64_t, 2 = double, 3 = bool.
+         */
+        int key_kind(size_t r, int c) const
+        {
+            static constexpr int kinds[] = {0, 1, 2, 3, 1};
+            if (mode == StorageMode::Row)
+                return kinds[rows[r][c].index()];
+            const Column &column = cols[c];
+            if (column.is_null(r))
+                return 0;
+            switch (column.type())
+            {
+            case Column::Type::Int:
+            case Column::Type::UInt64: return 1;
+            case Column::Type::Double: return 2;
+            case Column::Type::Bool: return 3;
+            case Column::Type::Mixed: return kinds[column.get(r).index()];
+            default: return 0;
+            }
+        }
+
+        /**
+         * @brief Reads a cell as a double for aggregation; false for missing, NA and NaN cells.
+         * @throws std::invalid_argument or std::runtime_error If the cell cannot be converted, as in convert_cell.
+         */
+        bool numeric_cell(size_t r, size_t c, double &out) const
+        {
+            if (mode == StorageMode::Columnar)
+            {
+                const Column &column = cols[c];
+                if (column.is_null(r))
+                    return false;
+                if (column.type() == Column::Type::Double)
+                {
+                    out = column.values<double>()[r];
+                    return !std::isnan(out);
+                }
+                if (column.type() == Column::Type::Int)
+                {
+                    out = column.values<int>()[r];
+                    return true;
+                }
+            }
+            CellValue scratch;
+            const CellValue &value = mode == StorageMode::Columnar ? (scratch = cols[c].get(r)) : rows[r][c];
+            if (std::holds_alternative<std::string>(value) && is_na_string(std::get<std::string>(value)))
+            {
+                return false;
+            }
+            out = convert_cell<double>(value);
+            return !std::isnan(out);
+        }
+
+        /**
+         * @brief Collects a column's numeric values for describe, skipping missing, NA and NaN cells.
+         * @return false If the column holds a value that is not an int, double or uint64_t.
+         */
+        bool numeric_values(size_t c, std::vector<double> &values) const
+        {
+            values.reserve(row_count());
+            if (mode == StorageMode::Columnar)
+            {
+                const Column::Type type = cols[c].type();
+                if (type == Column::Type::String || type == Column::Type::Bool || type == Column::Type::Categorical)
+                {
+                    return false;
+                }
+                if (type != Column::Type::Mixed)
+                {
+                    // Walk the validity bitmap, so null cells cost nothing
+                    std::visit([&](const auto &vec)
+                               {
+                                   using V = typename std::decay_t<decltype(vec)>::value_type;
+                                   if constexpr (std::is_arithmetic_v<V>)
+                                       cols[c].for_each_valid([&](size_t r)
+                                                              {
+                                                                  const double x = static_cast<double>(vec[r]);
+                                                                  if (!std::isnan(x))
+                                                                      values.push_back(x); }); },
+                               cols[c].data_);
+                    return true;
+                }
+            }
+            for (size_t r = 0; r < row_count(); ++r)
+            {
+                const CellValue value = cell_at(r, c);
+                if (std::holds_alternative<std::string>(value) && is_na_string(std::get<std::string>(value)))
+                {
+                    continue;
+                }
+                if (std::holds_alternative<std::string>(value) || std::holds_alternative<bool>(value))
+                {
+                    return false;
+                }
+                double x = convert_cell<double>(value);
+                if (!std::isnan(x))
+                {
+                    values.push_back(x);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Maps a key to an unsigned integer with the same order, for radix sorting.
+         */
+        static uint64_t sortable_bits(int value)
+        {
+            return static_cast<uint64_t>(static_cast<int64_t>(value)) ^ (uint64_t(1) << 63);
+        }
+
+        static uint64_t sortable_bits(uint64_t value) { return value; }
+
+        static uint64_t sortable_bits(bool value) { return value; }
+
+        static uint64_t sortable_bits(double value)
+        {
+            uint64_t bits = std::bit_cast<uint64_t>(value == 0.0 ? 0.0 : value); // -0.0 sorts as 0.0
+            return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+        }
+
+        /**
+         * @brief Stable LSD radix sort of a permutation by 64-bit keys, one byte per pass.
+         *
+         * keys[i] is the key of order[i]. Bytes that are the same in every key are skipped, so small
+         * integers take few passes. With several threads each thread counts and scatters its own range.
+         */
+        static void radix_sort_indices(std::vector<size_t> &order, std::vector<uint64_t> &keys, size_t num_threads)
+        {
+            const size_t n = order.size();
+            const size_t parts = n < 2 * rows_per_parallel_block ? 1 : num_threads;
+            std::vector<size_t> order_out(n);
+            std::vector<uint64_t> keys_out(n);
+            std::vector<std::array<size_t, 256>> counts(parts);
+            for (int shift = 0; shift < 64; shift += 8)
+            {
+                parallel_for(parts, num_threads, [&](size_t part)
+                {
+                    counts[part].fill(0);
+                    for (size_t i = part * n / parts; i < (part + 1) * n / parts; ++i)
+                        ++counts[part][(keys[i] >> shift) & 255];
+                });
+                // Exclusive prefix sums in (digit, part) order give each part's output position per digit
+                size_t offset = 0;
+                bool single_digit = false;
+                for (size_t digit = 0; digit < 256; ++digit)
+                {
+                    size_t digit_count = 0;
+                    for (size_t part = 0; part < parts; ++part)
+                    {
+                        size_t count = counts[part][digit];
+                        counts[part][digit] = offset;
+                        offset += count;
+                        digit_count += count;
+                    }
+                    single_digit = single_digit || digit_count == n;
+                }
+                if (single_digit)
+                {
+                    continue;
+                }
+                parallel_for(parts, num_threads, [&](size_t part)
+                {
+                    for (size_t i = part * n / parts; i < (part + 1) * n / parts; ++i)
+                    {
+                        size_t pos = counts[part][(keys[i] >> shift) & 255]++;
+                        keys_out[pos] = keys[i];
+                        order_out[pos] = order[i];
+                    }
+                });
+                std::swap(keys, keys_out);
+                std::swap(order, order_out);
+            }
+        }
+
+        /**
+         * @brief Sorts a permutation with a comparator: ranges are sorted on worker threads, then merged
+         * pairwise (std::merge keeps equal elements in order, so stable sorts stay stable).
+         */
+        template <typename Less>
+        static void sort_indices(std::vector<size_t> &order, Less less, bool stable, size_t num_threads)
+        {
+            const size_t n = order.size();
+            const size_t parts = n < 2 * rows_per_parallel_block ? 1 : num_threads;
+            std::vector<size_t> bounds;
+            for (size_t part = 0; part <= parts; ++part)
+            {
+                bounds.push_back(part * n / parts);
+            }
+            parallel_for(parts, num_threads, [&](size_t part)
+            {
+                auto first = order.begin() + bounds[part], last = order.begin() + bounds[part + 1];
+                stable ? std::stable_sort(first, last, less) : std::sort(first, last, less);
+            });
+            std::vector<size_t> merged(parts > 1 ? n : 0);
+            while (bounds.size() > 2)
+            {
+                size_t runs = bounds.size() - 1;
+                parallel_for((runs + 1) / 2, num_threads, [&](size_t pair)
+                {
+                    size_t lo = bounds[2 * pair], mid = bounds[std::min(2 * pair + 1, runs)], hi = bounds[std::min(2 * pair + 2, runs)];
+                    std::merge(order.begin() + lo, order.begin() + mid, order.begin() + mid, order.begin() + hi,
+                               merged.begin() + lo, less);
+                });
+                std::swap(order, merged);
+                std::vector<size_t> next;
+                for (size_t i = 0; i < bounds.size(); i += 2)
+                {
+                    next.push_back(bounds[i]);
+                }
+                if (next.back() != n)
+                {
+                    next.push_back(n);
+                }
+                bounds = std::move(next);
+            }
+        }
+
+        /**
+         * @brief Stably reorders a permutation by one column (see sort_by_columns for the ordering).
+         */
+        void sort_indices_by_column(std::vector<size_t> &order, size_t col_idx, bool ascending, size_t num_threads) const
+        {
+            // Missing cells go last, in their current order
+            auto missing = [&](size_t r)
+            {
+                return mode == StorageMode::Columnar ? cols[col_idx].is_null(r) : Column::is_missing(rows[r][col_idx]);
+            };
+            auto present_end = std::stable_partition(order.begin(), order.end(), [&](size_t r) { return !missing(r); });
+            std::vector<size_t> present(order.begin(), present_end);
+
+            // Which kinds of value the column holds decides between radix and comparison sorting
+            bool negative_ints = false, uint64s = false, doubles = false, strings = false;
+            for (size_t r : present)
+            {
+                std::visit([&](const auto &v)
+                {
+                    using V = std::decay_t<decltype(v)>;
+                    if constexpr (std::is_same_v<V, std::string>)
+                        strings = true;
+                    else if constexpr (std::is_same_v<V, double>)
+                        doubles = true;
+                    else if constexpr (std::is_same_v<V, uint64_t>)
+                        uint64s = true;
+                    else if constexpr (std::is_same_v<V, int>)
+                        negative_ints = negative_ints || v < 0;
+                }, mode == StorageMode::Columnar ? cols[col_idx].get(r) : rows[r][col_idx]);
+            }
+
+            std::vector<CellValue> scratch(mode == StorageMode::Columnar ? present.size() : 0);
+            if (mode == StorageMode::Columnar)
+            {
+                for (size_t i = 0; i < present.size(); ++i)
+                    scratch[i] = cols[col_idx].get(present[i]);
+            }
+            auto cell = [&](size_t i) -> const CellValue &
+            { return mode == StorageMode::Columnar ? scratch[i] : rows[present[i]][col_idx]; };
+
+            if (!strings && !(uint64s && (doubles || negative_ints)))
+            {
+                std::vector<uint64_t> keys(present.size());
+                for (size_t i = 0; i < present.size(); ++i)
+                {
+                    uint64_t bits = std::visit([&](const auto &v) -> uint64_t
+                    {
+                        using V = std::decay_t<decltype(v)>;
+                        if constexpr (std::is_same_v<V, std::string>)
+                            return 0;
+                        else if (doubles)
+                            return sortable_bits(static_cast<double>(v));
+                        else if (uint64s)
+                            return static_cast<uint64_t>(v);
+                        else
+                            return sortable_bits(static_cast<int>(v));
+                    }, cell(i));
+                    keys[i] = ascending ? bits : ~bits;
+                }
+                radix_sort_indices(present, keys, num_threads);
+            }
+            else
+            {
+                std::vector<size_t> positions(present.size());
+                std::iota(positions.begin(), positions.end(), size_t(0));
+                auto less = [&](size_t a, size_t b)
+                { return ascending ? key_less(cell(a), cell(b)) : key_less(cell(b), cell(a)); };
+                sort_indices(positions, less, true, num_threads);
+                std::vector<size_t> sorted(present.size());
+                for (size_t i = 0; i < positions.size(); ++i)
+                {
+                    sorted[i] = present[positions[i]];
+                }
+                present = std::move(sorted);
+            }
+            std::copy(present.begin(), present.end(), order.begin());
+        }
+
+        /**
+         * @brief Reorders the rows so that row i becomes the old row order[i], moving rather than copying rows.
+         */
+        void apply_permutation(const std::vector<size_t> &order, size_t num_threads)
+        {
+            indexes.clear();
+            if (mode == StorageMode::Columnar)
+            {
+                parallel_for(cols.size(), num_threads, [&](size_t c)
+                {
+                    cols[c] = cols[c].gather(order);
+                });
+                return;
+            }
+            std::vector<std::vector<CellValue>> sorted(rows.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                sorted[i] = std::move(rows[order[i]]);
+            }
+            rows = std::move(sorted);
+        }
+
+        /**
+         * @brief Evaluates an expression for every row into a value buffer and a validity bitmap.
+         */
+        template <typename E>
+        auto evaluate_expression(const E &expr, size_t num_threads) const
+        {
+            using Storage = Column::storage_type<typename E::value_type>;
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            const auto bound = expr.bind(*this);
+            const size_t n = row_count();
+            std::vector<Storage> values(n);
+            std::vector<uint64_t> validity((n + 63) / 64, ~uint64_t(0));
+            if (n % 64 != 0)
+            {
+                validity.back() = (uint64_t(1) << (n % 64)) - 1;
+            }
+            // Blocks are whole bitmap words, so each thread masks its own words
+            parallel_for((n + rows_per_parallel_block - 1) / rows_per_parallel_block, num_threads, [&](size_t b)
+            {
+                const size_t begin = b * rows_per_parallel_block;
+                const size_t end = std::min(n, begin + rows_per_parallel_block);
+                for (size_t r = begin; r < end; ++r)
+                {
+                    values[r] = static_cast<Storage>(bound[r]);
+                }
+                bound.mask(validity.data(), begin, end);
+            });
+            return std::pair(std::move(values), std::move(validity));
+        }
+
+        /**
+         * @brief Builds a column from the cells at the given rows; Column::npos gives a missing cell.
+         */
+        Column gather_column(size_t col_idx, const std::vector<size_t> &row_indices) const
+        {
+            if (mode == StorageMode::Columnar)
+            {
+                return cols[col_idx].gather(row_indices);
+            }
+            return Column::infer(row_indices.size(), [&](size_t i) -> CellValue
+            {
+                return row_indices[i] == Column::npos ? CellValue(std::string("")) : rows[row_indices[i]][col_idx];
+            });
+        }
+
+        /**
+         * @brief Orders keys like a Filter compares them, with numbers below strings; used by sorted indexes.
+         */
+        static bool key_less(const CellValue &a, const CellValue &b)
+        {
+            bool a_string = std::holds_alternative<std::string>(a);
+            bool b_string = std::holds_alternative<std::string>(b);
+            if (a_string != b_string)
+                return b_string;
+            return compare_values(a, b) < 0;
+        }
+
+        /**
+         * @brief Returns the index on a column, or nullptr if there is none or it missed rows added behind its back.
+         */
+        const ColumnIndex *usable_index(size_t col_idx) const
+        {
+            auto it = indexes.find(static_cast<int>(col_idx));
+            return it != indexes.end() && it->second.rows_indexed == row_count() ? &it->second : nullptr;
+        }
+
+        /**
+         * @brief Builds an index from scratch over all rows.
+         */
+        void build_index(ColumnIndex &index, size_t col_idx, size_t num_threads) const
+        {
+            index.rows_by_key.clear();
+            index.order.clear();
+            index.numeric_kinds = 0;
+            index.rows_indexed = 0;
+            if (index.kind == IndexKind::Hash)
+            {
+                add_to_index(index, col_idx);
+                return;
+            }
+            for (size_t r = 0; r < row_count(); ++r)
+            {
+                CellValue key = cell_at(r, col_idx);
+                note_numeric_kind(index, key);
+                if (!Column::is_missing(key) && !(std::holds_alternative<double>(key) && std::isnan(std::get<double>(key))))
+                    index.order.push_back(r);
+            }
+            sort_indices_by_column(index.order, col_idx, true, num_threads);
+            index.rows_indexed = row_count();
+        }
+
+        /**
+         * @brief Adds the rows appended since the index was last updated.
+         */
+        void add_to_index(ColumnIndex &index, size_t col_idx) const
+        {
+            const size_t n = row_count();
+            const size_t old_size = index.order.size();
+            for (size_t r = index.rows_indexed; r < n; ++r)
+            {
+                CellValue key = cell_at(r, col_idx);
+                note_numeric_kind(index, key);
+                if (index.kind == IndexKind::Hash)
+                {
+                    index.rows_by_key[std::move(key)].push_back(r);
+                }
+                else if (!Column::is_missing(key) && !(std::holds_alternative<double>(key) && std::isnan(std::get<double>(key))))
+                {
+                    index.order.push_back(r);
+                }
+            }
+            if (index.kind == IndexKind::Sorted && index.order.size() > old_size)
+            {
+                // Sort the new rows on their own and merge them in once, from the first indexed row that
+                // follows the smallest new key; the merge is stable, so equal keys stay in row order
+                auto mid = index.order.begin() + old_size;
+                std::vector<size_t> added(mid, index.order.end());
+                sort_indices_by_column(added, col_idx, true, 1);
+                std::ranges::copy(added, mid);
+                auto less = [&](size_t a, size_t b) { return key_less(cell_at(a, col_idx), cell_at(b, col_idx)); };
+                auto first = std::upper_bound(index.order.begin(), mid, added.front(), less);
+                std::inplace_merge(first, mid, index.order.end(), less);
+            }
+            index.rows_indexed = n;
+        }
+
+        static void note_numeric_kind(ColumnIndex &index, const CellValue &key)
+        {
+            if (std::holds_alternative<int>(key) || std::holds_alternative<uint64_t>(key))
+                index.numeric_kinds |= 1;
+            else if (std::holds_alternative<double>(key))
+                index.numeric_kinds |= 2;
+            else if (std::holds_alternative<bool>(key))
+                index.numeric_kinds |= 4;
+        }
+
+        /**
+         * @brief Adds newly appended rows to every index.
+         */
+        void index_new_rows()
+        {
+            for (auto &[col_idx, index] : indexes)
+            {
+                add_to_index(index, col_idx);
+            }
+        }
+
+        /**
+         * @brief Checks whether a hash lookup finds exactly the rows a Filter Eq would: strings only equal
+         * strings, and a number may only be looked up in a column holding one kind of number.
+         */
+        static bool hash_compatible(const ColumnIndex &index, const CellValue &key)
+        {
+            if (std::holds_alternative<std::string>(key))
+                return true;
+            unsigned kind = std::holds_alternative<double>(key) ? 2 : std::holds_alternative<bool>(key) ? 4 : 1;
+            return (index.numeric_kinds & ~kind) == 0;
+        }
+
+        /**
+         * @brief Returns the part of a sorted index holding keys of the same kind as value (numbers or strings).
+         */
+        std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator>
+        index_segment(const ColumnIndex &index, size_t col_idx, const CellValue &value) const
+        {
+            auto strings_begin = std::partition_point(index.order.begin(), index.order.end(), [&](size_t r)
+                                                      { return !std::holds_alternative<std::string>(cell_at(r, col_idx)); });
+            if (std::holds_alternative<std::string>(value))
+                return {strings_begin, index.order.end()};
+            return {index.order.begin(), strings_begin};
+        }
+
+        /**
+         * @brief Answers a predicate from an index on its column, writing the selection bitmap.
+         * @return false if there is no suitable index, leaving out untouched.
+         */
+        bool index_select(const ColumnPredicate &predicate, size_t col_idx, uint64_t *out) const
+        {
+            const ColumnIndex *index = usable_index(col_idx);
+            if (!index || Column::is_missing(predicate.value) || predicate.op == CompareOp::Ne)
+                return false;
+            const size_t words = (row_count() + 63) / 64;
+            auto mark = [out](auto first, auto last)
+            {
+                for (; first != last; ++first)
+                    out[*first >> 6] |= uint64_t(1) << (*first & 63);
+            };
+            if (index->kind == IndexKind::Hash)
+            {
+                if (predicate.op != CompareOp::Eq || !hash_compatible(*index, predicate.value))
+                    return false;
+                std::fill(out, out + words, 0);
+                if (auto it = index->rows_by_key.find(predicate.value); it != index->rows_by_key.end())
+                    mark(it->second.begin(), it->second.end());
+                return true;
+            }
+            auto [first, last] = index_segment(*index, col_idx, predicate.value);
+            auto lo = std::lower_bound(first, last, predicate.value, [&](size_t r, const CellValue &v)
+                                       { return compare_values(cell_at(r, col_idx), v) < 0; });
+            auto hi = std::upper_bound(lo, last, predicate.value, [&](const CellValue &v, size_t r)
+                                       { return compare_values(v, cell_at(r, col_idx)) < 0; });
+            std::fill(out, out + words, 0);
+            switch (predicate.op)
+            {
+            case CompareOp::Eq: mark(lo, hi); break;
+            case CompareOp::Lt: mark(first, lo); break;
+            case CompareOp::Le: mark(first, hi); break;
+            case CompareOp::Gt: mark(hi, last); break;
+            default: mark(lo, last); break; // Ge
+            }
+            return true;
+        }
+
+        /**
+         * @brief Keeps the rows whose keep flag is non-zero, preserving their order.
+         */
+        void retain_rows(const std::vector<char> &keep)
+        {
+            indexes.clear();
+            if (mode == StorageMode::Columnar)
+            {
+                for (auto &column : cols)
+                {
+                    column.retain(keep);
+                }
+                return;
+            }
+            size_t write_idx = 0;
+            for (size_t read_idx = 0; read_idx < rows.size(); ++read_idx)
+            {
+                if (keep[read_idx])
+                {
+                    if (write_idx != read_idx)
+                    {
+                        rows[write_idx] = std::move(rows[read_idx]);
+                    }
+                    ++write_idx;
+                }
+            }
+            rows.resize(write_idx);
+        }
+
+        /**
+         * @brief Writes one row as a CSV line (no trailing newline).
+         */
+        void write_row(std::ostream &os, size_t r) const
+        {
+            std::string line;
+            append_csv_row(line, r);
+            line.pop_back();
+            os << line;
+        }
+
+        static constexpr size_t write_buffer_size = size_t{1} << 20;
+        static constexpr size_t rows_per_write_block = 16384;
+        static constexpr size_t rows_per_parallel_block = 16384; // Rows per task of the parallel row-wise operations
+
+        /**
+         * @brief Sends one operation's events to an observer: on_start on construction, on_progress from add()
+         * whenever the row count crosses a multiple of the interval, and on_end from finish().
+         *
+         * Without an observer (or with M2_CSV_NO_OBSERVERS) every member returns at once, and callers test
+         * active() to skip their own timing and batching.
+         */
+        class OperationReporter
+        {
+        public:
+            OperationReporter(std::shared_ptr<Observer> observer, std::string_view operation, std::string_view source,
+                              size_t total_rows, size_t interval = 0)
+                : observer_(observers_enabled ? std::move(observer) : nullptr)
+            {
+                if (!active())
+                    return;
+                event_.operation = operation;
+                event_.source = source;
+                set_total(total_rows, interval);
+                start_time_ = std::chrono::steady_clock::now();
+                observer_->on_start(event_);
+            }
+
+            bool active() const { return observers_enabled && observer_ != nullptr; }
+
+            /// Whether the observer asked for per-row phase timings (see Observer::wants_phase_timings).
+            bool timed() const { return active() && observer_->wants_phase_timings(); }
+
+            size_t interval() const { return interval_; }
+
+            /**
+             * @brief Sets the row total once it is known, with progress every interval rows (0 = every 1%).
+             */
+            void set_total(size_t total_rows, size_t interval = 0)
+            {
+                event_.total_rows = total_rows;
+                interval_ = interval ? interval : std::max(size_t(1), total_rows / 100);
+            }
+
+            /**
+             * @brief Records rows_done more rows, matched of which matched, and bytes more input; safe from any thread.
+             * Progress is reported only when rows are added.
+             */
+            void add(size_t rows_done, size_t matched = 0, size_t bytes = 0)
+            {
+                if (!active())
+                    return;
+                matched_.fetch_add(matched);
+                bytes_.fetch_add(bytes);
+                if (rows_done == 0)
+                    return;
+                size_t before = rows_.fetch_add(rows_done);
+                size_t after = before + rows_done;
+                if (before / interval_ == after / interval_ && after != event_.total_rows)
+                    return;
+                std::lock_guard<std::mutex> lock(mutex_);
+                observer_->on_progress(snapshot());
+            }
+
+            /// Adds time to a phase; call from one thread.
+            void add_phase(std::string_view name, std::chrono::nanoseconds time)
+            {
+                if (!active())
+                    return;
+                auto it = std::ranges::find(phases_, name, &PhaseTiming::name);
+                if (it == phases_.end())
+                    phases_.push_back({name, time});
+                else
+                    it->time += time;
+            }
+
+            /// Reports the end of the operation.
+            void finish()
+            {
+                if (!active())
+                    return;
+                OperationEvent event = snapshot();
+                event.phases = phases_;
+                observer_->on_end(event);
+            }
+
+        private:
+            std::shared_ptr<Observer> observer_;
+            OperationEvent event_;
+            size_t interval_ = 1;
+            std::chrono::steady_clock::time_point start_time_;
+            std::atomic<size_t> rows_{0};
+            std::atomic<size_t> matched_{0};
+            std::atomic<size_t> bytes_{0};
+            std::vector<PhaseTiming> phases_;
+            std::mutex mutex_;
+
+            OperationEvent snapshot() const
+            {
+                OperationEvent event = event_;
+                event.rows = rows_.load();
+                event.matched = matched_.load();
+                event.bytes = bytes_.load();
+                event.elapsed = std::chrono::steady_clock::now() - start_time_;
+                return event;
+            }
+        };
+
+        /// Times a phase of an operation into an OperationReporter, from construction to stop() or destruction.
+        class PhaseTimer
+        {
+        public:
+            PhaseTimer(OperationReporter &report, std::string_view name) : report_(report), name_(name)
+            {
+                if (report_.active())
+                    start_ = std::chrono::steady_clock::now();
+            }
+            ~PhaseTimer() { stop(); }
+
+            void stop()
+            {
+                if (report_.active() && !stopped_)
+                    report_.add_phase(name_, std::chrono::steady_clock::now() - start_);
+                stopped_ = true;
+            }
+
+        private:
+            OperationReporter &report_;
+            std::string_view name_;
+            std::chrono::steady_clock::time_point start_;
+            bool stopped_ = false;
+        };
+
+        /**
+         * @brief Appends a number formatted with std::to_chars; bools print as true/false.
+         */
+        template <typename T>
+        static void append_number(std::string &out, T value)
+        {
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                out.append(value ? "true" : "false");
+            }
+            else if constexpr (std::is_same_v<T, double>)
+            {
+                char buf[32];
+                auto result = std::trunc(value) == value && std::abs(value) < 0x1p53
+                                  ? std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed)
+                                  : std::to_chars(buf, buf + sizeof(buf), value);
+                out.append(buf, result.ptr);
+            }
+            else
+            {
+                char buf[32];
+                auto result = std::to_chars(buf, buf + sizeof(buf), value);
+                out.append(buf, result.ptr);
+            }
+        }
+
+        /**
+         * @brief Appends row r as a CSV line, including the trailing newline.
+         *
+         * Columnar tables are formatted straight from their typed buffers; null cells are left empty.
+         */
+        void append_csv_row(std::string &out, size_t r) const
+        {
+            size_t width = row_width(r);
+            for (size_t c = 0; c < width; ++c)
+            {
+                if (c > 0)
+                    out.push_back(',');
+                if (mode == StorageMode::Row)
+                {
+                    append_csv_value(out, rows[r][c]);
+                    continue;
+                }
+                const Column &column = cols[c];
+                if (column.is_null(r))
+                    continue;
+                switch (column.type())
+                {
+                case Column::Type::String: append_csv_field(out, column.values<std::string>()[r]); break;
+                case Column::Type::Int: append_number(out, column.values<int>()[r]); break;
+                case Column::Type::Double: append_number(out, column.values<double>()[r]); break;
+                case Column::Type::Bool: append_number(out, column.values<bool>()[r] != 0); break;
+                case Column::Type::UInt64: append_number(out, column.values<uint64_t>()[r]); break;
+                default: append_csv_value(out, column.get(r)); break;
+                }
+            }
+            out.push_back('\n');
+        }
+
+        static void append_csv_value(std::string &out, const CellValue &value)
+        {
+            if (const auto *str = std::get_if<std::string>(&value))
+                append_csv_field(out, *str);
+            else
+                append_cell_text(out, value);
+        }
+
+        /**
+         * @brief Writes the table as CSV through a reusable buffer, flushed in large blocks.
+         * @param os The destination stream.
+         * @param header Whether to write the column names first.
+         * @param num_threads Threads used to format rows; blocks of rows are formatted concurrently and written in order.
+         * @param row_indices If given, only these rows are written, in this order.
+         */
+        void write_csv(std::ostream &os, bool header, size_t num_threads = 1, const std::vector<int> *row_indices = nullptr) const
+        {
+            std::string buffer;
+            buffer.reserve(write_buffer_size + 4096);
+            if (header)
+            {
+                for (size_t i = 0; i < col_names.size(); ++i)
+                {
+                    if (i > 0)
+                        buffer.push_back(',');
+                    append_csv_field(buffer, col_names[i]);
+                }
+                buffer.push_back('\n');
+            }
+
+            const size_t n = row_indices ? row_indices->size() : row_count();
+            auto source_row = [row_indices](size_t r)
+            { return row_indices ? static_cast<size_t>((*row_indices)[r]) : r; };
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            if (num_threads <= 1 || n < 2 * rows_per_write_block)
+            {
+                for (size_t r = 0; r < n; ++r)
+                {
+                    append_csv_row(buffer, source_row(r));
+                    if (buffer.size() >= write_buffer_size)
+                    {
+                        os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                        buffer.clear();
+                    }
+                }
+                os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                return;
+            }
+
+            // Format one wave of blocks in parallel, then write the blocks in order
+            os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            std::vector<std::string> blocks(num_threads);
+            for (size_t wave_start = 0; wave_start < n; wave_start += num_threads * rows_per_write_block)
+            {
+                size_t wave_blocks = std::min(num_threads, (n - wave_start + rows_per_write_block - 1) / rows_per_write_block);
+                parallel_for(wave_blocks, num_threads, [&](size_t b)
+                             {
+                                 size_t begin = wave_start + b * rows_per_write_block;
+                                 size_t end = std::min(n, begin + rows_per_write_block);
+                                 blocks[b].clear();
+                                 for (size_t r = begin; r < end; ++r)
+                                 {
+                                     append_csv_row(blocks[b], source_row(r));
+                                 } });
+                for (size_t b = 0; b < wave_blocks; ++b)
+                {
+                    os.write(blocks[b].data(), static_cast<std::streamsize>(blocks[b].size()));
+                }
+            }
+        }
+
+        /**
+         * @brief Runs task(i) for every i in [0, num_tasks) on up to num_threads threads, including the caller.
+         *
+         * Tasks are claimed from a shared counter. The first exception thrown by a task is rethrown
+         * on the calling thread after all threads have finished.
+         */
+        template <typename Task>
+        static void parallel_for(size_t num_tasks, size_t num_threads, Task &&task)
+        {
+            std::atomic<size_t> next{0};
+            std::mutex error_mutex;
+            std::exception_ptr error;
+            auto worker = [&]()
+            {
+                size_t i;
+                while ((i = next.fetch_add(1)) < num_tasks)
+                {
+                    try
+                    {
+                        task(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error)
+                            error = std::current_exception();
+                        next = num_tasks;
+                    }
+                }
+            };
+            std::vector<std::thread> threads;
+            size_t extra = std::min(num_threads, num_tasks);
+            extra = extra > 0 ? extra - 1 : 0;
+            threads.reserve(extra);
+            for (size_t t = 0; t < extra; ++t)
+            {
+                threads.emplace_back(worker);
+            }
+            worker();
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        /**
+         * @brief Creates a table with the same columns and storage layout but no rows.
+         */
+        CSVTable empty_copy() const
+        {
+            CSVTable result;
+            result.col_names = col_names;
+            result.col_map = col_map;
+            result.mode = mode;
+            return result;
+        }
+
+        /**
+         * @brief Binary search on a column sorted ascending, in either storage layout.
+         * @return size_t The index of the first row whose value is not less than value.
+         */
+        template <typename T>
+        size_t lower_bound_index(int col_index, const T &value) const
+        {
+            size_t lo = 0, hi = row_count();
+            while (lo < hi)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (value_as<T>(mid, col_index) < value)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        /**
+         * @brief Extracts a column as a vector of T, copying the buffer directly when it already holds T.
+         */
+        template <ConvertibleToCellValue T>
+        static std::vector<T> column_as(const Column &column)
+        {
+            if (column.type() == Column::type_of<T>() && column.null_count() == 0)
+            {
+                const auto &values = column.template values<T>();
+                return std::vector<T>(values.begin(), values.end());
+            }
+            std::vector<T> column_values;
+            column_values.reserve(column.size());
+            for (size_t i = 0; i < column.size(); ++i)
+            {
+                column_values.push_back(column.get_as<T>(i));
+            }
+            return column_values;
+        }
+
+        /**
+         * @brief Deselects the valid cells of a column that hold the "NA", "NaN" or "#N/A" strings.
+         * Numeric and bool columns have none, so only string, categorical and mixed columns are scanned.
+         */
+        static void clear_na_strings(const Column &column, Selection &selection)
+        {
+            switch (column.type())
+            {
+            case Column::Type::String:
+            {
+                const auto &values = column.values<std::string>();
+                column.for_each_valid([&](size_t i)
+                                      {
+                                          if (is_na_string(values[i]))
+                                              selection.set(i, false); });
+                break;
+            }
+            case Column::Type::Categorical:
+            {
+                const auto &categories = column.categories();
+                std::vector<char> na_codes(categories.size());
+                bool any = false;
+                for (size_t k = 0; k < categories.size(); ++k)
+                {
+                    na_codes[k] = is_na_string(categories[k]);
+                    any = any || na_codes[k];
+                }
+                if (!any)
+                    break;
+                const auto &codes = column.codes();
+                column.for_each_valid([&](size_t i)
+                                      {
+                                          if (na_codes[codes[i]])
+                                              selection.set(i, false); });
+                break;
+            }
+            case Column::Type::Mixed:
+                column.for_each_valid([&](size_t i)
+                                      {
+                                          CellValue value = column.get(i);
+                                          if (std::holds_alternative<std::string>(value) && is_na_string(std::get<std::string>(value)))
+                                              selection.set(i, false); });
+                break;
+            default:
+                break;
+            }
+        }
+
+        /**
+         * @brief Returns a column's values as doubles (see value_as). A columnar double column without nulls is
+         * returned in place; otherwise the values are converted into scratch, which backs the returned span.
+         * @param rows Rows to read, in order, or nullptr for all rows.
+         * @param skip_missing Leave out missing cells (nulls and NA strings) instead of converting them; a
+         * columnar numeric column is then read through its validity bitmap.
+         */
+        std::span<const double> doubles(size_t col_index, std::vector<double> &scratch,
+                                        const std::vector<int> *rows = nullptr, bool skip_missing = false) const
+        {
+            const Column *column = mode == StorageMode::Columnar ? &cols[col_index] : nullptr;
+            if (column && !rows && column->type() == Column::Type::Double && column->null_count() == 0)
+            {
+                return column->values<double>();
+            }
+            if (skip_missing)
+            {
+                scratch.clear();
+                scratch.reserve(rows ? rows->size() : row_count());
+                if (column && !rows && column->type() == Column::Type::Double)
+                {
+                    const auto &values = column->values<double>();
+                    column->for_each_valid([&](size_t i)
+                                           { scratch.push_back(values[i]); });
+                    return scratch;
+                }
+                if (column && !rows && column->type() == Column::Type::Int)
+                {
+                    const auto &values = column->values<int>();
+                    column->for_each_valid([&](size_t i)
+                                           { scratch.push_back(values[i]); });
+                    return scratch;
+                }
+                const size_t n = rows ? rows->size() : row_count();
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const size_t r = rows ? (*rows)[i] : i;
+                    CellValue cell;
+                    const CellValue &value = column ? (cell = column->get(r)) : this->rows[r][col_index];
+                    if (!(std::holds_alternative<std::string>(value) && is_na_string(std::get<std::string>(value))))
+                    {
+                        scratch.push_back(convert_cell<double>(value));
+                    }
+                }
+                return scratch;
+            }
+            const size_t n = rows ? rows->size() : row_count();
+            scratch.resize(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                scratch[i] = value_as<double>(rows ? (*rows)[i] : i, col_index);
+            }
+            return scratch;
+        }
+
+        /**
+         * @brief Returns two columns' values as doubles for the paired statistics, keeping only the rows where
+         * both cells are present (missing cells are skipped as in doubles).
+         * @param rows Rows to read, in order, or nullptr for all rows.
+         */
+        std::array<std::span<const double>, 2> paired_doubles(size_t col1, size_t col2, std::vector<double> (&scratch)[2],
+                                                              const std::vector<int> *rows = nullptr) const
+        {
+            auto present = [&](size_t r, size_t c)
+            {
+                if (mode == StorageMode::Columnar)
+                {
+                    const Column &column = cols[c];
+                    if (column.is_null(r))
+                        return false;
+                    if (!column.is_text() && column.type() != Column::Type::Mixed)
+                        return true;
+                    CellValue value = column.get(r);
+                    return !(std::holds_alternative<std::string>(value) && is_na_string(std::get<std::string>(value)));
+                }
+                const CellValue &value = this->rows[r][c];
+                return !(std::holds_alternative<std::string>(value) && is_na_string(std::get<std::string>(value)));
+            };
+            const size_t n = rows ? rows->size() : row_count();
+            std::vector<int> both;
+            both.reserve(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const size_t r = rows ? (*rows)[i] : i;
+                if (present(r, col1) && present(r, col2))
+                    both.push_back(static_cast<int>(r));
+            }
+            if (both.size() == n)
+            {
+                return {doubles(col1, scratch[0], rows), doubles(col2, scratch[1], rows)};
+            }
+            return {doubles(col1, scratch[0], &both), doubles(col2, scratch[1], &both)};
+        }
+
+        /**
+         * @brief Returns a column's non-missing values as an owned vector of doubles, for the selection statistics.
+         * @param rows Rows to read, in order, or nullptr for all rows.
+         */
+        std::vector<double> present_doubles(size_t col_index, const std::vector<int> *rows = nullptr) const
+        {
+            std::vector<double> scratch;
+            std::span<const double> values = doubles(col_index, scratch, rows, true);
+            if (values.data() != scratch.data())
+            {
+                return std::vector<double>(values.begin(), values.end());
             }
-            return column_values;
+            return scratch;
         }
 
         /**
-         * @brief Keeps every nth row in the table, removing all others.
-         *
-         * This function modifies the table in-place by retaining only the rows whose
-         * zero-based indices are multiples of n (e.g., for n=2, keeps rows 0, 2, 4, etc.).
-         * If n is 0, the table is cleared. If n is 1, all rows are kept (no change).
-         *
-         * @param n The interval at which to keep rows (must be non-negative).
-         * @throws std::invalid_argument If n is negative.
+         * @brief Statistics over already-extracted column values, shared by CSVTable and TableView.
+         * Each makes one fused pass over the values; the col_name arguments are only used in error messages.
          */
-        void keep_every_nth_row(int n) {
-            if (n < 0) {
-                throw std::invalid_argument("n must be non-negative");
-            }
-            if (n == 0) {
-                rows.clear();
-                return;
+        static double mean_of(std::span<const double> column, std::string_view col_name)
+        {
+            if (column.empty()) {
+                throw std::invalid_argument("Cannot compute mean of empty column: " + std::string(col_name));
             }
-            if (n == 1) {
-                return; // No change needed
+            // Four partial sums, so the additions pipeline and vectorize like the Welford lanes in Moments::of
+            std::array<double, 4> sums{};
+            const size_t full = column.size() / sums.size() * sums.size();
+            for (size_t i = 0; i < full; i += sums.size()) {
+                for (size_t l = 0; l < sums.size(); ++l) {
+                    sums[l] += column[i + l];
+                }
             }
-
-            std::vector<std::vector<CellValue>> new_rows;
-            new_rows.reserve((rows.size() + n - 1) / n); // Reserve space for efficiency
-            for (size_t i = 0; i < rows.size(); i += n) {
-                new_rows.push_back(std::move(rows[i]));
+            double sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+            for (size_t i = full; i < column.size(); ++i) {
+                sum += column[i];
             }
-            rows = std::move(new_rows);
+            return sum / column.size();
         }
 
-    /**
-    * @brief Calculates the mean of a column, assuming double values.
-    *
-    * Computes the arithmetic mean of all values in the specified column. The column
-    * must contain values convertible to double.
-    *
-    * @param col_name The name of the column to compute the mean for.
-    * @return double The mean value of the column.
-    * @throws std::invalid_argument If the column does not exist or is empty.
-    * @throws std::runtime_error If any value cannot be converted to double.
-    */
-    double mean(std::string_view col_name) const {
-        auto column = get_column_as<double>(col_name);
-        if (column.empty()) {
-            throw std::invalid_argument("Cannot compute mean of empty column: " + std::string(col_name));
-        }
-        double sum = 0.0;
-        for (double val : column) {
-            sum += val;
+        static double median_of(std::vector<double> column, std::string_view col_name)
+        {
+            if (column.empty()) {
+                throw std::invalid_argument("Cannot compute median of empty column: " + std::string(col_name));
+            }
+            return select_percentile(column, 0.5);
         }
-        return sum / column.size();
-    }
 
-    /**
-     * @brief Calculates the median of a column, assuming double values.
-     *
-     * Computes the median of all values in the specified column by sorting the values
-     * and finding the middle value (or average of two middle values for even-sized columns).
-     * The column must contain values convertible to double.
-     *
-     * @param col_name The name of the column to compute the median for.
-     * @return double The median value of the column.
-     * @throws std::invalid_argument If the column does not exist or is empty.
-     * @throws std::runtime_error If any value cannot be converted to double.
-     */
-    double median(std::string_view col_name) const {
-        auto column = get_column_as<double>(col_name);
-        if (column.empty()) {
-            throw std::invalid_argument("Cannot compute median of empty column: " + std::string(col_name));
-        }
-        std::sort(column.begin(), column.end());
-        size_t n = column.size();
-        if (n % 2 == 0) {
-            return (column[n / 2 - 1] + column[n / 2]) / 2.0;
-        } else {
-            return column[n / 2];
+        static double standard_deviation_of(std::span<const double> column, std::string_view col_name)
+        {
+            if (column.size() < 2) {
+                throw std::invalid_argument("Cannot compute standard deviation with fewer than 2 values in column: " + std::string(col_name));
+            }
+            return std::sqrt(Moments::of(column).variance());
         }
-    }
 
-    /**
-     * @brief Calculates the standard deviation of a column, assuming double values.
-     *
-     * Computes the sample standard deviation of all values in the specified column.
-     * The column must contain values convertible to double.
-     *
-     * @param col_name The name of the column to compute the standard deviation for.
-     * @return double The standard deviation of the column.
-     * @throws std::invalid_argument If the column does not exist or has fewer than 2 values.
-     * @throws std::runtime_error If any value cannot be converted to double.
-     */
-    double standard_deviation(std::string_view col_name) const {
-        auto column = get_column_as<double>(col_name);
-        if (column.size() < 2) {
-            throw std::invalid_argument("Cannot compute standard deviation with fewer than 2 values in column: " + std::string(col_name));
+        static double correlation_of(std::span<const double> col1, std::span<const double> col2, std::string_view col_name1, std::string_view col_name2)
+        {
+            if (col1.empty()) {
+                throw std::invalid_argument("Cannot compute correlation with empty column: " + std::string(col_name1));
+            }
+            if (col1.size() != col2.size()) {
+                throw std::invalid_argument("Columns must have the same number of rows for correlation");
+            }
+            if (col1.size() < 2) {
+                throw std::invalid_argument("Cannot compute standard deviation with fewer than 2 values in column: " + std::string(col_name1));
+            }
+            // Welford co-moments (means, sums of squared deviations and of cross deviations) of the values
+            // shifted by the first row, which keeps large offsets out of the running deltas
+            const double shift1 = col1[0], shift2 = col2[0];
+            double mean1 = 0.0, mean2 = 0.0, m2_1 = 0.0, m2_2 = 0.0, co_m2 = 0.0;
+            for (size_t i = 0; i < col1.size(); ++i) {
+                const double inv_count = 1.0 / static_cast<double>(i + 1);
+                double x = col1[i] - shift1, y = col2[i] - shift2;
+                double delta1 = x - mean1;
+                double delta2 = y - mean2;
+                mean1 += delta1 * inv_count;
+                mean2 += delta2 * inv_count;
+                m2_1 += delta1 * (x - mean1);
+                m2_2 += delta2 * (y - mean2);
+                co_m2 += delta1 * (y - mean2);
+            }
+            if (m2_1 == 0.0 || m2_2 == 0.0) {
+                throw std::runtime_error("Cannot compute correlation with zero standard deviation in column: " +
+                                         std::string(m2_1 == 0.0 ? col_name1 : col_name2));
+            }
+            return co_m2 / std::sqrt(m2_1 * m2_2);
         }
 
-        // Compute mean from already-extracted column (don't call mean() - it re-extracts!)
-        double sum = 0.0;
-        for (double val : column) {
-            sum += val;
+        static double r_squared_of(std::span<const double> col1, std::span<const double> col2, std::string_view col_name1, std::string_view col_name2)
+        {
+            if (col1.empty()) {
+                throw std::invalid_argument("Cannot compute R-squared with empty column: " + std::string(col_name1));
+            }
+            if (col1.size() != col2.size()) {
+                throw std::invalid_argument("Columns must have the same number of rows for R-squared");
+            }
+            if (col1.size() < 2) {
+                throw std::invalid_argument("Cannot compute R-squared with fewer than 2 values in column: " + std::string(col_name1));
+            }
+            Moments actual;      // ss_tot is actual.m2
+            double ss_res = 0.0; // Residual sum of squares
+            for (size_t i = 0; i < col1.size(); ++i) {
+                double y = col2[i]; // Actual
+                double y_pred = col1[i]; // Predicted
+                actual.add(y);
+                ss_res += (y - y_pred) * (y - y_pred);
+            }
+            if (actual.m2 == 0.0) {
+                throw std::runtime_error("Cannot compute R-squared with zero total variance in column: " + std::string(col_name2));
+            }
+            return 1.0 - (ss_res / actual.m2);
         }
-        double m = sum / column.size();
 
-        // Compute variance
-        double sum_sq_diff = 0.0;
-        for (double val : column) {
-            double diff = val - m;
-            sum_sq_diff += diff * diff;
+        static double rmse_of(std::span<const double> col1, std::span<const double> col2, std::string_view col_name1)
+        {
+            if (col1.empty()) {
+                throw std::invalid_argument("Cannot compute RMSE with empty column: " + std::string(col_name1));
+            }
+            if (col1.size() != col2.size()) {
+                throw std::invalid_argument("Columns must have the same number of rows for RMSE");
+            }
+            if (col1.size() < 2) {
+                throw std::invalid_argument("Cannot compute RMSE with fewer than 2 values in column: " + std::string(col_name1));
+            }
+            double sum_sq_error = 0.0;
+            for (size_t i = 0; i < col1.size(); ++i) {
+                double error = col1[i] - col2[i];
+                sum_sq_error += error * error;
+            }
+            return std::sqrt(sum_sq_error / col1.size());
         }
-        return std::sqrt(sum_sq_diff / (column.size() - 1));
-    }
-
-    /**
-     * @brief Calculates the Pearson correlation coefficient between two columns.
-     *
-     * Computes the correlation between two specified columns, assuming both contain
-     * values convertible to double. The coefficient ranges from -1 to 1, indicating
-     * the strength and direction of the linear relationship.
-     *
-     * @param col_name1 The name of the first column.
-     * @param col_name2 The name of the second column.
-     * @return double The Pearson correlation coefficient.
-     * @throws std::invalid_argument If either column does not exist, is empty, or columns have different sizes.
-     * @throws std::runtime_error If any value cannot be converted to double or if the standard deviation of either column is zero.
-     */
-    double correlation(std::string_view col_name1, std::string_view col_name2) const {
-        auto col1 = get_column_as<double>(col_name1);
-        auto col2 = get_column_as<double>(col_name2);
-        if (col1.empty()) {
-            throw std::invalid_argument("Cannot compute correlation with empty column: " + std::string(col_name1));
-        }
-        if (col1.size() != col2.size()) {
-            throw std::invalid_argument("Columns must have the same number of rows for correlation");
-        }
-        double mean1 = mean(col_name1);
-        double mean2 = mean(col_name2);
-        double std1 = standard_deviation(col_name1);
-        double std2 = standard_deviation(col_name2);
-        if (std1 == 0.0 || std2 == 0.0) {
-            throw std::runtime_error("Cannot compute correlation with zero standard deviation");
-        }
-        double cov = 0.0;
-        for (size_t i = 0; i < col1.size(); ++i) {
-            cov += (col1[i] - mean1) * (col2[i] - mean2);
-        }
-        cov /= col1.size() - 1;
-        return cov / (std1 * std2);
-    }
 
-    /**
-     * @brief Calculates the R-squared (coefficient of determination) between two columns.
-     *
-     * Computes the R-squared value to measure the proportion of variance in the dependent
-     * column (col_name2) explained by the independent column (col_name1). Both columns
-     * must contain values convertible to double.
-     *
-     * @param col_name1 The name of the independent (predictor) column.
-     * @param col_name2 The name of the dependent (actual) column.
-     * @return double The R-squared value, typically between 0 and 1.
-     * @throws std::invalid_argument If either column does not exist, is empty, or columns have different sizes.
-     * @throws std::runtime_error If any value cannot be converted to double or if the variance of the dependent column is zero.
-     */
-    double r_squared(std::string_view col_name1, std::string_view col_name2) const {
-        auto col1 = get_column_as<double>(col_name1); // Predicted values
-        auto col2 = get_column_as<double>(col_name2); // Actual values
-        if (col1.empty()) {
-            throw std::invalid_argument("Cannot compute R-squared with empty column: " + std::string(col_name1));
-        }
-        if (col1.size() != col2.size()) {
-            throw std::invalid_argument("Columns must have the same number of rows for R-squared");
-        }
-        double mean_y = mean(col_name2);
-        double ss_tot = 0.0; // Total sum of squares
-        double ss_res = 0.0; // Residual sum of squares
-        for (size_t i = 0; i < col1.size(); ++i) {
-            double y = col2[i]; // Actual
-            double y_pred = col1[i]; // Predicted
-            ss_tot += (y - mean_y) * (y - mean_y);
-            ss_res += (y - y_pred) * (y - y_pred);
-        }
-        if (ss_tot == 0.0) {
-            throw std::runtime_error("Cannot compute R-squared with zero total variance in column: " + std::string(col_name2));
-        }
-        return 1.0 - (ss_res / ss_tot);
-    }
-
-    /**
-     * @brief Calculates the Root Mean Squared Error (RMSE) between two columns.
-     *
-     * Computes the RMSE to measure the average magnitude of errors between predicted
-     * values in col_name1 and actual values in col_name2. Both columns must contain
-     * values convertible to double.
-     *
-     * @param col_name1 The name of the predicted column.
-     * @param col_name2 The name of the actual column.
-     * @return double The RMSE value.
-     * @throws std::invalid_argument If either column does not exist, is empty, or columns have different sizes.
-     * @throws std::runtime_error If any value cannot be converted to double.
-     */
-    double rmse(std::string_view col_name1, std::string_view col_name2) const {
-        auto col1 = get_column_as<double>(col_name1); // Predicted values
-        auto col2 = get_column_as<double>(col_name2); // Actual values
-        if (col1.empty()) {
-            throw std::invalid_argument("Cannot compute RMSE with empty column: " + std::string(col_name1));
-        }
-        if (col1.size() != col2.size()) {
-            throw std::invalid_argument("Columns must have the same number of rows for RMSE");
-        }
-        double sum_sq_error = 0.0;
-        for (size_t i = 0; i < col1.size(); ++i) {
-            double error = col1[i] - col2[i];
-            sum_sq_error += error * error;
+        static double squared_error_of(std::span<const double> column, std::string_view col_name)
+        {
+            if (column.empty()) {
+                throw std::invalid_argument("Cannot compute squared error of empty column: " + std::string(col_name));
+            }
+            double sum_sq = 0.0;
+            for (double val : column) {
+                sum_sq += val * val;
+            }
+            return sum_sq;
         }
-        return std::sqrt(sum_sq_error / col1.size());
-    }
 
-    /**
-     * @brief Calculates the squared error of a column, assuming a mean of zero.
-     *
-     * Computes the sum of squared values in the specified column, assuming the mean is zero
-     * (i.e., no mean subtraction). The column must contain values convertible to double.
-     *
-     * @param col_name The name of the column to compute the squared error for.
-     * @return double The sum of squared values in the column.
-     * @throws std::invalid_argument If the column does not exist or is empty.
-     * @throws std::runtime_error If any value cannot be converted to double.
-     */
-    double squared_error(std::string_view col_name) const {
-        auto column = get_column_as<double>(col_name);
-        if (column.empty()) {
-            throw std::invalid_argument("Cannot compute squared error of empty column: " + std::string(col_name));
-        }
-        double sum_sq = 0.0;
-        for (double val : column) {
-            sum_sq += val * val;
+        static double percentile_of(std::vector<double> column, std::string_view col_name, double p)
+        {
+            if (p < 0.0 || p > 1.0) {
+                throw std::invalid_argument("Percentile p must be in [0, 1], got: " + std::to_string(p));
+            }
+            if (column.empty()) {
+                throw std::invalid_argument("Cannot compute percentile of empty column: " + std::string(col_name));
+            }
+            return select_percentile(column, p);
         }
-        return sum_sq;
-    }
-
-    /**
-     * @brief Calculates the specified percentile of a column, assuming double values.
-     *
-     * Computes the percentile (e.g., 0.25 for 25th percentile) of the values in the specified
-     * column. The column must contain values convertible to double. Linear interpolation is used
-     * if the percentile falls between two values.
-     *
-     * @param col_name The name of the column to compute the percentile for.
-     * @param p The percentile to compute, in the range [0, 1] (e.g., 0.25 for 25th percentile).
-     * @return double The value at the specified percentile.
-     * @throws std::invalid_argument If the column does not exist, is empty, or p is not in [0, 1].
-     * @throws std::runtime_error If any value cannot be converted to double.
-     */
-    double percentile(std::string_view col_name, double p) const {
-        if (p < 0.0 || p > 1.0) {
-            throw std::invalid_argument("Percentile p must be in [0, 1], got: " + std::to_string(p));
-        }
-        auto column = get_column_as<double>(col_name);
-        if (column.empty()) {
-            throw std::invalid_argument("Cannot compute percentile of empty column: " + std::string(col_name));
-        }
-        std::sort(column.begin(), column.end());
-        size_t n = column.size();
-        double index = p * (n - 1);
-        size_t lower_idx = static_cast<size_t>(std::floor(index));
-        if (lower_idx == n - 1) {
-            return column[n - 1];
-        }
-        double fraction = index - lower_idx;
-        return column[lower_idx] + fraction * (column[lower_idx + 1] - column[lower_idx]);
-    }
 
-    /**
-     * @brief Get the column index for a column name (for caching in hot loops).
-     * @param col_name The column name.
-     * @return int The column index.
-     * @throws std::invalid_argument If the column does not exist.
-     */
-    int get_column_index(std::string_view col_name) const {
-        auto it = col_map.find(col_name);
-        if (it == col_map.end()) {
-            throw std::invalid_argument("Column not found: " + std::string(col_name));
+        /**
+         * @brief Percentile p of non-empty values with linear interpolation, found by selection (nth_element)
+         * rather than a full sort. Reorders values.
+         * @param from Values before this position must be no greater than any after it, as left by an earlier
+         * call with a smaller p (from = the floor of that p * (size - 1)); the selection then skips them.
+         */
+        static double select_percentile(std::vector<double> &values, double p, size_t from = 0)
+        {
+            const size_t n = values.size();
+            double index = p * (n - 1);
+            size_t lower_idx = static_cast<size_t>(std::floor(index));
+            auto lower = values.begin() + lower_idx;
+            std::nth_element(values.begin() + from, lower, values.end());
+            if (lower_idx == n - 1) {
+                return *lower;
+            }
+            double fraction = index - lower_idx;
+            double upper = *std::min_element(lower + 1, values.end());
+            return *lower + fraction * (upper - *lower);
         }
-        return it->second;
-    }
 
-    /**
-     * @brief Get value by row and pre-computed column index (faster than by name).
-     * @tparam T The type to retrieve.
-     * @param row The row index.
-     * @param col_index The column index (from get_column_index).
-     * @return T The value cast to type T.
-     * @throws std::out_of_range If the row index is invalid.
-     */
-    template <ConvertibleToCellValue T>
-    T get_by_index(int row, int col_index) const {
-        if (row < 0 || static_cast<size_t>(row) >= rows.size()) {
-            throw std::out_of_range("Row index out of range");
+        /**
+         * @brief Writes the rows of column col_idx that satisfy a predicate into a selection bitmap.
+         * @param out Bitmap words covering row_count() rows, overwritten.
+         */
+        void select_predicate(const ColumnPredicate &predicate, size_t col_idx, uint64_t *out) const
+        {
+            if (!indexes.empty() && index_select(predicate, col_idx, out))
+            {
+                return;
+            }
+            const size_t n = row_count();
+            if (mode == StorageMode::Columnar && cols[col_idx].type() != Column::Type::Mixed)
+            {
+                const Column &column = cols[col_idx];
+                bool typed = true;
+                switch (column.type())
+                {
+                case Column::Type::Int:
+                    typed = compare_numeric(column.values<int>().data(), n, predicate, out);
+                    break;
+                case Column::Type::Double:
+                    typed = compare_numeric(column.values<double>().data(), n, predicate, out);
+                    break;
+                case Column::Type::Bool:
+                    typed = compare_numeric(column.values<bool>().data(), n, predicate, out);
+                    break;
+                case Column::Type::UInt64:
+                    typed = compare_numeric(column.values<uint64_t>().data(), n, predicate, out);
+                    break;
+                case Column::Type::Categorical:
+                    if (std::holds_alternative<std::string>(predicate.value))
+                    {
+                        compare_codes(column, std::get<std::string>(predicate.value), predicate.op, out);
+                    }
+                    else
+                    {
+                        typed = false;
+                    }
+                    break;
+                default:
+                    if (std::holds_alternative<std::string>(predicate.value))
+                    {
+                        compare_block(column.values<std::string>().data(), n, std::get<std::string>(predicate.value), predicate.op, out);
+                    }
+                    else
+                    {
+                        typed = false;
+                    }
+                    break;
+                }
+                if (!typed)
+                {
+                    // The constant is of the other kind (string vs number), so nothing matches
+                    std::fill(out, out + (n + 63) / 64, uint64_t(0));
+                    return;
+                }
+                // Missing cells never match
+                const auto &validity = column.validity();
+                for (size_t w = 0; w < validity.size(); ++w)
+                {
+                    out[w] &= validity[w];
+                }
+                return;
+            }
+            for (size_t w = 0; w * 64 < n; ++w)
+            {
+                uint64_t bits = 0;
+                const size_t base = w * 64;
+                const size_t count = std::min<size_t>(64, n - base);
+                for (size_t j = 0; j < count; ++j)
+                {
+                    const bool match = mode == StorageMode::Columnar ? cell_matches(cols[col_idx].get(base + j), predicate)
+                                                                     : cell_matches(rows[base + j][col_idx], predicate);
+                    bits |= uint64_t(match) << j;
+                }
+                out[w] = bits;
+            }
         }
-        return convert_cell<T>(rows[row][col_index]);
-    }
 
-    /**
-     * @brief Extract multiple columns at once to amortize map lookups.
-     * @tparam T The type to extract.
-     * @param col_names The column names to extract.
-     * @return std::vector<std::vector<T>> A vector of column vectors.
-     * @throws std::invalid_argument If any column does not exist.
-     */
-    template <ConvertibleToCellValue T>
-    std::vector<std::vector<T>> get_columns_as(const std::vector<std::string_view>& col_names) const {
-        // First, resolve all column indices
-        std::vector<int> col_indices;
-        col_indices.reserve(col_names.size());
-        for (const auto& col_name : col_names) {
-            auto it = col_map.find(col_name);
-            if (it == col_map.end()) {
-                throw std::invalid_argument("Column not found: " + std::string(col_name));
+        /**
+         * @brief Compares a typed numeric buffer with a predicate constant, using the same rules as
+         * compare_values (exact integer comparison, otherwise double).
+         * @return false if the constant is not a number.
+         */
+        template <typename V>
+        static bool compare_numeric(const V *data, size_t n, const ColumnPredicate &predicate, uint64_t *out)
+        {
+            const CellValue &value = predicate.value;
+            if (std::holds_alternative<std::string>(value))
+            {
+                return false;
+            }
+            if (std::is_floating_point_v<V> || std::holds_alternative<double>(value))
+            {
+                const double constant = std::visit([](const auto &x) -> double
+                                                   {
+                                                       if constexpr (std::is_same_v<std::decay_t<decltype(x)>, std::string>)
+                                                           return 0.0;
+                                                       else
+                                                           return static_cast<double>(x); },
+                                                   value);
+                compare_block(data, n, constant, predicate.op, out);
+                return true;
+            }
+            // Integer constant against an integer column: pick a comparison type that is exact for both
+            int64_t signed_constant = 0;
+            bool fits_signed = true;
+            if (std::holds_alternative<uint64_t>(value))
+            {
+                uint64_t u = std::get<uint64_t>(value);
+                fits_signed = std::in_range<int64_t>(u);
+                signed_constant = static_cast<int64_t>(u);
+            }
+            else
+            {
+                signed_constant = std::holds_alternative<int>(value) ? std::get<int>(value) : int64_t(std::get<bool>(value));
+            }
+            if constexpr (std::is_same_v<V, uint64_t>)
+            {
+                if (signed_constant >= 0 || !fits_signed)
+                {
+                    compare_block(data, n, static_cast<uint64_t>(signed_constant), predicate.op, out);
+                }
+                else
+                {
+                    // Negative constant: every unsigned value is greater
+                    compare_block(data, n, static_cast<double>(signed_constant), predicate.op, out);
+                }
+            }
+            else if (fits_signed)
+            {
+                compare_block(data, n, signed_constant, predicate.op, out);
             }
-            col_indices.push_back(it->second);
+            else
+            {
+                compare_block(data, n, static_cast<double>(std::get<uint64_t>(value)), predicate.op, out);
+            }
+            return true;
         }
 
-        // Extract all columns
-        std::vector<std::vector<T>> result(col_names.size());
-        for (size_t i = 0; i < col_names.size(); ++i) {
-            result[i].reserve(rows.size());
+        /**
+         * @brief Sets bit i of out when data[i] op constant holds, for i in [0, n).
+         *
+         * The comparison is chosen once per call and the inner loop is branch-free, so it vectorizes.
+         */
+        template <typename V, typename C>
+        static void compare_block(const V *data, size_t n, const C &constant, CompareOp op, uint64_t *out)
+        {
+            switch (op)
+            {
+            case CompareOp::Eq: compare_block(data, n, constant, std::equal_to<>(), out); break;
+            case CompareOp::Ne: compare_block(data, n, constant, std::not_equal_to<>(), out); break;
+            case CompareOp::Lt: compare_block(data, n, constant, std::less<>(), out); break;
+            case CompareOp::Le: compare_block(data, n, constant, std::less_equal<>(), out); break;
+            case CompareOp::Gt: compare_block(data, n, constant, std::greater<>(), out); break;
+            case CompareOp::Ge: compare_block(data, n, constant, std::greater_equal<>(), out); break;
+            }
         }
 
-        for (const auto& row : rows) {
-            for (size_t i = 0; i < col_indices.size(); ++i) {
-                result[i].push_back(convert_cell<T>(row[col_indices[i]]));
+        template <typename V, typename C, typename Compare>
+        static void compare_block(const V *data, size_t n, const C &constant, Compare compare, uint64_t *out)
+        {
+            for (size_t w = 0; w * 64 < n; ++w)
+            {
+                const size_t base = w * 64;
+                const size_t count = std::min<size_t>(64, n - base);
+                uint64_t bits = 0;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    bits |= uint64_t(compare(data[base + j], constant)) << j;
+                }
+                out[w] = bits;
             }
         }
 
-        return result;
-    }
+        /**
+         * @brief Sets bit i of out when cell i of a Categorical column op constant holds. Eq and Ne compare
+         * codes with the constant's code; other operators compare each category once and look rows up by code.
+         */
+        static void compare_codes(const Column &column, const std::string &constant, CompareOp op, uint64_t *out)
+        {
+            const auto &codes = column.codes();
+            const size_t n = codes.size();
+            if (op == CompareOp::Eq || op == CompareOp::Ne)
+            {
+                // A value outside the dictionary gets a code no cell has
+                const uint32_t code = column.code_of(constant).value_or(std::numeric_limits<uint32_t>::max());
+                compare_block(codes.data(), n, code, op, out);
+                return;
+            }
+            const auto &categories = column.categories();
+            if (categories.empty())
+            {
+                std::fill(out, out + (n + 63) / 64, uint64_t(0));
+                return;
+            }
+            std::vector<uint64_t> matches((categories.size() + 63) / 64);
+            compare_block(categories.data(), categories.size(), constant, op, matches.data());
+            for (size_t w = 0; w * 64 < n; ++w)
+            {
+                const size_t base = w * 64;
+                const size_t count = std::min<size_t>(64, n - base);
+                uint64_t bits = 0;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    const uint32_t code = codes[base + j];
+                    bits |= ((matches[code >> 6] >> (code & 63)) & 1) << j;
+                }
+                out[w] = bits;
+            }
+        }
 
-    /**
-     * @brief Retrieves a Row object for the specified row index.
-     *
-     * Returns a Row object that allows access to the row's values by column name.
-     *
-     * @param index The zero-based index of the row.
-     * @return Row A Row object representing the specified row.
-     * @throws std::out_of_range If the index is out of range.
-     */
-    Row get_row(size_t index)  {
-        if (index >= rows.size()) {
-            throw std::out_of_range("Row index out of range: " + std::to_string(index));
+        /**
+         * @brief Calls f with every cell of a column, in row order, in either storage layout.
+         */
+        template <typename F>
+        void for_each_cell(size_t col_idx, F &&f) const
+        {
+            for_each_cell(col_idx, 0, row_count(), std::forward<F>(f));
         }
-        return Row(this, index);
-    }
 
-    /**
-     * @brief Removes rows from the table that satisfy a predicate.
-     *
-     * Iterates over the table's rows and removes those for which the provided predicate
-     * returns true. The predicate takes a Row object representing the current row.
-     *
-     * @param predicate A function that takes a Row object and returns true if the row
-     *                  should be removed.
-     */
-    void remove_rows_if(std::function<bool(const Row&)> predicate) {
-        std::vector<std::vector<CellValue>> new_rows;
-        new_rows.reserve(rows.size()); // Reserve space for efficiency
-        for (size_t i = 0; i < rows.size(); ++i) {
-            Row row(this, i);
-            if (!predicate(row)) {
-                new_rows.push_back(std::move(rows[i]));
+        /**
+         * @brief Calls f with each cell of a column in rows [begin, end).
+         */
+        template <typename F>
+        void for_each_cell(size_t col_idx, size_t begin, size_t end, F &&f) const
+        {
+            if (mode == StorageMode::Columnar)
+            {
+                const Column &column = cols[col_idx];
+                for (size_t r = begin; r < end; ++r)
+                {
+                    f(column.get(r));
+                }
+                return;
+            }
+            for (size_t r = begin; r < end; ++r)
+            {
+                f(rows[r][col_idx]);
             }
         }
-        rows = std::move(new_rows);
-    }
-    
-    private:
-        std::vector<std::string> col_names;
-        std::unordered_map<std::string, int, string_hash, string_equal> col_map;
-        std::vector<std::vector<CellValue>> rows;
 
         /**
-         * @brief Converts an Arrow array value to a CellValue.
-         * @param array The Arrow array.
-         * @param row_idx The row index.
-         * @return CellValue The converted value.
+         * @brief Checks whether a column has at most max_ratio distinct non-empty values per non-empty value.
+         * @param col_idx The column index.
+         * @param max_ratio The largest distinct/non-empty ratio that counts as low cardinality.
+         * @param max_rows Only the first max_rows rows are sampled.
          */
-        static CellValue arrow_value_to_cell(const std::shared_ptr<arrow::Array>& array, size_t row_idx)
+        bool low_cardinality(size_t col_idx, double max_ratio, size_t max_rows) const
         {
-            if (array->IsNull(row_idx)) {
-                return std::string("");
-            }
+            std::unordered_set<std::string> distinct;
+            size_t values = 0;
+            for_each_cell(col_idx, 0, std::min(max_rows, row_count()), [&](const CellValue &cell)
+            {
+                std::string text = cell_to_string(cell);
+                if (!text.empty())
+                {
+                    ++values;
+                    distinct.insert(std::move(text));
+                }
+            });
+            return values > 0 && distinct.size() <= max_ratio * values;
+        }
 
-            switch (array->type_id()) {
+        /**
+         * @brief Calls f once with a typed accessor for an Arrow array, so per-row loops avoid type dispatch.
+         * @param array The Arrow array.
+         * @param f Called with a callable mapping a row index to bool, int, uint64_t, double or std::string_view
+         *          (STRING, and DICTIONARY arrays of strings). INT64 and unsupported types map to CellValue:
+         *          non-negative INT64 values become uint64_t, negative ones int, and unsupported types an empty string.
+         */
+        template <typename F>
+        static void visit_arrow_values(const arrow::Array& array, F&& f)
+        {
+            switch (array.type_id()) {
                 case arrow::Type::BOOL: {
-                    auto bool_array = std::static_pointer_cast<arrow::BooleanArray>(array);
-                    return bool_array->Value(row_idx);
-                }
-                case arrow::Type::INT8:
-                case arrow::Type::INT16:
-                case arrow::Type::INT32: {
-                    auto int_array = std::static_pointer_cast<arrow::Int32Array>(array);
-                    return static_cast<int>(int_array->Value(row_idx));
+                    const auto& bools = static_cast<const arrow::BooleanArray&>(array);
+                    f([&bools](int64_t i) { return bools.Value(i); });
+                    break;
                 }
+                case arrow::Type::INT8: visit_arrow_numeric<arrow::Int8Array, int>(array, f); break;
+                case arrow::Type::INT16: visit_arrow_numeric<arrow::Int16Array, int>(array, f); break;
+                case arrow::Type::INT32: visit_arrow_numeric<arrow::Int32Array, int>(array, f); break;
                 case arrow::Type::INT64: {
-                    auto int64_array = std::static_pointer_cast<arrow::Int64Array>(array);
-                    int64_t val = int64_array->Value(row_idx);
-                    if (val >= 0) {
-                        return static_cast<uint64_t>(val);
-                    } else {
+                    const int64_t* values = static_cast<const arrow::Int64Array&>(array).raw_values();
+                    f([values](int64_t i) -> CellValue {
+                        int64_t val = values[i];
+                        if (val >= 0) {
+                            return static_cast<uint64_t>(val);
+                        }
                         return static_cast<int>(val);
+                    });
+                    break;
+                }
+                case arrow::Type::UINT8: visit_arrow_numeric<arrow::UInt8Array, uint64_t>(array, f); break;
+                case arrow::Type::UINT16: visit_arrow_numeric<arrow::UInt16Array, uint64_t>(array, f); break;
+                case arrow::Type::UINT32: visit_arrow_numeric<arrow::UInt32Array, uint64_t>(array, f); break;
+                case arrow::Type::UINT64: visit_arrow_numeric<arrow::UInt64Array, uint64_t>(array, f); break;
+                case arrow::Type::FLOAT: visit_arrow_numeric<arrow::FloatArray, double>(array, f); break;
+                case arrow::Type::DOUBLE: visit_arrow_numeric<arrow::DoubleArray, double>(array, f); break;
+                case arrow::Type::STRING: {
+                    const auto& strings = static_cast<const arrow::StringArray&>(array);
+                    f([&strings](int64_t i) { return strings.GetView(i); });
+                    break;
+                }
+                case arrow::Type::DICTIONARY: {
+                    const auto& encoded = static_cast<const arrow::DictionaryArray&>(array);
+                    if (encoded.dictionary()->type_id() == arrow::Type::STRING) {
+                        const auto& strings = static_cast<const arrow::StringArray&>(*encoded.dictionary());
+                        f([&encoded, &strings](int64_t i) { return strings.GetView(encoded.GetValueIndex(i)); });
+                        break;
                     }
+                    f([](int64_t) { return CellValue(std::string("")); });
+                    break;
                 }
+                default: {
+                    // For unsupported types, convert to string
+                    f([](int64_t) { return CellValue(std::string("")); });
+                    break;
+                }
+            }
+        }
+
+        template <typename ArrayType, typename T, typename F>
+        static void visit_arrow_numeric(const arrow::Array& array, F& f)
+        {
+            const auto* values = static_cast<const ArrayType&>(array).raw_values();
+            f([values](int64_t i) { return static_cast<T>(values[i]); });
+        }
+
+        template <typename V>
+        static CellValue arrow_cell(V value)
+        {
+            if constexpr (std::is_same_v<V, std::string_view>) {
+                return std::string(value);
+            } else {
+                return CellValue(value);
+            }
+        }
+
+        /**
+         * @brief Appends an INT32, UINT64 or DOUBLE chunk to a column of the same type by copying its value
+         * buffer and validity bitmap in bulk.
+         * @return false If the chunk holds another type, leaving the column unchanged.
+         */
+        static bool append_primitive_chunk(Column& column, const arrow::Array& array)
+        {
+            const uint8_t* bitmap = array.null_count() > 0 ? array.null_bitmap_data() : nullptr;
+            const auto length = static_cast<size_t>(array.length());
+            const auto offset = static_cast<size_t>(array.offset());
+            if (array.type_id() == arrow::Type::INT32 && column.type() == Column::Type::Int) {
+                column.append_values(static_cast<const arrow::Int32Array&>(array).raw_values(), length, bitmap, offset);
+            } else if (array.type_id() == arrow::Type::UINT64 && column.type() == Column::Type::UInt64) {
+                column.append_values(static_cast<const arrow::UInt64Array&>(array).raw_values(), length, bitmap, offset);
+            } else if (array.type_id() == arrow::Type::DOUBLE && column.type() == Column::Type::Double) {
+                column.append_values(static_cast<const arrow::DoubleArray&>(array).raw_values(), length, bitmap, offset);
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Converts every chunk of an Arrow column into a typed Column.
+         */
+        static Column arrow_to_column(const arrow::ChunkedArray& chunked)
+        {
+            Column column(Column::Type::String);
+            switch (chunked.type()->id()) {
+                case arrow::Type::BOOL: column = Column(Column::Type::Bool); break;
+                case arrow::Type::INT8:
+                case arrow::Type::INT16:
+                case arrow::Type::INT32: column = Column(Column::Type::Int); break;
                 case arrow::Type::UINT8:
                 case arrow::Type::UINT16:
                 case arrow::Type::UINT32:
-                case arrow::Type::UINT64: {
-                    auto uint64_array = std::static_pointer_cast<arrow::UInt64Array>(array);
-                    return uint64_array->Value(row_idx);
-                }
+                case arrow::Type::UINT64: column = Column(Column::Type::UInt64); break;
                 case arrow::Type::FLOAT:
-                case arrow::Type::DOUBLE: {
-                    auto double_array = std::static_pointer_cast<arrow::DoubleArray>(array);
-                    return double_array->Value(row_idx);
-                }
-                case arrow::Type::STRING: {
-                    auto string_array = std::static_pointer_cast<arrow::StringArray>(array);
-                    return std::string(string_array->GetView(row_idx));
+                case arrow::Type::DOUBLE: column = Column(Column::Type::Double); break;
+                case arrow::Type::DICTIONARY: column = Column(Column::Type::Categorical); break;
+                default: break; // strings; INT64 retypes on its first value
+            }
+            column.reserve(static_cast<size_t>(chunked.length()));
+            for (const auto& chunk : chunked.chunks()) {
+                const arrow::Array& array = *chunk;
+                const int64_t length = array.length();
+                const bool has_nulls = array.null_count() > 0;
+                if (array.type_id() == arrow::Type::DICTIONARY &&
+                    static_cast<const arrow::DictionaryArray&>(array).dictionary()->type_id() == arrow::Type::STRING) {
+                    // Keep the encoding: intern the chunk's dictionary once, then copy codes
+                    const auto& encoded = static_cast<const arrow::DictionaryArray&>(array);
+                    const auto& strings = static_cast<const arrow::StringArray&>(*encoded.dictionary());
+                    std::vector<std::string_view> values;
+                    for (int64_t k = 0; k < strings.length(); ++k) {
+                        values.push_back(strings.GetView(k));
+                    }
+                    column.append_encoded(values, static_cast<size_t>(length), [&](size_t i) -> std::optional<size_t> {
+                        if (has_nulls && array.IsNull(static_cast<int64_t>(i))) {
+                            return std::nullopt;
+                        }
+                        return static_cast<size_t>(encoded.GetValueIndex(static_cast<int64_t>(i)));
+                    });
+                    continue;
                 }
-                default: {
-                    // For unsupported types, convert to string
-                    return std::string("");
+                if (append_primitive_chunk(column, array)) {
+                    continue;
                 }
+                visit_arrow_values(array, [&](auto value) {
+                    using V = decltype(value(0));
+                    for (int64_t i = 0; i < length; ++i) {
+                        if (has_nulls && array.IsNull(i)) {
+                            column.push_null();
+                        } else if constexpr (std::is_same_v<V, CellValue>) {
+                            column.push_back(value(i));
+                        } else if constexpr (std::is_same_v<V, std::string_view>) {
+                            column.push_back_value(std::string(value(i)));
+                        } else {
+                            column.push_back_value(value(i));
+                        }
+                    }
+                });
             }
+            return column;
         }
 
         /**
-         * @brief Builds an Arrow column (field and array) from a CSVTable column.
-         * @param col_idx The column index.
-         * @return A pair of Arrow Field and Array.
+         * @brief Copies rows [begin, end) of an Arrow column into column col_idx of rows[row_offset + begin, ...).
+         * @param chunk_starts The first row of each chunk of the column.
          */
-        std::pair<std::shared_ptr<arrow::Field>, std::shared_ptr<arrow::Array>>
-        build_arrow_column(size_t col_idx) const
+        void fill_rows_from_arrow(const arrow::ChunkedArray& chunked, const std::vector<int64_t>& chunk_starts,
+                                  size_t col_idx, size_t begin, size_t end, size_t row_offset)
         {
-            const std::string& col_name = col_names[col_idx];
+            // Find the chunk containing begin, then walk forward through the chunks
+            size_t chunk_idx = std::upper_bound(chunk_starts.begin(), chunk_starts.end(), static_cast<int64_t>(begin)) - chunk_starts.begin() - 1;
+            size_t r = begin;
+            for (; r < end && chunk_idx < chunk_starts.size(); ++chunk_idx) {
+                const arrow::Array& array = *chunked.chunk(static_cast<int>(chunk_idx));
+                const int64_t first = static_cast<int64_t>(r) - chunk_starts[chunk_idx];
+                const int64_t last = std::min<int64_t>(array.length(), static_cast<int64_t>(end) - chunk_starts[chunk_idx]);
+                const bool has_nulls = array.null_count() > 0;
+                visit_arrow_values(array, [&](auto value) {
+                    for (int64_t i = first; i < last; ++i, ++r) {
+                        auto& cell = rows[row_offset + r][col_idx];
+                        if (has_nulls && array.IsNull(i)) {
+                            cell = std::string("");
+                        } else {
+                            cell = arrow_cell(value(i));
+                        }
+                    }
+                });
+            }
+        }
 
-            // Determine the column type by examining the first non-empty value
-            arrow::Type::type arrow_type = arrow::Type::STRING;
+        /**
+         * @brief Picks the narrowest Arrow type that holds every non-empty value of a column.
+         *
+         * Typed columnar columns map straight to their type. Otherwise the cells are scanned: ints and
+         * doubles together give DOUBLE, and any other mix gives STRING, so no value is written as a null.
+         * @param col_idx The column index.
+         * @return arrow::Type::type INT32, UINT64, DOUBLE, BOOL, STRING, or DICTIONARY for a categorical column.
+         */
+        arrow::Type::type detect_arrow_type(size_t col_idx) const
+        {
+            if (mode == StorageMode::Columnar) {
+                switch (cols[col_idx].type()) {
+                    case Column::Type::Int: return arrow::Type::INT32;
+                    case Column::Type::UInt64: return arrow::Type::UINT64;
+                    case Column::Type::Double: return arrow::Type::DOUBLE;
+                    case Column::Type::Bool: return arrow::Type::BOOL;
+                    case Column::Type::String: return arrow::Type::STRING;
+                    case Column::Type::Categorical: return arrow::Type::DICTIONARY;
+                    default: break;
+                }
+            }
 
-            for (const auto& row : rows) {
-                const auto& cell = row[col_idx];
+            std::optional<arrow::Type::type> arrow_type;
+            auto widen = [&](arrow::Type::type type) {
+                if (!arrow_type || *arrow_type == type) {
+                    arrow_type = type;
+                } else if ((*arrow_type == arrow::Type::INT32 && type == arrow::Type::DOUBLE) ||
+                           (*arrow_type == arrow::Type::DOUBLE && type == arrow::Type::INT32)) {
+                    arrow_type = arrow::Type::DOUBLE;
+                } else {
+                    arrow_type = arrow::Type::STRING;
+                }
+            };
+            for (size_t r = 0; r < row_count() && arrow_type != arrow::Type::STRING; ++r) {
+                const CellValue cell = cell_at(r, col_idx);
                 if (std::holds_alternative<int>(cell)) {
-                    arrow_type = arrow::Type::INT32;
-                    break;
+                    widen(arrow::Type::INT32);
                 } else if (std::holds_alternative<uint64_t>(cell)) {
-                    arrow_type = arrow::Type::UINT64;
-                    break;
+                    widen(arrow::Type::UINT64);
                 } else if (std::holds_alternative<double>(cell)) {
-                    arrow_type = arrow::Type::DOUBLE;
-                    break;
+                    widen(arrow::Type::DOUBLE);
                 } else if (std::holds_alternative<bool>(cell)) {
-                    arrow_type = arrow::Type::BOOL;
-                    break;
-                } else if (std::holds_alternative<std::string>(cell)) {
-                    auto str = std::get<std::string>(cell);
-                    if (!str.empty()) {
-                        arrow_type = arrow::Type::STRING;
-                        break;
-                    }
+                    widen(arrow::Type::BOOL);
+                } else if (!std::get<std::string>(cell).empty()) {
+                    widen(arrow::Type::STRING);
                 }
             }
+            return arrow_type.value_or(arrow::Type::STRING);
+        }
+
+        /**
+         * @brief Builds an Arrow column of a given type. Empty cells are written as nulls.
+         * @param col_idx The column index.
+         * @param arrow_type The target type: INT32, UINT64, DOUBLE, BOOL, STRING or DICTIONARY (of strings).
+         * @param begin The first row to convert.
+         * @param end One past the last row to convert.
+         * @return A pair of Arrow Field and Array.
+         * @throws std::runtime_error If a non-empty cell does not fit the type (an int does fit DOUBLE).
+         */
+        std::pair<std::shared_ptr<arrow::Field>, std::shared_ptr<arrow::Array>>
+        build_arrow_column(size_t col_idx, arrow::Type::type arrow_type, size_t begin, size_t end) const
+        {
+            const std::string& col_name = col_names[col_idx];
+
+            if (mode == StorageMode::Columnar && cols[col_idx].type() != Column::Type::Mixed &&
+                arrow_type == detect_arrow_type(col_idx)) {
+                return build_arrow_column_typed(col_idx, begin, end);
+            }
 
             // Build the array based on the determined type
             std::shared_ptr<arrow::Field> field;
             std::shared_ptr<arrow::Array> array;
 
+            // Appends a null for an empty cell; any other cell that does not fit would be lost, so it is an error
+            size_t row = begin;
+            auto append_null = [&](auto& builder, const CellValue& cell, const char* type_name) {
+                if (!std::holds_alternative<std::string>(cell) || !std::get<std::string>(cell).empty()) {
+                    throw std::runtime_error("Cannot write \"" + cell_to_string(cell) + "\" at row " + std::to_string(row) +
+                                             " of column " + col_name + " as Parquet " + type_name);
+                }
+                PARQUET_THROW_NOT_OK(builder.AppendNull());
+            };
+
             switch (arrow_type) {
                 case arrow::Type::BOOL: {
                     arrow::BooleanBuilder builder;
-                    for (const auto& row : rows) {
-                        const auto& cell = row[col_idx];
+                    for_each_cell(col_idx, begin, end, [&](const CellValue& cell) {
                         if (std::holds_alternative<bool>(cell)) {
                             PARQUET_THROW_NOT_OK(builder.Append(std::get<bool>(cell)));
                         } else {
-                            PARQUET_THROW_NOT_OK(builder.AppendNull());
+                            append_null(builder, cell, "boolean");
                         }
-                    }
+                        ++row;
+                    });
                     PARQUET_THROW_NOT_OK(builder.Finish(&array));
                     field = arrow::field(col_name, arrow::boolean());
                     break;
                 }
                 case arrow::Type::INT32: {
                     arrow::Int32Builder builder;
-                    for (const auto& row : rows) {
-                        const auto& cell = row[col_idx];
+                    for_each_cell(col_idx, begin, end, [&](const CellValue& cell) {
                         if (std::holds_alternative<int>(cell)) {
                             PARQUET_THROW_NOT_OK(builder.Append(std::get<int>(cell)));
                         } else {
-                            PARQUET_THROW_NOT_OK(builder.AppendNull());
+                            append_null(builder, cell, "int32");
                         }
-                    }
+                        ++row;
+                    });
                     PARQUET_THROW_NOT_OK(builder.Finish(&array));
                     field = arrow::field(col_name, arrow::int32());
                     break;
                 }
                 case arrow::Type::UINT64: {
                     arrow::UInt64Builder builder;
-                    for (const auto& row : rows) {
-                        const auto& cell = row[col_idx];
+                    for_each_cell(col_idx, begin, end, [&](const CellValue& cell) {
                         if (std::holds_alternative<uint64_t>(cell)) {
                             PARQUET_THROW_NOT_OK(builder.Append(std::get<uint64_t>(cell)));
                         } else {
-                            PARQUET_THROW_NOT_OK(builder.AppendNull());
+                            append_null(builder, cell, "uint64");
                         }
-                    }
+                        ++row;
+                    });
                     PARQUET_THROW_NOT_OK(builder.Finish(&array));
                     field = arrow::field(col_name, arrow::uint64());
                     break;
                 }
                 case arrow::Type::DOUBLE: {
                     arrow::DoubleBuilder builder;
-                    for (const auto& row : rows) {
-                        const auto& cell = row[col_idx];
+                    for_each_cell(col_idx, begin, end, [&](const CellValue& cell) {
                         if (std::holds_alternative<double>(cell)) {
                             PARQUET_THROW_NOT_OK(builder.Append(std::get<double>(cell)));
                         } else if (std::holds_alternative<int>(cell)) {
                             PARQUET_THROW_NOT_OK(builder.Append(static_cast<double>(std::get<int>(cell))));
                         } else {
-                            PARQUET_THROW_NOT_OK(builder.AppendNull());
+                            append_null(builder, cell, "double");
                         }
-                    }
+                        ++row;
+                    });
                     PARQUET_THROW_NOT_OK(builder.Finish(&array));
                     field = arrow::field(col_name, arrow::float64());
                     break;
                 }
+                case arrow::Type::DICTIONARY: {
+                    // A batch whose column is not categorical, written into a dictionary-typed file
+                    std::unordered_map<std::string, int32_t, string_hash, string_equal> codes;
+                    arrow::StringBuilder dictionary;
+                    arrow::Int32Builder indices;
+                    for_each_cell(col_idx, begin, end, [&](const CellValue& cell) {
+                        std::string str_value = cell_to_string(cell);
+                        if (str_value.empty()) {
+                            PARQUET_THROW_NOT_OK(indices.AppendNull());
+                            return;
+                        }
+                        auto [it, inserted] = codes.try_emplace(std::move(str_value), static_cast<int32_t>(codes.size()));
+                        if (inserted) {
+                            PARQUET_THROW_NOT_OK(dictionary.Append(it->first));
+                        }
+                        PARQUET_THROW_NOT_OK(indices.Append(it->second));
+                    });
+                    std::tie(field, array) = dictionary_arrow_column(col_name, indices, dictionary);
+                    break;
+                }
                 default: {
                     arrow::StringBuilder builder;
-                    for (const auto& row : rows) {
-                        const auto& cell = row[col_idx];
+                    for_each_cell(col_idx, begin, end, [&](const CellValue& cell) {
                         std::string str_value = cell_to_string(cell);
-                        PARQUET_THROW_NOT_OK(builder.Append(str_value));
-                    }
+                        PARQUET_THROW_NOT_OK(str_value.empty() ? builder.AppendNull() : builder.Append(str_value));
+                    });
                     PARQUET_THROW_NOT_OK(builder.Finish(&array));
                     field = arrow::field(col_name, arrow::utf8());
                     break;
@@ -2463,6 +11619,99 @@ namespace m2
 
             return {field, array};
         }
+
+        /**
+         * @brief Builds an Arrow column straight from a typed columnar buffer, without per-cell dispatch.
+         * @param col_idx The column index; its storage must not be Mixed.
+         * @param begin The first row to convert.
+         * @param end One past the last row to convert.
+         * @return A pair of Arrow Field and Array.
+         */
+        std::pair<std::shared_ptr<arrow::Field>, std::shared_ptr<arrow::Array>>
+        build_arrow_column_typed(size_t col_idx, size_t begin, size_t end) const
+        {
+            const std::string& col_name = col_names[col_idx];
+            const Column& column = cols[col_idx];
+            const int64_t length = static_cast<int64_t>(end - begin);
+
+            // The validity words are Arrow's validity bitmap (least significant bit first, 1 = valid), so the
+            // builders copy them from bit begin rather than from one byte per cell
+            static_assert(std::endian::native == std::endian::little, "Validity words are read as bytes");
+            const uint8_t* bitmap = column.null_count() == 0 ? nullptr : reinterpret_cast<const uint8_t*>(column.validity().data());
+            const auto offset = static_cast<int64_t>(begin);
+
+            std::shared_ptr<arrow::Array> array;
+            std::shared_ptr<arrow::Field> field;
+            switch (column.type()) {
+                case Column::Type::Bool: {
+                    arrow::BooleanBuilder builder;
+                    PARQUET_THROW_NOT_OK(builder.AppendValues(column.values<bool>().data() + begin, length, bitmap, offset));
+                    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+                    field = arrow::field(col_name, arrow::boolean());
+                    break;
+                }
+                case Column::Type::Int: {
+                    arrow::Int32Builder builder;
+                    PARQUET_THROW_NOT_OK(builder.AppendValues(column.values<int>().data() + begin, length, bitmap, offset));
+                    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+                    field = arrow::field(col_name, arrow::int32());
+                    break;
+                }
+                case Column::Type::UInt64: {
+                    arrow::UInt64Builder builder;
+                    PARQUET_THROW_NOT_OK(builder.AppendValues(column.values<uint64_t>().data() + begin, length, bitmap, offset));
+                    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+                    field = arrow::field(col_name, arrow::uint64());
+                    break;
+                }
+                case Column::Type::Double: {
+                    arrow::DoubleBuilder builder;
+                    PARQUET_THROW_NOT_OK(builder.AppendValues(column.values<double>().data() + begin, length, bitmap, offset));
+                    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+                    field = arrow::field(col_name, arrow::float64());
+                    break;
+                }
+                case Column::Type::Categorical: {
+                    arrow::StringBuilder dictionary;
+                    for (const std::string& value : column.categories()) {
+                        PARQUET_THROW_NOT_OK(dictionary.Append(value));
+                    }
+                    arrow::Int32Builder indices;
+                    static_assert(sizeof(int32_t) == sizeof(uint32_t));
+                    PARQUET_THROW_NOT_OK(indices.AppendValues(reinterpret_cast<const int32_t*>(column.codes().data()) + begin,
+                                                              length, bitmap, offset));
+                    std::tie(field, array) = dictionary_arrow_column(col_name, indices, dictionary);
+                    break;
+                }
+                default: {
+                    arrow::StringBuilder builder;
+                    const auto& values = column.values<std::string>();
+                    for (size_t i = begin; i < end; ++i) {
+                        PARQUET_THROW_NOT_OK(column.is_null(i) ? builder.AppendNull() : builder.Append(values[i]));
+                    }
+                    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+                    field = arrow::field(col_name, arrow::utf8());
+                    break;
+                }
+            }
+            return {field, array};
+        }
+
+        /**
+         * @brief Finishes an Arrow dictionary<int32, utf8> column from its index and dictionary builders.
+         */
+        static std::pair<std::shared_ptr<arrow::Field>, std::shared_ptr<arrow::Array>>
+        dictionary_arrow_column(const std::string& col_name, arrow::Int32Builder& indices, arrow::StringBuilder& dictionary)
+        {
+            std::shared_ptr<arrow::Array> index_array;
+            std::shared_ptr<arrow::Array> dictionary_array;
+            PARQUET_THROW_NOT_OK(indices.Finish(&index_array));
+            PARQUET_THROW_NOT_OK(dictionary.Finish(&dictionary_array));
+            auto type = arrow::dictionary(arrow::int32(), arrow::utf8());
+            std::shared_ptr<arrow::Array> array;
+            PARQUET_ASSIGN_OR_THROW(array, arrow::DictionaryArray::FromArrays(type, index_array, dictionary_array));
+            return {arrow::field(col_name, type), array};
+        }
     };
 
 } // namespace m2
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "CSVTable.hpp"
 #include <fstream>
 #include <vector>
+#include <sstream>
 #include <filesystem>
 
 namespace m2 {
@@ -379,7 +380,7 @@ TEST_F(CSVTableTest, SaveToFile) {
     std::getline(file, line);
     EXPECT_EQ(line, "Name,Age,Score,ID") << "Save to file: Header";
     std::getline(file, line);
-    EXPECT_EQ(line, "Alice,25,90.5000000000,123456789012345") << "Save to file: First row";
+    EXPECT_EQ(line, "Alice,25,90.5,123456789012345") << "Save to file: First row";
 
     // Test failure: Invalid file path
     EXPECT_THROW(table.save_to_file("/invalid/path/output.csv"), std::runtime_error) << "Save to file: Invalid path";
@@ -391,7 +392,7 @@ TEST_F(CSVTableTest, StreamOutput) {
     std::ostringstream oss;
     oss << table;
     std::string output = oss.str();
-    std::string expected = "Name,Age,Score,ID\nAlice,25,90.5000000000,123456789012345\nBob,30,85,987654321098765\nCharlie,,95,555555555555555\n";
+    std::string expected = "Name,Age,Score,ID\nAlice,25,90.5,123456789012345\nBob,30,85,987654321098765\nCharlie,,95,555555555555555\n";
     EXPECT_EQ(output, expected) << "Stream output: Correct format";
 }
 
@@ -785,6 +786,1891 @@ TEST_F(CSVTableTest, FilterInPlace) {
     }
 }
 
+TEST_F(CSVTableTest, ColumnarStorageAccess) {
+    CSVTable table("test.csv", CSVTable::StorageMode::Columnar);
+    EXPECT_EQ(table.storage_mode(), CSVTable::StorageMode::Columnar);
+    EXPECT_EQ(table.num_rows(), 3);
+
+    // Typed buffers with the missing Age recorded as a null
+    EXPECT_EQ(table.column_data("Name").type(), CSVTable::Column::Type::String);
+    EXPECT_EQ(table.column_data("Age").type(), CSVTable::Column::Type::Int);
+    EXPECT_EQ(table.column_data("Age").null_count(), 1);
+    EXPECT_EQ(table.column_data("Score").type(), CSVTable::Column::Type::Double);
+    EXPECT_EQ(table.column_data("ID").type(), CSVTable::Column::Type::UInt64);
+
+    EXPECT_EQ(table.get<std::string>(0, "Name"), "Alice");
+    EXPECT_EQ(table.get<int>(1, "Age"), 30);
+    EXPECT_DOUBLE_EQ(table.get<double>(0, "Score"), 90.5);
+    EXPECT_EQ(table.get<uint64_t>(2, "ID"), 555555555555555ULL);
+    EXPECT_EQ(table.get<std::string>(2, "Age"), "") << "Null reads back as an empty string";
+    EXPECT_THROW(table.get<int>(2, "Age"), std::runtime_error);
+
+    // Writes through Row, CellAccess and CellAssigner
+    auto row = table.get_row(2);
+    row["Age"] = 41;
+    table[0]["Name"] = std::string("Alicia");
+    EXPECT_EQ(table.get<int>(2, "Age"), 41);
+    EXPECT_EQ(table.column_data("Age").null_count(), 0);
+    EXPECT_EQ(row.get<std::string>("Name"), "Charlie");
+    EXPECT_EQ(table.get<std::string>(0, "Name"), "Alicia");
+
+    // A value of another type promotes the column to Mixed without losing data
+    table[1]["Age"] = std::string("unknown");
+    EXPECT_EQ(table.column_data("Age").type(), CSVTable::Column::Type::Mixed);
+    EXPECT_EQ(table.get<int>(0, "Age"), 25);
+    EXPECT_EQ(table.get<std::string>(1, "Age"), "unknown");
+
+    EXPECT_THROW(CSVTable().column_data("Name"), std::invalid_argument);
+    CSVTable row_table("test.csv");
+    EXPECT_THROW(row_table.column_data("Name"), std::runtime_error);
+}
+
+TEST_F(CSVTableTest, ColumnarMatchesRowStorage) {
+    CSVTable row_table("test.csv");
+    CSVTable col_table("test.csv", CSVTable::StorageMode::Columnar);
+
+    std::ostringstream row_out, col_out;
+    row_out << row_table;
+    col_out << col_table;
+    EXPECT_EQ(row_out.str(), col_out.str());
+
+    // Converting back restores the original rows
+    col_table.set_storage_mode(CSVTable::StorageMode::Row);
+    EXPECT_EQ(col_table.get_rows(), row_table.get_rows());
+
+    // dropna / fillna / drop_duplicates behave the same in both layouts
+    CSVTable dropped("test.csv", CSVTable::StorageMode::Columnar);
+    dropped.dropna({"Age"});
+    EXPECT_EQ(dropped.num_rows(), 2);
+    CSVTable filled("test.csv", CSVTable::StorageMode::Columnar);
+    filled.fillna({"Age"}, 0);
+    EXPECT_EQ(filled.get<int>(2, "Age"), 0);
+    filled.append_row({std::string("Alice"), 25, 90.5, uint64_t(123456789012345ULL)});
+    filled.drop_duplicates();
+    EXPECT_EQ(filled.num_rows(), 3);
+}
+
+TEST_F(CSVTableTest, ColumnarColumnKernels) {
+    CSVTable table;
+    table.add_column<int>("id");
+    table.add_column<double>("value");
+    for (int i = 0; i < 1000; ++i) {
+        table.append_row({i, static_cast<double>(i % 100)});
+    }
+    table.set_storage_mode(CSVTable::StorageMode::Columnar);
+
+    const auto& values = table.column_data("value").values<double>();
+    EXPECT_EQ(values.size(), 1000);
+    EXPECT_DOUBLE_EQ(values[101], 1.0);
+    EXPECT_DOUBLE_EQ(table.mean("value"), 49.5);
+    EXPECT_DOUBLE_EQ(table.percentile("value", 0.5), 49.5);
+    EXPECT_EQ(table.get_column_as<int>("id").back(), 999);
+
+    table.sort_by_column<int>("id", false);
+    EXPECT_EQ(table.get<int>(0, "id"), 999);
+    EXPECT_DOUBLE_EQ(table.get<double>(0, "value"), 99.0);
+    table.sort_by_column<int>("id", true);
+    auto it = table.find<int>("id", 250);
+    ASSERT_NE(it, static_cast<const CSVTable&>(table).end());
+    EXPECT_EQ(it.index(), 250);
+
+    auto small = table.filter_table_fast([](int row, const CSVTable& t) {
+        return t.get<double>(row, "value") < 10.0;
+    });
+    EXPECT_EQ(small.storage_mode(), CSVTable::StorageMode::Columnar);
+    EXPECT_EQ(small.num_rows(), 100);
+
+    EXPECT_EQ(table.filter_in_place([](int row, const CSVTable& t) {
+        return t.get<double>(row, "value") < 50.0;
+    }), 500);
+    EXPECT_EQ(table.get<int>(499, "id"), 949);
+    table.delete_row(0);
+    EXPECT_EQ(table.get<int>(0, "id"), 1);
+}
+
+TEST_F(CSVTableTest, RecordReaderMappedAndBuffered) {
+    const std::string file = "line_reader_test.csv";
+    std::string content = "a,b\r\n\nlonger line,\"quoted\nnewline\"\r\n5\" tv,1\nlast";
+    write_csv(file, content);
+
+    std::vector<std::string> expected = {"a,b", "", "longer line,\"quoted\nnewline\"", "5\" tv,1", "last"};
+    for (bool use_mmap : {true, false}) {
+        // A tiny block size forces lines to straddle buffer refills
+        CSVRecordReader reader(file, use_mmap, 3);
+        ASSERT_TRUE(reader.is_open());
+        std::vector<std::string> lines;
+        std::string_view line;
+        while (reader.next_record(line)) {
+            lines.emplace_back(line);
+        }
+        EXPECT_EQ(lines, expected) << "use_mmap=" << use_mmap;
+    }
+    EXPECT_FALSE(CSVRecordReader("missing_file.csv").is_open());
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, ReadFileCRLFWithoutTrailingNewline) {
+    const std::string file = "crlf_test.csv";
+    write_csv(file, "\"Name\",Age,Score\r\nAlice,25,90.5\r\n\"Bob\",,85\r\nCarol,40,1.5");
+    CSVTable table(file);
+    EXPECT_EQ(table.get_col_names(), (std::vector<std::string>{"Name", "Age", "Score"}));
+    ASSERT_EQ(table.num_rows(), 3);
+    EXPECT_EQ(table.get<std::string>(1, "Name"), "Bob");
+    EXPECT_EQ(table.get<std::string>(1, "Age"), "");
+    EXPECT_EQ(table.get<int>(1, "Score"), 85);
+    EXPECT_DOUBLE_EQ(table.get<double>(2, "Score"), 1.5);
+
+    write_csv(file, "");
+    EXPECT_THROW(CSVTable{file}, std::runtime_error);
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, ReadFileQuotedFields) {
+    const std::string file = "quoted_test.csv";
+    write_csv(file, "Name,Note,Value\n\"Smith, J\",\"said \"\"hi\"\"\n twice\",1\n\"\",plain,2\n");
+    CSVTable table(file);
+    ASSERT_EQ(table.num_rows(), 2);
+    EXPECT_EQ(table.get<std::string>(0, "Name"), "Smith, J");
+    EXPECT_EQ(table.get<std::string>(0, "Note"), "said \"hi\"\n twice");
+    EXPECT_EQ(table.get<int>(0, "Value"), 1);
+    EXPECT_EQ(table.get<std::string>(1, "Name"), "");
+    EXPECT_EQ(table.get<int>(1, "Value"), 2);
+
+    // A quote inside an unquoted field is plain text and does not open a quoted field
+    write_csv(file, "item,qty\n5\" tv,1\nlamp,2\n12\" pizza,3\n");
+    for (size_t threads : {size_t{1}, size_t{4}}) {
+        CSVTable stray;
+        stray.read_file(file, threads, 4);
+        ASSERT_EQ(stray.num_rows(), 3) << threads;
+        EXPECT_EQ(stray.get<std::string>(0, "item"), "5\" tv");
+        EXPECT_EQ(stray.get<int>(1, "qty"), 2);
+        EXPECT_EQ(stray.get<std::string>(2, "item"), "12\" pizza");
+    }
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, ParallelReadMatchesSerial) {
+    const std::string file = "parallel_read_test.csv";
+    std::ostringstream content;
+    content << "id,name,score,flag\n";
+    for (int i = 0; i < 5000; ++i) {
+        content << i << ",";
+        if (i % 7 == 0)
+            content << "\"multi\nline, " << i << "\"";
+        else
+            content << "name" << i;
+        content << "," << (i * 0.5) << "," << (i % 2 ? "true" : "false") << "\n";
+    }
+    write_csv(file, content.str());
+
+    CSVTable serial(file);
+    ASSERT_EQ(serial.num_rows(), 5000);
+    EXPECT_EQ(serial.get<std::string>(7, "name"), "multi\nline, 7");
+
+    // Small chunks guarantee boundaries fall near quoted newlines
+    for (size_t chunk_size : {size_t{1}, size_t{97}, size_t{4096}}) {
+        CSVTable parallel;
+        parallel.read_file(file, 4, chunk_size);
+        EXPECT_EQ(parallel.get_rows(), serial.get_rows()) << "chunk_size=" << chunk_size;
+    }
+
+    CSVTable columnar;
+    columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+    columnar.read_file(file, 3, 256);
+    columnar.set_storage_mode(CSVTable::StorageMode::Row);
+    EXPECT_EQ(columnar.get_rows(), serial.get_rows());
+
+    // Appending to an existing table keeps the existing rows first
+    CSVTable appended(file);
+    appended.read_file(file, 2, 512);
+    ASSERT_EQ(appended.num_rows(), 10000);
+    EXPECT_EQ(appended.get<int>(5000, "id"), 0);
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, ParseCellInference) {
+    using CV = CSVTable::CellValue;
+    EXPECT_EQ(CSVTable::parse_cell("42"), CV(42));
+    EXPECT_EQ(CSVTable::parse_cell("-17"), CV(-17));
+    EXPECT_EQ(CSVTable::parse_cell(" 25"), CV(25));
+    EXPECT_EQ(CSVTable::parse_cell("+8"), CV(8));
+    EXPECT_EQ(CSVTable::parse_cell("2147483647"), CV(2147483647));
+    EXPECT_EQ(CSVTable::parse_cell("2147483648"), CV(uint64_t(2147483648ULL)));
+    EXPECT_EQ(CSVTable::parse_cell("18446744073709551615"), CV(uint64_t(18446744073709551615ULL)));
+    EXPECT_EQ(CSVTable::parse_cell("-9999999999"), CV(-9999999999.0)) << "Negative overflow becomes double, not a wrapped uint64";
+    EXPECT_EQ(CSVTable::parse_cell("3.25"), CV(3.25));
+    EXPECT_EQ(CSVTable::parse_cell("1e5"), CV(1e5));
+    EXPECT_EQ(CSVTable::parse_cell("true"), CV(true));
+    EXPECT_EQ(CSVTable::parse_cell("false"), CV(false));
+    EXPECT_EQ(CSVTable::parse_cell("NA"), CV(std::string("")));
+    EXPECT_EQ(CSVTable::parse_cell("#N/A"), CV(std::string("")));
+    EXPECT_EQ(CSVTable::parse_cell("12abc"), CV(std::string("12abc")));
+    EXPECT_EQ(CSVTable::parse_cell("1234567890123x"), CV(std::string("1234567890123x")));
+    EXPECT_EQ(CSVTable::parse_cell("25 "), CV(std::string("25 ")));
+    EXPECT_EQ(CSVTable::parse_cell("-"), CV(std::string("-")));
+
+    EXPECT_EQ(CSVTable::try_parse<int>("123"), 123);
+    EXPECT_FALSE(CSVTable::try_parse<int>("12.5").has_value());
+    EXPECT_FALSE(CSVTable::try_parse<uint64_t>("-1").has_value());
+    EXPECT_EQ(CSVTable::try_parse<bool>("1"), true);
+    EXPECT_FALSE(CSVTable::try_parse<double>("").has_value());
+    EXPECT_TRUE(CSVTable::is_all_digits("0123456789012345"));
+    EXPECT_FALSE(CSVTable::is_all_digits("01234567:9"));
+    EXPECT_FALSE(CSVTable::is_all_digits("0123456/"));
+}
+
+TEST_F(CSVTableTest, SetColumnTypeSkipErrorsWithoutThrowing) {
+    CSVTable table;
+    table.add_column<std::string>("raw");
+    for (const char* v : {"10", "x", "30", "4.5", "NA"}) {
+        table.append_row({std::string(v)});
+    }
+    table.set_column_type<int>("raw", true, -1);
+    EXPECT_EQ(table.get_column_as<int>("raw"), (std::vector<int>{10, -1, 30, -1, -1}));
+}
+
+TEST_F(CSVTableTest, ReadFileWithSchema) {
+    const std::string file = "schema_test.csv";
+    write_csv(file, "id,code,price,note,active\n1,007,9.5,first,true\n2,42,10,second,0\n3,,NA,third,false\n");
+    using CT = CSVTable::ColumnType;
+    CSVTable::Schema schema = {{"id", CT::UInt64}, {"code", CT::String}, {"price", CT::Double},
+                               {"note", CT::Skip}, {"active", CT::Bool}};
+
+    for (size_t threads : {size_t{1}, size_t{3}}) {
+        CSVTable table;
+        table.read_file(file, schema, threads, 8);
+        EXPECT_EQ(table.get_col_names(), (std::vector<std::string>{"id", "code", "price", "active"}));
+        ASSERT_EQ(table.num_rows(), 3);
+        const auto& rows = table.get_rows();
+        EXPECT_EQ(rows[0][0], CSVTable::CellValue(uint64_t(1)));
+        EXPECT_EQ(rows[0][1], CSVTable::CellValue(std::string("007"))) << "Declared strings are not inferred";
+        EXPECT_EQ(rows[1][2], CSVTable::CellValue(10.0));
+        EXPECT_EQ(rows[1][3], CSVTable::CellValue(false));
+        EXPECT_EQ(rows[2][2], CSVTable::CellValue(std::string(""))) << "NA becomes an empty cell";
+    }
+
+    // Columnar tables get typed columns straight away; unlisted columns are still inferred
+    CSVTable columnar;
+    columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+    columnar.read_file(file, {{"price", CT::Double}, {"note", CT::Skip}});
+    EXPECT_EQ(columnar.column_data("price").type(), CSVTable::Column::Type::Double);
+    EXPECT_EQ(columnar.column_data("id").type(), CSVTable::Column::Type::Int);
+    EXPECT_EQ(columnar.column_data("price").null_count(), 1);
+
+    EXPECT_THROW(CSVTable().read_file(file, {{"missing", CT::Int}}), std::invalid_argument);
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, ReadFileWithSchemaReportsRowAndColumn) {
+    const std::string file = "schema_error_test.csv";
+    std::ostringstream content;
+    content << "id,value\n";
+    for (int i = 0; i < 100; ++i) {
+        content << i << "," << (i == 73 ? std::string("oops") : std::to_string(i)) << "\n";
+    }
+    write_csv(file, content.str());
+
+    for (size_t threads : {size_t{1}, size_t{4}}) {
+        CSVTable table;
+        try {
+            table.read_file(file, {{"value", CSVTable::ColumnType::Int}}, threads, 64);
+            FAIL() << "Expected a conversion error";
+        } catch (const std::runtime_error& e) {
+            std::string message = e.what();
+            EXPECT_NE(message.find("row 73"), std::string::npos) << message;
+            EXPECT_NE(message.find("column value"), std::string::npos) << message;
+            EXPECT_NE(message.find("'oops'"), std::string::npos) << message;
+        }
+        EXPECT_EQ(table.num_rows(), 0) << "No partial rows are kept";
+        EXPECT_TRUE(table.get_col_names().empty()) << "An empty table gets no columns from a failed read";
+        table.read_file(file, {{"value", CSVTable::ColumnType::String}}, threads, 64);
+        EXPECT_EQ(table.num_rows(), 100);
+    }
+    CSVTable table;
+    EXPECT_THROW(table.read_file(file, {{"missing", CSVTable::ColumnType::Int}}), std::invalid_argument);
+    EXPECT_TRUE(table.get_col_names().empty());
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, BatchReaderYieldsBoundedBatches) {
+    const std::string file = "batch_test.csv";
+    std::ostringstream content;
+    content << "id,value\n";
+    for (int i = 0; i < 1000; ++i) {
+        content << i << "," << i * 0.5 << "\n";
+    }
+    write_csv(file, content.str());
+
+    CSVTable::BatchReader reader(file, 300);
+    EXPECT_EQ(reader.get_col_names(), (std::vector<std::string>{"id", "value"}));
+    CSVTable batch;
+    std::vector<size_t> sizes;
+    int expected_id = 0;
+    while (reader.next(batch)) {
+        sizes.push_back(batch.num_rows());
+        EXPECT_EQ(batch.get<int>(0, "id"), expected_id);
+        expected_id += batch.num_rows();
+    }
+    EXPECT_EQ(sizes, (std::vector<size_t>{300, 300, 300, 100}));
+    EXPECT_EQ(reader.rows_read(), 1000);
+    EXPECT_EQ(batch.num_rows(), 0);
+
+    CSVTable::BatchReader columnar(file, 512, {{"id", CSVTable::ColumnType::UInt64}}, CSVTable::StorageMode::Columnar);
+    ASSERT_TRUE(columnar.next(batch));
+    EXPECT_EQ(batch.storage_mode(), CSVTable::StorageMode::Columnar);
+    EXPECT_EQ(batch.column_data("id").type(), CSVTable::Column::Type::UInt64);
+    EXPECT_THROW(CSVTable::BatchReader(file, 0), std::invalid_argument);
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, StreamingFilterPipeline) {
+    const std::string input = "stream_input.csv";
+    const std::string csv_out = "stream_output.csv";
+    const std::string parquet_out = "stream_output.parquet";
+    std::ostringstream content;
+    content << "id,value\n";
+    for (int i = 0; i < 2000; ++i) {
+        content << i << "," << (i % 10) << "\n";
+    }
+    write_csv(input, content.str());
+    std::filesystem::remove(csv_out);
+
+    auto keep = [](int row, const CSVTable& t) { return t.get<int>(row, "value") < 3; };
+    CSVTable::ParquetWriter parquet(parquet_out);
+    size_t total = CSVTable::read_file_batches(input, 256, [&](CSVTable& batch) {
+        batch.filter_in_place(keep);
+        batch.save_to_file(csv_out, true);
+        parquet.write(batch);
+    });
+    parquet.close();
+    EXPECT_EQ(total, 2000);
+    EXPECT_EQ(parquet.rows_written(), 600);
+
+    CSVTable expected(input);
+    expected.filter_in_place(keep);
+    CSVTable from_csv(csv_out);
+    EXPECT_EQ(from_csv.get_rows(), expected.get_rows()) << "Header written once, rows appended in order";
+    CSVTable from_parquet;
+    from_parquet.read_parquet(parquet_out);
+    EXPECT_EQ(from_parquet.get_rows(), expected.get_rows()) << "Every row group is read";
+
+    // A later batch whose column no longer fits the file's type is an error rather than a column of nulls
+    CSVTable::ParquetWriter typed(parquet_out);
+    CSVTable prices;
+    prices.add_column<std::string>("sym");
+    prices.add_column<double>("px");
+    prices.append_row({std::string("a"), 1.5});
+    typed.write(prices);
+    CSVTable ints;
+    ints.add_column<std::string>("sym");
+    ints.add_column<int>("px");
+    ints.append_row({std::string("b"), 2});
+    ints.append_row({std::string("c"), std::string("")});
+    typed.write(ints);
+    CSVTable words;
+    words.add_column<std::string>("sym");
+    words.add_column<std::string>("px");
+    words.append_row({std::string("d"), std::string("")});
+    words.append_row({std::string("e"), std::string("n/a")});
+    try {
+        typed.write(words);
+        FAIL() << "Expected std::runtime_error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("row 1 of column px"), std::string::npos) << e.what();
+    }
+    typed.close();
+    CSVTable widened;
+    widened.read_parquet(parquet_out);
+    ASSERT_EQ(widened.num_rows(), 3);
+    EXPECT_EQ(widened.get<double>(1, "px"), 2.0);
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(csv_out);
+    std::filesystem::remove(parquet_out);
+}
+
+TEST_F(CSVTableTest, SaveToFileQuotesAndRoundTrips) {
+    CSVTable table;
+    table.add_column<std::string>("text");
+    table.add_column<double>("value");
+    table.append_row({std::string("plain"), 0.1});
+    table.append_row({std::string("a,b"), 1e20});
+    table.append_row({std::string("say \"hi\""), -2.5});
+    table.append_row({std::string("two\nlines"), 1.0 / 3.0});
+
+    std::ostringstream out;
+    out << table;
+    EXPECT_EQ(out.str(), "text,value\nplain,0.1\n\"a,b\",1e+20\n\"say \"\"hi\"\"\",-2.5\n\"two\nlines\",0.3333333333333333\n");
+
+    const std::string file = "quoted_output.csv";
+    table.save_to_file(file);
+    CSVTable reread(file);
+    EXPECT_EQ(reread.get_rows(), table.get_rows()) << "Quoted fields and shortest doubles read back unchanged";
+    std::filesystem::remove(file);
+
+    // Whole numbers are written in full rather than in exponent form
+    EXPECT_EQ(CSVTable::cell_to_string(1e5), "100000");
+    EXPECT_EQ(CSVTable::cell_to_string(1e6), "1000000");
+    EXPECT_EQ(CSVTable::cell_to_string(-1e15), "-1000000000000000");
+    EXPECT_EQ(CSVTable::cell_to_string(1e5 + 0.5), "100000.5");
+    CSVTable whole;
+    whole.add_column<double>("value");
+    whole.append_row({1e5});
+    whole.append_row({1e15});
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        whole.set_storage_mode(mode);
+        std::ostringstream printed;
+        printed << whole;
+        EXPECT_EQ(printed.str(), "value\n100000\n1000000000000000\n");
+    }
+}
+
+TEST_F(CSVTableTest, ParallelSaveMatchesSerial) {
+    CSVTable table;
+    table.add_column<int>("id");
+    table.add_column<std::string>("name");
+    table.add_column<double>("score");
+    for (int i = 0; i < 50000; ++i) {
+        table.append_row({i, std::string(i % 5 ? "n" : "n,") + std::to_string(i), i * 0.25});
+    }
+    const std::string serial_file = "serial_save.csv";
+    const std::string parallel_file = "parallel_save.csv";
+    table.save_to_file(serial_file);
+    table.save_to_file(parallel_file, false, 4);
+    std::ifstream a(serial_file), b(parallel_file);
+    std::string serial_text((std::istreambuf_iterator<char>(a)), std::istreambuf_iterator<char>());
+    std::string parallel_text((std::istreambuf_iterator<char>(b)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(serial_text.size(), parallel_text.size());
+    EXPECT_TRUE(serial_text == parallel_text);
+
+    table.set_storage_mode(CSVTable::StorageMode::Columnar);
+    table.save_to_file(parallel_file, false, 3);
+    std::ifstream c(parallel_file);
+    std::string columnar_text((std::istreambuf_iterator<char>(c)), std::istreambuf_iterator<char>());
+    EXPECT_TRUE(serial_text == columnar_text);
+    std::filesystem::remove(serial_file);
+    std::filesystem::remove(parallel_file);
+}
+
+TEST_F(CSVTableTest, ReadParquetAllRowGroupsParallel) {
+    const std::string file = "row_groups.parquet";
+    CSVTable expected;
+    CSVTable::ParquetWriter writer(file);
+    for (int group = 0; group < 5; ++group) {
+        CSVTable batch;
+        batch.add_column<int>("id");
+        batch.add_column<double>("score");
+        batch.add_column<std::string>("name");
+        batch.add_column<bool>("flag");
+        batch.add_column<uint64_t>("big");
+        for (int i = 0; i < 30000; ++i) {
+            int id = group * 30000 + i;
+            CSVTable::CellValue score = id % 7 == 0 ? CSVTable::CellValue(std::string("")) : CSVTable::CellValue(id * 0.5);
+            batch.append_row({id, score, "n" + std::to_string(id), id % 2 == 0, uint64_t(1) << 40 | uint64_t(id)});
+        }
+        writer.write(batch);
+        expected.append_table(batch);
+    }
+    writer.close();
+
+    CSVTable serial;
+    serial.read_parquet(file);
+    EXPECT_EQ(serial.num_rows(), 150000);
+    EXPECT_EQ(serial.get_rows(), expected.get_rows());
+    CSVTable parallel;
+    parallel.read_parquet(file, 4);
+    EXPECT_EQ(parallel.get_rows(), expected.get_rows());
+
+    CSVTable columnar;
+    columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+    columnar.read_parquet(file, 3);
+    EXPECT_EQ(columnar.column_data("id").type(), CSVTable::Column::Type::Int);
+    EXPECT_EQ(columnar.column_data("score").null_count(), 150000 / 7 + 1);
+    EXPECT_EQ(columnar.column_data("flag").type(), CSVTable::Column::Type::Bool);
+    columnar.set_storage_mode(CSVTable::StorageMode::Row);
+    EXPECT_EQ(columnar.get_rows(), expected.get_rows());
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, ReadParquetProjectionAndPredicates) {
+    const std::string file = "projection.parquet";
+    CSVTable::ParquetWriter writer(file);
+    for (int group = 0; group < 4; ++group) {
+        CSVTable batch;
+        batch.add_column<int>("date");
+        batch.add_column<std::string>("symbol");
+        batch.add_column<double>("price");
+        batch.add_column<std::string>("unused");
+        for (int i = 0; i < 100; ++i) {
+            int date = 20240000 + group * 100 + i;
+            batch.append_row({date, std::string(i % 2 ? "AAA" : "BBB"), i * 1.5, std::string("x")});
+        }
+        writer.write(batch);
+    }
+    writer.close();
+
+    using Op = CSVTable::CompareOp;
+    CSVTable table;
+    table.read_parquet(file, {"symbol", "price"}, {{"date", Op::Ge, 20240290}, {"date", Op::Lt, 20240310}});
+    EXPECT_EQ(table.get_col_names(), (std::vector<std::string>{"symbol", "price"})) << "Predicate-only columns are dropped";
+    ASSERT_EQ(table.num_rows(), 20);
+    EXPECT_EQ(table.get<double>(0, "price"), 90 * 1.5);
+    EXPECT_EQ(table.get<double>(19, "price"), 9 * 1.5);
+
+    CSVTable columnar;
+    columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+    columnar.read_parquet(file, {}, {{"symbol", Op::Eq, std::string("AAA")}, {"price", Op::Gt, 140.0}});
+    EXPECT_EQ(columnar.get_col_names().size(), 4);
+    EXPECT_EQ(columnar.num_rows(), 12);
+    EXPECT_EQ(columnar.column_data("date").type(), CSVTable::Column::Type::Int);
+
+    CSVTable none;
+    none.read_parquet(file, {"date"}, {{"date", Op::Gt, 20250000}});
+    EXPECT_EQ(none.num_rows(), 0);
+    EXPECT_THROW(none.read_parquet(file, {"missing"}), std::invalid_argument);
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, SaveToParquetRowGroupsAndOptions) {
+    const std::string file = "options.parquet";
+    CSVTable table;
+    table.add_column<int>("id");
+    table.add_column<std::string>("side");
+    table.add_column<std::string>("name");
+    for (int i = 0; i < 2500; ++i) {
+        table.append_row({i, std::string(i % 2 ? "buy" : "sell"), "order" + std::to_string(i)});
+    }
+
+    ParquetWriteOptions options;
+    options.row_group_size = 1000;
+    options.codec = ParquetWriteOptions::Codec::Zstd;
+    options.compression_level = 3;
+    table.save_to_parquet(file, options);
+
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(file));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader));
+    EXPECT_EQ(reader->parquet_reader()->metadata()->num_row_groups(), 3);
+
+    CSVTable loaded;
+    loaded.read_parquet(file);
+    EXPECT_EQ(loaded.get_rows(), table.get_rows());
+
+    table.set_storage_mode(CSVTable::StorageMode::Columnar);
+    options.dictionary = false;
+    table.save_to_parquet(file, options);
+    CSVTable columnar;
+    columnar.read_parquet(file);
+    EXPECT_EQ(columnar.get_rows(), loaded.get_rows());
+
+    // Row groups whose cells infer differently share a type wide enough for every value
+    CSVTable mixed;
+    mixed.add_column<double>("num");
+    mixed.add_column<std::string>("code");
+    for (int i = 0; i < 300; ++i) {
+        CSVTable::CellValue num = i < 100 ? CSVTable::CellValue(i) : CSVTable::CellValue(i + 0.5);
+        CSVTable::CellValue code = i < 200 ? CSVTable::CellValue(i) : CSVTable::CellValue("c" + std::to_string(i));
+        mixed.append_row({num, code});
+    }
+    options.row_group_size = 100;
+    mixed.save_to_parquet(file, options);
+    CSVTable widened;
+    widened.read_parquet(file);
+    ASSERT_EQ(widened.num_rows(), 300);
+    EXPECT_EQ(widened.get<double>(99, "num"), 99.0);
+    EXPECT_EQ(widened.get<double>(150, "num"), 150.5);
+    EXPECT_EQ(widened.get<std::string>(0, "code"), "0");
+    EXPECT_EQ(widened.get<std::string>(250, "code"), "c250");
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, DeclarativeFilterMatchesPredicate) {
+    using Filter = CSVTable::Filter;
+    using Op = CSVTable::CompareOp;
+    CSVTable table;
+    table.add_column<int>("id");
+    table.add_column<double>("value");
+    table.add_column<std::string>("category");
+    table.add_column<uint64_t>("big");
+    for (int i = 0; i < 1000; ++i) {
+        CSVTable::CellValue value = i % 50 == 0 ? CSVTable::CellValue(std::string("")) : CSVTable::CellValue(i * 1.5);
+        table.append_row({i, value, std::string(i % 3 == 0 ? "A" : "B"), uint64_t(i) * 10});
+    }
+    Filter filter = (Filter("value", Op::Gt, 750.0) && Filter("category", Op::Eq, std::string("A"))) ||
+                    Filter("id", Op::Lt, 5) || Filter("big", Op::Ge, 9980);
+    auto expected = table.filter_rows([](int r, const CSVTable&) {
+        bool high = r % 50 != 0 && r * 1.5 > 750.0;
+        return (high && r % 3 == 0) || r < 5 || r >= 998;
+    });
+
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable copy = table;
+        copy.set_storage_mode(mode);
+        CSVTable::Selection selection = copy.select(filter);
+        EXPECT_EQ(selection.size(), 1000);
+        EXPECT_EQ(selection.indices(), expected);
+        EXPECT_EQ(copy.sub_table(selection).num_rows(), expected.size());
+        EXPECT_EQ(copy.select(Filter("value", Op::Ne, 3.0)).count(), 1000 - 20 - 1) << "Missing cells never match";
+        EXPECT_EQ(copy.select(Filter("id", Op::Eq, std::string("1"))).count(), 0) << "Strings do not match numbers";
+        EXPECT_EQ(copy.select(Filter("big", Op::Gt, -1)).count(), 1000);
+        EXPECT_EQ(copy.filter_in_place(filter), expected.size());
+        EXPECT_EQ(copy.get<int>(0, "id"), 0);
+    }
+    EXPECT_THROW(table.select(Filter("missing", Op::Eq, 1)), std::invalid_argument);
+}
+
+TEST_F(CSVTableTest, ParallelRowOperationsMatchSerial) {
+    CSVTable table;
+    table.add_column<int>("id");
+    table.add_column<double>("value");
+    for (int i = 0; i < 100000; ++i) {
+        table.append_row({i, (i * 37 % 1000) * 0.5});
+    }
+    auto predicate = [](int row, const CSVTable& t) { return t.get<double>(row, "value") > 300.0; };
+    auto parallel = ExecutionPolicy::parallel(4);
+
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable copy = table;
+        copy.set_storage_mode(mode);
+        CSVTable serial_result = copy.filter_table_fast(predicate);
+        CSVTable parallel_result = copy.filter_table_fast(predicate, parallel);
+        EXPECT_EQ(parallel_result.get_rows(), serial_result.get_rows());
+
+        CSVTable in_place = copy;
+        EXPECT_EQ(in_place.filter_in_place(predicate, parallel), serial_result.num_rows());
+        EXPECT_EQ(in_place.get_rows(), serial_result.get_rows());
+
+        CSVTable applied = copy;
+        applied.apply_to_column<double>("value", [](const CSVTable::CellValue& v) { return std::get<double>(v) * 2; }, parallel);
+        applied.modify([](int row, CSVTable& t) { t[row]["id"] = t.get<int>(row, "id") + 1; }, parallel);
+        EXPECT_EQ(applied.get<double>(99999, "value"), table.get<double>(99999, "value") * 2);
+        EXPECT_EQ(applied.get<int>(99999, "id"), 100000);
+
+        EXPECT_THROW(copy.filter_table_fast([](int row, const CSVTable&) -> bool {
+            if (row == 54321) throw std::runtime_error("bad row");
+            return true;
+        }, parallel), std::runtime_error) << "Predicate exceptions reach the caller";
+    }
+}
+
+TEST_F(CSVTableTest, TableViewFiltersSortsAndSavesWithoutCopying) {
+    using Op = CSVTable::CompareOp;
+    CSVTable table;
+    table.add_column<int>("id");
+    table.add_column<double>("value");
+    table.add_column<std::string>("category");
+    for (int i = 0; i < 100; ++i) {
+        table.append_row({i, (i * 7 % 100) * 1.0, std::string(i % 2 ? "odd" : "even")});
+    }
+
+    auto view = table.view(CSVTable::Filter("category", Op::Eq, std::string("odd")))
+                    .filter([](int row, const CSVTable& t) { return t.get<int>(row, "id") < 50; })
+                    .sort_by_column<double>("value", false);
+    CSVTable expected = table.filter_table([](int row, const CSVTable& t) {
+        return row % 2 == 1 && t.get<int>(row, "id") < 50;
+    });
+    expected.sort_by_column<double>("value", false);
+
+    ASSERT_EQ(view.num_rows(), 25);
+    EXPECT_EQ(&view.parent(), &table);
+    EXPECT_EQ(view.get<int>(0, "id"), expected.get<int>(0, "id"));
+    EXPECT_DOUBLE_EQ(view.mean("value"), expected.mean("value"));
+    EXPECT_DOUBLE_EQ(view.median("value"), expected.median("value"));
+    EXPECT_DOUBLE_EQ(view.percentile("value", 0.9), expected.percentile("value", 0.9));
+    EXPECT_DOUBLE_EQ(view.correlation("id", "value"), expected.correlation("id", "value"));
+    size_t seen = 0;
+    for (auto row : view) {
+        static_assert(std::is_same_v<decltype(row["id"]), CSVTable::CellValue>, "View rows are read-only");
+        EXPECT_EQ(row.get<std::string>("category"), "odd");
+        EXPECT_EQ(std::get<std::string>(row["category"]), "odd");
+        ++seen;
+    }
+    EXPECT_EQ(seen, 25);
+    // A declarative filter on a view only evaluates the view's rows
+    auto narrowed = view.filter(CSVTable::Filter("value", Op::Ge, 50.0) || CSVTable::Filter("id", Op::Eq, 1));
+    std::vector<int> expected_narrowed;
+    for (int idx : view.row_indices()) {
+        if (table.get<double>(idx, "value") >= 50.0 || idx == 1) {
+            expected_narrowed.push_back(idx);
+        }
+    }
+    EXPECT_EQ(narrowed.row_indices(), expected_narrowed);
+    EXPECT_THROW(view.filter(CSVTable::Filter("missing", Op::Eq, 1)), std::invalid_argument);
+    EXPECT_EQ(view.materialize().get_rows(), expected.get_rows());
+    EXPECT_THROW(view.get<int>(25, "id"), std::out_of_range);
+
+    view.save_to_file("view.csv");
+    expected.save_to_file("expected.csv");
+    std::ifstream view_csv("view.csv"), expected_csv("expected.csv");
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(view_csv), {}),
+              std::string(std::istreambuf_iterator<char>(expected_csv), {}));
+    view.save_to_parquet("view.parquet");
+    CSVTable from_parquet;
+    from_parquet.read_parquet("view.parquet");
+    EXPECT_EQ(from_parquet.get_rows(), expected.get_rows());
+    std::filesystem::remove("view.csv");
+    std::filesystem::remove("expected.csv");
+    std::filesystem::remove("view.parquet");
+
+    table.set_storage_mode(CSVTable::StorageMode::Columnar);
+    auto columnar_view = table.view(CSVTable::Filter("category", Op::Eq, std::string("odd")))
+                             .filter([](int row, const CSVTable& t) { return t.get<int>(row, "id") < 50; })
+                             .sort_by_column<double>("value", false);
+    EXPECT_EQ(columnar_view.row_indices(), view.row_indices());
+    EXPECT_DOUBLE_EQ(columnar_view.standard_deviation("value"), expected.standard_deviation("value"));
+}
+
+TEST_F(CSVTableTest, DropDuplicatesKeepModesAndParallel) {
+    CSVTable table;
+    table.add_column<std::string>("a");
+    table.add_column<std::string>("b");
+    table.add_column<int>("n");
+    table.append_row({std::string("x|"), std::string("y"), 1});
+    table.append_row({std::string("x"), std::string("|y"), 2}); // Distinct key despite the same joined text
+    table.append_row({std::string("x|"), std::string("y"), 3});
+    CSVTable last = table;
+    table.drop_duplicates({"a", "b"});
+    ASSERT_EQ(table.num_rows(), 2);
+    EXPECT_EQ(table.get<int>(0, "n"), 1);
+    EXPECT_EQ(table.get<int>(1, "n"), 2);
+    last.drop_duplicates({"a", "b"}, "last");
+    ASSERT_EQ(last.num_rows(), 2);
+    EXPECT_EQ(last.get<int>(0, "n"), 2);
+    EXPECT_EQ(last.get<int>(1, "n"), 3);
+    EXPECT_THROW(last.drop_duplicates({}, "middle"), std::invalid_argument);
+
+    CSVTable big;
+    big.add_column<int>("key");
+    big.add_column<int>("row");
+    for (int i = 0; i < 100000; ++i) {
+        big.append_row({i % 997, i});
+    }
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        for (std::string_view keep : {"first", "last"}) {
+            CSVTable serial = big;
+            serial.set_storage_mode(mode);
+            CSVTable parallel = serial;
+            serial.drop_duplicates({"key"}, keep);
+            parallel.drop_duplicates({"key"}, keep, 4);
+            ASSERT_EQ(serial.num_rows(), 997);
+            EXPECT_EQ(serial.get<int>(0, "row"), keep == "first" ? 0 : 100000 - 997);
+            EXPECT_EQ(parallel.get_column_as<int>("row"), serial.get_column_as<int>("row"));
+        }
+    }
+}
+
+TEST_F(CSVTableTest, MergeHashAndSortMergeJoins) {
+    CSVTable left;
+    left.add_column<int>("id");
+    left.add_column<std::string>("name");
+    for (int i = 0; i < 40000; ++i) {
+        left.append_row({i % 5000, std::string("l") + std::to_string(i)});
+    }
+    CSVTable right;
+    right.add_column<int>("id");
+    right.add_column<double>("score");
+    for (int i = 0; i < 3000; ++i) {
+        right.append_row({i * 2, i * 0.5});
+    }
+
+    // Reference: a nested-loop join in left order, with unmatched right rows at the end.
+    auto expected_rows = [&](std::string_view how) {
+        std::vector<std::vector<CSVTable::CellValue>> out;
+        std::vector<char> right_matched(right.num_rows(), 0);
+        for (size_t l = 0; l < left.num_rows(); ++l) {
+            bool matched = false;
+            int id = left.get<int>(l, "id");
+            if (id % 2 == 0 && id / 2 < 3000) {
+                out.push_back({id, left.get<std::string>(l, "name"), (id / 2) * 0.5});
+                right_matched[id / 2] = matched = true;
+            }
+            if (!matched && (how == "left" || how == "outer")) {
+                out.push_back({id, left.get<std::string>(l, "name"), std::string("")});
+            }
+        }
+        for (size_t r = 0; how == "outer" && r < right.num_rows(); ++r) {
+            if (!right_matched[r]) {
+                out.push_back({right.get<int>(r, "id"), std::string(""), right.get<double>(r, "score")});
+            }
+        }
+        return out;
+    };
+
+    for (std::string_view how : {"inner", "left", "outer"}) {
+        auto expected = expected_rows(how);
+        EXPECT_EQ(left.merge(right, {"id"}, how).get_rows(), expected) << how;
+        EXPECT_EQ(left.merge(right, {"id"}, how, 4).get_rows(), expected) << how;
+        CSVTable columnar = left;
+        columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+        CSVTable merged = columnar.merge(right, {"id"}, how, 4);
+        EXPECT_EQ(merged.storage_mode(), CSVTable::StorageMode::Columnar);
+        EXPECT_EQ(merged.num_rows(), expected.size());
+        EXPECT_EQ(merged.get_rows(), expected) << how;
+    }
+
+    // "right" follows the right table and keeps its unmatched rows
+    CSVTable right_join = right.merge(left.sub_table(std::vector<int>{0, 1, 2, 4}), {"id"}, "right");
+    ASSERT_EQ(right_join.num_rows(), 4);
+    EXPECT_EQ(right_join.get<int>(1, "id"), 1);
+    EXPECT_EQ(right_join.get<std::string>(1, "score"), "");
+    EXPECT_EQ(right_join.get<double>(2, "score"), 0.5);
+    EXPECT_EQ(right_join.get<double>(3, "score"), 1.0);
+
+    // Inputs sorted on the key take the sort-merge path, which gives the same rows in the same order
+    CSVTable hashed_join = left;
+    hashed_join.sort_by_column<int>("id", true);
+    hashed_join = hashed_join.merge(right.sub_table(std::vector<int>{2, 1, 0}), {"id"}, "inner");
+    EXPECT_EQ(hashed_join.num_rows(), 24);
+    left.sort_by_column<int>("id", true);
+    for (std::string_view how : {"inner", "left", "outer"}) {
+        EXPECT_EQ(left.merge(right, {"id"}, how).get_rows(), expected_rows(how)) << how;
+        CSVTable columnar = left;
+        columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+        EXPECT_EQ(columnar.merge(right, {"id"}, how).get_rows(), expected_rows(how)) << how;
+    }
+    CSVTable dup_left, dup_right;
+    dup_left.add_column<int>("id");
+    dup_left.add_column<std::string>("l");
+    dup_right.add_column<int>("id");
+    dup_right.add_column<std::string>("r");
+    for (auto [id, name] : {std::pair{1, "a"}, {1, "b"}, {2, "c"}}) {
+        dup_left.append_row({id, std::string(name)});
+    }
+    for (auto [id, name] : {std::pair{1, "x"}, {1, "y"}, {3, "z"}}) {
+        dup_right.append_row({id, std::string(name)});
+    }
+    CSVTable sorted_right_join = dup_left.merge(dup_right, {"id"}, "right");
+    CSVTable hashed_right_join = dup_left.sub_table(std::vector<int>{2, 0, 1}).merge(dup_right, {"id"}, "right");
+    std::vector<std::vector<CSVTable::CellValue>> right_order = {
+        {1, std::string("a"), std::string("x")}, {1, std::string("b"), std::string("x")},
+        {1, std::string("a"), std::string("y")}, {1, std::string("b"), std::string("y")},
+        {3, std::string(""), std::string("z")}};
+    EXPECT_EQ(sorted_right_join.get_rows(), right_order);
+    EXPECT_EQ(hashed_right_join.get_rows(), right_order);
+}
+
+TEST_F(CSVTableTest, GroupByAggregates) {
+    using Op = CSVTable::AggOp;
+    CSVTable table;
+    table.add_column<std::string>("sym");
+    table.add_column<int>("day");
+    table.add_column<double>("px");
+    for (int i = 0; i < 60000; ++i) {
+        table.append_row({std::string(i % 3 == 0 ? "A" : i % 3 == 1 ? "B" : "C"), i % 2, static_cast<double>(i % 100)});
+    }
+    table[5]["px"] = std::string(""); // Missing cells are skipped
+
+    std::vector<CSVTable::Aggregation> aggs = {
+        {"px", Op::Sum}, {"px", Op::Count}, {"px", Op::Mean}, {"px", Op::Min}, {"px", Op::Max},
+        {"px", Op::Std}, {"px", Op::Percentile, 0.9}, {"", Op::Count, 0.5, "rows"}};
+    CSVTable grouped = table.group_by({"sym", "day"}).agg(aggs);
+    ASSERT_EQ(grouped.num_rows(), 6);
+    EXPECT_EQ(grouped.get_col_names(), (std::vector<std::string>{"sym", "day", "px_sum", "px_count", "px_mean",
+                                                                 "px_min", "px_max", "px_std", "px_p90", "rows"}));
+    // Groups appear in order of first appearance and match a filter_table over the key
+    for (size_t g = 0; g < grouped.num_rows(); ++g) {
+        std::string sym = grouped.get<std::string>(g, "sym");
+        int day = grouped.get<int>(g, "day");
+        CSVTable part = table.filter_table([&](int row, const CSVTable& t) {
+            return t.get<std::string>(row, "sym") == sym && t.get<int>(row, "day") == day;
+        });
+        EXPECT_EQ(sym, table.get<std::string>(g, "sym")); // Rows 0..5 each start a new group
+        EXPECT_EQ(day, table.get<int>(g, "day"));
+        EXPECT_EQ(grouped.get<uint64_t>(g, "rows"), part.num_rows());
+        part.dropna({"px"});
+        EXPECT_EQ(grouped.get<uint64_t>(g, "px_count"), part.num_rows());
+        EXPECT_NEAR(grouped.get<double>(g, "px_mean"), part.mean("px"), 1e-9);
+        EXPECT_NEAR(grouped.get<double>(g, "px_std"), part.standard_deviation("px"), 1e-9);
+        EXPECT_DOUBLE_EQ(grouped.get<double>(g, "px_p90"), part.percentile("px", 0.9));
+        auto px = part.get_column_as<double>("px");
+        EXPECT_DOUBLE_EQ(grouped.get<double>(g, "px_min"), *std::ranges::min_element(px));
+        EXPECT_DOUBLE_EQ(grouped.get<double>(g, "px_sum"), std::accumulate(px.begin(), px.end(), 0.0));
+    }
+
+    // Parallel partial aggregates, columnar storage and the sorted streaming path agree
+    auto close_rows = [](const CSVTable& a, const CSVTable& b) {
+        ASSERT_EQ(a.num_rows(), b.num_rows());
+        for (size_t r = 0; r < a.num_rows(); ++r) {
+            EXPECT_EQ(a.get<std::string>(r, "sym"), b.get<std::string>(r, "sym"));
+            EXPECT_EQ(a.get<uint64_t>(r, "rows"), b.get<uint64_t>(r, "rows"));
+            EXPECT_NEAR(a.get<double>(r, "px_std"), b.get<double>(r, "px_std"), 1e-9);
+            EXPECT_DOUBLE_EQ(a.get<double>(r, "px_p90"), b.get<double>(r, "px_p90"));
+        }
+    };
+    close_rows(table.group_by({"sym", "day"}).agg(aggs, 4), grouped);
+    CSVTable columnar = table;
+    columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+    close_rows(columnar.group_by({"sym", "day"}).agg(aggs, 4), grouped);
+    CSVTable sorted = table;
+    sorted.sort_by_column<std::string>("sym", true);
+    close_rows(sorted.group_by({"sym"}).agg(aggs, 4), table.group_by({"sym"}).agg(aggs));
+
+    // A group whose cells are all missing has a count of 0 and missing for every other aggregate
+    CSVTable empty_group = table.sub_table(std::vector<int>{0, 1, 2});
+    empty_group.append_row({std::string("D"), 0, std::string("")});
+    CSVTable empty_aggs = empty_group.group_by({"sym"}).agg(aggs);
+    ASSERT_EQ(empty_aggs.num_rows(), 4);
+    EXPECT_EQ(empty_aggs.get<uint64_t>(3, "px_count"), 0);
+    EXPECT_EQ(empty_aggs.get<uint64_t>(3, "rows"), 1);
+    for (std::string col : {"px_sum", "px_mean", "px_min", "px_max", "px_std", "px_p90"}) {
+        EXPECT_EQ(empty_aggs.get<std::string>(3, col), "") << col;
+    }
+
+    EXPECT_THROW(table.group_by({"missing"}), std::invalid_argument);
+    EXPECT_THROW(table.group_by({"sym"}).agg({{"px", Op::Percentile, 1.5}}), std::invalid_argument);
+    EXPECT_THROW(table.group_by({"sym"}).agg({{"", Op::Mean}}), std::invalid_argument);
+    EXPECT_THROW(table.group_by({"sym"}).agg({{"px", Op::Sum}, {"px", Op::Sum}}), std::invalid_argument);
+}
+
+TEST_F(CSVTableTest, SortByColumnsTypedMultiKey) {
+    CSVTable table;
+    table.add_column<std::string>("sym");
+    table.add_column<int>("qty");
+    table.add_column<double>("px");
+    table.add_column<int>("row");
+    for (int i = 0; i < 50000; ++i) {
+        table.append_row({std::string(1, static_cast<char>('a' + i * 7 % 5)), (i * 7919) % 201 - 100,
+                          ((i * 31) % 1000 - 500) / 8.0, i});
+    }
+    table[3]["qty"] = std::string(""); // Missing keys sort last
+
+    // Reference: stable sort of (sym asc, qty desc) with missing qty last
+    auto rows = table.get_rows();
+    std::ranges::stable_sort(rows, [](const auto& a, const auto& b) {
+        if (a[0] != b[0]) return std::get<std::string>(a[0]) < std::get<std::string>(b[0]);
+        bool a_missing = std::holds_alternative<std::string>(a[1]), b_missing = std::holds_alternative<std::string>(b[1]);
+        if (a_missing || b_missing) return !a_missing && b_missing;
+        return std::get<int>(a[1]) > std::get<int>(b[1]);
+    });
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        for (size_t threads : {1, 4}) {
+            CSVTable sorted = table;
+            sorted.set_storage_mode(mode);
+            sorted.sort_by_columns({{"sym", true}, {"qty", false}}, threads);
+            EXPECT_EQ(sorted.get_rows(), rows);
+        }
+    }
+
+    // Typed single-key sorts: radix for numbers (stable), parallel comparison sort for strings
+    for (size_t threads : {1, 4}) {
+        CSVTable by_px = table;
+        by_px.sort_by_column<double>("px", false, false, threads);
+        auto px = by_px.get_column_as<double>("px");
+        EXPECT_TRUE(std::ranges::is_sorted(px, std::greater<>()));
+        auto row = by_px.get_column_as<int>("row");
+        for (size_t i = 1; i < px.size(); ++i) {
+            if (px[i] == px[i - 1]) {
+                EXPECT_LT(row[i - 1], row[i]);
+            }
+        }
+        CSVTable by_sym = table;
+        by_sym.sort_by_column<std::string>("sym", true, true, threads);
+        auto syms = by_sym.get_column_as<std::string>("sym");
+        EXPECT_TRUE(std::ranges::is_sorted(syms));
+        EXPECT_EQ(by_sym.get<int>(0, "row"), 0);
+        EXPECT_EQ(by_sym.get<int>(1, "row"), 5);
+    }
+    EXPECT_THROW(table.sort_by_columns({{"nope", true}}), std::invalid_argument);
+}
+
+TEST_F(CSVTableTest, CreateIndexLookupsAndMaintenance) {
+    using Op = CSVTable::CompareOp;
+    using Kind = CSVTable::IndexKind;
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable table;
+        table.add_column<int>("id");
+        table.add_column<double>("px");
+        for (int i = 0; i < 20000; ++i) {
+            table.append_row({(i * 7919) % 1000, i * 0.25});
+        }
+        table.set_storage_mode(mode);
+        auto scanned = table.select(CSVTable::Filter("id", Op::Eq, 42)).indices();
+        auto range = table.select(CSVTable::Filter("id", Op::Ge, 990) && CSVTable::Filter("px", Op::Lt, 100.0)).indices();
+        ASSERT_EQ(scanned.size(), 20u);
+
+        for (auto kind : {Kind::Hash, Kind::Sorted}) {
+            CSVTable indexed = table;
+            indexed.create_index("id", kind);
+            EXPECT_EQ(indexed.index_kind("id"), kind);
+            EXPECT_EQ(indexed.find_rows("id", 42), scanned);
+            EXPECT_TRUE(indexed.find_rows("id", 5000).empty());
+            EXPECT_EQ(indexed.find<int>("id", 42).index(), static_cast<size_t>(scanned.front()));
+            EXPECT_EQ(indexed.select(CSVTable::Filter("id", Op::Ge, 990) && CSVTable::Filter("px", Op::Lt, 100.0)).indices(),
+                      range);
+
+            // Appends are indexed; removals, reorders and writes to the column drop the index
+            indexed.append_row({42, -1.0});
+            EXPECT_EQ(indexed.index_kind("id"), kind);
+            EXPECT_EQ(indexed.find_rows("id", 42).back(), 20000);
+            // A bulk append from either storage mode is merged into the index in one step
+            for (auto batch_mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+                CSVTable appended = indexed;
+                CSVTable batch = table.sub_table(std::vector<int>{7, 3, 11, 3});
+                batch.set_storage_mode(batch_mode);
+                appended.append_table(batch);
+                EXPECT_EQ(appended.index_kind("id"), kind);
+                CSVTable unindexed = appended;
+                unindexed.drop_index("id");
+                for (int key : {table.get<int>(3, "id"), table.get<int>(7, "id"), 42}) {
+                    EXPECT_EQ(appended.find_rows("id", key), unindexed.find_rows("id", key)) << key;
+                }
+                EXPECT_EQ(appended.select(CSVTable::Filter("id", Op::Ge, 990)).indices(),
+                          unindexed.select(CSVTable::Filter("id", Op::Ge, 990)).indices());
+            }
+            CSVTable written = indexed;
+            written[0]["id"] = 42;
+            EXPECT_EQ(written.index_kind("id"), std::nullopt);
+            EXPECT_EQ(written.find_rows("id", 42).front(), 0);
+            CSVTable deleted = indexed;
+            deleted.delete_row(0);
+            EXPECT_EQ(deleted.index_kind("id"), std::nullopt);
+            CSVTable modified = indexed;
+            modified.modify([](int r, CSVTable &t) { t[r]["id"] = t.get<int>(r, "id") + 1; }, ExecutionPolicy::parallel(4));
+            EXPECT_EQ(modified.index_kind("id"), std::nullopt);
+            auto shifted = scanned;
+            shifted.push_back(20000);
+            EXPECT_EQ(modified.find_rows("id", 43), shifted);
+        }
+
+        CSVTable sorted = table;
+        sorted.create_index("id", Kind::Sorted);
+        auto it = sorted.lower_bound<int>("id", 500);
+        ASSERT_NE(it.index(), sorted.get_rows().size());
+        EXPECT_EQ((*it).get<int>("id"), 500);
+        sorted.sort_by_column<double>("px", false);
+        EXPECT_EQ(sorted.index_kind("id"), std::nullopt);
+    }
+
+    // merge probes a hash index on the other table's key instead of building a hash table
+    CSVTable left;
+    left.add_column<int>("id");
+    left.add_column<int>("n");
+    for (int i = 0; i < 5000; ++i) {
+        left.append_row({(i * 31) % 700, i});
+    }
+    CSVTable right;
+    right.add_column<int>("id");
+    right.add_column<double>("score");
+    for (int i = 0; i < 1000; ++i) {
+        right.append_row({(i * 17) % 500, i * 0.5});
+    }
+    auto expected_inner = left.merge(right, {"id"}, "inner");
+    auto expected_left = left.merge(right, {"id"}, "left", 4);
+    right.create_index("id");
+    EXPECT_EQ(left.merge(right, {"id"}, "inner").get_rows(), expected_inner.get_rows());
+    EXPECT_EQ(left.merge(right, {"id"}, "left", 4).get_rows(), expected_left.get_rows());
+    EXPECT_THROW(right.create_index("nope"), std::invalid_argument);
+}
+
+TEST_F(CSVTableTest, FusedStatisticsAndDescribe) {
+    CSVTable table;
+    table.add_column<std::string>("sym");
+    table.add_column<double>("px");
+    table.add_column<int>("qty");
+    for (int i = 0; i < 10001; ++i) {
+        table.append_row({std::string(i % 2 ? "a" : "b"), 1e9 + ((i * 7919) % 1000) / 4.0, (i * 31) % 997});
+    }
+    auto px = table.get_column_as<double>("px");
+    auto qty = table.get_column_as<double>("qty");
+    auto sorted = px;
+    std::ranges::sort(sorted);
+    double mean_px = std::accumulate(px.begin(), px.end(), 0.0) / px.size();
+    double mean_qty = std::accumulate(qty.begin(), qty.end(), 0.0) / qty.size();
+    double ss_px = 0.0, ss_qty = 0.0, cross = 0.0;
+    for (size_t i = 0; i < px.size(); ++i) {
+        ss_px += (px[i] - mean_px) * (px[i] - mean_px);
+        ss_qty += (qty[i] - mean_qty) * (qty[i] - mean_qty);
+        cross += (px[i] - mean_px) * (qty[i] - mean_qty);
+    }
+
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        table.set_storage_mode(mode);
+        EXPECT_NEAR(table.mean("px"), mean_px, 1e-6);
+        EXPECT_NEAR(table.standard_deviation("px"), std::sqrt(ss_px / (px.size() - 1)), 1e-9);
+        EXPECT_NEAR(table.correlation("px", "qty"), cross / std::sqrt(ss_px * ss_qty), 1e-12);
+        EXPECT_EQ(table.median("px"), sorted[5000]);
+        EXPECT_DOUBLE_EQ(table.percentile("px", 0.3), sorted[3000]);
+        EXPECT_DOUBLE_EQ(table.percentile("px", 0.90005), sorted[9000] + 0.5 * (sorted[9001] - sorted[9000]));
+
+        CSVTable summary = table.describe(mode == CSVTable::StorageMode::Row ? 1 : 3);
+        ASSERT_EQ(summary.get_rows().size(), 2u); // sym is not numeric
+        EXPECT_EQ(summary.get<std::string>(0, "column"), "px");
+        EXPECT_EQ(summary.get<std::string>(1, "column"), "qty");
+        EXPECT_EQ(summary.get<uint64_t>(0, "count"), 10001u);
+        EXPECT_NEAR(summary.get<double>(0, "mean"), mean_px, 1e-6);
+        EXPECT_NEAR(summary.get<double>(0, "std"), table.standard_deviation("px"), 1e-9);
+        EXPECT_EQ(summary.get<double>(0, "min"), sorted.front());
+        EXPECT_EQ(summary.get<double>(0, "25%"), sorted[2500]);
+        EXPECT_EQ(summary.get<double>(0, "50%"), sorted[5000]);
+        EXPECT_EQ(summary.get<double>(0, "75%"), sorted[7500]);
+        EXPECT_EQ(summary.get<double>(0, "max"), sorted.back());
+        EXPECT_EQ(summary.get<double>(1, "50%"), table.median("qty"));
+    }
+
+    // Missing cells are skipped by describe
+    CSVTable sparse;
+    sparse.add_column<double>("x");
+    sparse.append_row({1.0});
+    sparse.append_row({std::string("")});
+    sparse.append_row({3.0});
+    CSVTable summary = sparse.describe();
+    EXPECT_EQ(summary.get<uint64_t>(0, "count"), 2u);
+    EXPECT_EQ(summary.get<double>(0, "50%"), 2.0);
+}
+
+TEST_F(CSVTableTest, RollingWindowsMatchRecomputation) {
+    using Op = CSVTable::AggOp;
+    CSVTable table;
+    table.add_column<uint64_t>("ts");
+    table.add_column<std::string>("sym");
+    table.add_column<double>("px");
+    uint64_t ts = 1'700'000'000'000'000'000ULL;
+    for (int i = 0; i < 3000; ++i) {
+        ts += 1 + (i * 7919) % 5;
+        table.append_row({ts, std::string(1, static_cast<char>('a' + i % 3)), ((i * 31) % 101) / 4.0});
+    }
+    table[7]["px"] = std::string(""); // Missing values are skipped
+    const auto& cells = table.get_rows();
+
+    // Reference: recompute each window from scratch over the same partition
+    auto expected = [&](Op op, const CSVTable::RollingWindow& window, size_t r) -> CSVTable::CellValue {
+        std::vector<double> xs;
+        size_t in_window = 0;
+        for (size_t j = r + 1; j-- > 0;) {
+            if (table.get<std::string>(j, "sym") != table.get<std::string>(r, "sym")) continue;
+            if (window.rows > 0) {
+                if (++in_window > window.rows) break; // Row windows count missing cells too
+            } else if (table.get<uint64_t>(r, "ts") - table.get<uint64_t>(j, "ts") >= window.span) {
+                break;
+            }
+            xs.push_back(cells[j][2] == CSVTable::CellValue(std::string("")) ? NAN : std::get<double>(cells[j][2]));
+        }
+        std::erase_if(xs, [](double x) { return std::isnan(x); });
+        if (op == Op::Count) return static_cast<uint64_t>(xs.size());
+        if (xs.size() < std::max<size_t>(window.min_periods, op == Op::Std ? 2 : 1)) return std::string("");
+        double sum = std::accumulate(xs.begin(), xs.end(), 0.0), mean = sum / xs.size();
+        switch (op) {
+        case Op::Sum: return sum;
+        case Op::Mean: return mean;
+        case Op::Min: return *std::ranges::min_element(xs);
+        case Op::Max: return *std::ranges::max_element(xs);
+        default: {
+            double ss = 0.0;
+            for (double x : xs) ss += (x - mean) * (x - mean);
+            return std::sqrt(ss / (xs.size() - 1));
+        }
+        }
+    };
+
+    CSVTable::RollingWindow by_rows{.rows = 20, .partition_by = "sym", .min_periods = 5};
+    CSVTable::RollingWindow by_time{.time_column = "ts", .span = 40, .partition_by = "sym"};
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable rolled = table;
+        rolled.set_storage_mode(mode);
+        int n = 0;
+        for (auto op : {Op::Sum, Op::Count, Op::Mean, Op::Min, Op::Max, Op::Std}) {
+            for (const auto* window : {&by_rows, &by_time}) {
+                std::string name = "r" + std::to_string(n++);
+                rolled.add_rolling_column(name, "px", op, *window, 2);
+                auto rolled_rows = rolled.get_rows();
+                for (size_t r = 0; r < 3000; r += 7) {
+                    CSVTable::CellValue want = expected(op, *window, r);
+                    CSVTable::CellValue got = rolled_rows[r].back();
+                    if (std::holds_alternative<double>(want)) {
+                        ASSERT_NEAR(std::get<double>(got), std::get<double>(want), 1e-9) << name << " row " << r;
+                    } else {
+                        ASSERT_EQ(got, want) << name << " row " << r;
+                    }
+                }
+            }
+        }
+    }
+
+    CSVTable::RollingWindow no_window;
+    EXPECT_THROW(table.add_rolling_column("bad", "px", Op::Mean, no_window), std::invalid_argument);
+    EXPECT_THROW(table.add_rolling_column("bad", "px", Op::Percentile, by_rows), std::invalid_argument);
+    EXPECT_THROW(table.add_rolling_column("px", "px", Op::Mean, by_rows), std::invalid_argument);
+    CSVTable unsorted = table;
+    unsorted.sort_by_column<std::string>("sym", true);
+    EXPECT_THROW(unsorted.add_rolling_column("bad", "px", Op::Mean, {.time_column = "ts", .span = 10}),
+                 std::invalid_argument);
+}
+
+TEST_F(CSVTableTest, CategoricalColumnsEncodeFilterJoinAndRoundTrip) {
+    using Op = CSVTable::CompareOp;
+    using Type = CSVTable::Column::Type;
+    auto rows_of = [](CSVTable t) { return t.get_rows(); };  // get_rows() switches to row storage
+    CSVTable plain;
+    plain.add_column<std::string>("sym");
+    plain.add_column<int>("qty");
+    for (int i = 0; i < 5000; ++i) {
+        plain.append_row({i % 11 == 0 ? std::string("") : std::string(1, static_cast<char>('A' + i % 3)), i});
+    }
+    plain.set_storage_mode(CSVTable::StorageMode::Columnar);
+    CSVTable table = plain;
+    table.set_categorical("sym");
+    const auto& sym = table.column_data("sym");
+    ASSERT_EQ(sym.type(), Type::Categorical);
+    EXPECT_EQ(sym.categories().size(), 3u);
+    EXPECT_EQ(sym.null_count(), plain.column_data("sym").null_count());
+    EXPECT_EQ(table.get<std::string>(1, "sym"), "B");
+    EXPECT_EQ(rows_of(table), rows_of(plain));
+
+    // Filters, dedup, grouping and joins give the same results as on plain strings
+    for (auto op : {Op::Eq, Op::Ne, Op::Lt, Op::Ge}) {
+        EXPECT_EQ(table.select(CSVTable::Filter("sym", op, std::string("B"))).indices(),
+                  plain.select(CSVTable::Filter("sym", op, std::string("B"))).indices());
+    }
+    EXPECT_EQ(table.select(CSVTable::Filter("sym", Op::Eq, std::string("Z"))).indices().size(), 0u);
+    CSVTable deduped = table;
+    deduped.drop_duplicates({"sym"});
+    EXPECT_EQ(deduped.num_rows(), 4);
+    EXPECT_EQ(table.group_by({"sym"}).agg({{"qty", CSVTable::AggOp::Sum}}).get_rows(),
+              plain.group_by({"sym"}).agg({{"qty", CSVTable::AggOp::Sum}}).get_rows());
+    CSVTable venues;
+    venues.add_column<std::string>("sym");
+    venues.add_column<std::string>("venue");
+    venues.append_row({std::string("A"), std::string("X")});
+    venues.append_row({std::string("C"), std::string("Y")});
+    venues.set_storage_mode(CSVTable::StorageMode::Columnar);
+    venues.set_categorical("sym");
+    auto joined = table.merge(venues, {"sym"}, "left");
+    EXPECT_EQ(rows_of(joined), plain.merge(venues, {"sym"}, "left").get_rows());
+    EXPECT_EQ(joined.column_data("sym").type(), Type::Categorical);
+
+    // Writes intern new values without disturbing copies that share the dictionary
+    CSVTable copy = table;
+    copy[0]["sym"] = std::string("D");
+    EXPECT_EQ(copy.get<std::string>(0, "sym"), "D");
+    EXPECT_EQ(copy.column_data("sym").categories().size(), 4u);
+    EXPECT_EQ(table.column_data("sym").categories().size(), 3u);
+
+    // Parquet stores a dictionary column, which reads back categorical; CSV reads can be declared categorical
+    std::string parquet_file = "categorical_test.parquet";
+    table.save_to_parquet(parquet_file);
+    CSVTable from_parquet;
+    from_parquet.set_storage_mode(CSVTable::StorageMode::Columnar);
+    from_parquet.read_parquet(parquet_file);
+    EXPECT_EQ(from_parquet.column_data("sym").type(), Type::Categorical);
+    EXPECT_EQ(rows_of(from_parquet), rows_of(table));
+    CSVTable rows_from_parquet;
+    rows_from_parquet.read_parquet(parquet_file);
+    EXPECT_EQ(rows_of(rows_from_parquet), rows_of(table));
+    std::filesystem::remove(parquet_file);
+
+    std::string csv_file = "categorical_test.csv";
+    table.save_to_file(csv_file);
+    CSVTable from_csv;
+    from_csv.set_storage_mode(CSVTable::StorageMode::Columnar);
+    from_csv.read_file(csv_file, {{"sym", CSVTable::ColumnType::Categorical}}, 2, 4096);
+    EXPECT_EQ(from_csv.column_data("sym").type(), Type::Categorical);
+    EXPECT_EQ(rows_of(from_csv), rows_of(table));
+    std::filesystem::remove(csv_file);
+
+    EXPECT_THROW(table.set_categorical("qty"), std::runtime_error);
+    CSVTable row_table;
+    row_table.add_column<std::string>("sym");
+    EXPECT_THROW(row_table.set_categorical("sym"), std::runtime_error);
+}
+
+TEST_F(CSVTableTest, StringColumnsShareArenaBlocks) {
+    auto text = [](int i) { return "note " + std::to_string(i) + std::string(i % 7 * 5, 'x'); };
+    CSVTable rows;
+    rows.add_column<std::string>("note");
+    rows.add_column<int>("id");
+    for (int i = 0; i < 20000; ++i) {
+        rows.append_row({i % 9 == 0 ? std::string("") : text(i), i});
+    }
+    rows.append_row({std::string(3 << 20, 'L'), 20000}); // Larger than an arena block
+
+    auto table = std::make_unique<CSVTable>(rows);
+    table->set_storage_mode(CSVTable::StorageMode::Columnar);
+    CSVTable copy = *table;
+    std::vector<int> odd;
+    for (int i = 1; i <= 20000; i += 2) {
+        odd.push_back(i);
+    }
+    CSVTable odd_rows = table->sub_table(odd);
+    CSVTable doubled = *table;
+    doubled.append_table(*table);
+
+    // Overwriting and destroying the source leaves copies, gathers and appends intact
+    for (int i = 0; i < 20000; i += 3) {
+        (*table)[i]["note"] = std::string("overwritten");
+    }
+    table.reset();
+
+    EXPECT_EQ(copy.column_data("note").type(), CSVTable::Column::Type::String);
+    for (int i = 0; i < 20000; ++i) {
+        std::string expected = i % 9 == 0 ? std::string("") : text(i);
+        ASSERT_EQ(copy.get<std::string>(i, "note"), expected);
+        ASSERT_EQ(doubled.get<std::string>(20001 + i, "note"), expected);
+        if (i % 2 == 1) {
+            ASSERT_EQ(odd_rows.get<std::string>(i / 2, "note"), expected);
+        }
+    }
+    EXPECT_EQ(copy.get<std::string>(20000, "note").size(), size_t(3) << 20);
+    EXPECT_EQ(copy.column_data("note").null_count(), 20000u / 9 + 1);
+
+    // Writes to a copy never reach the blocks it shares
+    copy[1]["note"] = std::string("changed");
+    copy.append_row({std::string("appended"), 20001});
+    EXPECT_EQ(doubled.get<std::string>(1, "note"), text(1));
+    EXPECT_EQ(copy.get<std::string>(1, "note"), "changed");
+    EXPECT_EQ(copy.get<std::string>(20001, "note"), "appended");
+    EXPECT_EQ(doubled.select(CSVTable::Filter("note", CSVTable::CompareOp::Eq, text(5))).indices(),
+              (std::vector<int>{5, 20006}));
+}
+
+TEST_F(CSVTableTest, BulkAppendColumnsBuilderAndMovedTables) {
+    std::vector<int> ids = {1, 2, 3};
+    std::vector<double> prices = {10.5, 11.0, 12.25};
+    std::vector<std::string> syms = {"AAPL", "", "MSFT"};
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable expected;
+        expected.add_column<int>("id");
+        expected.add_column<double>("px");
+        expected.add_column<std::string>("sym");
+        expected.set_storage_mode(mode);
+        CSVTable table = expected;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            expected.append_row({ids[i], prices[i], syms[i]});
+        }
+
+        table.reserve(6);
+        table.append_columns({ids, prices, syms});
+        EXPECT_EQ(table.num_rows(), 3);
+        EXPECT_THROW(table.append_columns({ids, prices}), std::invalid_argument);
+        EXPECT_THROW(table.append_columns({ids, std::vector<double>{1.0}, syms}), std::invalid_argument);
+        EXPECT_EQ(table.num_rows(), 3);
+
+        // Builder values are committed together; mismatched lengths leave the table untouched
+        auto builder = table.builder();
+        builder.append<int>("id", ids).append<double>("px", prices);
+        for (const auto &sym : syms) {
+            builder.push_back("sym", sym);
+        }
+        builder.push_back("id", 4);
+        EXPECT_THROW(builder.commit(), std::invalid_argument);
+        EXPECT_EQ(table.num_rows(), 3);
+        builder.push_back("px", 13.0).push_back("sym", std::string("IBM"));
+        EXPECT_EQ(builder.size("id"), 4u);
+        builder.commit();
+        EXPECT_EQ(builder.size("id"), 0u);
+        expected.append_table(expected.sub_table(std::vector<int>{0, 1, 2}));
+        expected.append_row({4, 13.0, std::string("IBM")});
+        EXPECT_EQ(CSVTable(table).get_rows(), CSVTable(expected).get_rows());
+        if (mode == CSVTable::StorageMode::Columnar) {
+            EXPECT_EQ(table.column_data("id").type(), CSVTable::Column::Type::Int);
+            EXPECT_EQ(table.column_data("sym").null_count(), 2u);
+        }
+
+        // Appending an rvalue moves its rows and leaves it empty
+        CSVTable moved = table;
+        CSVTable target = table;
+        target.append_table(std::move(moved));
+        EXPECT_EQ(target.num_rows(), 14);
+        EXPECT_EQ(moved.num_rows(), 0);
+        EXPECT_EQ(target.get<std::string>(7 + 6, "sym"), "IBM");
+        EXPECT_EQ(target.get<double>(7 + 2, "px"), 12.25);
+        EXPECT_EQ(target.get<std::string>(7 + 1, "sym"), "");
+    }
+}
+
+TEST_F(CSVTableTest, ColumnHandlesReadWriteAndFilter) {
+    static_assert(std::ranges::input_range<CSVTable::ColumnHandle<double>>);
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable table;
+        table.add_column<int>("id");
+        table.add_column<double>("value");
+        for (int i = 0; i < 1000; ++i) {
+            table.append_row({i, i * 0.5});
+        }
+        table.set_storage_mode(mode);
+        const bool columnar = mode == CSVTable::StorageMode::Columnar;
+
+        auto value = table.column<double>("value");
+        auto id_as_double = table.column<double>("id");
+        EXPECT_EQ(value.size(), 1000u);
+        EXPECT_EQ(value[10], 5.0);
+        EXPECT_EQ(id_as_double[7], 7.0);
+        EXPECT_THROW(value.at(1000), std::out_of_range);
+        EXPECT_THROW(table.column<double>("missing"), std::invalid_argument);
+        EXPECT_EQ(value.contiguous(), columnar);
+        if (columnar) {
+            EXPECT_EQ(value.values()[20], 10.0);
+        } else {
+            EXPECT_THROW(value.values(), std::runtime_error);
+        }
+        double sum = 0;
+        for (double v : value) {
+            sum += v;
+        }
+        EXPECT_DOUBLE_EQ(sum, 0.5 * 999 * 1000 / 2);
+
+        // Row-index predicates work anywhere a (row, table) predicate does
+        auto by_handle = table.filter_rows([&](int r) { return value[r] > 400.0; });
+        auto by_name = table.filter_rows([](int r, const CSVTable &t) { return t.get<double>(r, "value") > 400.0; });
+        EXPECT_EQ(by_handle, by_name);
+        EXPECT_EQ(table.filter_table_fast([&](int r) { return value[r] > 400.0; }, ExecutionPolicy::parallel(2)).num_rows(), 199);
+        EXPECT_EQ(table.view().filter([&](int r) { return value[r] < 1.0; }).num_rows(), 2);
+
+        // Writes go through the table; a write that retypes the column keeps the handle usable
+        auto id = table.column<int>("id");
+        id.set(3, 42);
+        EXPECT_EQ(table.get<int>(3, "id"), 42);
+        table.column<std::string>("id").set(4, std::string("x"));
+        auto ids = table.column<int>("id");
+        EXPECT_EQ(ids[5], 5);
+        EXPECT_THROW(ids[4], std::invalid_argument);
+        EXPECT_FALSE(table.column<std::string>("id").is_missing(6));
+        const CSVTable &read_only = table;
+        EXPECT_THROW(read_only.column<int>("id").set(0, 1), std::runtime_error);
+
+        size_t kept = table.filter_in_place([&](int r) { return value[r] >= 250.0; });
+        EXPECT_EQ(kept, 500u);
+    }
+}
+
+TEST_F(CSVTableTest, LazyPipelineFusesAndPushesDown) {
+    auto rows_of = [](CSVTable t) { return t.get_rows(); };
+    CSVTable source;
+    source.add_column<int>("id");
+    source.add_column<std::string>("sym");
+    source.add_column<int>("qty");
+    source.add_column<double>("px");
+    const std::vector<std::string> syms = {"AAPL", "MSFT", "IBM", "ORCL"};
+    for (int i = 0; i < 40000; ++i) {
+        source.append_row({i, syms[i % 4], i % 50, 1.0 + (i % 7)});
+    }
+    std::map<std::string, double> expected_sums;
+    for (int i = 0; i < 40000; ++i) {
+        double notional = (1.0 + (i % 7)) * (i % 50);
+        if (i % 50 > 10 && notional > 60.0) {
+            expected_sums[syms[i % 4]] += notional;
+        }
+    }
+
+    auto build = [](CSVTable::LazyTable plan) {
+        return plan.filter(CSVTable::Filter("qty", CSVTable::CompareOp::Gt, 10))
+            .with_column("notional", [](const auto &row) { return CSVTable::CellValue(row.template get<double>("px") * row.template get<int>("qty")); }, {"px", "qty"})
+            .filter([](const auto &row) { return row.template get<double>("notional") > 60.0; }, {"notional"})
+            .select({"sym", "notional"})
+            .group_by({"sym"}, {{"notional", CSVTable::AggOp::Sum}})
+            .sort_by({{"sym", true}});
+    };
+    std::vector<std::vector<CSVTable::CellValue>> first;
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable table = source;
+        table.set_storage_mode(mode);
+        CSVTable result = build(table.lazy()).collect(mode == CSVTable::StorageMode::Row ? 1 : 4);
+        ASSERT_EQ(result.num_rows(), 4);
+        EXPECT_EQ(result.get_col_names(), (std::vector<std::string>{"sym", "notional_sum"}));
+        for (int r = 0; r < 4; ++r) {
+            EXPECT_DOUBLE_EQ(result.get<double>(r, "notional_sum"), expected_sums[result.get<std::string>(r, "sym")]);
+        }
+        if (first.empty()) {
+            first = rows_of(result);
+        } else {
+            EXPECT_EQ(rows_of(result), first);
+        }
+    }
+
+    // Scans load only the needed columns, with the leading filter pushed into the read
+    const std::string parquet_file = "lazy.parquet", csv_file = "lazy.csv";
+    source.save_to_parquet(parquet_file);
+    source.save_to_file(csv_file);
+    std::string plan = build(CSVTable::scan_parquet(parquet_file)).explain();
+    EXPECT_NE(plan.find("columns=[sym, qty, px] pushdown=qty > 10"), std::string::npos) << plan;
+    EXPECT_NE(plan.find("pass | with_column notional | filter <predicate> | select [sym, notional]"), std::string::npos) << plan;
+    EXPECT_EQ(rows_of(build(CSVTable::scan_parquet(parquet_file)).collect(2)), first);
+    EXPECT_NE(build(CSVTable::scan_csv(csv_file)).explain().find("filter batches qty > 10"), std::string::npos);
+    EXPECT_EQ(rows_of(build(CSVTable::scan_csv(csv_file)).collect(2)), first);
+
+    // A filter on a replaced column runs after the replacement, in the same pass
+    CSVTable doubled = source.lazy()
+                           .with_column("px", [](const auto &row) { return CSVTable::CellValue(row.template get<double>("px") * 2); }, {"px"})
+                           .filter(CSVTable::Filter("px", CSVTable::CompareOp::Ge, 14.0))
+                           .select({"id", "px"})
+                           .collect();
+    EXPECT_EQ(doubled.num_rows(), 40000 / 7);
+    EXPECT_EQ(doubled.get<double>(0, "px"), 14.0);
+    EXPECT_EQ(doubled.get<int>(0, "id"), 6);
+
+    EXPECT_THROW(source.lazy().select({"missing"}).collect(), std::invalid_argument);
+    EXPECT_THROW(source.lazy().with_column("x", [](const auto &row) { return CSVTable::CellValue(row.template get<int>("id")); }, {"qty"}).collect(),
+                 std::invalid_argument);
+    std::filesystem::remove(parquet_file);
+    std::filesystem::remove(csv_file);
+}
+
+TEST_F(CSVTableTest, TypedExpressionsComputeSelectAndFeedLazyStages) {
+    using E = CSVTable;
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable table;
+        table.add_column<int>("id");
+        table.add_column<double>("price");
+        table.add_column<int>("qty");
+        table.add_column<std::string>("note");
+        for (int i = 0; i < 20000; ++i) {
+            table.append_row({i, 1.5 + i % 10, i % 7, std::string("n")});
+        }
+        table[5]["qty"] = std::string(""); // Missing qty
+        table.set_storage_mode(mode);
+
+        table.compute_column("notional", E::col<double>("price") * E::col<int>("qty"), 2);
+        EXPECT_EQ(table.get_col_names().back(), "notional");
+        EXPECT_EQ(table.get<double>(3, "notional"), 4.5 * 3);
+        EXPECT_EQ(table.get<std::string>(5, "notional"), "");
+        if (mode == CSVTable::StorageMode::Columnar) {
+            EXPECT_EQ(table.column_data("notional").type(), CSVTable::Column::Type::Double);
+            EXPECT_EQ(table.column_data("notional").null_count(), 1u);
+        }
+
+        // Literals, integer division by zero (missing), unary minus and replacing a column with a new type
+        table.compute_column("per_qty", E::col<int>("id") / E::col<int>("qty"));
+        EXPECT_EQ(table.get<int>(9, "per_qty"), 4);
+        EXPECT_EQ(table.get<std::string>(7, "per_qty"), "");
+        table.compute_column("qty", -(E::col<int>("qty") * 2) + 1.0);
+        EXPECT_EQ(table.get<double>(3, "qty"), -5.0);
+
+        // A bool expression selects the same rows as the equivalent row predicate
+        auto expr = E::col<double>("notional") > 20.0 && !(E::col<int>("id") == 100);
+        auto selection = table.select(expr);
+        auto expected = table.filter_rows([](int r, const CSVTable &t) {
+            return r != 5 && t.get<int>(r, "id") != 100 && t.get<double>(r, "notional") > 20.0;
+        });
+        EXPECT_EQ(selection.indices(), expected);
+
+        // Lazy stages take expressions and read only their columns
+        CSVTable lazy = table.lazy().with_column("twice", E::col<double>("notional") * 2).filter(expr).select({"id", "twice"}).collect();
+        EXPECT_EQ(lazy.num_rows(), static_cast<int>(expected.size()));
+        EXPECT_EQ(lazy.get<double>(0, "twice"), 2 * table.get<double>(expected[0], "notional"));
+
+        EXPECT_THROW(table.compute_column("x", E::col<int>("missing") + 1), std::invalid_argument);
+        EXPECT_THROW(table.compute_column("x", E::col<int>("note") + 1), std::invalid_argument);
+        EXPECT_FALSE(table.get_col_names().back() == "x");
+    }
+}
+
+TEST_F(CSVTableTest, SnapshotsRoundTripAndServeReadFile) {
+    auto rows_of = [](CSVTable t) { return t.get_rows(); };
+    CSVTable table;
+    table.add_column<int>("id");
+    table.add_column<double>("px");
+    table.add_column<std::string>("sym");
+    table.add_column<std::string>("venue");
+    table.add_column<bool>("flag");
+    table.add_column<uint64_t>("ts");
+    table.add_column<std::string>("mixed");
+    for (int i = 0; i < 300; ++i) {
+        CSVTable::CellValue mixed = i % 3 == 0 ? CSVTable::CellValue(i) : CSVTable::CellValue("m" + std::to_string(i));
+        table.append_row({i, i * 0.25, i % 11 == 0 ? std::string("") : "symbol-" + std::to_string(i % 17), std::string(i % 2 ? "XNAS" : "ARCA"),
+                          i % 5 == 0, uint64_t(1) << 40 | i, mixed});
+    }
+    table.set_storage_mode(CSVTable::StorageMode::Columnar);
+    table.set_categorical("venue");
+    const std::string snapshot = "table.snapshot";
+    table.save_snapshot(snapshot);
+
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        std::optional<CSVTable> loaded(std::in_place);
+        loaded->set_storage_mode(mode);
+        loaded->load_snapshot(snapshot);
+        EXPECT_EQ(loaded->get_col_names(), table.get_col_names());
+        EXPECT_EQ(rows_of(*loaded), rows_of(table));
+        if (mode == CSVTable::StorageMode::Columnar) {
+            EXPECT_EQ(loaded->column_data("venue").type(), CSVTable::Column::Type::Categorical);
+            EXPECT_EQ(loaded->column_data("mixed").type(), CSVTable::Column::Type::Mixed);
+            EXPECT_EQ(loaded->column_data("sym").null_count(), 28u);
+            // Copies keep the mapped strings alive after the loaded table is gone
+            CSVTable copy = *loaded;
+            loaded.reset();
+            EXPECT_EQ(copy.get<std::string>(1, "sym"), "symbol-1");
+            copy[1]["sym"] = std::string("changed");
+            EXPECT_EQ(copy.get<std::string>(1, "sym"), "changed");
+        }
+    }
+
+    // read_file uses an adjacent snapshot only while the CSV is unchanged
+    const std::string csv = "snapshot_source.csv";
+    table.save_to_file(csv);
+    CSVTable parsed;
+    parsed.read_file(csv);
+    parsed.add_column<int>("from_snapshot", 1);
+    parsed.save_snapshot(CSVTable::snapshot_path(csv), csv);
+    CSVTable fast;
+    fast.read_file(csv);
+    EXPECT_EQ(fast.get_col_names().back(), "from_snapshot");
+    EXPECT_EQ(fast.num_rows(), 300);
+
+    // Appending checks the snapshot's columns as it checks a CSV header
+    auto header_error = [&](CSVTable target) {
+        try {
+            target.read_file(csv);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string("no error");
+    };
+    const std::string mismatch = "Column headers in " + csv + " do not match existing table";
+    EXPECT_EQ(header_error(table), mismatch) << "The snapshot holds an extra column";
+    std::filesystem::rename(CSVTable::snapshot_path(csv), snapshot + ".aside");
+    EXPECT_EQ(header_error(fast), mismatch) << "The CSV lacks the extra column";
+    std::filesystem::rename(snapshot + ".aside", CSVTable::snapshot_path(csv));
+
+    // The snapshot stands in for the CSV as saved, even for a table filtered after reading it
+    CSVTable filtered = parsed.filter_table([](int row, const CSVTable& t) { return t.get<int>(row, "id") < 10; });
+    filtered.save_snapshot(CSVTable::snapshot_path(csv), csv);
+    EXPECT_EQ(CSVTable(csv).num_rows(), 10);
+    filtered.save_snapshot(CSVTable::snapshot_path(csv));
+    EXPECT_EQ(CSVTable(csv).num_rows(), 300) << "A snapshot saved without its source is never used by read_file";
+    {
+        std::ofstream out(csv, std::ios::app);
+        out << "300,1.5,s,XNAS,false,1,m\n";
+    }
+    CSVTable reparsed;
+    reparsed.read_file(csv);
+    EXPECT_EQ(reparsed.num_rows(), 301);
+    EXPECT_EQ(reparsed.get_col_names(), table.get_col_names());
+
+    // A current snapshot with a damaged body is ignored and the CSV parsed instead
+    reparsed.add_column<int>("from_snapshot", 1);
+    reparsed.save_snapshot(CSVTable::snapshot_path(csv), csv);
+    std::filesystem::resize_file(CSVTable::snapshot_path(csv), std::filesystem::file_size(CSVTable::snapshot_path(csv)) - 100);
+    for (auto mode : {CSVTable::StorageMode::Row, CSVTable::StorageMode::Columnar}) {
+        CSVTable fallback(csv, mode);
+        EXPECT_EQ(fallback.num_rows(), 301);
+        EXPECT_EQ(fallback.get_col_names(), table.get_col_names());
+    }
+
+    // Truncated and foreign files are rejected
+    std::filesystem::resize_file(snapshot, std::filesystem::file_size(snapshot) / 2);
+    CSVTable truncated;
+    EXPECT_THROW(truncated.load_snapshot(snapshot), std::runtime_error);
+    CSVTable foreign;
+    EXPECT_THROW(foreign.load_snapshot(csv), std::runtime_error);
+    EXPECT_THROW(foreign.load_snapshot("no_such.snapshot"), std::runtime_error);
+    std::filesystem::remove(snapshot);
+    std::filesystem::remove(csv);
+    std::filesystem::remove(CSVTable::snapshot_path(csv));
+}
+
+TEST_F(CSVTableTest, NullBitmapsDropFillStatisticsAndParquet) {
+    auto rows_of = [](CSVTable t) { return t.get_rows(); };
+    CSVTable row_table;
+    row_table.add_column<int>("id");
+    row_table.add_column<double>("px");
+    row_table.add_column<std::string>("sym");
+    row_table.add_column<std::string>("venue");
+    double px_sum = 0;
+    int px_count = 0;
+    for (int i = 0; i < 200; ++i) {
+        CSVTable::CellValue px = i % 4 == 0 ? CSVTable::CellValue(std::string("")) : CSVTable::CellValue(i * 0.5);
+        if (i % 4 != 0) {
+            px_sum += i * 0.5;
+            ++px_count;
+        }
+        std::string sym = i % 5 == 0 ? "" : i % 7 == 0 ? "NA" : "s" + std::to_string(i % 13);
+        row_table.append_row({i, px, sym, std::string(i % 9 == 0 ? "#N/A" : i % 2 ? "XNAS" : "ARCA")});
+    }
+    CSVTable columnar = row_table;
+    columnar.set_storage_mode(CSVTable::StorageMode::Columnar);
+    columnar.set_categorical("venue");
+    EXPECT_EQ(columnar.column_data("px").null_count(), 50u);
+
+    // The bitmap and NA-string checks agree with the row-storage scan
+    EXPECT_EQ(columnar.notna().indices(), row_table.notna().indices());
+    EXPECT_EQ(columnar.notna({"px"}).count(), 150u);
+    EXPECT_THROW(columnar.notna({"missing"}), std::invalid_argument);
+    CSVTable dropped_rows = row_table, dropped_cols = columnar;
+    dropped_rows.dropna({"sym", "venue"});
+    dropped_cols.dropna({"sym", "venue"});
+    EXPECT_EQ(rows_of(dropped_cols), rows_of(dropped_rows));
+    EXPECT_EQ(dropped_cols.notna({"sym", "venue"}).count(), static_cast<size_t>(dropped_cols.num_rows()));
+
+    CSVTable filled_rows = row_table, filled_cols = columnar;
+    filled_rows.fillna({"sym", "venue"}, std::string("?"));
+    filled_cols.fillna({"sym", "venue"}, std::string("?"));
+    filled_rows.fillna({"px"}, -1.0);
+    filled_cols.fillna({"px"}, -1.0);
+    EXPECT_EQ(rows_of(filled_cols), rows_of(filled_rows));
+    EXPECT_EQ(filled_cols.column_data("px").null_count(), 0u);
+    EXPECT_EQ(filled_cols.column_data("px").type(), CSVTable::Column::Type::Double);
+    EXPECT_EQ(filled_cols.get<std::string>(7, "sym"), "?");
+
+    // Single-column statistics skip missing cells
+    EXPECT_DOUBLE_EQ(columnar.mean("px"), px_sum / px_count);
+    EXPECT_DOUBLE_EQ(row_table.mean("px"), px_sum / px_count);
+    EXPECT_DOUBLE_EQ(columnar.median("px"), row_table.median("px"));
+    EXPECT_DOUBLE_EQ(columnar.standard_deviation("px"), row_table.standard_deviation("px"));
+    for (const CSVTable *source : {&row_table, &columnar}) {
+        auto all = source->view();
+        EXPECT_DOUBLE_EQ(all.mean("px"), px_sum / px_count);
+        EXPECT_DOUBLE_EQ(all.median("px"), row_table.median("px"));
+        EXPECT_DOUBLE_EQ(all.percentile("px", 0.9), row_table.percentile("px", 0.9));
+        EXPECT_DOUBLE_EQ(all.standard_deviation("px"), row_table.standard_deviation("px"));
+        EXPECT_DOUBLE_EQ(all.squared_error("px"), row_table.squared_error("px"));
+        auto tail = source->view(CSVTable::Filter("id", CSVTable::CompareOp::Ge, 100));
+        EXPECT_DOUBLE_EQ(tail.mean("px"), tail.materialize().mean("px"));
+    }
+
+    // Two-column statistics skip rows where either cell is missing
+    for (const CSVTable *source : {&row_table, &columnar}) {
+        CSVTable paired = *source;
+        paired[3]["id"] = std::string("");
+        CSVTable complete = paired;
+        complete.dropna({"id", "px"});
+        ASSERT_EQ(complete.num_rows(), 149);
+        EXPECT_DOUBLE_EQ(paired.correlation("id", "px"), complete.correlation("id", "px"));
+        EXPECT_DOUBLE_EQ(paired.r_squared("id", "px"), complete.r_squared("id", "px"));
+        EXPECT_DOUBLE_EQ(paired.rmse("id", "px"), complete.rmse("id", "px"));
+        EXPECT_DOUBLE_EQ(paired.view().correlation("id", "px"), complete.correlation("id", "px"));
+        EXPECT_DOUBLE_EQ(paired.view().rmse("id", "px"), complete.rmse("id", "px"));
+        CSVTable sparse = paired.sub_table(std::vector<int>{0, 1, 3});
+        EXPECT_THROW(sparse.correlation("id", "px"), std::invalid_argument) << "Only row 1 has both values";
+        EXPECT_THROW(sparse.rmse("id", "px"), std::invalid_argument);
+    }
+
+    // Nulls round-trip through Parquet validity bitmaps
+    const std::string file = "nulls.parquet";
+    columnar.save_to_parquet(file);
+    CSVTable from_parquet;
+    from_parquet.set_storage_mode(CSVTable::StorageMode::Columnar);
+    from_parquet.read_parquet(file);
+    EXPECT_EQ(from_parquet.column_data("px").null_count(), 50u);
+    EXPECT_EQ(from_parquet.column_data("sym").null_count(), 40u);
+    EXPECT_EQ(rows_of(from_parquet), rows_of(columnar));
+    std::filesystem::remove(file);
+}
+
+TEST_F(CSVTableTest, ObserversReceiveEventsAndCanBeSilenced) {
+    struct Recorder : Observer {
+        bool timings = false;
+        std::vector<std::string> calls;
+        OperationEvent last;
+        std::vector<std::string> phases;
+        void on_start(const OperationEvent &e) override { calls.push_back("start " + std::string(e.operation)); }
+        void on_progress(const OperationEvent &e) override { calls.push_back("progress"); last = e; }
+        void on_end(const OperationEvent &e) override {
+            calls.push_back("end " + std::string(e.operation));
+            last = e;
+            phases.clear();
+            for (const auto &phase : e.phases)
+                phases.emplace_back(phase.name);
+        }
+        bool wants_phase_timings() const override { return timings; }
+    };
+
+    const std::string file = "observed.csv";
+    {
+        std::ofstream out(file);
+        out << "id,px\n";
+        for (int i = 0; i < 25000; ++i)
+            out << i << "," << i * 0.5 << "\n";
+    }
+    const size_t file_size = std::filesystem::file_size(file);
+
+    auto recorder = std::make_shared<Recorder>();
+    recorder->timings = true;
+    CSVTable table;
+    table.set_observer(recorder);
+    table.read_file(file);
+    ASSERT_GE(recorder->calls.size(), 4u);
+    EXPECT_EQ(recorder->calls.front(), "start read_file");
+    EXPECT_EQ(recorder->calls[1], "progress");
+    EXPECT_EQ(recorder->calls.back(), "end read_file");
+    EXPECT_EQ(recorder->last.rows, 25000u);
+    EXPECT_EQ(recorder->last.source, file);
+    EXPECT_GT(recorder->last.bytes, 0u);
+    EXPECT_LE(recorder->last.bytes, file_size);
+    EXPECT_EQ(recorder->phases, (std::vector<std::string>{"tokenize", "parse", "convert"}));
+
+    CSVTable parallel;
+    parallel.set_observer(recorder);
+    parallel.read_file(file, 2, 4096);
+    EXPECT_EQ(recorder->last.rows, 25000u);
+    EXPECT_EQ(std::ranges::count(recorder->phases, "tokenize") + std::ranges::count(recorder->phases, "parse") +
+                  std::ranges::count(recorder->phases, "convert"), 3);
+
+    // Filters report their matches only when asked for progress
+    recorder->calls.clear();
+    table.filter_table_fast([](int r, const CSVTable &t) { return t.get<int>(r, "id") % 5 == 0; });
+    EXPECT_TRUE(recorder->calls.empty());
+    table.filter_table_fast([](int r, const CSVTable &t) { return t.get<int>(r, "id") % 5 == 0; }, true);
+    EXPECT_EQ(recorder->calls.back(), "end filter_table_fast");
+    EXPECT_EQ(recorder->last.total_rows, 25000u);
+    EXPECT_EQ(recorder->last.matched, 5000u);
+
+    const std::string parquet = "observed.parquet";
+    table.save_to_parquet(parquet);
+    CSVTable from_parquet;
+    from_parquet.set_observer(recorder);
+    from_parquet.read_parquet(parquet);
+    EXPECT_EQ(recorder->calls.back(), "end read_parquet");
+    EXPECT_EQ(recorder->last.rows, 25000u);
+    EXPECT_EQ(recorder->last.bytes, std::filesystem::file_size(parquet));
+    EXPECT_EQ(recorder->phases, (std::vector<std::string>{"read", "convert"}));
+
+    // nullptr silences a table; the default observer covers tables without their own
+    recorder->calls.clear();
+    CSVTable silent;
+    silent.set_observer(nullptr);
+    silent.read_file(file);
+    EXPECT_EQ(silent.num_rows(), 25000);
+    EXPECT_TRUE(recorder->calls.empty());
+
+    auto previous = CSVTable::default_observer();
+    CSVTable::set_default_observer(recorder);
+    CSVTable defaulted;
+    defaulted.read_file(file);
+    CSVTable::set_default_observer(previous);
+    EXPECT_EQ(recorder->calls.back(), "end read_file");
+
+    std::ostringstream progress;
+    CSVTable printed;
+    printed.set_observer(std::make_shared<ProgressObserver>(progress));
+    printed.read_file(file);
+    EXPECT_NE(progress.str().find("Read CSV: 25000 rows total"), std::string::npos);
+
+    // The printed lines only cover rows that were read: nothing before a Parquet total is known, and
+    // nothing for a CSV file without data rows
+    std::ostringstream parquet_progress;
+    CSVTable printed_parquet;
+    printed_parquet.set_observer(std::make_shared<ProgressObserver>(parquet_progress));
+    printed_parquet.read_parquet(parquet);
+    EXPECT_EQ(parquet_progress.str().find("(0/0 rows"), std::string::npos) << parquet_progress.str();
+    EXPECT_NE(parquet_progress.str().find("100.0% (25000/25000 rows"), std::string::npos);
+    const std::string header_only = "observed_header_only.csv";
+    {
+        std::ofstream out(header_only);
+        out << "id,px\n";
+    }
+    std::ostringstream empty_progress;
+    CSVTable printed_empty;
+    printed_empty.set_observer(std::make_shared<ProgressObserver>(empty_progress));
+    printed_empty.read_file(header_only);
+    EXPECT_EQ(empty_progress.str(), "");
+    std::filesystem::remove(header_only);
+
+    // A read_file served from a snapshot reports its own start and end
+    table.save_snapshot(CSVTable::snapshot_path(file), file);
+    recorder->calls.clear();
+    CSVTable from_snapshot;
+    from_snapshot.set_observer(recorder);
+    from_snapshot.read_file(file);
+    EXPECT_EQ(recorder->calls.front(), "start read_file");
+    EXPECT_EQ(recorder->calls.back(), "end read_file");
+    EXPECT_EQ(recorder->last.rows, 25000u);
+    EXPECT_EQ(recorder->last.bytes, std::filesystem::file_size(CSVTable::snapshot_path(file)));
+    EXPECT_EQ(recorder->phases, (std::vector<std::string>{"snapshot"}));
+
+    std::filesystem::remove(file);
+    std::filesystem::remove(parquet);
+    std::filesystem::remove(CSVTable::snapshot_path(file));
+}
+
 } // namespace m2
 
 int main(int argc, char **argv) {
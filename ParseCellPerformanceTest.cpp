@@ -0,0 +1,98 @@
+#include "CSVTable.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+
+using namespace m2;
+
+// The previous stoi/stoull/stod implementation of parse_cell, kept for comparison
+static CSVTable::CellValue legacy_parse_cell(std::string_view str)
+{
+    if (str.empty() || str == "NA" || str == "NaN" || str == "#N/A")
+    {
+        return std::string("");
+    }
+    if (str == "true")
+        return true;
+    if (str == "false")
+        return false;
+    try
+    {
+        size_t pos;
+        int i = std::stoi(std::string(str), &pos);
+        if (pos != str.size())
+            throw std::invalid_argument("stoi did not consume entire string");
+        return i;
+    }
+    catch (...)
+    {
+    }
+    try
+    {
+        size_t pos;
+        uint64_t u = std::stoull(std::string(str), &pos);
+        if (pos == str.size())
+            return u;
+    }
+    catch (...)
+    {
+    }
+    try
+    {
+        size_t pos;
+        double d = std::stod(std::string(str), &pos);
+        if (pos == str.size())
+            return d;
+    }
+    catch (...)
+    {
+    }
+    return std::string(str);
+}
+
+template <typename Parser>
+static long long time_parser(const std::vector<std::string>& fields, Parser parse, size_t& checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& field : fields) {
+        checksum += parse(field).index();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+int main() {
+    std::cout << "=== CSVTable parse_cell Performance Test ===\n" << std::endl;
+
+    // Mixed-type column: ints, large ids, doubles, booleans, NA and plain strings
+    const size_t num_fields = 2000000;
+    std::vector<std::string> fields;
+    fields.reserve(num_fields);
+    for (size_t i = 0; i < num_fields; ++i) {
+        switch (i % 6) {
+        case 0: fields.push_back(std::to_string(i)); break;
+        case 1: fields.push_back(std::to_string(5000000000ULL + i)); break;
+        case 2: fields.push_back(std::to_string(i * 0.25)); break;
+        case 3: fields.push_back(i % 2 ? "true" : "false"); break;
+        case 4: fields.push_back("NA"); break;
+        default: fields.push_back("label" + std::to_string(i % 100)); break;
+        }
+    }
+    std::cout << "Parsing " << num_fields << " mixed-type fields\n" << std::endl;
+
+    size_t legacy_checksum = 0, fast_checksum = 0;
+    auto legacy_ms = time_parser(fields, legacy_parse_cell, legacy_checksum);
+    auto fast_ms = time_parser(fields, CSVTable::parse_cell, fast_checksum);
+
+    std::cout << "  stoi/stoull/stod parse_cell: " << legacy_ms << "ms ("
+              << std::fixed << std::setprecision(0) << (num_fields * 1000.0 / (legacy_ms + 1)) << " fields/sec)" << std::endl;
+    std::cout << "  from_chars parse_cell:       " << fast_ms << "ms ("
+              << (num_fields * 1000.0 / (fast_ms + 1)) << " fields/sec)" << std::endl;
+    std::cout << "  Speedup: " << std::setprecision(1) << (legacy_ms / (fast_ms + 0.001)) << "x" << std::endl;
+
+    if (legacy_checksum != fast_checksum) {
+        std::cerr << "Type inference differs between implementations" << std::endl;
+        return 1;
+    }
+    return 0;
+}